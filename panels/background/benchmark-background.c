@@ -0,0 +1,605 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Generates a synthetic photo library in a temporary directory, and
+ * measures how long the background sources take to go through it,
+ * how many pictures they decode on the way, and how much their
+ * resident memory grows:
+ *
+ *   ./benchmark-background --count=100
+ *   ./benchmark-background --count=1000
+ *   ./benchmark-background --count=10000
+ *
+ * The sources need a display, as they draw their thumbnails.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+
+#include "bg-pictures-source.h"
+#include "bg-wallpapers-source.h"
+#include "cc-background-xml.h"
+
+#define IDLE_TIMEOUT (30 * G_USEC_PER_SEC)
+#define RSS_SAMPLE_INTERVAL (10 * 1000)
+
+static gint count = 1000;
+static gint n_slideshows = 10;
+static gboolean keep = FALSE;
+
+static GOptionEntry entries[] =
+{
+  { "count", 'n', 0, G_OPTION_ARG_INT, &count, "Number of pictures to generate", "N" },
+  { "slideshows", 's', 0, G_OPTION_ARG_INT, &n_slideshows, "Number of slideshow XMLs to generate", "N" },
+  { "keep", 'k', 0, G_OPTION_ARG_NONE, &keep, "Do not remove the generated files", NULL },
+  { NULL }
+};
+
+static const struct {
+  gint width;
+  gint height;
+} sizes[] = {
+  { 320, 240 },
+  { 800, 600 },
+  { 1024, 768 },
+  { 640, 960 },
+  { 1920, 1080 },
+};
+
+typedef struct
+{
+  gint64 start;
+  gint64 first;
+  gint64 last;
+  guint n_done;
+  guint n_expected;
+  guint n_decodes;
+  glong rss_start;
+  glong rss_peak;
+  gint64 rss_sampled;
+} Progress;
+
+/* Resident memory of the process in KiB, or -1 if unknown */
+static glong
+get_rss (void)
+{
+  gchar *contents;
+  glong pages = -1;
+
+  if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+    return -1;
+
+  if (sscanf (contents, "%*s %ld", &pages) != 1)
+    pages = -1;
+  g_free (contents);
+
+  if (pages < 0)
+    return -1;
+
+  return pages * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+static void
+progress_sample_rss (Progress *progress)
+{
+  glong rss;
+
+  progress->rss_sampled = g_get_monotonic_time ();
+
+  rss = get_rss ();
+  if (rss > progress->rss_peak)
+    progress->rss_peak = rss;
+}
+
+static void
+progress_start (Progress *progress,
+                guint     n_expected)
+{
+  memset (progress, 0, sizeof (Progress));
+  progress->rss_start = get_rss ();
+  progress->rss_peak = progress->rss_start;
+  progress->start = g_get_monotonic_time ();
+  progress->rss_sampled = progress->start;
+  progress->n_expected = n_expected;
+}
+
+static void
+progress_step (Progress *progress)
+{
+  progress->last = g_get_monotonic_time ();
+  if (progress->n_done == 0)
+    progress->first = progress->last;
+  progress->n_done++;
+}
+
+/* Runs the main loop until everything is done, or nothing
+ * happened for a while */
+static void
+progress_wait (Progress *progress,
+               gboolean *finished)
+{
+  while (progress->n_done < progress->n_expected && (finished == NULL || !*finished))
+    {
+      gint64 last = progress->n_done > 0 ? progress->last : progress->start;
+
+      if (g_get_monotonic_time () - last > IDLE_TIMEOUT)
+        break;
+
+      if (g_get_monotonic_time () - progress->rss_sampled > RSS_SAMPLE_INTERVAL)
+        progress_sample_rss (progress);
+
+      if (!g_main_context_iteration (NULL, FALSE))
+        g_usleep (1000);
+    }
+
+  progress_sample_rss (progress);
+}
+
+static void
+progress_print_rss (Progress    *progress,
+                    const gchar *name)
+{
+  if (progress->rss_start < 0)
+    return;
+
+  g_print ("%s: RSS %ld KiB at start, %ld KiB at peak (+%ld KiB)\n",
+           name,
+           progress->rss_start,
+           progress->rss_peak,
+           progress->rss_peak - progress->rss_start);
+}
+
+static gdouble
+ms_since_start (Progress *progress,
+                gint64    t)
+{
+  if (t == 0)
+    return -1;
+
+  return (t - progress->start) / 1000.0;
+}
+
+static gboolean
+generate_picture (const gchar *dir,
+                  guint        i)
+{
+  GdkPixbuf *pixbuf;
+  GError *error = NULL;
+  const gchar *format;
+  gchar *filename;
+  gchar *path;
+  guchar *pixels;
+  gint width, height, rowstride;
+  gint x, y;
+  gboolean ret;
+
+  width = sizes[i % G_N_ELEMENTS (sizes)].width;
+  height = sizes[i % G_N_ELEMENTS (sizes)].height;
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+  pixels = gdk_pixbuf_get_pixels (pixbuf);
+  rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+  /* Every picture is different, so that none are collapsed as duplicates */
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        guchar *p = pixels + y * rowstride + x * 3;
+
+        p[0] = (x + i) & 0xff;
+        p[1] = (y + i * 7) & 0xff;
+        p[2] = (x ^ y ^ i) & 0xff;
+      }
+
+  format = (i % 3 == 0) ? "png" : "jpeg";
+  filename = g_strdup_printf ("picture-%05u.%s", i, format);
+  path = g_build_filename (dir, filename, NULL);
+
+  ret = gdk_pixbuf_save (pixbuf, path, format, &error, NULL);
+  if (!ret)
+    {
+      g_printerr ("Failed to save %s: %s\n", path, error->message);
+      g_error_free (error);
+    }
+
+  g_free (path);
+  g_free (filename);
+  g_object_unref (pixbuf);
+
+  return ret;
+}
+
+static gboolean
+generate_wallpapers (const gchar *data_dir,
+                     const gchar *pictures_dir)
+{
+  GString *list;
+  GError *error = NULL;
+  gchar *dir;
+  gchar *path;
+  gint i, j;
+  gboolean ret;
+
+  dir = g_build_filename (data_dir, "gnome-background-properties", NULL);
+  g_mkdir_with_parents (dir, 0700);
+
+  list = g_string_new ("<?xml version=\"1.0\"?>\n"
+                       "<!DOCTYPE wallpapers SYSTEM \"gnome-wp-list.dtd\">\n"
+                       "<wallpapers>\n");
+
+  for (i = 0; i < n_slideshows; i++)
+    {
+      GString *slideshow;
+      gchar *filename;
+      gint n_frames = MIN (count, 5);
+
+      slideshow = g_string_new ("<background>\n"
+                                "  <starttime><year>2011</year><month>11</month><day>24</day>"
+                                "<hour>7</hour><minute>0</minute><second>0</second></starttime>\n");
+      for (j = 0; j < n_frames; j++)
+        {
+          gchar *from, *to;
+
+          from = g_strdup_printf ("%s/picture-%05d.%s", pictures_dir,
+                                  (i + j) % count, ((i + j) % count) % 3 == 0 ? "png" : "jpeg");
+          to = g_strdup_printf ("%s/picture-%05d.%s", pictures_dir,
+                                (i + j + 1) % count, ((i + j + 1) % count) % 3 == 0 ? "png" : "jpeg");
+          g_string_append_printf (slideshow,
+                                  "  <static><duration>1795.0</duration><file>%s</file></static>\n"
+                                  "  <transition type=\"overlay\"><duration>5.0</duration><from>%s</from><to>%s</to></transition>\n",
+                                  from, from, to);
+          g_free (from);
+          g_free (to);
+        }
+      g_string_append (slideshow, "</background>\n");
+
+      filename = g_strdup_printf ("%s/slideshow-%03d.xml", dir, i);
+      if (!g_file_set_contents (filename, slideshow->str, -1, &error))
+        {
+          g_printerr ("Failed to save %s: %s\n", filename, error->message);
+          g_clear_error (&error);
+        }
+
+      g_string_append_printf (list,
+                              "  <wallpaper deleted=\"false\">\n"
+                              "    <name>Slideshow %d</name>\n"
+                              "    <filename>%s</filename>\n"
+                              "    <options>zoom</options>\n"
+                              "    <shade_type>solid</shade_type>\n"
+                              "    <pcolor>#000000</pcolor>\n"
+                              "    <scolor>#000000</scolor>\n"
+                              "  </wallpaper>\n",
+                              i, filename);
+
+      g_string_free (slideshow, TRUE);
+      g_free (filename);
+    }
+  g_string_append (list, "</wallpapers>\n");
+
+  path = g_build_filename (dir, "benchmark.xml", NULL);
+  ret = g_file_set_contents (path, list->str, -1, &error);
+  if (!ret)
+    {
+      g_printerr ("Failed to save %s: %s\n", path, error->message);
+      g_error_free (error);
+    }
+
+  g_string_free (list, TRUE);
+  g_free (path);
+  g_free (dir);
+
+  return ret;
+}
+
+typedef struct
+{
+  Progress progress;
+  cairo_surface_t *placeholder;
+  GHashTable *thumbnailed;
+} PicturesProgress;
+
+/* Every picture is inserted with the same placeholder, which
+ * gets replaced by its thumbnail once it is decoded */
+static void
+on_picture_inserted (GtkTreeModel     *model,
+                     GtkTreePath      *path,
+                     GtkTreeIter      *iter,
+                     PicturesProgress *pictures)
+{
+  cairo_surface_t *surface;
+
+  if (pictures->placeholder != NULL)
+    return;
+
+  gtk_tree_model_get (model, iter, 0, &surface, -1);
+  pictures->placeholder = surface;
+}
+
+static void
+on_picture_changed (GtkTreeModel     *model,
+                    GtkTreePath      *path,
+                    GtkTreeIter      *iter,
+                    PicturesProgress *pictures)
+{
+  CcBackgroundItem *item;
+  cairo_surface_t *surface;
+
+  gtk_tree_model_get (model, iter, 0, &surface, 1, &item, -1);
+
+  if (surface != NULL && surface != pictures->placeholder)
+    {
+      pictures->progress.n_decodes++;
+      if (item != NULL && g_hash_table_add (pictures->thumbnailed, g_object_ref (item)))
+        progress_step (&pictures->progress);
+    }
+
+  g_clear_pointer (&surface, cairo_surface_destroy);
+  g_clear_object (&item);
+}
+
+/* Screenshots and broken pictures go away once decoded */
+static void
+on_picture_deleted (GtkTreeModel     *model,
+                    GtkTreePath      *path,
+                    PicturesProgress *pictures)
+{
+  pictures->progress.n_decodes++;
+}
+
+static void
+benchmark_pictures_source (void)
+{
+  BgPicturesSource *source;
+  GtkListStore *store;
+  PicturesProgress pictures;
+  Progress *progress = &pictures.progress;
+
+  progress_start (progress, count);
+  pictures.placeholder = NULL;
+  pictures.thumbnailed = g_hash_table_new_full (NULL, NULL, g_object_unref, NULL);
+
+  source = bg_pictures_source_new (NULL);
+  store = bg_source_get_liststore (BG_SOURCE (source));
+  g_signal_connect (store, "row-inserted", G_CALLBACK (on_picture_inserted), &pictures);
+  g_signal_connect (store, "row-changed", G_CALLBACK (on_picture_changed), &pictures);
+  g_signal_connect (store, "row-deleted", G_CALLBACK (on_picture_deleted), &pictures);
+
+  /* Pretend every row is on screen, so that all get thumbnailed */
+  bg_source_set_visible_range (BG_SOURCE (source), 0, count);
+
+  progress_wait (progress, NULL);
+
+  g_print ("BgPicturesSource: %u/%u thumbnails, %u decodes, first after %.1f ms, all after %.1f ms\n",
+           progress->n_done, progress->n_expected, progress->n_decodes,
+           ms_since_start (progress, progress->first),
+           ms_since_start (progress, progress->n_done >= progress->n_expected ? progress->last : 0));
+  progress_print_rss (progress, "BgPicturesSource");
+
+  g_signal_handlers_disconnect_by_data (store, &pictures);
+  g_object_unref (source);
+  g_clear_pointer (&pictures.placeholder, cairo_surface_destroy);
+  g_hash_table_destroy (pictures.thumbnailed);
+}
+
+static void
+on_xml_added (CcBackgroundXml  *xml,
+              CcBackgroundItem *item,
+              Progress         *progress)
+{
+  progress_step (progress);
+}
+
+static void
+on_xml_loaded (GObject      *source_object,
+               GAsyncResult *res,
+               gpointer      user_data)
+{
+  gboolean *finished = user_data;
+
+  cc_background_xml_load_list_finish (res);
+  *finished = TRUE;
+}
+
+static guint
+benchmark_xml (void)
+{
+  CcBackgroundXml *xml;
+  Progress progress;
+  gboolean finished = FALSE;
+
+  progress_start (&progress, G_MAXUINT);
+
+  xml = cc_background_xml_new ();
+  g_signal_connect (xml, "added", G_CALLBACK (on_xml_added), &progress);
+  cc_background_xml_load_list_async (xml, NULL, on_xml_loaded, &finished);
+
+  progress_wait (&progress, &finished);
+
+  /* Let the pending "added" emissions through */
+  while (g_main_context_iteration (NULL, FALSE));
+
+  /* Parsing the lists doesn't decode anything */
+  g_print ("CcBackgroundXml: %u wallpapers, %u decodes, first after %.1f ms, all after %.1f ms\n",
+           progress.n_done, progress.n_decodes,
+           ms_since_start (&progress, progress.first),
+           ms_since_start (&progress, progress.last));
+  progress_print_rss (&progress, "CcBackgroundXml");
+
+  g_object_unref (xml);
+
+  return progress.n_done;
+}
+
+/* Wallpapers are only inserted with their thumbnail drawn */
+static void
+on_wallpaper_inserted (GtkTreeModel *model,
+                       GtkTreePath  *path,
+                       GtkTreeIter  *iter,
+                       Progress     *progress)
+{
+  progress->n_decodes++;
+  progress_step (progress);
+}
+
+static void
+benchmark_wallpapers_source (guint n_wallpapers)
+{
+  BgWallpapersSource *source;
+  GtkListStore *store;
+  Progress progress;
+
+  progress_start (&progress, n_wallpapers);
+
+  source = bg_wallpapers_source_new (NULL);
+  store = bg_source_get_liststore (BG_SOURCE (source));
+  g_signal_connect (store, "row-inserted", G_CALLBACK (on_wallpaper_inserted), &progress);
+
+  progress_wait (&progress, NULL);
+
+  g_print ("BgWallpapersSource: %u/%u thumbnails, %u decodes, first after %.1f ms, all after %.1f ms\n",
+           progress.n_done, progress.n_expected, progress.n_decodes,
+           ms_since_start (&progress, progress.first),
+           ms_since_start (&progress, progress.n_done >= progress.n_expected ? progress.last : 0));
+  progress_print_rss (&progress, "BgWallpapersSource");
+
+  g_signal_handlers_disconnect_by_data (store, &progress);
+  g_object_unref (source);
+}
+
+static void
+remove_tree (const gchar *path)
+{
+  GDir *dir;
+  const gchar *name;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir != NULL)
+    {
+      while ((name = g_dir_read_name (dir)) != NULL)
+        {
+          gchar *child;
+
+          child = g_build_filename (path, name, NULL);
+          remove_tree (child);
+          g_free (child);
+        }
+      g_dir_close (dir);
+    }
+
+  g_remove (path);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gchar *tmp_dir;
+  gchar *pictures_dir;
+  gchar *config_dir;
+  gchar *data_dir;
+  gchar *cache_dir;
+  gchar *user_dirs;
+  gchar *user_dirs_path;
+  gint64 start;
+  guint n_wallpapers;
+  gint i;
+
+  context = g_option_context_new ("- benchmark the background panel sources");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (FALSE));
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (count <= 0)
+    {
+      g_printerr ("The number of pictures needs to be positive\n");
+      return 1;
+    }
+
+  /* Point the XDG directories at the synthetic library before
+   * anything has a chance to look them up */
+  tmp_dir = g_dir_make_tmp ("benchmark-background-XXXXXX", &error);
+  if (tmp_dir == NULL)
+    {
+      g_printerr ("Failed to create temporary directory: %s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+
+  pictures_dir = g_build_filename (tmp_dir, "Pictures", NULL);
+  config_dir = g_build_filename (tmp_dir, "config", NULL);
+  data_dir = g_build_filename (tmp_dir, "data", NULL);
+  cache_dir = g_build_filename (tmp_dir, "cache", NULL);
+  g_mkdir_with_parents (pictures_dir, 0700);
+  g_mkdir_with_parents (config_dir, 0700);
+
+  user_dirs = g_strdup_printf ("XDG_PICTURES_DIR=\"%s\"\n", pictures_dir);
+  user_dirs_path = g_build_filename (config_dir, "user-dirs.dirs", NULL);
+  g_file_set_contents (user_dirs_path, user_dirs, -1, NULL);
+
+  g_setenv ("XDG_CONFIG_HOME", config_dir, TRUE);
+  g_setenv ("XDG_DATA_HOME", data_dir, TRUE);
+  g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+
+  if (!gtk_init_check (NULL, NULL))
+    {
+      g_printerr ("Cannot open a display, the sources need one to draw thumbnails\n");
+      remove_tree (tmp_dir);
+      return 1;
+    }
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < count; i++)
+    {
+      if (!generate_picture (pictures_dir, i))
+        return 1;
+    }
+  if (!generate_wallpapers (data_dir, pictures_dir))
+    return 1;
+  g_print ("Generated %d pictures and %d slideshows in %s (%.1f s)\n",
+           count, n_slideshows, tmp_dir,
+           (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC);
+
+  benchmark_pictures_source ();
+  n_wallpapers = benchmark_xml ();
+  benchmark_wallpapers_source (n_wallpapers);
+
+  if (!keep)
+    remove_tree (tmp_dir);
+
+  g_free (user_dirs_path);
+  g_free (user_dirs);
+  g_free (cache_dir);
+  g_free (data_dir);
+  g_free (config_dir);
+  g_free (pictures_dir);
+  g_free (tmp_dir);
+
+  return 0;
+}
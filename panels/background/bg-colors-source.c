@@ -23,6 +23,7 @@
 #include "bg-colors-source.h"
 
 #include "cc-background-item.h"
+#include "cc-background-shading.h"
 
 #include <cairo-gobject.h>
 #include <glib/gi18n-lib.h>
@@ -75,7 +76,7 @@ bg_colors_source_add_color (BgColorsSource               *self,
 {
   CcBackgroundItemFlags flags;
   CcBackgroundItem *item;
-  GdkPixbuf *pixbuf;
+  GdkPixbuf *pixbuf = NULL;
   cairo_surface_t *surface;
   int scale_factor;
   int thumbnail_height, thumbnail_width;
@@ -104,11 +105,20 @@ bg_colors_source_add_color (BgColorsSource               *self,
 
   /* insert the item into the liststore */
   scale_factor = bg_source_get_scale_factor (BG_SOURCE (self));
-  pixbuf = cc_background_item_get_thumbnail (item,
-                                             thumb_factory,
-                                             thumbnail_width, thumbnail_height,
-                                             scale_factor);
-  surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale_factor, NULL);
+  if (cc_background_shading_can_render (item))
+    {
+      surface = cc_background_shading_render (item,
+                                              thumbnail_width, thumbnail_height,
+                                              scale_factor);
+    }
+  else
+    {
+      pixbuf = cc_background_item_get_thumbnail (item,
+                                                 thumb_factory,
+                                                 thumbnail_width, thumbnail_height,
+                                                 scale_factor);
+      surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale_factor, NULL);
+    }
   gtk_list_store_insert_with_values (store, &iter, 0,
                                      0, surface,
                                      1, item,
@@ -124,7 +134,7 @@ bg_colors_source_add_color (BgColorsSource               *self,
     }
 
   cairo_surface_destroy (surface);
-  g_object_unref (pixbuf);
+  g_clear_object (&pixbuf);
   g_object_unref (item);
 }
 
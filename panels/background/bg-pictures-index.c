@@ -0,0 +1,372 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include "bg-pictures-index.h"
+
+/* The index is a key file with one group per picture, named after
+ * the SHA-256 of its URI, as URIs are not valid group names:
+ *
+ * [<sha256 of uri>]
+ * uri=file:///home/user/Pictures/foo.jpg
+ * size=123456
+ * mtime=1450000000
+ * hash=<sha1 of the contents>
+ * thumbnail=<thumbnail key>
+ */
+
+#define INDEX_VERSION 1
+#define HASH_BUFFER_SIZE 65536
+
+struct _BgPicturesIndex
+{
+  gchar      *path;
+  GHashTable *entries;  /* uri → BgPicturesIndexEntry */
+  GHashTable *by_hash;  /* hash → GList of BgPicturesIndexEntry */
+  gboolean    dirty;
+};
+
+static void
+entry_free (BgPicturesIndexEntry *entry)
+{
+  g_free (entry->uri);
+  g_free (entry->hash);
+  g_free (entry->thumbnail);
+  g_slice_free (BgPicturesIndexEntry, entry);
+}
+
+static gboolean
+remove_entry (BgPicturesIndex *index,
+              const gchar     *uri)
+{
+  BgPicturesIndexEntry *entry;
+  GList *entries;
+
+  entry = g_hash_table_lookup (index->entries, uri);
+  if (entry == NULL)
+    return FALSE;
+
+  entries = g_hash_table_lookup (index->by_hash, entry->hash);
+  entries = g_list_remove (entries, entry);
+  if (entries != NULL)
+    g_hash_table_replace (index->by_hash, g_strdup (entry->hash), entries);
+  else
+    g_hash_table_remove (index->by_hash, entry->hash);
+
+  g_hash_table_remove (index->entries, uri);
+
+  return TRUE;
+}
+
+static void
+add_entry (BgPicturesIndex      *index,
+           BgPicturesIndexEntry *entry)
+{
+  GList *entries;
+
+  remove_entry (index, entry->uri);
+
+  entries = g_hash_table_lookup (index->by_hash, entry->hash);
+  g_hash_table_replace (index->by_hash,
+                        g_strdup (entry->hash),
+                        g_list_prepend (entries, entry));
+  g_hash_table_insert (index->entries, entry->uri, entry);
+}
+
+/* Local pictures deleted while nothing was watching */
+static gboolean
+entry_is_gone (const gchar *uri)
+{
+  gchar *path;
+  gboolean ret;
+
+  path = g_filename_from_uri (uri, NULL, NULL);
+  if (path == NULL)
+    return FALSE;
+
+  ret = !g_file_test (path, G_FILE_TEST_EXISTS);
+  g_free (path);
+
+  return ret;
+}
+
+static gchar *
+get_group_name (const gchar *uri)
+{
+  return g_compute_checksum_for_string (G_CHECKSUM_SHA256, uri, -1);
+}
+
+static void
+load_index (BgPicturesIndex *index)
+{
+  GKeyFile *keyfile;
+  gchar **groups;
+  guint i;
+
+  keyfile = g_key_file_new ();
+  if (!g_key_file_load_from_file (keyfile, index->path, G_KEY_FILE_NONE, NULL))
+    goto out;
+
+  if (g_key_file_get_integer (keyfile, "Index", "version", NULL) != INDEX_VERSION)
+    goto out;
+
+  groups = g_key_file_get_groups (keyfile, NULL);
+  for (i = 0; groups[i] != NULL; i++)
+    {
+      BgPicturesIndexEntry *entry;
+      gchar *uri;
+      gchar *hash;
+
+      uri = g_key_file_get_string (keyfile, groups[i], "uri", NULL);
+      hash = g_key_file_get_string (keyfile, groups[i], "hash", NULL);
+      if (uri == NULL || hash == NULL || entry_is_gone (uri))
+        {
+          /* Written back without it on the next save */
+          index->dirty = TRUE;
+          g_free (uri);
+          g_free (hash);
+          continue;
+        }
+
+      entry = g_slice_new0 (BgPicturesIndexEntry);
+      entry->uri = uri;
+      entry->hash = hash;
+      entry->size = g_key_file_get_uint64 (keyfile, groups[i], "size", NULL);
+      entry->mtime = g_key_file_get_uint64 (keyfile, groups[i], "mtime", NULL);
+      entry->thumbnail = g_key_file_get_string (keyfile, groups[i], "thumbnail", NULL);
+
+      add_entry (index, entry);
+    }
+  g_strfreev (groups);
+
+ out:
+  g_key_file_unref (keyfile);
+}
+
+BgPicturesIndex *
+bg_pictures_index_new (const gchar *path)
+{
+  BgPicturesIndex *index;
+
+  g_return_val_if_fail (path != NULL, NULL);
+
+  index = g_new0 (BgPicturesIndex, 1);
+  index->path = g_strdup (path);
+  index->entries = g_hash_table_new_full (g_str_hash,
+                                          g_str_equal,
+                                          NULL,
+                                          (GDestroyNotify) entry_free);
+  index->by_hash = g_hash_table_new_full (g_str_hash,
+                                          g_str_equal,
+                                          g_free,
+                                          NULL);
+  load_index (index);
+
+  return index;
+}
+
+void
+bg_pictures_index_free (BgPicturesIndex *index)
+{
+  GHashTableIter iter;
+  GList *entries;
+
+  if (index == NULL)
+    return;
+
+  g_hash_table_iter_init (&iter, index->by_hash);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entries))
+    g_list_free (entries);
+  g_hash_table_destroy (index->by_hash);
+  g_hash_table_destroy (index->entries);
+  g_free (index->path);
+  g_free (index);
+}
+
+/* Returns the entry for @uri only if it is still up to date
+ * with the given size and modification time */
+const BgPicturesIndexEntry *
+bg_pictures_index_lookup (BgPicturesIndex *index,
+                          const gchar     *uri,
+                          guint64          size,
+                          guint64          mtime)
+{
+  BgPicturesIndexEntry *entry;
+
+  entry = g_hash_table_lookup (index->entries, uri);
+  if (entry == NULL || entry->size != size || entry->mtime != mtime)
+    return NULL;
+
+  return entry;
+}
+
+void
+bg_pictures_index_update (BgPicturesIndex *index,
+                          const gchar     *uri,
+                          guint64          size,
+                          guint64          mtime,
+                          const gchar     *hash,
+                          const gchar     *thumbnail)
+{
+  BgPicturesIndexEntry *entry;
+
+  entry = g_slice_new0 (BgPicturesIndexEntry);
+  entry->uri = g_strdup (uri);
+  entry->size = size;
+  entry->mtime = mtime;
+  entry->hash = g_strdup (hash);
+  entry->thumbnail = g_strdup (thumbnail);
+
+  add_entry (index, entry);
+  index->dirty = TRUE;
+}
+
+void
+bg_pictures_index_remove (BgPicturesIndex *index,
+                          const gchar     *uri)
+{
+  if (remove_entry (index, uri))
+    index->dirty = TRUE;
+}
+
+/* Returns the URIs of all the indexed pictures with the given contents.
+ * The list needs to be freed with g_list_free(), the URIs belong to
+ * the index. */
+GList *
+bg_pictures_index_find_by_hash (BgPicturesIndex *index,
+                                const gchar     *hash)
+{
+  GList *entries, *l;
+  GList *uris = NULL;
+
+  entries = g_hash_table_lookup (index->by_hash, hash);
+  for (l = entries; l != NULL; l = l->next)
+    {
+      BgPicturesIndexEntry *entry = l->data;
+
+      uris = g_list_prepend (uris, entry->uri);
+    }
+
+  return uris;
+}
+
+gboolean
+bg_pictures_index_save (BgPicturesIndex  *index,
+                        GError          **error)
+{
+  GHashTableIter iter;
+  BgPicturesIndexEntry *entry;
+  GKeyFile *keyfile;
+  gchar *dir;
+  gboolean ret;
+
+  if (!index->dirty)
+    return TRUE;
+
+  keyfile = g_key_file_new ();
+  g_key_file_set_integer (keyfile, "Index", "version", INDEX_VERSION);
+
+  g_hash_table_iter_init (&iter, index->entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+      gchar *group;
+
+      group = get_group_name (entry->uri);
+      g_key_file_set_string (keyfile, group, "uri", entry->uri);
+      g_key_file_set_uint64 (keyfile, group, "size", entry->size);
+      g_key_file_set_uint64 (keyfile, group, "mtime", entry->mtime);
+      g_key_file_set_string (keyfile, group, "hash", entry->hash);
+      if (entry->thumbnail != NULL)
+        g_key_file_set_string (keyfile, group, "thumbnail", entry->thumbnail);
+      g_free (group);
+    }
+
+  dir = g_path_get_dirname (index->path);
+  g_mkdir_with_parents (dir, USER_DIR_MODE);
+  g_free (dir);
+
+  ret = g_key_file_save_to_file (keyfile, index->path, error);
+  if (ret)
+    index->dirty = FALSE;
+
+  g_key_file_unref (keyfile);
+
+  return ret;
+}
+
+static void
+hash_file_thread (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+  GFileInputStream *stream;
+  GChecksum *checksum;
+  GError *error = NULL;
+  guchar *buffer;
+  gssize len;
+
+  stream = g_file_read (G_FILE (source_object), cancellable, &error);
+  if (stream == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+  buffer = g_malloc (HASH_BUFFER_SIZE);
+
+  while ((len = g_input_stream_read (G_INPUT_STREAM (stream),
+                                     buffer, HASH_BUFFER_SIZE,
+                                     cancellable, &error)) > 0)
+    g_checksum_update (checksum, buffer, len);
+
+  if (len < 0)
+    g_task_return_error (task, error);
+  else
+    g_task_return_pointer (task, g_strdup (g_checksum_get_string (checksum)), g_free);
+
+  g_free (buffer);
+  g_checksum_free (checksum);
+  g_object_unref (stream);
+}
+
+void
+bg_pictures_index_hash_file_async (GFile               *file,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+  GTask *task;
+
+  task = g_task_new (G_OBJECT (file), cancellable, callback, user_data);
+  g_task_set_priority (task, G_PRIORITY_LOW);
+  g_task_run_in_thread (task, hash_file_thread);
+  g_object_unref (task);
+}
+
+gchar *
+bg_pictures_index_hash_file_finish (GFile         *file,
+                                    GAsyncResult  *res,
+                                    GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, file), NULL);
+
+  return g_task_propagate_pointer (G_TASK (res), error);
+}
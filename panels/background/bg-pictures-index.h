@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _BG_PICTURES_INDEX_H
+#define _BG_PICTURES_INDEX_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _BgPicturesIndex BgPicturesIndex;
+
+typedef struct
+{
+  gchar   *uri;
+  guint64  size;
+  guint64  mtime;
+  gchar   *hash;
+  gchar   *thumbnail;
+} BgPicturesIndexEntry;
+
+BgPicturesIndex            *bg_pictures_index_new          (const gchar     *path);
+void                        bg_pictures_index_free         (BgPicturesIndex *index);
+
+const BgPicturesIndexEntry *bg_pictures_index_lookup       (BgPicturesIndex *index,
+                                                            const gchar     *uri,
+                                                            guint64          size,
+                                                            guint64          mtime);
+void                        bg_pictures_index_update       (BgPicturesIndex *index,
+                                                            const gchar     *uri,
+                                                            guint64          size,
+                                                            guint64          mtime,
+                                                            const gchar     *hash,
+                                                            const gchar     *thumbnail);
+void                        bg_pictures_index_remove       (BgPicturesIndex *index,
+                                                            const gchar     *uri);
+GList                      *bg_pictures_index_find_by_hash (BgPicturesIndex *index,
+                                                            const gchar     *hash);
+gboolean                    bg_pictures_index_save         (BgPicturesIndex *index,
+                                                            GError         **error);
+
+void                        bg_pictures_index_hash_file_async  (GFile               *file,
+                                                                GCancellable        *cancellable,
+                                                                GAsyncReadyCallback  callback,
+                                                                gpointer             user_data);
+gchar                      *bg_pictures_index_hash_file_finish (GFile               *file,
+                                                                GAsyncResult        *res,
+                                                                GError             **error);
+
+G_END_DECLS
+
+#endif /* _BG_PICTURES_INDEX_H */
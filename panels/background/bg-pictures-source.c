@@ -23,6 +23,7 @@
 
 #include "bg-pictures-source.h"
 
+#include "bg-pictures-index.h"
 #include "cc-background-grilo-miner.h"
 #include "cc-background-item.h"
 
@@ -40,8 +41,23 @@ G_DEFINE_TYPE (BgPicturesSource, bg_pictures_source, BG_TYPE_SOURCE)
 
 #define ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_NAME "," \
 	G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
         G_FILE_ATTRIBUTE_TIME_MODIFIED
 
+/* Delay, in seconds, before changes to the index get written out */
+#define INDEX_SAVE_TIMEOUT 5
+
+/* Thumbnails of rows further than this from the visible range are
+ * dropped, and replaced by the placeholder again */
+#define THUMBNAIL_KEEP_MARGIN 48
+
+enum
+{
+  THUMBNAIL_NONE,
+  THUMBNAIL_LOADING,
+  THUMBNAIL_LOADED
+};
+
 struct _BgPicturesSourcePrivate
 {
   GCancellable *cancellable;
@@ -54,6 +70,16 @@ struct _BgPicturesSourcePrivate
   GFileMonitor *cache_dir_monitor;
 
   GHashTable *known_items;
+
+  BgPicturesIndex *index;
+  guint save_index_id;
+
+  /* content hash → URI of the picture shown for those contents */
+  GHashTable *shown_hashes;
+
+  /* items currently holding a real thumbnail in the store */
+  GHashTable *loaded_items;
+  cairo_surface_t *placeholder;
 };
 
 const char * const content_types[] = {
@@ -66,12 +92,10 @@ const char * const content_types[] = {
 	NULL
 };
 
-const char * const screenshot_types[] = {
-	"image/png",
-	NULL
-};
-
 static char *bg_pictures_source_get_unique_filename (const char *uri);
+static void bg_pictures_source_visible_range_changed (BgSource *source);
+static void file_info_ready (GObject *object, GAsyncResult *res, gpointer user_data);
+static void hash_picture (BgPicturesSource *bg_source, CcBackgroundItem *item);
 
 static void
 bg_pictures_source_dispose (GObject *object)
@@ -84,6 +108,15 @@ bg_pictures_source_dispose (GObject *object)
       g_clear_object (&priv->cancellable);
     }
 
+  if (priv->save_index_id != 0)
+    {
+      g_source_remove (priv->save_index_id);
+      priv->save_index_id = 0;
+    }
+
+  if (priv->index != NULL)
+    bg_pictures_index_save (priv->index, NULL);
+
   g_clear_object (&priv->grl_miner);
   g_clear_object (&priv->thumb_factory);
 
@@ -98,6 +131,10 @@ bg_pictures_source_finalize (GObject *object)
   g_clear_object (&bg_source->priv->thumb_factory);
 
   g_clear_pointer (&bg_source->priv->known_items, g_hash_table_destroy);
+  g_clear_pointer (&bg_source->priv->loaded_items, g_hash_table_destroy);
+  g_clear_pointer (&bg_source->priv->shown_hashes, g_hash_table_destroy);
+  g_clear_pointer (&bg_source->priv->index, bg_pictures_index_free);
+  g_clear_pointer (&bg_source->priv->placeholder, (GDestroyNotify) cairo_surface_destroy);
 
   g_clear_object (&bg_source->priv->picture_dir_monitor);
   g_clear_object (&bg_source->priv->cache_dir_monitor);
@@ -109,11 +146,49 @@ static void
 bg_pictures_source_class_init (BgPicturesSourceClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  BgSourceClass *source_class = BG_SOURCE_CLASS (klass);
 
   g_type_class_add_private (klass, sizeof (BgPicturesSourcePrivate));
 
   object_class->dispose = bg_pictures_source_dispose;
   object_class->finalize = bg_pictures_source_finalize;
+
+  source_class->visible_range_changed = bg_pictures_source_visible_range_changed;
+}
+
+static void
+set_thumbnail_state (CcBackgroundItem *item,
+                     gint              state)
+{
+  g_object_set_data (G_OBJECT (item), "thumbnail-state", GINT_TO_POINTER (state));
+}
+
+static gint
+get_thumbnail_state (CcBackgroundItem *item)
+{
+  return GPOINTER_TO_INT (g_object_get_data (G_OBJECT (item), "thumbnail-state"));
+}
+
+static gint
+get_item_row (BgPicturesSource *bg_source,
+              CcBackgroundItem *item)
+{
+  GtkTreeRowReference *row_ref;
+  GtkTreePath *path;
+  gint row = -1;
+
+  row_ref = g_object_get_data (G_OBJECT (item), "row-ref");
+  if (row_ref == NULL)
+    return -1;
+
+  path = gtk_tree_row_reference_get_path (row_ref);
+  if (path == NULL)
+    return -1;
+
+  row = gtk_tree_path_get_indices (path)[0];
+  gtk_tree_path_free (path);
+
+  return row;
 }
 
 static void
@@ -130,10 +205,10 @@ remove_placeholder (BgPicturesSource *bg_source, CcBackgroundItem *item)
     return;
 
   path = gtk_tree_row_reference_get_path (row_ref);
-  if (!gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path))
-    return;
+  if (path != NULL && gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path))
+    gtk_list_store_remove (store, &iter);
 
-  gtk_list_store_remove (store, &iter);
+  gtk_tree_path_free (path);
 }
 
 static void
@@ -151,6 +226,7 @@ picture_scaled (GObject *source_object,
   GtkTreePath *path;
   GtkTreeRowReference *row_ref;
   GtkListStore *store;
+  GFile *native_file;
   cairo_surface_t *surface = NULL;
   int scale_factor;
 
@@ -173,6 +249,11 @@ picture_scaled (GObject *source_object,
    */
   bg_source = BG_PICTURES_SOURCE (user_data);
   store = bg_source_get_liststore (BG_SOURCE (bg_source));
+
+  /* The same picture is already shown under another name */
+  if (g_object_get_data (G_OBJECT (item), "is-duplicate") != NULL)
+    goto out;
+
   uri = cc_background_item_get_uri (item);
   if (uri == NULL)
     uri = cc_background_item_get_source_url (item);
@@ -187,18 +268,55 @@ picture_scaled (GObject *source_object,
       goto out;
     }
 
+  native_file = g_object_get_data (G_OBJECT (item), "native-file");
+  if (native_file != NULL)
+    {
+      char *native_path;
+      char *native_dir;
+      char *mtime;
+
+      native_path = g_file_get_path (native_file);
+      native_dir = g_path_get_dirname (native_path);
+      g_mkdir_with_parents (native_dir, USER_DIR_MODE);
+
+      /* The keys the thumbnail specification requires, so that other
+       * users of the cache can tell which picture it is of */
+      mtime = g_strdup_printf ("%" G_GUINT64_FORMAT, cc_background_item_get_modified (item));
+      if (!gdk_pixbuf_save (pixbuf, native_path, "png", &error,
+                            "tEXt::Thumb::URI", cc_background_item_get_source_url (item),
+                            "tEXt::Thumb::MTime", mtime,
+                            NULL))
+        {
+          g_warning ("Failed to save thumbnail '%s': %s", native_path, error->message);
+          g_clear_error (&error);
+        }
+
+      g_object_set_data (G_OBJECT (item), "native-file", NULL);
+      g_free (mtime);
+      g_free (native_dir);
+      g_free (native_path);
+    }
+
   scale_factor = bg_source_get_scale_factor (BG_SOURCE (bg_source));
   surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale_factor, NULL);
   cc_background_item_load (item, NULL);
 
+  set_thumbnail_state (item, THUMBNAIL_LOADED);
+  g_hash_table_add (bg_source->priv->loaded_items, g_object_ref (item));
+
   row_ref = g_object_get_data (G_OBJECT (item), "row-ref");
   if (row_ref == NULL)
     {
       /* insert the item into the liststore if it did not exist */
-      gtk_list_store_insert_with_values (store, NULL, -1,
+      gtk_list_store_insert_with_values (store, &iter, -1,
                                          0, surface,
                                          1, item,
                                          -1);
+
+      path = gtk_tree_model_get_path (GTK_TREE_MODEL (store), &iter);
+      row_ref = gtk_tree_row_reference_new (GTK_TREE_MODEL (store), path);
+      g_object_set_data_full (G_OBJECT (item), "row-ref", row_ref, (GDestroyNotify) gtk_tree_row_reference_free);
+      gtk_tree_path_free (path);
     }
   else
     {
@@ -210,6 +328,7 @@ picture_scaled (GObject *source_object,
                               0, surface,
                               -1);
         }
+      gtk_tree_path_free (path);
     }
 
   g_hash_table_insert (bg_source->priv->known_items,
@@ -234,7 +353,9 @@ picture_opened_for_read (GObject *source_object,
   gint thumbnail_height;
   gint thumbnail_width;
 
-  item = g_object_get_data (source_object, "item");
+  /* The item holds on to its file, so the file mustn't hold on to
+   * the item any longer than it takes to open it */
+  item = g_object_steal_data (source_object, "item");
   stream = g_file_read_finish (G_FILE (source_object), res, &error);
   if (stream == NULL)
     {
@@ -247,6 +368,7 @@ picture_opened_for_read (GObject *source_object,
         }
 
       g_error_free (error);
+      g_object_unref (item);
       return;
     }
 
@@ -257,7 +379,7 @@ picture_opened_for_read (GObject *source_object,
 
   thumbnail_height = bg_source_get_thumbnail_height (BG_SOURCE (bg_source));
   thumbnail_width = bg_source_get_thumbnail_width (BG_SOURCE (bg_source));
-  g_object_set_data_full (G_OBJECT (stream), "item", g_object_ref (item), g_object_unref);
+  g_object_set_data_full (G_OBJECT (stream), "item", item, g_object_unref);
   gdk_pixbuf_new_from_stream_at_scale_async (G_INPUT_STREAM (stream),
                                              thumbnail_width, thumbnail_height,
                                              TRUE,
@@ -266,47 +388,6 @@ picture_opened_for_read (GObject *source_object,
   g_object_unref (stream);
 }
 
-static void
-picture_copied_for_read (GObject *source_object,
-                         GAsyncResult *res,
-                         gpointer user_data)
-{
-  BgPicturesSource *bg_source;
-  CcBackgroundItem *item;
-  GError *error = NULL;
-  GFile *thumbnail_file = G_FILE (source_object);
-  GFile *native_file;
-
-  if (!g_file_copy_finish (thumbnail_file, res, &error))
-    {
-      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        goto out;
-      else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_EXISTS))
-        {
-          gchar *uri;
-
-          uri = g_file_get_uri (thumbnail_file);
-          g_warning ("Failed to download '%s': %s", uri, error->message);
-          g_free (uri);
-          goto out;
-        }
-    }
-
-  bg_source = BG_PICTURES_SOURCE (user_data);
-
-  native_file = g_object_get_data (G_OBJECT (thumbnail_file), "native-file");
-  item = g_object_get_data (G_OBJECT (thumbnail_file), "item");
-  g_object_set_data_full (G_OBJECT (native_file), "item", g_object_ref (item), g_object_unref);
-  g_file_read_async (native_file,
-                     G_PRIORITY_DEFAULT,
-                     bg_source->priv->cancellable,
-                     picture_opened_for_read,
-                     bg_source);
-
- out:
-  g_clear_error (&error);
-}
-
 static gboolean
 in_content_types (const char *content_type)
 {
@@ -317,16 +398,6 @@ in_content_types (const char *content_type)
 	return FALSE;
 }
 
-static gboolean
-in_screenshot_types (const char *content_type)
-{
-	guint i;
-	for (i = 0; screenshot_types[i]; i++)
-		if (g_str_equal (screenshot_types[i], content_type))
-			return TRUE;
-	return FALSE;
-}
-
 static cairo_surface_t *
 get_content_loading_icon (BgSource *source)
 {
@@ -382,6 +453,154 @@ get_content_loading_icon (BgSource *source)
   return surface;
 }
 
+static cairo_surface_t *
+get_placeholder (BgPicturesSource *bg_source)
+{
+  BgPicturesSourcePrivate *priv = bg_source->priv;
+
+  if (priv->placeholder == NULL)
+    priv->placeholder = get_content_loading_icon (BG_SOURCE (bg_source));
+
+  return priv->placeholder;
+}
+
+static void
+load_thumbnail (BgPicturesSource *bg_source,
+                CcBackgroundItem *item)
+{
+  GFile *file;
+  GrlMedia *media;
+  const char *source_uri;
+
+  if (get_thumbnail_state (item) != THUMBNAIL_NONE)
+    return;
+
+  file = g_object_get_data (G_OBJECT (item), "file");
+  if (file == NULL)
+    return;
+
+  hash_picture (bg_source, item);
+
+  set_thumbnail_state (item, THUMBNAIL_LOADING);
+
+  media = g_object_get_data (G_OBJECT (file), "grl-media");
+  if (media == NULL)
+    {
+      g_object_set_data_full (G_OBJECT (file), "item", g_object_ref (item), g_object_unref);
+      g_file_read_async (file, G_PRIORITY_DEFAULT,
+                         bg_source->priv->cancellable,
+                         picture_opened_for_read, bg_source);
+    }
+  else
+    {
+      GFile *native_file;
+      GFile *thumbnail_file;
+      gchar *native_path;
+
+      source_uri = cc_background_item_get_source_url (item);
+
+      native_path = gnome_desktop_thumbnail_path_for_uri (source_uri, GNOME_DESKTOP_THUMBNAIL_SIZE_LARGE);
+      native_file = g_file_new_for_path (native_path);
+
+      if (g_file_query_exists (native_file, NULL))
+        {
+          /* We already downloaded this thumbnail before */
+          thumbnail_file = g_object_ref (native_file);
+        }
+      else
+        {
+          /* Decode straight from the download stream, and keep the
+           * result around in the thumbnail cache once done */
+          thumbnail_file = g_file_new_for_uri (grl_media_get_thumbnail (media));
+          g_object_set_data_full (G_OBJECT (item),
+                                  "native-file",
+                                  g_object_ref (native_file),
+                                  g_object_unref);
+        }
+
+      g_object_set_data_full (G_OBJECT (thumbnail_file), "item", g_object_ref (item), g_object_unref);
+      g_file_read_async (thumbnail_file,
+                         G_PRIORITY_DEFAULT,
+                         bg_source->priv->cancellable,
+                         picture_opened_for_read,
+                         bg_source);
+
+      g_object_unref (thumbnail_file);
+      g_object_unref (native_file);
+      g_free (native_path);
+    }
+}
+
+static void
+unload_thumbnail (BgPicturesSource *bg_source,
+                  CcBackgroundItem *item)
+{
+  GtkListStore *store;
+  GtkTreeRowReference *row_ref;
+  GtkTreePath *path;
+  GtkTreeIter iter;
+
+  set_thumbnail_state (item, THUMBNAIL_NONE);
+
+  row_ref = g_object_get_data (G_OBJECT (item), "row-ref");
+  if (row_ref == NULL)
+    return;
+
+  store = bg_source_get_liststore (BG_SOURCE (bg_source));
+  path = gtk_tree_row_reference_get_path (row_ref);
+  if (path != NULL && gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path))
+    gtk_list_store_set (store, &iter,
+                        0, get_placeholder (bg_source),
+                        -1);
+  gtk_tree_path_free (path);
+}
+
+static void
+bg_pictures_source_visible_range_changed (BgSource *source)
+{
+  BgPicturesSource *bg_source = BG_PICTURES_SOURCE (source);
+  GHashTableIter hash_iter;
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+  gpointer key;
+  gboolean cont;
+  gint start, end;
+  gint row;
+
+  /* Drop the thumbnails of rows far away from the view first */
+  g_hash_table_iter_init (&hash_iter, bg_source->priv->loaded_items);
+  while (g_hash_table_iter_next (&hash_iter, &key, NULL))
+    {
+      CcBackgroundItem *item = key;
+
+      row = get_item_row (bg_source, item);
+      if (row >= 0 && bg_source_is_row_visible (source, row, THUMBNAIL_KEEP_MARGIN))
+        continue;
+
+      unload_thumbnail (bg_source, item);
+      g_hash_table_iter_remove (&hash_iter);
+    }
+
+  /* Then produce the missing ones for the rows about to be shown */
+  model = GTK_TREE_MODEL (bg_source_get_liststore (source));
+  bg_source_get_visible_range (source, &start, &end);
+
+  cont = gtk_tree_model_iter_nth_child (model, &iter, NULL, start);
+  for (row = start; cont && row <= end; row++)
+    {
+      CcBackgroundItem *item;
+
+      gtk_tree_model_get (model, &iter, 1, &item, -1);
+      if (item != NULL)
+        {
+          load_thumbnail (bg_source, item);
+          g_object_unref (item);
+        }
+
+      cont = gtk_tree_model_iter_next (model, &iter);
+    }
+}
+
 static GFile *
 bg_pictures_source_get_cache_file (void)
 {
@@ -395,13 +614,186 @@ bg_pictures_source_get_cache_file (void)
   return file;
 }
 
+static gboolean
+save_index_timeout (gpointer user_data)
+{
+  BgPicturesSource *bg_source = BG_PICTURES_SOURCE (user_data);
+  GError *error = NULL;
+
+  bg_source->priv->save_index_id = 0;
+
+  if (!bg_pictures_index_save (bg_source->priv->index, &error))
+    {
+      g_warning ("Failed to save pictures index: %s", error->message);
+      g_error_free (error);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_save_index (BgPicturesSource *bg_source)
+{
+  if (bg_source->priv->save_index_id != 0)
+    return;
+
+  bg_source->priv->save_index_id = g_timeout_add_seconds (INDEX_SAVE_TIMEOUT,
+                                                          save_index_timeout,
+                                                          bg_source);
+}
+
+/* Returns TRUE if the contents with @hash are already shown
+ * under another URI, otherwise records @uri as showing them */
+static gboolean
+claim_hash (BgPicturesSource *bg_source,
+            const char       *hash,
+            const char       *uri)
+{
+  const char *shown_uri;
+
+  shown_uri = g_hash_table_lookup (bg_source->priv->shown_hashes, hash);
+  if (shown_uri != NULL)
+    return !g_str_equal (shown_uri, uri);
+
+  g_hash_table_insert (bg_source->priv->shown_hashes, g_strdup (hash), g_strdup (uri));
+  return FALSE;
+}
+
+static void
+release_hash (BgPicturesSource *bg_source,
+              const char       *hash,
+              const char       *uri)
+{
+  GList *uris, *l;
+  const char *shown_uri;
+
+  shown_uri = g_hash_table_lookup (bg_source->priv->shown_hashes, hash);
+  if (shown_uri == NULL || !g_str_equal (shown_uri, uri))
+    return;
+
+  g_hash_table_remove (bg_source->priv->shown_hashes, hash);
+
+  /* Show one of the duplicates that were hidden in its stead */
+  uris = bg_pictures_index_find_by_hash (bg_source->priv->index, hash);
+  for (l = uris; l != NULL; l = l->next)
+    {
+      GFile *file;
+
+      if (g_str_equal (l->data, uri))
+        continue;
+
+      file = g_file_new_for_uri (l->data);
+      g_file_query_info_async (file,
+                               ATTRIBUTES,
+                               G_FILE_QUERY_INFO_NONE,
+                               G_PRIORITY_LOW,
+                               bg_source->priv->cancellable,
+                               file_info_ready,
+                               bg_source);
+      g_object_unref (file);
+      break;
+    }
+  g_list_free (uris);
+}
+
+static void
+mark_duplicate (BgPicturesSource *bg_source,
+                CcBackgroundItem *item,
+                const char       *uri)
+{
+  g_object_set_data (G_OBJECT (item), "is-duplicate", GINT_TO_POINTER (TRUE));
+  bg_pictures_source_remove (bg_source, uri);
+
+  /* bg_pictures_source_remove() forgets about it, but it is
+   * still on disk, so don't let the monitor add it back */
+  g_hash_table_insert (bg_source->priv->known_items,
+                       bg_pictures_source_get_unique_filename (uri),
+                       GINT_TO_POINTER (TRUE));
+}
+
+static void
+picture_hashed (GObject      *source_object,
+                GAsyncResult *res,
+                gpointer      user_data)
+{
+  BgPicturesSource *bg_source;
+  CcBackgroundItem *item;
+  GFile *file = G_FILE (source_object);
+  GError *error = NULL;
+  guint64 *size;
+  gchar *hash;
+  gchar *uri;
+  gchar *thumbnail;
+
+  /* The file is kept alive by the item, so it must not hold
+   * on to the item any longer than the hashing takes */
+  item = g_object_steal_data (source_object, "hash-item");
+  size = g_object_steal_data (source_object, "hash-size");
+  hash = bg_pictures_index_hash_file_finish (file, res, &error);
+  if (hash == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_debug ("Failed to hash picture: %s", error->message);
+      g_error_free (error);
+      g_object_unref (item);
+      g_free (size);
+      return;
+    }
+
+  bg_source = BG_PICTURES_SOURCE (user_data);
+
+  uri = g_file_get_uri (file);
+  thumbnail = gnome_desktop_thumbnail_path_for_uri (uri, GNOME_DESKTOP_THUMBNAIL_SIZE_LARGE);
+  bg_pictures_index_update (bg_source->priv->index,
+                            uri,
+                            *size,
+                            cc_background_item_get_modified (item),
+                            hash,
+                            thumbnail);
+  queue_save_index (bg_source);
+
+  g_object_set_data_full (G_OBJECT (item), "content-hash", g_strdup (hash), g_free);
+  if (claim_hash (bg_source, hash, uri))
+    mark_duplicate (bg_source, item, uri);
+
+  g_free (thumbnail);
+  g_free (uri);
+  g_free (hash);
+  g_free (size);
+  g_object_unref (item);
+}
+
+/* Hashing reads the whole file, so it waits like the thumbnail
+ * does for the row to come into view */
+static void
+hash_picture (BgPicturesSource *bg_source,
+              CcBackgroundItem *item)
+{
+  GFile *file;
+  guint64 *size;
+
+  size = g_object_steal_data (G_OBJECT (item), "hash-size");
+  if (size == NULL)
+    return;
+
+  file = g_object_get_data (G_OBJECT (item), "file");
+  g_object_set_data_full (G_OBJECT (file), "hash-item", g_object_ref (item), g_object_unref);
+  g_object_set_data_full (G_OBJECT (file), "hash-size", size, g_free);
+  bg_pictures_index_hash_file_async (file,
+                                     bg_source->priv->cancellable,
+                                     picture_hashed,
+                                     bg_source);
+}
+
 static gboolean
 add_single_file (BgPicturesSource     *bg_source,
                  GFile                *file,
                  const gchar          *content_type,
+                 guint64               size,
                  guint64               mtime,
                  GtkTreeRowReference **ret_row_ref)
 {
+  const BgPicturesIndexEntry *entry = NULL;
   CcBackgroundItem *item = NULL;
   CcBackgroundItemFlags flags = 0;
   GtkListStore *store;
@@ -415,6 +807,7 @@ add_single_file (BgPicturesSource     *bg_source,
   gboolean retval = FALSE;
   GFile *pictures_dir, *cache_dir;
   GrlMedia *media;
+  gboolean visible;
 
   /* find png and jpeg files */
   if (!content_type)
@@ -454,10 +847,40 @@ add_single_file (BgPicturesSource     *bg_source,
                 "source-url", source_uri,
 		NULL);
 
-  if (!ret_row_ref && in_screenshot_types (content_type))
-    goto read_file;
+  media = g_object_get_data (G_OBJECT (file), "grl-media");
+  if (media != NULL)
+    g_object_set (G_OBJECT (item), "name", grl_media_get_title (media), NULL);
+
+  /* Local pictures we already know are stat-compared against the
+   * index, and only shown once for any given contents */
+  if (!needs_download)
+    {
+      entry = bg_pictures_index_lookup (bg_source->priv->index, uri, size, mtime);
+      if (entry != NULL)
+        {
+          if (claim_hash (bg_source, entry->hash, uri))
+            {
+              g_hash_table_insert (bg_source->priv->known_items,
+                                   bg_pictures_source_get_unique_filename (uri),
+                                   GINT_TO_POINTER (TRUE));
+              goto out;
+            }
+
+          g_object_set_data_full (G_OBJECT (item), "content-hash", g_strdup (entry->hash), g_free);
+        }
+      else
+        {
+          /* Not known yet, hashed once its row is shown */
+          g_object_set_data_full (G_OBJECT (item), "hash-size",
+                                  g_memdup (&size, sizeof (guint64)), g_free);
+        }
+    }
+
+  g_object_set_data_full (G_OBJECT (item), "file", g_object_ref (file), g_object_unref);
 
-  surface = get_content_loading_icon (BG_SOURCE (bg_source));
+  /* Every picture waits for its row to scroll into view, screenshots
+   * included: their placeholder goes away once decoding tells them apart */
+  surface = cairo_surface_reference (get_placeholder (bg_source));
   store = bg_source_get_liststore (BG_SOURCE (bg_source));
 
   /* insert the item into the liststore */
@@ -470,58 +893,11 @@ add_single_file (BgPicturesSource     *bg_source,
   row_ref = gtk_tree_row_reference_new (GTK_TREE_MODEL (store), path);
   g_object_set_data_full (G_OBJECT (item), "row-ref", row_ref, (GDestroyNotify) gtk_tree_row_reference_free);
 
-
- read_file:
-
-  media = g_object_get_data (G_OBJECT (file), "grl-media");
-  if (media == NULL)
-    {
-      g_object_set_data_full (G_OBJECT (file), "item", g_object_ref (item), g_object_unref);
-      g_file_read_async (file, G_PRIORITY_DEFAULT,
-                         bg_source->priv->cancellable,
-                         picture_opened_for_read, bg_source);
-    }
-  else
-    {
-      GFile *native_file;
-      GFile *thumbnail_file = NULL;
-      gchar *native_dir;
-      gchar *native_path;
-      const gchar *title;
-      const gchar *thumbnail_uri;
-
-      title = grl_media_get_title (media);
-      g_object_set (G_OBJECT (item), "name", title, NULL);
-
-      thumbnail_uri = grl_media_get_thumbnail (media);
-      thumbnail_file = g_file_new_for_uri (thumbnail_uri);
-
-      native_path = gnome_desktop_thumbnail_path_for_uri (source_uri, GNOME_DESKTOP_THUMBNAIL_SIZE_LARGE);
-      native_file = g_file_new_for_path (native_path);
-
-      native_dir = g_path_get_dirname (native_path);
-      g_mkdir_with_parents (native_dir, USER_DIR_MODE);
-
-      g_object_set_data_full (G_OBJECT (thumbnail_file), "item", g_object_ref (item), g_object_unref);
-      g_object_set_data_full (G_OBJECT (thumbnail_file),
-                              "native-file",
-                              g_object_ref (native_file),
-                              g_object_unref);
-      g_file_copy_async (thumbnail_file,
-                         native_file,
-                         G_FILE_COPY_ALL_METADATA,
-                         G_PRIORITY_DEFAULT,
-                         bg_source->priv->cancellable,
-                         NULL,
-                         NULL,
-                         picture_copied_for_read,
-                         bg_source);
-
-      g_clear_object (&thumbnail_file);
-      g_object_unref (native_file);
-      g_free (native_dir);
-      g_free (native_path);
-    }
+  visible = bg_source_is_row_visible (BG_SOURCE (bg_source),
+                                      gtk_tree_path_get_indices (path)[0],
+                                      0);
+  if (visible || ret_row_ref != NULL)
+    load_thumbnail (bg_source, item);
 
   retval = TRUE;
 
@@ -549,11 +925,13 @@ add_single_file_from_info (BgPicturesSource     *bg_source,
                            GtkTreeRowReference **ret_row_ref)
 {
   const gchar *content_type;
+  guint64 size;
   guint64 mtime;
 
   content_type = g_file_info_get_content_type (info);
+  size = g_file_info_get_size (info);
   mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
-  return add_single_file (bg_source, file, content_type, mtime, ret_row_ref);
+  return add_single_file (bg_source, file, content_type, size, mtime, ret_row_ref);
 }
 
 static gboolean
@@ -578,7 +956,7 @@ add_single_file_from_media (BgPicturesSource *bg_source,
   else
     mtime_unix = g_get_real_time () / G_USEC_PER_SEC;
 
-  return add_single_file (bg_source, file, content_type, (guint64) mtime_unix, NULL);
+  return add_single_file (bg_source, file, content_type, 0, (guint64) mtime_unix, NULL);
 }
 
 gboolean
@@ -622,12 +1000,19 @@ bg_pictures_source_remove (BgPicturesSource *bg_source,
       tmp_uri = cc_background_item_get_uri (tmp_item);
       if (g_str_equal (tmp_uri, uri))
         {
+          const char *hash;
           char *uuid;
           uuid = bg_pictures_source_get_unique_filename (uri);
           g_hash_table_insert (bg_source->priv->known_items,
 			       uuid, NULL);
 
+          hash = g_object_get_data (G_OBJECT (tmp_item), "content-hash");
+          if (hash != NULL)
+            release_hash (bg_source, hash, uri);
+
+          g_hash_table_remove (bg_source->priv->loaded_items, tmp_item);
           gtk_list_store_remove (GTK_LIST_STORE (model), &iter);
+          g_object_unref (tmp_item);
           retval = TRUE;
           break;
         }
@@ -830,8 +1215,21 @@ file_info_ready (GObject      *object,
 
   if (!info)
     {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_warning ("Problem looking up file info: %s", error->message);
+      /* Pictures come and go, and the index may not know yet */
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+        {
+          BgPicturesSource *bg_source = BG_PICTURES_SOURCE (user_data);
+          char *uri;
+
+          uri = g_file_get_uri (file);
+          bg_pictures_index_remove (bg_source->priv->index, uri);
+          queue_save_index (bg_source);
+          g_free (uri);
+        }
+      else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          g_warning ("Problem looking up file info: %s", error->message);
+        }
       g_clear_error (&error);
       return;
     }
@@ -841,6 +1239,48 @@ file_info_ready (GObject      *object,
    */
   g_object_ref (file);
   add_single_file_from_info (BG_PICTURES_SOURCE (user_data), file, info, NULL);
+  g_object_unref (info);
+}
+
+static void
+file_changed_info_ready (GObject      *object,
+                         GAsyncResult *res,
+                         gpointer      user_data)
+{
+  BgPicturesSource *self;
+  GFileInfo *info;
+  GError *error = NULL;
+  GFile *file = G_FILE (object);
+  char *uri;
+
+  info = g_file_query_info_finish (file, res, &error);
+  if (!info)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Problem looking up file info: %s", error->message);
+      g_clear_error (&error);
+      return;
+    }
+
+  self = BG_PICTURES_SOURCE (user_data);
+  uri = g_file_get_uri (file);
+
+  /* Only pictures whose contents really changed get reloaded */
+  if (bg_pictures_index_lookup (self->priv->index,
+                                uri,
+                                g_file_info_get_size (info),
+                                g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)) == NULL)
+    {
+      bg_pictures_index_remove (self->priv->index, uri);
+      queue_save_index (self);
+      bg_pictures_source_remove (self, uri);
+
+      g_object_ref (file);
+      add_single_file_from_info (self, file, info, NULL);
+    }
+
+  g_free (uri);
+  g_object_unref (info);
 }
 
 static void
@@ -856,10 +1296,20 @@ file_added (GFile            *file,
                                ATTRIBUTES,
                                G_FILE_QUERY_INFO_NONE,
                                G_PRIORITY_LOW,
-                               NULL,
+                               self->priv->cancellable,
                                file_info_ready,
                                self);
     }
+  else
+    {
+      g_file_query_info_async (file,
+                               ATTRIBUTES,
+                               G_FILE_QUERY_INFO_NONE,
+                               G_PRIORITY_LOW,
+                               self->priv->cancellable,
+                               file_changed_info_ready,
+                               self);
+    }
 
   g_free (uri);
 }
@@ -882,6 +1332,8 @@ files_changed_cb (GFileMonitor      *monitor,
 
       case G_FILE_MONITOR_EVENT_DELETED:
         uri = g_file_get_uri (file);
+        bg_pictures_index_remove (self->priv->index, uri);
+        queue_save_index (self);
         bg_pictures_source_remove (self, uri);
         g_free (uri);
         break;
@@ -941,6 +1393,7 @@ bg_pictures_source_init (BgPicturesSource *self)
   const gchar *pictures_path;
   BgPicturesSourcePrivate *priv;
   char *cache_path;
+  char *index_path;
   GtkListStore *store;
 
   priv = self->priv = PICTURES_SOURCE_PRIVATE (self);
@@ -950,6 +1403,21 @@ bg_pictures_source_init (BgPicturesSource *self)
 					     g_str_equal,
 					     (GDestroyNotify) g_free,
 					     NULL);
+  priv->loaded_items = g_hash_table_new_full (g_direct_hash,
+                                              g_direct_equal,
+                                              g_object_unref,
+                                              NULL);
+  priv->shown_hashes = g_hash_table_new_full (g_str_hash,
+                                              g_str_equal,
+                                              g_free,
+                                              g_free);
+
+  index_path = g_build_filename (g_get_user_cache_dir (),
+                                 "gnome-control-center",
+                                 "pictures-index.ini",
+                                 NULL);
+  priv->index = bg_pictures_index_new (index_path);
+  g_free (index_path);
 
   pictures_path = g_get_user_special_dir (G_USER_DIRECTORY_PICTURES);
   if (pictures_path == NULL)
@@ -26,6 +26,10 @@
 #define THUMBNAIL_WIDTH 256
 #define THUMBNAIL_HEIGHT (THUMBNAIL_WIDTH * 3 / 4)
 
+/* Number of rows on either side of the visible ones for which
+ * thumbnails are prepared ahead of scrolling */
+#define VISIBLE_RANGE_PREFETCH 12
+
 G_DEFINE_ABSTRACT_TYPE (BgSource, bg_source, G_TYPE_OBJECT)
 
 #define SOURCE_PRIVATE(o) \
@@ -37,6 +41,8 @@ struct _BgSourcePrivate
   GtkWidget *window;
   gint thumbnail_height;
   gint thumbnail_width;
+  gint visible_start;
+  gint visible_end;
 };
 
 enum
@@ -158,6 +164,10 @@ bg_source_init (BgSource *self)
   priv = self->priv = SOURCE_PRIVATE (self);
 
   priv->store = gtk_list_store_new (3, CAIRO_GOBJECT_TYPE_SURFACE, G_TYPE_OBJECT, G_TYPE_STRING);
+
+  /* Until a view tells us otherwise, assume the first rows are shown */
+  priv->visible_start = 0;
+  priv->visible_end = 0;
 }
 
 GtkListStore*
@@ -173,6 +183,9 @@ bg_source_get_scale_factor (BgSource *source)
 {
   g_return_val_if_fail (BG_IS_SOURCE (source), 1);
 
+  if (source->priv->window == NULL)
+    return 1;
+
   return gtk_widget_get_scale_factor (source->priv->window);
 }
 
@@ -191,3 +204,59 @@ bg_source_get_thumbnail_width (BgSource *source)
 
   return source->priv->thumbnail_width;
 }
+
+void
+bg_source_set_visible_range (BgSource *source,
+                             gint      start,
+                             gint      end)
+{
+  BgSourcePrivate *priv;
+  BgSourceClass *klass;
+
+  g_return_if_fail (BG_IS_SOURCE (source));
+  g_return_if_fail (start <= end);
+
+  priv = source->priv;
+  if (priv->visible_start == start && priv->visible_end == end)
+    return;
+
+  priv->visible_start = start;
+  priv->visible_end = end;
+
+  klass = BG_SOURCE_GET_CLASS (source);
+  if (klass->visible_range_changed != NULL)
+    klass->visible_range_changed (source);
+}
+
+/* Returns the range of rows, prefetch margin included, for which
+ * thumbnails should be available */
+void
+bg_source_get_visible_range (BgSource *source,
+                             gint     *start,
+                             gint     *end)
+{
+  BgSourcePrivate *priv;
+
+  g_return_if_fail (BG_IS_SOURCE (source));
+
+  priv = source->priv;
+
+  if (start != NULL)
+    *start = MAX (0, priv->visible_start - VISIBLE_RANGE_PREFETCH);
+  if (end != NULL)
+    *end = priv->visible_end + VISIBLE_RANGE_PREFETCH;
+}
+
+gboolean
+bg_source_is_row_visible (BgSource *source,
+                          gint      row,
+                          gint      margin)
+{
+  gint start, end;
+
+  g_return_val_if_fail (BG_IS_SOURCE (source), TRUE);
+
+  bg_source_get_visible_range (source, &start, &end);
+
+  return row >= start - margin && row <= end + margin;
+}
@@ -61,6 +61,10 @@ struct _BgSource
 struct _BgSourceClass
 {
   GObjectClass parent_class;
+
+  /* called when the rows shown by the view change, so that sources
+   * can produce (or drop) thumbnails for those rows only */
+  void (*visible_range_changed) (BgSource *source);
 };
 
 GType bg_source_get_type (void) G_GNUC_CONST;
@@ -73,6 +77,18 @@ gint bg_source_get_thumbnail_height (BgSource *source);
 
 gint bg_source_get_thumbnail_width (BgSource *source);
 
+void bg_source_set_visible_range (BgSource *source,
+                                  gint      start,
+                                  gint      end);
+
+void bg_source_get_visible_range (BgSource *source,
+                                  gint     *start,
+                                  gint     *end);
+
+gboolean bg_source_is_row_visible (BgSource *source,
+                                   gint      row,
+                                   gint      margin);
+
 G_END_DECLS
 
 #endif /* _BG_SOURCE_H */
@@ -385,14 +385,61 @@ out:
   gtk_drag_finish (context, ret, FALSE, time);
 }
 
+static gboolean
+update_visible_range_idle (gpointer user_data)
+{
+  GtkIconView *icon_view = GTK_ICON_VIEW (user_data);
+  GtkTreePath *start_path;
+  GtkTreePath *end_path;
+  BgSource *source;
+
+  g_object_set_data (G_OBJECT (icon_view), "visible-range-id", NULL);
+
+  source = g_object_get_data (G_OBJECT (icon_view), "source");
+  if (source == NULL)
+    return G_SOURCE_REMOVE;
+
+  if (!gtk_icon_view_get_visible_range (icon_view, &start_path, &end_path))
+    return G_SOURCE_REMOVE;
+
+  bg_source_set_visible_range (source,
+                               gtk_tree_path_get_indices (start_path)[0],
+                               gtk_tree_path_get_indices (end_path)[0]);
+
+  gtk_tree_path_free (start_path);
+  gtk_tree_path_free (end_path);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_visible_range_update (GtkWidget *icon_view)
+{
+  guint id;
+
+  /* Coalesce scroll and allocation changes into one update */
+  if (g_object_get_data (G_OBJECT (icon_view), "visible-range-id") != NULL)
+    return;
+
+  id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                        update_visible_range_idle,
+                        g_object_ref (icon_view),
+                        g_object_unref);
+  g_object_set_data (G_OBJECT (icon_view), "visible-range-id", GUINT_TO_POINTER (id));
+}
+
 static GtkWidget *
-create_view (CcBackgroundChooserDialog *chooser, GtkTreeModel *model)
+create_view (CcBackgroundChooserDialog *chooser, BgSource *source)
 {
   GtkCellRenderer *renderer;
+  GtkAdjustment *vadjustment;
+  GtkTreeModel *model;
   GtkWidget *icon_view;
   GtkWidget *sw;
   GtkWindow *parent;
 
+  model = GTK_TREE_MODEL (bg_source_get_liststore (source));
+
   sw = gtk_scrolled_window_new (NULL, NULL);
   gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (sw), GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
   gtk_widget_set_hexpand (sw, TRUE);
@@ -405,6 +452,13 @@ create_view (CcBackgroundChooserDialog *chooser, GtkTreeModel *model)
   g_signal_connect (icon_view, "selection-changed", G_CALLBACK (on_selection_changed), chooser);
   g_signal_connect (icon_view, "item-activated", G_CALLBACK (on_item_activated), chooser);
 
+  /* Let the source know which rows need thumbnails */
+  g_object_set_data_full (G_OBJECT (icon_view), "source", g_object_ref (source), g_object_unref);
+  vadjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (icon_view));
+  g_signal_connect_object (vadjustment, "value-changed", G_CALLBACK (queue_visible_range_update), icon_view, G_CONNECT_SWAPPED);
+  g_signal_connect_object (vadjustment, "changed", G_CALLBACK (queue_visible_range_update), icon_view, G_CONNECT_SWAPPED);
+  g_signal_connect (icon_view, "size-allocate", G_CALLBACK (queue_visible_range_update), NULL);
+
   parent = gtk_window_get_transient_for (GTK_WINDOW (chooser));
   if (parent == NULL || !gtk_window_is_maximized (parent))
     gtk_icon_view_set_columns (GTK_ICON_VIEW (icon_view), 3);
@@ -426,23 +480,19 @@ cc_background_chooser_dialog_constructed (GObject *object)
 {
   CcBackgroundChooserDialog *chooser = CC_BACKGROUND_CHOOSER_DIALOG (object);
   CcBackgroundChooserDialogPrivate *priv = chooser->priv;
-  GtkListStore *model;
   GtkWidget *sw;
   GtkWidget *vbox;
 
   G_OBJECT_CLASS (cc_background_chooser_dialog_parent_class)->constructed (object);
 
-  model = bg_source_get_liststore (BG_SOURCE (priv->wallpapers_source));
-  sw = create_view (chooser, GTK_TREE_MODEL (model));
+  sw = create_view (chooser, BG_SOURCE (priv->wallpapers_source));
   gtk_stack_add_titled (GTK_STACK (priv->stack), sw, "wallpapers", _("Wallpapers"));
   gtk_container_child_set (GTK_CONTAINER (priv->stack), sw, "position", 0, NULL);
 
-  model = bg_source_get_liststore (BG_SOURCE (priv->pictures_source));
-  sw = create_view (chooser, GTK_TREE_MODEL (model));
+  sw = create_view (chooser, BG_SOURCE (priv->pictures_source));
   gtk_stack_add_named (GTK_STACK (priv->pictures_stack), sw, "view");
 
-  model = bg_source_get_liststore (BG_SOURCE (priv->colors_source));
-  sw = create_view (chooser, GTK_TREE_MODEL (model));
+  sw = create_view (chooser, BG_SOURCE (priv->colors_source));
   gtk_stack_add_titled (GTK_STACK (priv->stack), sw, "colors", _("Colors"));
 
   vbox = gtk_dialog_get_content_area (GTK_DIALOG (chooser));
@@ -31,8 +31,19 @@ struct _CcBackgroundGriloMiner
   GObject parent;
   GCancellable *cancellable;
   GList *accounts;
+
+  /* sources waiting for one of the running searches to finish */
+  GQueue pending_sources;
+  guint n_running;
 };
 
+typedef struct
+{
+  CcBackgroundGriloMiner *self;
+  GrlSource *source;
+  GList *medias;
+} SearchData;
+
 struct _CcBackgroundGriloMinerClass
 {
   GObjectClass parent_class;
@@ -50,6 +61,14 @@ G_DEFINE_TYPE (CcBackgroundGriloMiner, cc_background_grilo_miner, G_TYPE_OBJECT)
 
 #define REMOTE_ITEM_COUNT 50
 
+/* Maximum number of online sources searched at the same time */
+#define MAX_RUNNING_SEARCHES 3
+
+/* Lifetime, in seconds, of the cached search results of a source */
+#define SEARCH_CACHE_LIFETIME (60 * 60)
+
+static void query_online_source (CcBackgroundGriloMiner *self, GrlSource *source);
+
 static gchar *
 get_grilo_id (GoaObject *goa_object)
 {
@@ -96,34 +115,170 @@ is_online_data_cached (GObject      *object,
   g_clear_error (&error);
 }
 
+static gchar *
+get_search_cache_path (GrlSource *source)
+{
+  gchar *filename;
+  gchar *path;
+
+  filename = g_strdup_printf ("%s.ini", grl_source_get_id (source));
+  path = g_build_filename (g_get_user_cache_dir (),
+                           "gnome-control-center",
+                           "grilo",
+                           filename,
+                           NULL);
+  g_free (filename);
+
+  return path;
+}
+
 static void
-searched_online_source (GrlSource    *source,
-                        guint         operation_id,
-                        GrlMedia     *media,
-                        guint         remaining,
-                        gpointer      user_data,
-                        const GError *error)
+save_search_cache (GrlSource *source,
+                   GList     *medias)
 {
-  CcBackgroundGriloMiner *self = CC_BACKGROUND_GRILO_MINER (user_data);
-  GFile *cache_file = NULL;
-  const gchar *uri;
-  gchar *cache_path = NULL;
+  GError *error = NULL;
+  GKeyFile *keyfile;
+  GList *l;
+  gchar *dir;
+  gchar *path;
+  guint i;
 
-  if (error != NULL)
+  keyfile = g_key_file_new ();
+  g_key_file_set_int64 (keyfile, "Search", "expires",
+                        g_get_real_time () / G_USEC_PER_SEC + SEARCH_CACHE_LIFETIME);
+
+  for (l = medias, i = 0; l != NULL; l = l->next, i++)
     {
-      const gchar *source_id;
+      GrlMedia *media = GRL_MEDIA (l->data);
+      GDateTime *date;
+      gchar *group;
+
+      if (grl_media_get_url (media) == NULL)
+        continue;
+
+      group = g_strdup_printf ("Media %u", i);
+      g_key_file_set_string (keyfile, group, "url", grl_media_get_url (media));
+      if (grl_media_get_id (media) != NULL)
+        g_key_file_set_string (keyfile, group, "id", grl_media_get_id (media));
+      if (grl_media_get_title (media) != NULL)
+        g_key_file_set_string (keyfile, group, "title", grl_media_get_title (media));
+      if (grl_media_get_mime (media) != NULL)
+        g_key_file_set_string (keyfile, group, "mime", grl_media_get_mime (media));
+      if (grl_media_get_thumbnail (media) != NULL)
+        g_key_file_set_string (keyfile, group, "thumbnail", grl_media_get_thumbnail (media));
+
+      date = grl_media_get_creation_date (media);
+      if (date != NULL)
+        g_key_file_set_int64 (keyfile, group, "creation-date", g_date_time_to_unix (date));
+
+      g_free (group);
+    }
 
-      source_id = grl_source_get_id (source);
-      g_warning ("Error searching %s: %s", source_id, error->message);
-      grl_operation_cancel (operation_id);
-      remaining = 0;
-      goto out;
+  path = get_search_cache_path (source);
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, USER_DIR_MODE);
+
+  if (!g_key_file_save_to_file (keyfile, path, &error))
+    {
+      g_warning ("Failed to save search results of %s: %s", grl_source_get_id (source), error->message);
+      g_error_free (error);
+    }
+
+  g_free (dir);
+  g_free (path);
+  g_key_file_unref (keyfile);
+}
+
+/* Returns the medias found by the last search of @source, or NULL
+ * if there are none, or they are too old to be used */
+static GList *
+load_search_cache (GrlSource *source,
+                   gboolean  *found)
+{
+  GKeyFile *keyfile;
+  GList *medias = NULL;
+  gchar **groups = NULL;
+  gchar *path;
+  gint64 expires;
+  guint i;
+
+  *found = FALSE;
+
+  keyfile = g_key_file_new ();
+  path = get_search_cache_path (source);
+  if (!g_key_file_load_from_file (keyfile, path, G_KEY_FILE_NONE, NULL))
+    goto out;
+
+  expires = g_key_file_get_int64 (keyfile, "Search", "expires", NULL);
+  if (expires < g_get_real_time () / G_USEC_PER_SEC)
+    goto out;
+
+  groups = g_key_file_get_groups (keyfile, NULL);
+  for (i = 0; groups[i] != NULL; i++)
+    {
+      GrlMedia *media;
+      gchar *value;
+      gint64 date;
+
+      value = g_key_file_get_string (keyfile, groups[i], "url", NULL);
+      if (value == NULL)
+        continue;
+
+      media = grl_media_image_new ();
+      grl_media_set_url (media, value);
+      g_free (value);
+
+      value = g_key_file_get_string (keyfile, groups[i], "id", NULL);
+      grl_media_set_id (media, value);
+      g_free (value);
+
+      value = g_key_file_get_string (keyfile, groups[i], "title", NULL);
+      grl_media_set_title (media, value);
+      g_free (value);
+
+      value = g_key_file_get_string (keyfile, groups[i], "mime", NULL);
+      grl_media_set_mime (media, value);
+      g_free (value);
+
+      value = g_key_file_get_string (keyfile, groups[i], "thumbnail", NULL);
+      grl_media_set_thumbnail (media, value);
+      g_free (value);
+
+      date = g_key_file_get_int64 (keyfile, groups[i], "creation-date", NULL);
+      if (date > 0)
+        {
+          GDateTime *date_time;
+
+          date_time = g_date_time_new_from_unix_utc (date);
+          grl_media_set_creation_date (media, date_time);
+          g_date_time_unref (date_time);
+        }
+
+      medias = g_list_prepend (medias, media);
     }
 
+  *found = TRUE;
+
+ out:
+  g_strfreev (groups);
+  g_free (path);
+  g_key_file_unref (keyfile);
+
+  return g_list_reverse (medias);
+}
+
+static void
+check_media (CcBackgroundGriloMiner *self,
+             GrlMedia               *media)
+{
+  GFile *cache_file;
+  const gchar *uri;
+  gchar *cache_path;
+
   uri = grl_media_get_url (media);
   cache_path = bg_pictures_source_get_unique_path (uri);
   cache_file = g_file_new_for_path (cache_path);
-  g_object_set_data_full (G_OBJECT (cache_file), "grl-media", media, g_object_unref);
+  g_object_set_data_full (G_OBJECT (cache_file), "grl-media", g_object_ref (media), g_object_unref);
   g_file_query_info_async (cache_file,
                            G_FILE_ATTRIBUTE_STANDARD_TYPE,
                            G_FILE_QUERY_INFO_NONE,
@@ -132,11 +287,67 @@ searched_online_source (GrlSource    *source,
                            is_online_data_cached,
                            self);
 
- out:
-  g_clear_object (&cache_file);
+  g_object_unref (cache_file);
   g_free (cache_path);
+}
+
+static void
+search_finished (SearchData *data,
+                 gboolean    success)
+{
+  CcBackgroundGriloMiner *self = data->self;
+  GrlSource *next;
+
+  if (success)
+    save_search_cache (data->source, data->medias);
+
+  self->n_running--;
+
+  next = g_queue_pop_head (&self->pending_sources);
+  if (next != NULL)
+    {
+      query_online_source (self, next);
+      g_object_unref (next);
+    }
+
+  g_list_free_full (data->medias, g_object_unref);
+  g_object_unref (data->source);
+  g_object_unref (data->self);
+  g_slice_free (SearchData, data);
+}
+
+static void
+searched_online_source (GrlSource    *source,
+                        guint         operation_id,
+                        GrlMedia     *media,
+                        guint         remaining,
+                        gpointer      user_data,
+                        const GError *error)
+{
+  SearchData *data = user_data;
+
+  if (error != NULL)
+    {
+      const gchar *source_id;
+
+      source_id = grl_source_get_id (source);
+      g_warning ("Error searching %s: %s", source_id, error->message);
+      grl_operation_cancel (operation_id);
+      search_finished (data, FALSE);
+      return;
+    }
+
+  if (media != NULL)
+    {
+      check_media (data->self, media);
+      data->medias = g_list_prepend (data->medias, media);
+    }
+
   if (remaining == 0)
-    g_object_unref (self);
+    {
+      data->medias = g_list_reverse (data->medias);
+      search_finished (data, TRUE);
+    }
 }
 
 static void
@@ -145,6 +356,33 @@ query_online_source (CcBackgroundGriloMiner *self, GrlSource *source)
   const GList *keys;
   GrlCaps *caps;
   GrlOperationOptions *options;
+  SearchData *data;
+  GList *medias, *l;
+  gboolean cached;
+
+  /* Recent results don't need another round trip */
+  medias = load_search_cache (source, &cached);
+  if (cached)
+    {
+      g_debug ("Using cached search results for %s", grl_source_get_id (source));
+      for (l = medias; l != NULL; l = l->next)
+        check_media (self, GRL_MEDIA (l->data));
+
+      g_list_free_full (medias, g_object_unref);
+      return;
+    }
+
+  if (self->n_running >= MAX_RUNNING_SEARCHES)
+    {
+      g_queue_push_tail (&self->pending_sources, g_object_ref (source));
+      return;
+    }
+
+  self->n_running++;
+
+  data = g_slice_new0 (SearchData);
+  data->self = g_object_ref (self);
+  data->source = g_object_ref (source);
 
   keys = grl_source_supported_keys (source);
   caps = grl_source_get_caps (source, GRL_OP_BROWSE);
@@ -153,7 +391,7 @@ query_online_source (CcBackgroundGriloMiner *self, GrlSource *source)
   grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_FAST_ONLY);
   grl_operation_options_set_type_filter (options, GRL_TYPE_FILTER_IMAGE);
 
-  grl_source_search (source, NULL, keys, options, searched_online_source, g_object_ref (self));
+  grl_source_search (source, NULL, keys, options, searched_online_source, data);
   g_object_unref (options);
 }
 
@@ -275,6 +513,9 @@ cc_background_grilo_miner_dispose (GObject *object)
       self->accounts = NULL;
     }
 
+  g_queue_foreach (&self->pending_sources, (GFunc) g_object_unref, NULL);
+  g_queue_clear (&self->pending_sources);
+
   G_OBJECT_CLASS (cc_background_grilo_miner_parent_class)->dispose (object);
 }
 
@@ -282,6 +523,7 @@ static void
 cc_background_grilo_miner_init (CcBackgroundGriloMiner *self)
 {
   self->cancellable = g_cancellable_new ();
+  g_queue_init (&self->pending_sources);
 }
 
 static void
@@ -327,3 +569,15 @@ cc_background_grilo_miner_start (CcBackgroundGriloMiner *self)
 {
   setup_online_accounts (self);
 }
+
+/* Searches @source directly, without going through the online
+ * accounts; this is used to test the miner against local sources */
+void
+cc_background_grilo_miner_add_source (CcBackgroundGriloMiner *self,
+                                      GrlSource              *source)
+{
+  g_return_if_fail (CC_IS_BACKGROUND_GRILO_MINER (self));
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  query_online_source (self, source);
+}
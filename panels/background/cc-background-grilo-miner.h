@@ -20,6 +20,7 @@
 #define _CC_BACKGROUND_GRILO_MINER_H
 
 #include <glib-object.h>
+#include <grilo.h>
 
 G_BEGIN_DECLS
 
@@ -54,6 +55,9 @@ CcBackgroundGriloMiner   *cc_background_grilo_miner_new            (void);
 
 void                      cc_background_grilo_miner_start          (CcBackgroundGriloMiner *self);
 
+void                      cc_background_grilo_miner_add_source     (CcBackgroundGriloMiner *self,
+                                                                    GrlSource              *source);
+
 G_END_DECLS
 
 #endif /* _CC_BACKGROUND_GRILO_MINER_H */
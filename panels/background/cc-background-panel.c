@@ -32,6 +32,7 @@
 #include "cc-background-chooser-dialog.h"
 #include "cc-background-item.h"
 #include "cc-background-resources.h"
+#include "cc-background-shading.h"
 #include "cc-background-xml.h"
 
 #include "bg-pictures-source.h"
@@ -117,6 +118,8 @@ cc_background_panel_dispose (GObject *object)
       priv->chooser = NULL;
     }
 
+  cc_background_shading_clear_cache ();
+
   g_clear_object (&priv->thumb_factory);
   g_clear_object (&priv->display_screenshot);
 
@@ -222,20 +225,36 @@ update_display_preview (CcBackgroundPanel *panel,
   if (!current_background)
     return;
 
-  scale_factor = gtk_widget_get_scale_factor (widget);
-  pixbuf = cc_background_item_get_frame_thumbnail (current_background,
-                                                   priv->thumb_factory,
-                                                   preview_width,
-                                                   preview_height,
-                                                   scale_factor,
-                                                   -2, TRUE);
-
   cr = gdk_cairo_create (gtk_widget_get_window (widget));
-  gdk_cairo_set_source_pixbuf (cr,
-                               pixbuf,
-                               0, 0);
-  cairo_paint (cr);
-  g_object_unref (pixbuf);
+
+  scale_factor = gtk_widget_get_scale_factor (widget);
+  if (cc_background_shading_can_render (current_background))
+    {
+      cairo_surface_t *surface;
+
+      /* Plain colours don't need a full GnomeBG render */
+      surface = cc_background_shading_render (current_background,
+                                              preview_width,
+                                              preview_height,
+                                              1);
+      cairo_set_source_surface (cr, surface, 0, 0);
+      cairo_paint (cr);
+      cairo_surface_destroy (surface);
+    }
+  else
+    {
+      pixbuf = cc_background_item_get_frame_thumbnail (current_background,
+                                                       priv->thumb_factory,
+                                                       preview_width,
+                                                       preview_height,
+                                                       scale_factor,
+                                                       -2, TRUE);
+      gdk_cairo_set_source_pixbuf (cr,
+                                   pixbuf,
+                                   0, 0);
+      cairo_paint (cr);
+      g_object_unref (pixbuf);
+    }
 
   pixbuf = NULL;
   if (current_background == priv->current_background &&
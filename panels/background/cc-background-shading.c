@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <gtk/gtk.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "cc-background-shading.h"
+
+/* Renders solid colours and gradients, as used by the colors
+ * source and some wallpapers, without going through GnomeBG.
+ *
+ * Gradients only vary along one axis, so a single line of pixels
+ * is interpolated, and then copied over the rest of the surface. */
+
+#if defined(__SSE2__)
+
+static inline __m128
+unpack_pixel (guint32 pixel)
+{
+  __m128i zero = _mm_setzero_si128 ();
+  __m128i v;
+
+  v = _mm_cvtsi32_si128 ((gint32) pixel);
+  v = _mm_unpacklo_epi8 (v, zero);
+  v = _mm_unpacklo_epi16 (v, zero);
+
+  return _mm_cvtepi32_ps (v);
+}
+
+static void
+lerp_line (guint32 *dst,
+           gint     n,
+           guint32  from,
+           guint32  to)
+{
+  __m128 start, delta;
+  gfloat step;
+  gint i;
+
+  start = unpack_pixel (from);
+  delta = _mm_sub_ps (unpack_pixel (to), start);
+  step = n > 1 ? 1.0f / (n - 1) : 0.0f;
+
+  for (i = 0; i < n; i++)
+    {
+      __m128i v;
+
+      v = _mm_cvtps_epi32 (_mm_add_ps (start, _mm_mul_ps (delta, _mm_set1_ps (i * step))));
+      v = _mm_packs_epi32 (v, v);
+      v = _mm_packus_epi16 (v, v);
+      dst[i] = (guint32) _mm_cvtsi128_si32 (v);
+    }
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+static inline float32x4_t
+unpack_pixel (guint32 pixel)
+{
+  uint8x8_t b;
+  uint16x8_t w;
+
+  b = vreinterpret_u8_u32 (vdup_n_u32 (pixel));
+  w = vmovl_u8 (b);
+
+  return vcvtq_f32_u32 (vmovl_u16 (vget_low_u16 (w)));
+}
+
+static void
+lerp_line (guint32 *dst,
+           gint     n,
+           guint32  from,
+           guint32  to)
+{
+  float32x4_t start, delta, half;
+  gfloat step;
+  gint i;
+
+  start = unpack_pixel (from);
+  delta = vsubq_f32 (unpack_pixel (to), start);
+  half = vdupq_n_f32 (0.5f);
+  step = n > 1 ? 1.0f / (n - 1) : 0.0f;
+
+  for (i = 0; i < n; i++)
+    {
+      uint32x4_t v;
+      uint16x4_t h;
+      uint8x8_t b;
+
+      v = vcvtq_u32_f32 (vaddq_f32 (vmlaq_n_f32 (start, delta, i * step), half));
+      h = vmovn_u32 (v);
+      b = vmovn_u16 (vcombine_u16 (h, h));
+      dst[i] = vget_lane_u32 (vreinterpret_u32_u8 (b), 0);
+    }
+}
+
+#else
+
+static void
+lerp_line (guint32 *dst,
+           gint     n,
+           guint32  from,
+           guint32  to)
+{
+  gfloat step;
+  gint i, c;
+
+  step = n > 1 ? 1.0f / (n - 1) : 0.0f;
+
+  for (i = 0; i < n; i++)
+    {
+      guint32 pixel = 0;
+
+      for (c = 0; c < 32; c += 8)
+        {
+          gfloat a = (from >> c) & 0xff;
+          gfloat b = (to >> c) & 0xff;
+
+          pixel |= ((guint32) (a + (b - a) * i * step + 0.5f)) << c;
+        }
+
+      dst[i] = pixel;
+    }
+}
+
+#endif
+
+static inline void
+fill_line (guint32 *dst,
+           gint     n,
+           guint32  pixel)
+{
+  gint i;
+
+  for (i = 0; i < n; i++)
+    dst[i] = pixel;
+}
+
+void
+cc_background_shading_fill (guint32                   *pixels,
+                            gint                       width,
+                            gint                       height,
+                            gint                       stride,
+                            GDesktopBackgroundShading  shading,
+                            guint32                    pcolor,
+                            guint32                    scolor)
+{
+  guint32 *line;
+  guint32 *colors;
+  gint y;
+
+  g_return_if_fail (pixels != NULL);
+  g_return_if_fail (stride >= width * 4);
+
+  if (width <= 0 || height <= 0)
+    return;
+
+  switch (shading)
+    {
+    case G_DESKTOP_BACKGROUND_SHADING_HORIZONTAL:
+      lerp_line (pixels, width, pcolor, scolor);
+      for (y = 1; y < height; y++)
+        {
+          line = (guint32 *) ((guchar *) pixels + y * stride);
+          memcpy (line, pixels, width * 4);
+        }
+      break;
+
+    case G_DESKTOP_BACKGROUND_SHADING_VERTICAL:
+      colors = g_new (guint32, height);
+      lerp_line (colors, height, pcolor, scolor);
+      for (y = 0; y < height; y++)
+        {
+          line = (guint32 *) ((guchar *) pixels + y * stride);
+          fill_line (line, width, colors[y]);
+        }
+      g_free (colors);
+      break;
+
+    case G_DESKTOP_BACKGROUND_SHADING_SOLID:
+    default:
+      fill_line (pixels, width, pcolor);
+      for (y = 1; y < height; y++)
+        {
+          line = (guint32 *) ((guchar *) pixels + y * stride);
+          memcpy (line, pixels, width * 4);
+        }
+      break;
+    }
+}
+
+static guint32
+parse_color (const char *str)
+{
+  GdkRGBA rgba;
+
+  if (str == NULL || !gdk_rgba_parse (&rgba, str))
+    return 0xff000000;
+
+  return 0xff000000 |
+         ((guint32) (rgba.red * 255 + 0.5) << 16) |
+         ((guint32) (rgba.green * 255 + 0.5) << 8) |
+         ((guint32) (rgba.blue * 255 + 0.5));
+}
+
+/* Returns the PNG tiled over the colour, if any */
+static char *
+get_texture_path (CcBackgroundItem *item)
+{
+  const char *uri;
+
+  uri = cc_background_item_get_uri (item);
+  if (uri == NULL || cc_background_item_get_placement (item) == G_DESKTOP_BACKGROUND_STYLE_NONE)
+    return NULL;
+
+  return g_filename_from_uri (uri, NULL, NULL);
+}
+
+/* The PNGs tiled over colours, by path, as there are only a few of them */
+static GHashTable *textures = NULL;
+
+static cairo_surface_t *
+get_texture (const char *path)
+{
+  cairo_surface_t *texture;
+
+  if (textures == NULL)
+    textures = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                      g_free, (GDestroyNotify) cairo_surface_destroy);
+
+  texture = g_hash_table_lookup (textures, path);
+  if (texture == NULL)
+    {
+      texture = cairo_image_surface_create_from_png (path);
+      g_hash_table_insert (textures, g_strdup (path), texture);
+    }
+
+  if (cairo_surface_status (texture) != CAIRO_STATUS_SUCCESS)
+    return NULL;
+
+  return texture;
+}
+
+/* Drops the textures loaded so far, they get loaded again when needed */
+void
+cc_background_shading_clear_cache (void)
+{
+  g_clear_pointer (&textures, g_hash_table_destroy);
+}
+
+gboolean
+cc_background_shading_can_render (CcBackgroundItem *item)
+{
+  gboolean ret = FALSE;
+  char *path;
+
+  g_return_val_if_fail (CC_IS_BACKGROUND_ITEM (item), FALSE);
+
+  if ((cc_background_item_get_flags (item) & CC_BACKGROUND_ITEM_HAS_SHADING) == 0)
+    return FALSE;
+
+  if (cc_background_item_get_uri (item) == NULL ||
+      cc_background_item_get_placement (item) == G_DESKTOP_BACKGROUND_STYLE_NONE)
+    return TRUE;
+
+  /* A tiled PNG on top of the colour, as used by the colors source */
+  path = get_texture_path (item);
+  if (path != NULL &&
+      cc_background_item_get_placement (item) == G_DESKTOP_BACKGROUND_STYLE_WALLPAPER &&
+      g_str_has_suffix (path, ".png"))
+    ret = get_texture (path) != NULL;
+
+  g_free (path);
+
+  return ret;
+}
+
+cairo_surface_t *
+cc_background_shading_render (CcBackgroundItem *item,
+                              gint              width,
+                              gint              height,
+                              gint              scale_factor)
+{
+  cairo_surface_t *surface;
+  const char *pcolor, *scolor;
+  char *path;
+
+  g_return_val_if_fail (CC_IS_BACKGROUND_ITEM (item), NULL);
+  g_return_val_if_fail (width > 0 && height > 0, NULL);
+
+  pcolor = cc_background_item_get_pcolor (item);
+  scolor = cc_background_item_get_scolor (item);
+  if (scolor == NULL)
+    scolor = pcolor;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  cairo_surface_flush (surface);
+  cc_background_shading_fill ((guint32 *) cairo_image_surface_get_data (surface),
+                              width, height,
+                              cairo_image_surface_get_stride (surface),
+                              cc_background_item_get_shading (item),
+                              parse_color (pcolor),
+                              parse_color (scolor));
+  cairo_surface_mark_dirty (surface);
+
+  path = get_texture_path (item);
+  if (path != NULL && get_texture (path) != NULL)
+    {
+      cairo_pattern_t *pattern;
+      cairo_t *cr;
+
+      cr = cairo_create (surface);
+      pattern = cairo_pattern_create_for_surface (get_texture (path));
+      cairo_pattern_set_extend (pattern, CAIRO_EXTEND_REPEAT);
+      cairo_set_source (cr, pattern);
+      cairo_paint (cr);
+      cairo_pattern_destroy (pattern);
+      cairo_destroy (cr);
+    }
+  g_free (path);
+
+  cairo_surface_set_device_scale (surface, scale_factor, scale_factor);
+
+  return surface;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _CC_BACKGROUND_SHADING_H
+#define _CC_BACKGROUND_SHADING_H
+
+#include <cairo.h>
+#include <gdesktop-enums.h>
+
+#include "cc-background-item.h"
+
+G_BEGIN_DECLS
+
+gboolean         cc_background_shading_can_render (CcBackgroundItem          *item);
+
+cairo_surface_t *cc_background_shading_render     (CcBackgroundItem          *item,
+                                                   gint                       width,
+                                                   gint                       height,
+                                                   gint                       scale_factor);
+
+void             cc_background_shading_fill       (guint32                   *pixels,
+                                                   gint                       width,
+                                                   gint                       height,
+                                                   gint                       stride,
+                                                   GDesktopBackgroundShading  shading,
+                                                   guint32                    pcolor,
+                                                   guint32                    scolor);
+
+void             cc_background_shading_clear_cache (void);
+
+G_END_DECLS
+
+#endif /* _CC_BACKGROUND_SHADING_H */
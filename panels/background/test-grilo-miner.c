@@ -0,0 +1,247 @@
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <grilo.h>
+
+#include "cc-background-grilo-miner.h"
+
+#define N_MEDIAS 8
+#define N_SOURCES 5
+
+/* A Grilo source answering searches with local pictures, a few
+ * main loop iterations later, so that the miner can be exercised
+ * without network access */
+
+typedef struct
+{
+  GrlSource parent;
+  guint n_searches;
+} FakeSource;
+
+typedef struct
+{
+  GrlSourceClass parent_class;
+} FakeSourceClass;
+
+GType fake_source_get_type (void);
+
+G_DEFINE_TYPE (FakeSource, fake_source, GRL_TYPE_SOURCE)
+
+static guint n_running = 0;
+static guint max_running = 0;
+
+typedef struct
+{
+  GrlSourceSearchSpec *ss;
+  guint n;
+} SearchState;
+
+static gboolean
+emit_next_media (gpointer user_data)
+{
+  SearchState *state = user_data;
+  GrlMedia *media;
+  gchar *uri;
+
+  media = grl_media_image_new ();
+  uri = g_strdup_printf ("file:///nonexistent/%s/picture-%u.jpg",
+                         grl_source_get_id (state->ss->source), state->n);
+  grl_media_set_url (media, uri);
+  grl_media_set_title (media, "Picture");
+  grl_media_set_mime (media, "image/jpeg");
+  g_free (uri);
+
+  state->n++;
+  if (state->n == N_MEDIAS)
+    n_running--;
+
+  state->ss->callback (state->ss->source,
+                       state->ss->operation_id,
+                       media,
+                       N_MEDIAS - state->n,
+                       state->ss->user_data,
+                       NULL);
+
+  if (state->n < N_MEDIAS)
+    return G_SOURCE_CONTINUE;
+
+  g_free (state);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+fake_source_search (GrlSource           *source,
+                    GrlSourceSearchSpec *ss)
+{
+  SearchState *state;
+
+  ((FakeSource *) source)->n_searches++;
+
+  n_running++;
+  max_running = MAX (max_running, n_running);
+
+  state = g_new0 (SearchState, 1);
+  state->ss = ss;
+  g_idle_add (emit_next_media, state);
+}
+
+static const GList *
+fake_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (keys == NULL)
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_URL,
+                                      GRL_METADATA_KEY_TITLE,
+                                      GRL_METADATA_KEY_MIME,
+                                      GRL_METADATA_KEY_INVALID);
+
+  return keys;
+}
+
+static void
+fake_source_class_init (FakeSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->search = fake_source_search;
+  source_class->supported_keys = fake_source_supported_keys;
+}
+
+static void
+fake_source_init (FakeSource *self)
+{
+}
+
+static GrlSource *
+fake_source_new (guint i)
+{
+  GrlSource *source;
+  gchar *id;
+
+  id = g_strdup_printf ("grl-fake-%u", i);
+  source = g_object_new (fake_source_get_type (),
+                         "source-id", id,
+                         "source-name", id,
+                         NULL);
+  g_free (id);
+
+  return source;
+}
+
+static void
+media_found_cb (CcBackgroundGriloMiner *miner,
+                GrlMedia               *media,
+                guint                  *n_found)
+{
+  (*n_found)++;
+}
+
+static guint
+run_miner (GrlSource **sources,
+           guint       n_sources)
+{
+  CcBackgroundGriloMiner *miner;
+  guint n_found = 0;
+  guint i;
+  gint64 deadline;
+
+  miner = cc_background_grilo_miner_new ();
+  g_signal_connect (miner, "media-found", G_CALLBACK (media_found_cb), &n_found);
+
+  for (i = 0; i < n_sources; i++)
+    cc_background_grilo_miner_add_source (miner, sources[i]);
+
+  deadline = g_get_monotonic_time () + 10 * G_USEC_PER_SEC;
+  while (n_found < n_sources * N_MEDIAS && g_get_monotonic_time () < deadline)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_object_unref (miner);
+
+  return n_found;
+}
+
+static void
+test_bounded_searches (void)
+{
+  GrlSource *sources[N_SOURCES];
+  guint i;
+
+  for (i = 0; i < N_SOURCES; i++)
+    sources[i] = fake_source_new (i);
+
+  g_assert_cmpuint (run_miner (sources, N_SOURCES), ==, N_SOURCES * N_MEDIAS);
+  g_assert_cmpuint (max_running, >, 1);
+  g_assert_cmpuint (max_running, <=, 3);
+
+  for (i = 0; i < N_SOURCES; i++)
+    {
+      g_assert_cmpuint (((FakeSource *) sources[i])->n_searches, ==, 1);
+      g_object_unref (sources[i]);
+    }
+}
+
+static void
+test_cached_search (void)
+{
+  GrlSource *source;
+
+  source = fake_source_new (N_SOURCES);
+
+  /* The second run is answered from the on-disk cache */
+  g_assert_cmpuint (run_miner (&source, 1), ==, N_MEDIAS);
+  g_assert_cmpuint (run_miner (&source, 1), ==, N_MEDIAS);
+  g_assert_cmpuint (((FakeSource *) source)->n_searches, ==, 1);
+
+  g_object_unref (source);
+}
+
+static void
+remove_tree (const gchar *path)
+{
+  GDir *dir;
+  const gchar *name;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir != NULL)
+    {
+      while ((name = g_dir_read_name (dir)) != NULL)
+        {
+          gchar *child;
+
+          child = g_build_filename (path, name, NULL);
+          remove_tree (child);
+          g_free (child);
+        }
+      g_dir_close (dir);
+    }
+
+  g_remove (path);
+}
+
+int
+main (int argc, char **argv)
+{
+  gchar *cache_dir;
+  int ret;
+
+  cache_dir = g_dir_make_tmp ("test-grilo-miner-XXXXXX", NULL);
+  g_assert (cache_dir != NULL);
+  g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  /* The miner warns when the Flickr plugin is not installed */
+  g_log_set_always_fatal (G_LOG_FATAL_MASK | G_LOG_LEVEL_CRITICAL);
+
+  g_test_add_func ("/background/grilo-miner/bounded-searches", test_bounded_searches);
+  g_test_add_func ("/background/grilo-miner/cached-search", test_cached_search);
+
+  ret = g_test_run ();
+
+  remove_tree (cache_dir);
+  g_free (cache_dir);
+
+  return ret;
+}
@@ -0,0 +1,154 @@
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "cc-background-shading.h"
+
+#define WIDTH 37
+#define HEIGHT 11
+
+#define PCOLOR 0xff102030
+#define SCOLOR 0xfff0e0d0
+
+static guint32 pixels[WIDTH * HEIGHT];
+
+static guint32
+pixel_at (gint x, gint y)
+{
+  return pixels[y * WIDTH + x];
+}
+
+static void
+test_solid (void)
+{
+  gint x, y;
+
+  cc_background_shading_fill (pixels, WIDTH, HEIGHT, WIDTH * 4,
+                              G_DESKTOP_BACKGROUND_SHADING_SOLID,
+                              PCOLOR, SCOLOR);
+
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      g_assert_cmphex (pixel_at (x, y), ==, PCOLOR);
+}
+
+static void
+test_horizontal (void)
+{
+  gint y;
+
+  cc_background_shading_fill (pixels, WIDTH, HEIGHT, WIDTH * 4,
+                              G_DESKTOP_BACKGROUND_SHADING_HORIZONTAL,
+                              PCOLOR, SCOLOR);
+
+  for (y = 0; y < HEIGHT; y++)
+    {
+      g_assert_cmphex (pixel_at (0, y), ==, PCOLOR);
+      g_assert_cmphex (pixel_at (WIDTH - 1, y), ==, SCOLOR);
+      g_assert_cmphex (pixel_at (WIDTH / 2, y), ==, 0xff808080);
+    }
+}
+
+static void
+test_vertical (void)
+{
+  gint x;
+
+  cc_background_shading_fill (pixels, WIDTH, HEIGHT, WIDTH * 4,
+                              G_DESKTOP_BACKGROUND_SHADING_VERTICAL,
+                              PCOLOR, SCOLOR);
+
+  for (x = 0; x < WIDTH; x++)
+    {
+      g_assert_cmphex (pixel_at (x, 0), ==, PCOLOR);
+      g_assert_cmphex (pixel_at (x, HEIGHT - 1), ==, SCOLOR);
+      g_assert_cmphex (pixel_at (x, HEIGHT / 2), ==, 0xff808080);
+    }
+}
+
+static guint32
+surface_pixel_at (cairo_surface_t *surface,
+                  gint             x,
+                  gint             y)
+{
+  guchar *data = cairo_image_surface_get_data (surface);
+
+  return *(guint32 *) (data + y * cairo_image_surface_get_stride (surface) + x * 4);
+}
+
+/* A 2x1 PNG tiled over the colour, the way the colors source does */
+static void
+test_texture (void)
+{
+  CcBackgroundItem *item;
+  cairo_surface_t *texture;
+  cairo_surface_t *surface;
+  GError *error = NULL;
+  gchar *dir;
+  gchar *path;
+  gchar *uri;
+  gint x, y;
+
+  dir = g_dir_make_tmp ("test-shading-XXXXXX", &error);
+  g_assert_no_error (error);
+  path = g_build_filename (dir, "texture.png", NULL);
+  uri = g_filename_to_uri (path, NULL, NULL);
+
+  texture = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 2, 1);
+  cairo_surface_flush (texture);
+  *(guint32 *) cairo_image_surface_get_data (texture) = PCOLOR;
+  *((guint32 *) cairo_image_surface_get_data (texture) + 1) = 0x00000000;
+  cairo_surface_mark_dirty (texture);
+  g_assert_cmpint (cairo_surface_write_to_png (texture, path), ==, CAIRO_STATUS_SUCCESS);
+  cairo_surface_destroy (texture);
+
+  item = cc_background_item_new (uri);
+  g_object_set (G_OBJECT (item),
+                "primary-color", "#f0e0d0",
+                "secondary-color", "#f0e0d0",
+                "shading", G_DESKTOP_BACKGROUND_SHADING_SOLID,
+                "placement", G_DESKTOP_BACKGROUND_STYLE_WALLPAPER,
+                "flags", CC_BACKGROUND_ITEM_HAS_SHADING | CC_BACKGROUND_ITEM_HAS_URI,
+                NULL);
+
+  g_assert (cc_background_shading_can_render (item));
+
+  /* The texture stays cached once loaded */
+  g_unlink (path);
+  g_assert (cc_background_shading_can_render (item));
+
+  surface = cc_background_shading_render (item, WIDTH, HEIGHT, 1);
+  g_assert_cmpint (cairo_surface_status (surface), ==, CAIRO_STATUS_SUCCESS);
+  cairo_surface_flush (surface);
+
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      g_assert_cmphex (surface_pixel_at (surface, x, y), ==, x % 2 == 0 ? PCOLOR : SCOLOR);
+
+  cairo_surface_destroy (surface);
+
+  /* Until the cache is cleared */
+  cc_background_shading_clear_cache ();
+  g_assert (!cc_background_shading_can_render (item));
+  cc_background_shading_clear_cache ();
+
+  g_object_unref (item);
+  g_rmdir (dir);
+  g_free (uri);
+  g_free (path);
+  g_free (dir);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/background/shading/solid", test_solid);
+  g_test_add_func ("/background/shading/horizontal", test_horizontal);
+  g_test_add_func ("/background/shading/vertical", test_vertical);
+  g_test_add_func ("/background/shading/texture", test_texture);
+
+  return g_test_run ();
+}
@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include "cc-city-index.h"
+
+/* Searches cities by any of their names, translated or not, and by
+ * their country's names, ignoring case and accents.
+ *
+ * Matches are ranked by how well they match: the start of a city name
+ * first, then the start of a word in it, then anywhere in it, and the
+ * same for country names after that. Ties go to the shortest name.
+ *
+ * As the query usually grows one character at a time, the cities that
+ * matched the previous query are kept, and only those are searched
+ * when the new query contains the previous one. */
+
+#define MAX_RESULTS 50
+
+/* Added to the rank of matches in country names */
+#define COUNTRY_RANK 3
+
+struct _CcCityIndex
+{
+  GPtrArray *cities;
+  gchar *last_query;
+  GPtrArray *candidates;
+  GPtrArray *results;
+};
+
+static void
+city_free (CcCity *city)
+{
+  g_free (city->display_name);
+  g_free (city->zone);
+  g_strfreev (city->keys);
+  g_free (city->collate_key);
+  g_slice_free (CcCity, city);
+}
+
+/* Decomposes the string, drops the combining marks, and folds the case,
+ * so that "Zürich", "zurich" and "ZURICH" are all the same */
+gchar *
+cc_city_index_normalize (const gchar *str)
+{
+  GString *stripped;
+  gchar *decomposed;
+  gchar *ret;
+  const gchar *p;
+
+  g_return_val_if_fail (str != NULL, NULL);
+
+  decomposed = g_utf8_normalize (str, -1, G_NORMALIZE_NFKD);
+  if (decomposed == NULL)
+    return g_strdup ("");
+
+  stripped = g_string_sized_new (strlen (decomposed));
+  for (p = decomposed; *p != '\0'; p = g_utf8_next_char (p))
+    {
+      gunichar c = g_utf8_get_char (p);
+
+      if (g_unichar_ismark (c))
+        continue;
+
+      if (c == '_')
+        c = ' ';
+
+      g_string_append_unichar (stripped, c);
+    }
+
+  ret = g_utf8_casefold (stripped->str, stripped->len);
+
+  g_string_free (stripped, TRUE);
+  g_free (decomposed);
+
+  return ret;
+}
+
+CcCityIndex *
+cc_city_index_new (void)
+{
+  CcCityIndex *index;
+
+  index = g_new0 (CcCityIndex, 1);
+  index->cities = g_ptr_array_new_with_free_func ((GDestroyNotify) city_free);
+  index->candidates = g_ptr_array_new ();
+  index->results = g_ptr_array_new ();
+
+  return index;
+}
+
+void
+cc_city_index_free (CcCityIndex *index)
+{
+  if (index == NULL)
+    return;
+
+  g_ptr_array_unref (index->results);
+  g_ptr_array_unref (index->candidates);
+  g_ptr_array_unref (index->cities);
+  g_free (index->last_query);
+  g_free (index);
+}
+
+static void
+add_keys (GPtrArray           *keys,
+          const gchar * const *names)
+{
+  guint i, j;
+
+  for (i = 0; names != NULL && names[i] != NULL; i++)
+    {
+      gchar *key;
+      gboolean duplicate = FALSE;
+
+      key = cc_city_index_normalize (names[i]);
+
+      /* The translation is often the same as the original */
+      for (j = 0; j < keys->len && !duplicate; j++)
+        duplicate = g_str_equal (keys->pdata[j], key);
+
+      if (duplicate || *key == '\0')
+        g_free (key);
+      else
+        g_ptr_array_add (keys, key);
+    }
+}
+
+void
+cc_city_index_add (CcCityIndex         *index,
+                   const gchar         *display_name,
+                   const gchar         *zone,
+                   const gchar * const *city_names,
+                   const gchar * const *country_names)
+{
+  CcCity *city;
+  GPtrArray *keys;
+
+  g_return_if_fail (index != NULL);
+  g_return_if_fail (display_name != NULL);
+  g_return_if_fail (zone != NULL);
+
+  keys = g_ptr_array_new ();
+  add_keys (keys, city_names);
+
+  city = g_slice_new0 (CcCity);
+  city->n_city_keys = keys->len;
+
+  add_keys (keys, country_names);
+  g_ptr_array_add (keys, NULL);
+
+  city->display_name = g_strdup (display_name);
+  city->zone = g_strdup (zone);
+  city->keys = (gchar **) g_ptr_array_free (keys, FALSE);
+  city->collate_key = g_utf8_collate_key (display_name, -1);
+
+  g_ptr_array_add (index->cities, city);
+
+  /* The previous results don't know about this city */
+  g_clear_pointer (&index->last_query, g_free);
+}
+
+static gboolean
+is_word_start (const gchar *key,
+               const gchar *match)
+{
+  switch (match[-1])
+    {
+    case ' ':
+    case '-':
+    case '\'':
+    case '(':
+    case '/':
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+/* Returns the rank of the best match of @query in the names of @city,
+ * lower being better, or -1 if it does not match at all */
+static gint
+get_rank (CcCity      *city,
+          const gchar *query)
+{
+  gint best = -1;
+  guint i;
+
+  for (i = 0; city->keys[i] != NULL; i++)
+    {
+      const gchar *match;
+      gint rank;
+
+      match = strstr (city->keys[i], query);
+      if (match == NULL)
+        continue;
+
+      if (match == city->keys[i])
+        rank = 0;
+      else if (is_word_start (city->keys[i], match))
+        rank = 1;
+      else
+        rank = 2;
+
+      if (i >= city->n_city_keys)
+        rank += COUNTRY_RANK;
+
+      if (best < 0 || rank < best)
+        best = rank;
+    }
+
+  return best;
+}
+
+static gint
+compare_cities (gconstpointer a,
+                gconstpointer b)
+{
+  const CcCity *city_a = *(CcCity **) a;
+  const CcCity *city_b = *(CcCity **) b;
+  glong len_a, len_b;
+
+  if (city_a->rank != city_b->rank)
+    return city_a->rank - city_b->rank;
+
+  len_a = g_utf8_strlen (city_a->display_name, -1);
+  len_b = g_utf8_strlen (city_b->display_name, -1);
+  if (len_a != len_b)
+    return len_a < len_b ? -1 : 1;
+
+  return strcmp (city_a->collate_key, city_b->collate_key);
+}
+
+/* Returns the best matches for @query, best first. The array and the
+ * cities belong to the index, and the array is only valid until the
+ * next search. */
+const GPtrArray *
+cc_city_index_search (CcCityIndex *index,
+                      const gchar *query)
+{
+  GPtrArray *source, *candidates;
+  gchar *normalized;
+  guint i;
+
+  g_return_val_if_fail (index != NULL, NULL);
+  g_return_val_if_fail (query != NULL, NULL);
+
+  g_ptr_array_set_size (index->results, 0);
+
+  normalized = cc_city_index_normalize (query);
+  if (*normalized == '\0')
+    {
+      g_free (normalized);
+      g_clear_pointer (&index->last_query, g_free);
+      return index->results;
+    }
+
+  /* Anything matching the new query also matched the previous one */
+  if (index->last_query != NULL && strstr (normalized, index->last_query) != NULL)
+    source = index->candidates;
+  else
+    source = index->cities;
+
+  candidates = g_ptr_array_new ();
+  for (i = 0; i < source->len; i++)
+    {
+      CcCity *city = source->pdata[i];
+
+      city->rank = get_rank (city, normalized);
+      if (city->rank >= 0)
+        g_ptr_array_add (candidates, city);
+    }
+
+  g_ptr_array_unref (index->candidates);
+  index->candidates = candidates;
+  g_free (index->last_query);
+  index->last_query = normalized;
+
+  for (i = 0; i < candidates->len; i++)
+    g_ptr_array_add (index->results, candidates->pdata[i]);
+  g_ptr_array_sort (index->results, compare_cities);
+  if (index->results->len > MAX_RESULTS)
+    g_ptr_array_set_size (index->results, MAX_RESULTS);
+
+  return index->results;
+}
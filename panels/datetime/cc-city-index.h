@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _CC_CITY_INDEX_H
+#define _CC_CITY_INDEX_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CcCityIndex CcCityIndex;
+typedef struct _CcCity CcCity;
+
+struct _CcCity
+{
+  gchar *display_name;
+  gchar *zone;
+
+  /*< private >*/
+  gchar **keys;
+  guint n_city_keys;
+  gchar *collate_key;
+  gint rank;
+};
+
+CcCityIndex     *cc_city_index_new        (void);
+void             cc_city_index_free       (CcCityIndex        *index);
+void             cc_city_index_add        (CcCityIndex        *index,
+                                           const gchar        *display_name,
+                                           const gchar        *zone,
+                                           const gchar * const *city_names,
+                                           const gchar * const *country_names);
+const GPtrArray *cc_city_index_search     (CcCityIndex        *index,
+                                           const gchar        *query);
+gchar           *cc_city_index_normalize  (const gchar        *str);
+
+G_END_DECLS
+
+#endif /* _CC_CITY_INDEX_H */
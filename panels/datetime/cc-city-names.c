@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <libintl.h>
+#include <locale.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#define GNOME_DESKTOP_USE_UNSTABLE_API
+#include <libgnome-desktop/gnome-languages.h>
+
+#include "cc-city-names.h"
+
+/* The translated names of the cities, kept for the lifetime of the
+ * process, and on disk, so that they are only built once per locale.
+ *
+ * The cache file is thrown away when the locale, or any of the
+ * catalogs the names come from, change:
+ *
+ * [Cache]
+ * stamp=<locale>;<catalog>:<mtime>;...
+ *
+ * [Europe/Paris]
+ * display-name=Paris, France
+ * ...
+ */
+
+#define CACHE_GROUP "Cache"
+#define ISO_3166_DOMAIN "iso_3166"
+
+static GHashTable *names = NULL;
+static gchar *stamp = NULL;
+static gboolean dirty = FALSE;
+
+static void
+city_names_free (CcCityNames *city_names)
+{
+  g_free (city_names->display_name);
+  g_free (city_names->city);
+  g_free (city_names->country);
+  g_free (city_names->english_country);
+  g_slice_free (CcCityNames, city_names);
+}
+
+static gchar *
+get_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-control-center",
+                           "timezone-names.ini",
+                           NULL);
+}
+
+/* Appends the path and modification time of the catalog gettext
+ * would use for @domain */
+static void
+append_catalog_stamp (GString     *str,
+                      const gchar *domain)
+{
+  const gchar * const *languages;
+  const gchar *dir;
+  guint i;
+
+  dir = bindtextdomain (domain, NULL);
+  if (dir == NULL)
+    return;
+
+  languages = g_get_language_names ();
+  for (i = 0; languages[i] != NULL; i++)
+    {
+      GStatBuf buf;
+      gchar *filename;
+      gchar *path;
+
+      filename = g_strconcat (domain, ".mo", NULL);
+      path = g_build_filename (dir, languages[i], "LC_MESSAGES", filename, NULL);
+      g_free (filename);
+
+      if (g_stat (path, &buf) == 0)
+        {
+          g_string_append_printf (str, ";%s:%" G_GINT64_FORMAT, path, (gint64) buf.st_mtime);
+          g_free (path);
+          return;
+        }
+
+      g_free (path);
+    }
+}
+
+static gchar *
+compute_stamp (void)
+{
+  GString *str;
+
+  str = g_string_new (setlocale (LC_MESSAGES, NULL));
+  append_catalog_stamp (str, GETTEXT_PACKAGE);
+  append_catalog_stamp (str, GETTEXT_PACKAGE_TIMEZONES);
+  append_catalog_stamp (str, ISO_3166_DOMAIN);
+
+  return g_string_free (str, FALSE);
+}
+
+static void
+load_cache (void)
+{
+  GKeyFile *keyfile;
+  gchar **groups;
+  gchar *path;
+  gchar *file_stamp;
+  guint i;
+
+  keyfile = g_key_file_new ();
+  path = get_cache_path ();
+
+  if (!g_key_file_load_from_file (keyfile, path, G_KEY_FILE_NONE, NULL))
+    goto out;
+
+  file_stamp = g_key_file_get_string (keyfile, CACHE_GROUP, "stamp", NULL);
+  if (g_strcmp0 (file_stamp, stamp) != 0)
+    {
+      g_free (file_stamp);
+      goto out;
+    }
+  g_free (file_stamp);
+
+  groups = g_key_file_get_groups (keyfile, NULL);
+  for (i = 0; groups[i] != NULL; i++)
+    {
+      CcCityNames *city_names;
+
+      if (g_str_equal (groups[i], CACHE_GROUP))
+        continue;
+
+      city_names = g_slice_new0 (CcCityNames);
+      city_names->display_name = g_key_file_get_string (keyfile, groups[i], "display-name", NULL);
+      city_names->city = g_key_file_get_string (keyfile, groups[i], "city", NULL);
+      city_names->country = g_key_file_get_string (keyfile, groups[i], "country", NULL);
+      city_names->english_country = g_key_file_get_string (keyfile, groups[i], "english-country", NULL);
+
+      if (city_names->display_name == NULL || city_names->city == NULL ||
+          city_names->country == NULL || city_names->english_country == NULL)
+        {
+          city_names_free (city_names);
+          continue;
+        }
+
+      g_hash_table_insert (names, g_strdup (groups[i]), city_names);
+    }
+  g_strfreev (groups);
+
+ out:
+  g_free (path);
+  g_key_file_unref (keyfile);
+}
+
+static gchar *
+translated_city (TzLocation *loc)
+{
+  gchar *city;
+  gchar *zone_translated;
+  gchar **split_translated;
+  gint length;
+
+  /* Load the translation for it */
+  zone_translated = g_strdup (dgettext (GETTEXT_PACKAGE_TIMEZONES, loc->zone));
+  g_strdelimit (zone_translated, "_", ' ');
+  split_translated = g_regex_split_simple ("[\\x{2044}\\x{2215}\\x{29f8}\\x{ff0f}/]",
+                                           zone_translated,
+                                           0, 0);
+  g_free (zone_translated);
+
+  length = g_strv_length (split_translated);
+  city = g_strdup (split_translated[length-1]);
+  g_strfreev (split_translated);
+
+  return city;
+}
+
+static CcCityNames *
+city_names_new (TzLocation *loc)
+{
+  CcCityNames *city_names;
+
+  city_names = g_slice_new0 (CcCityNames);
+  city_names->city = translated_city (loc);
+  city_names->country = gnome_get_country_from_code (loc->country, NULL);
+  city_names->english_country = gnome_get_country_from_code (loc->country, "C");
+
+  /* gnome-desktop doesn't know about every code in zone.tab */
+  if (city_names->country == NULL)
+    city_names->country = g_strdup (loc->country);
+  if (city_names->english_country == NULL)
+    city_names->english_country = g_strdup (city_names->country);
+
+  /* Translators: "city, country" */
+  city_names->display_name = g_strdup_printf (C_("timezone loc", "%s, %s"),
+                                              city_names->city,
+                                              city_names->country);
+
+  return city_names;
+}
+
+/* Returns the names of @loc in the current locale. They belong
+ * to the cache, and stay valid for the lifetime of the process. */
+const CcCityNames *
+cc_city_names_get (TzLocation *loc)
+{
+  CcCityNames *city_names;
+
+  g_return_val_if_fail (loc != NULL, NULL);
+
+  if (names == NULL)
+    {
+      names = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                     g_free, (GDestroyNotify) city_names_free);
+      stamp = compute_stamp ();
+      load_cache ();
+    }
+
+  city_names = g_hash_table_lookup (names, loc->zone);
+  if (city_names == NULL)
+    {
+      city_names = city_names_new (loc);
+      g_hash_table_insert (names, g_strdup (loc->zone), city_names);
+      dirty = TRUE;
+    }
+
+  return city_names;
+}
+
+/* Writes the names looked up so far to disk, if any were missing */
+void
+cc_city_names_save (void)
+{
+  GHashTableIter iter;
+  CcCityNames *city_names;
+  GKeyFile *keyfile;
+  GError *error = NULL;
+  const gchar *zone;
+  gchar *path;
+  gchar *dir;
+
+  if (!dirty)
+    return;
+
+  keyfile = g_key_file_new ();
+  g_key_file_set_string (keyfile, CACHE_GROUP, "stamp", stamp);
+
+  g_hash_table_iter_init (&iter, names);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &zone, (gpointer *) &city_names))
+    {
+      g_key_file_set_string (keyfile, zone, "display-name", city_names->display_name);
+      g_key_file_set_string (keyfile, zone, "city", city_names->city);
+      g_key_file_set_string (keyfile, zone, "country", city_names->country);
+      g_key_file_set_string (keyfile, zone, "english-country", city_names->english_country);
+    }
+
+  path = get_cache_path ();
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, USER_DIR_MODE);
+
+  if (g_key_file_save_to_file (keyfile, path, &error))
+    dirty = FALSE;
+  else
+    {
+      g_debug ("Could not save the timezone names: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (dir);
+  g_free (path);
+  g_key_file_unref (keyfile);
+}
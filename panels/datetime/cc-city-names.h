@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _CC_CITY_NAMES_H
+#define _CC_CITY_NAMES_H
+
+#include <glib.h>
+#include "tz.h"
+
+G_BEGIN_DECLS
+
+#define GETTEXT_PACKAGE_TIMEZONES GETTEXT_PACKAGE "-timezones"
+
+typedef struct
+{
+  gchar *display_name;
+  gchar *city;
+  gchar *country;
+  gchar *english_country;
+} CcCityNames;
+
+const CcCityNames *cc_city_names_get  (TzLocation *loc);
+void               cc_city_names_save (void);
+
+G_END_DECLS
+
+#endif /* _CC_CITY_NAMES_H */
@@ -27,6 +27,8 @@
 #include <sys/time.h>
 #include "shell/list-box-helper.h"
 #include "cc-timezone-map.h"
+#include "cc-city-index.h"
+#include "cc-city-names.h"
 #include "timedated.h"
 #include "date-endian.h"
 #define GNOME_DESKTOP_USE_UNSTABLE_API
@@ -37,13 +39,11 @@
 #include <libintl.h>
 
 #include <glib/gi18n.h>
-#include <libgnome-desktop/gnome-languages.h>
 #include <libgnome-desktop/gnome-wall-clock.h>
 #include <polkit/polkit.h>
 
 /* FIXME: This should be "Etc/GMT" instead */
 #define DEFAULT_TZ "Europe/London"
-#define GETTEXT_PACKAGE_TIMEZONES GETTEXT_PACKAGE "-timezones"
 
 CC_PANEL_REGISTER (CcDateTimePanel, cc_date_time_panel)
 
@@ -53,6 +53,7 @@ CC_PANEL_REGISTER (CcDateTimePanel, cc_date_time_panel)
 enum {
   CITY_COL_CITY_HUMAN_READABLE,
   CITY_COL_ZONE,
+  CITY_COL_MATCHES,
   CITY_NUM_COLS
 };
 
@@ -68,6 +69,17 @@ enum {
 #define DATETIME_SCHEMA "org.gnome.desktop.datetime"
 #define AUTO_TIMEZONE_KEY "automatic-timezone"
 
+/* How long to wait for the user to stop editing before
+ * sending the changes to timedated, in milliseconds */
+#define APPLY_CHANGES_DELAY 750
+
+/* The changes waiting to be sent, in the order they are sent in */
+typedef enum {
+  CHANGE_NTP      = 1 << 0,
+  CHANGE_TIMEZONE = 1 << 1,
+  CHANGE_TIME     = 1 << 2,
+} PendingChange;
+
 struct _CcDateTimePanelPrivate
 {
   GtkBuilder *builder;
@@ -79,7 +91,7 @@ struct _CcDateTimePanelPrivate
 
   TzLocation *current_location;
 
-  GtkTreeModelFilter *city_filter;
+  CcCityIndex *city_index;
 
   GDateTime *date;
 
@@ -98,11 +110,18 @@ struct _CcDateTimePanelPrivate
   Timedate1 *dtm;
   GCancellable *cancellable;
 
+  guint pending_changes;
+  gint64 pending_time_offset;
+  guint apply_changes_id;
+  PendingChange applying_change;
+  gchar *change_error;
+
   GPermission *permission;
 };
 
 static void update_time (CcDateTimePanel *self);
 static void change_time (CcDateTimePanel *self);
+static void send_leftover_changes (CcDateTimePanel *self);
 
 
 static void
@@ -110,6 +129,14 @@ cc_date_time_panel_dispose (GObject *object)
 {
   CcDateTimePanelPrivate *priv = CC_DATE_TIME_PANEL (object)->priv;
 
+  /* Don't lose the last edits when the panel goes away */
+  if (priv->apply_changes_id != 0)
+    {
+      g_source_remove (priv->apply_changes_id);
+      priv->apply_changes_id = 0;
+    }
+  send_leftover_changes (CC_DATE_TIME_PANEL (object));
+
   if (priv->cancellable)
     {
       g_cancellable_cancel (priv->cancellable);
@@ -138,6 +165,7 @@ cc_date_time_panel_dispose (GObject *object)
   g_clear_object (&priv->filechooser_settings);
 
   g_clear_pointer (&priv->date, g_date_time_unref);
+  g_clear_pointer (&priv->change_error, g_free);
 
   g_clear_pointer (&priv->listboxes, g_list_free);
   g_clear_pointer (&priv->listboxes_reverse, g_list_free);
@@ -349,113 +377,368 @@ update_time (CcDateTimePanel *self)
   g_free (label);
 }
 
+/* Sends a single change to timedated. The time is kept at
+ * @time_offset microseconds from the wall clock. */
 static void
-set_time_cb (GObject      *source,
-             GAsyncResult *res,
-             gpointer      user_data)
+call_timedated (Timedate1           *dtm,
+                PendingChange        change,
+                gboolean             using_ntp,
+                const gchar         *timezone,
+                gint64               time_offset,
+                GCancellable        *cancellable,
+                GAsyncReadyCallback  callback,
+                gpointer             user_data)
 {
-  CcDateTimePanel *self = user_data;
-  GError *error;
+  gint64 unixtime;
 
-  error = NULL;
-  if (!timedate1_call_set_time_finish (self->priv->dtm,
-                                       res,
-                                       &error))
+  switch (change)
+    {
+    case CHANGE_NTP:
+      g_debug ("Setting NTP usage to %s", using_ntp ? "on" : "off");
+      timedate1_call_set_ntp (dtm,
+                              using_ntp,
+                              TRUE,
+                              cancellable,
+                              callback,
+                              user_data);
+      break;
+
+    case CHANGE_TIMEZONE:
+      g_debug ("Setting timezone to %s", timezone);
+      timedate1_call_set_timezone (dtm,
+                                   timezone,
+                                   TRUE,
+                                   cancellable,
+                                   callback,
+                                   user_data);
+      break;
+
+    case CHANGE_TIME:
+      /* timedated expects number of microseconds since 1 Jan 1970 UTC.
+       * The wall clock kept running since the edit, so keep the same
+       * distance from it as the user asked for. */
+      unixtime = g_get_real_time () + time_offset;
+
+      g_debug ("Setting time to %" G_GINT64_FORMAT, unixtime / G_USEC_PER_SEC);
+      timedate1_call_set_time (dtm,
+                               unixtime,
+                               FALSE,
+                               TRUE,
+                               cancellable,
+                               callback,
+                               user_data);
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+static gboolean
+finish_timedated_call (Timedate1      *dtm,
+                       PendingChange   change,
+                       GAsyncResult   *res,
+                       GError        **error)
+{
+  switch (change)
     {
-      /* TODO: display any error in a user friendly way */
+    case CHANGE_NTP:
+      return timedate1_call_set_ntp_finish (dtm, res, error);
+    case CHANGE_TIMEZONE:
+      return timedate1_call_set_timezone_finish (dtm, res, error);
+    case CHANGE_TIME:
+      return timedate1_call_set_time_finish (dtm, res, error);
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+static void
+warn_change_failed (PendingChange  change,
+                    const GError  *error)
+{
+  switch (change)
+    {
+    case CHANGE_NTP:
+      g_warning ("Could not set system to use NTP: %s", error->message);
+      break;
+    case CHANGE_TIMEZONE:
+      g_warning ("Could not set system timezone: %s", error->message);
+      break;
+    case CHANGE_TIME:
       g_warning ("Could not set system time: %s", error->message);
-      g_error_free (error);
+      break;
+    default:
+      g_assert_not_reached ();
     }
-  else
+}
+
+static gchar *
+format_change_error (PendingChange  change,
+                     const GError  *error)
+{
+  switch (change)
     {
-      update_time (self);
+    case CHANGE_NTP:
+      return g_strdup_printf (_("Could not change the automatic date & time: %s"), error->message);
+    case CHANGE_TIMEZONE:
+      return g_strdup_printf (_("Could not set the time zone: %s"), error->message);
+    case CHANGE_TIME:
+      return g_strdup_printf (_("Could not set the time: %s"), error->message);
+    default:
+      g_assert_not_reached ();
     }
 }
 
+/* The changes that were still pending when the panel went away.
+ * They keep the proxy alive, and are sent one after the other
+ * like the panel's own, until there are none left. */
+typedef struct
+{
+  Timedate1 *dtm;
+  guint pending_changes;
+  PendingChange applying_change;
+  gboolean using_ntp;
+  gchar *timezone;
+  gint64 time_offset;
+} LeftoverChanges;
+
+static void send_leftover_change (LeftoverChanges *leftover);
+
 static void
-set_timezone_cb (GObject      *source,
-                 GAsyncResult *res,
-                 gpointer      user_data)
+leftover_change_cb (GObject      *source,
+                    GAsyncResult *res,
+                    gpointer      user_data)
 {
-  CcDateTimePanel *self = user_data;
-  GError *error;
+  LeftoverChanges *leftover = user_data;
+  GError *error = NULL;
 
-  error = NULL;
-  if (!timedate1_call_set_timezone_finish (self->priv->dtm,
-                                           res,
-                                           &error))
+  if (!finish_timedated_call (leftover->dtm, leftover->applying_change, res, &error))
     {
-      /* TODO: display any error in a user friendly way */
-      g_warning ("Could not set system timezone: %s", error->message);
+      warn_change_failed (leftover->applying_change, error);
       g_error_free (error);
     }
+
+  send_leftover_change (leftover);
+}
+
+static void
+send_leftover_change (LeftoverChanges *leftover)
+{
+  PendingChange change;
+
+  if (leftover->pending_changes == 0)
+    {
+      g_object_unref (leftover->dtm);
+      g_free (leftover->timezone);
+      g_free (leftover);
+      return;
+    }
+
+  change = leftover->pending_changes & -leftover->pending_changes;
+  leftover->pending_changes &= ~change;
+  leftover->applying_change = change;
+
+  call_timedated (leftover->dtm,
+                  change,
+                  leftover->using_ntp,
+                  leftover->timezone,
+                  leftover->time_offset,
+                  NULL,
+                  leftover_change_cb,
+                  leftover);
+}
+
+/* Hands the pending changes over to a LeftoverChanges, with the
+ * values they would have been sent with */
+static void
+send_leftover_changes (CcDateTimePanel *self)
+{
+  CcDateTimePanelPrivate *priv = self->priv;
+  LeftoverChanges *leftover;
+
+  if (priv->pending_changes == 0 || priv->dtm == NULL)
+    return;
+
+  leftover = g_new0 (LeftoverChanges, 1);
+  leftover->dtm = g_object_ref (priv->dtm);
+  leftover->pending_changes = priv->pending_changes;
+  leftover->using_ntp = gtk_switch_get_active (GTK_SWITCH (W("network_time_switch")));
+  leftover->time_offset = priv->pending_time_offset;
+
+  if (priv->current_location != NULL)
+    leftover->timezone = g_strdup (priv->current_location->zone);
+  else
+    leftover->pending_changes &= ~CHANGE_TIMEZONE;
+
+  /* See send_change() */
+  if ((leftover->pending_changes & CHANGE_NTP) && leftover->using_ntp)
+    leftover->pending_changes &= ~CHANGE_TIME;
+
+  priv->pending_changes = 0;
+
+  send_leftover_change (leftover);
 }
 
+/* Tells whether the edits are waiting to be sent, being applied,
+ * or whether the last one failed */
 static void
-set_using_ntp_cb (GObject      *source,
-                  GAsyncResult *res,
-                  gpointer      user_data)
+update_status (CcDateTimePanel *self)
+{
+  CcDateTimePanelPrivate *priv = self->priv;
+  GtkWidget *label = W ("status_label");
+  GtkStyleContext *context = gtk_widget_get_style_context (label);
+  const gchar *text = NULL;
+
+  if (priv->applying_change != 0)
+    text = _("Applying the changes…");
+  else if (priv->pending_changes != 0)
+    text = _("The changes will be applied in a moment");
+  else
+    text = priv->change_error;
+
+  if (text == priv->change_error)
+    gtk_style_context_remove_class (context, GTK_STYLE_CLASS_DIM_LABEL);
+  else
+    gtk_style_context_add_class (context, GTK_STYLE_CLASS_DIM_LABEL);
+
+  gtk_label_set_text (GTK_LABEL (label), text);
+  gtk_widget_set_visible (label, text != NULL);
+}
+
+static void apply_next_change (CcDateTimePanel *self);
+
+static void
+change_applied_cb (GObject      *source,
+                   GAsyncResult *res,
+                   gpointer      user_data)
 {
   CcDateTimePanel *self = user_data;
+  PendingChange change = self->priv->applying_change;
   GError *error;
 
   error = NULL;
-  if (!timedate1_call_set_ntp_finish (self->priv->dtm,
-                                      res,
-                                      &error))
+  if (!finish_timedated_call (TIMEDATE1 (source), change, res, &error))
     {
-      /* TODO: display any error in a user friendly way */
-      g_warning ("Could not set system to use NTP: %s", error->message);
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          g_error_free (error);
+          return;
+        }
+
+      warn_change_failed (change, error);
+      g_free (self->priv->change_error);
+      self->priv->change_error = format_change_error (change, error);
       g_error_free (error);
     }
+  else if (change == CHANGE_TIME)
+    {
+      g_debug ("System time set");
+      update_time (self);
+    }
+
+  self->priv->applying_change = 0;
+  apply_next_change (self);
 }
 
+/* Sends a single change to timedated, with the values currently
+ * shown in the panel */
 static void
-queue_set_datetime (CcDateTimePanel *self)
+send_change (CcDateTimePanel *self,
+             PendingChange    change)
 {
-  gint64 unixtime;
+  CcDateTimePanelPrivate *priv = self->priv;
+  gboolean using_ntp;
+
+  priv->pending_changes &= ~change;
+
+  using_ntp = gtk_switch_get_active (GTK_SWITCH (W("network_time_switch")));
+
+  /* The time is about to be set by NTP, and timedated
+   * refuses to set it while NTP is in use anyway */
+  if (change == CHANGE_NTP && using_ntp)
+    priv->pending_changes &= ~CHANGE_TIME;
+
+  if (change == CHANGE_TIMEZONE && priv->current_location == NULL)
+    return;
 
-  /* timedated expects number of microseconds since 1 Jan 1970 UTC */
-  unixtime = g_date_time_to_unix (self->priv->date);
+  call_timedated (priv->dtm,
+                  change,
+                  using_ntp,
+                  priv->current_location ? priv->current_location->zone : NULL,
+                  priv->pending_time_offset,
+                  priv->cancellable,
+                  change_applied_cb,
+                  self);
 
-  timedate1_call_set_time (self->priv->dtm,
-                           unixtime * 1000000,
-                           FALSE,
-                           TRUE,
-                           self->priv->cancellable,
-                           set_time_cb,
-                           self);
+  priv->applying_change = change;
 }
 
+/* Sends the pending changes one after the other, so that they
+ * are applied in order, and at most once each per batch */
 static void
-queue_set_ntp (CcDateTimePanel *self)
+apply_next_change (CcDateTimePanel *self)
 {
   CcDateTimePanelPrivate *priv = self->priv;
-  gboolean using_ntp;
-  /* for now just do it */
-  using_ntp = gtk_switch_get_active (GTK_SWITCH (W("network_time_switch")));
 
-  timedate1_call_set_ntp (self->priv->dtm,
-                          using_ntp,
-                          TRUE,
-                          self->priv->cancellable,
-                          set_using_ntp_cb,
-                          self);
+  /* The user is still editing, wait for the next batch */
+  if (priv->applying_change == 0 && priv->apply_changes_id == 0)
+    {
+      while (priv->pending_changes != 0 && priv->applying_change == 0)
+        send_change (self, priv->pending_changes & -priv->pending_changes);
+    }
+
+  update_status (self);
+}
+
+static gboolean
+apply_changes_timeout (gpointer user_data)
+{
+  CcDateTimePanel *self = user_data;
+
+  self->priv->apply_changes_id = 0;
+  apply_next_change (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_change (CcDateTimePanel *self,
+              PendingChange    change)
+{
+  CcDateTimePanelPrivate *priv = self->priv;
+
+  priv->pending_changes |= change;
+  g_clear_pointer (&priv->change_error, g_free);
+
+  if (priv->apply_changes_id != 0)
+    g_source_remove (priv->apply_changes_id);
+  priv->apply_changes_id = g_timeout_add (APPLY_CHANGES_DELAY, apply_changes_timeout, self);
+  g_source_set_name_by_id (priv->apply_changes_id, "[gnome-control-center] apply_changes_timeout");
+
+  update_status (self);
+}
+
+static void
+queue_set_datetime (CcDateTimePanel *self)
+{
+  CcDateTimePanelPrivate *priv = self->priv;
+
+  priv->pending_time_offset = g_date_time_to_unix (priv->date) * G_USEC_PER_SEC
+                              - g_get_real_time ();
+  queue_change (self, CHANGE_TIME);
+}
+
+static void
+queue_set_ntp (CcDateTimePanel *self)
+{
+  queue_change (self, CHANGE_NTP);
 }
 
 static void
 queue_set_timezone (CcDateTimePanel *self)
 {
-  /* for now just do it */
-  if (self->priv->current_location)
-    {
-      timedate1_call_set_timezone (self->priv->dtm,
-                                   self->priv->current_location->zone,
-                                   TRUE,
-                                   self->priv->cancellable,
-                                   set_timezone_cb,
-                                   self);
-    }
+  queue_change (self, CHANGE_TIMEZONE);
 }
 
 static void
@@ -499,42 +782,12 @@ city_changed_cb (GtkEntryCompletion *entry_completion,
   return TRUE;
 }
 
-static char *
-translated_city_name (TzLocation *loc)
-{
-  char *country;
-  char *name;
-  char *zone_translated;
-  char **split_translated;
-  gint length;
-
-  /* Load the translation for it */
-  zone_translated = g_strdup (dgettext (GETTEXT_PACKAGE_TIMEZONES, loc->zone));
-  g_strdelimit (zone_translated, "_", ' ');
-  split_translated = g_regex_split_simple ("[\\x{2044}\\x{2215}\\x{29f8}\\x{ff0f}/]",
-                                           zone_translated,
-                                           0, 0);
-  g_free (zone_translated);
-
-  length = g_strv_length (split_translated);
-
-  country = gnome_get_country_from_code (loc->country, NULL);
-  /* Translators: "city, country" */
-  name = g_strdup_printf (C_("timezone loc", "%s, %s"),
-                          split_translated[length-1],
-                          country);
-  g_free (country);
-  g_strfreev (split_translated);
-
-  return name;
-}
-
 static void
 update_timezone (CcDateTimePanel *self)
 {
   CcDateTimePanelPrivate *priv = self->priv;
   char *bubble_text;
-  char *city_country;
+  const char *city_country;
   char *label;
   char *time_label;
   char *utc_label;
@@ -546,7 +799,7 @@ update_timezone (CcDateTimePanel *self)
   else
     use_ampm = FALSE;
 
-  city_country = translated_city_name (priv->current_location);
+  city_country = cc_city_names_get (priv->current_location)->display_name;
 
   /* Update the timezone on the listbow row */
   /* Translators: "timezone (details)" */
@@ -586,7 +839,6 @@ update_timezone (CcDateTimePanel *self)
 
   g_free (tz_desc);
   g_free (bubble_text);
-  g_free (city_country);
   g_free (time_label);
   g_free (utc_label);
 }
@@ -634,27 +886,126 @@ get_initial_timezone (CcDateTimePanel *self)
 }
 
 static void
-load_cities (TzLocation   *loc,
-             GtkListStore *city_store)
+load_cities (TzLocation  *loc,
+             CcCityIndex *index)
 {
-  char *human_readable;
-
-  human_readable = translated_city_name (loc);
-  gtk_list_store_insert_with_values (city_store, NULL, 0,
-                                     CITY_COL_CITY_HUMAN_READABLE, human_readable,
-                                     CITY_COL_ZONE, loc->zone,
-                                     -1);
-  g_free (human_readable);
+  const CcCityNames *names;
+  const char *city_names[3] = { NULL, };
+  const char *country_names[3] = { NULL, };
+  const char *english_city;
+
+  names = cc_city_names_get (loc);
+
+  /* The city can be searched in the current language and in English,
+   * and the same for the country */
+  english_city = strrchr (loc->zone, '/');
+  english_city = english_city ? english_city + 1 : loc->zone;
+
+  city_names[0] = names->city;
+  city_names[1] = english_city;
+  country_names[0] = names->country;
+  country_names[1] = names->english_country;
+
+  cc_city_index_add (index, names->display_name, loc->zone, city_names, country_names);
 }
 
-static void
-load_regions_model (GtkListStore *cities)
+/* The index is shared by all the instances of the panel, so that
+ * it only gets built the first time the panel is shown */
+static CcCityIndex *
+load_regions_model (void)
 {
+  static CcCityIndex *index = NULL;
   TzDB *db;
 
+  if (index != NULL)
+    return index;
+
+  index = cc_city_index_new ();
+
   db = tz_load_db ();
-  g_ptr_array_foreach (db->locations, (GFunc) load_cities, cities);
+  g_ptr_array_foreach (db->locations, (GFunc) load_cities, index);
   tz_db_free (db);
+
+  cc_city_names_save ();
+
+  return index;
+}
+
+/* Puts the best matches in the completion's rows, as the completion
+ * itself only knows about prefixes of a single column. Only the rows
+ * that changed are touched, and the ones left over from a longer list
+ * of matches are hidden rather than removed */
+static void
+timezone_search_changed (GtkEntry        *entry,
+                         CcDateTimePanel *self)
+{
+  CcDateTimePanelPrivate *priv = self->priv;
+  const GPtrArray *matches = NULL;
+  GtkListStore *store;
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+  gboolean valid;
+  gboolean row_matches;
+  gchar *zone;
+  guint i;
+
+  store = GTK_LIST_STORE (gtk_builder_get_object (priv->builder, "city-liststore"));
+  model = GTK_TREE_MODEL (store);
+
+  if (priv->city_index != NULL)
+    matches = cc_city_index_search (priv->city_index, gtk_entry_get_text (entry));
+
+  valid = gtk_tree_model_get_iter_first (model, &iter);
+  for (i = 0; matches != NULL && i < matches->len; i++)
+    {
+      CcCity *city = matches->pdata[i];
+
+      if (!valid)
+        {
+          gtk_list_store_insert_with_values (store, NULL, -1,
+                                             CITY_COL_CITY_HUMAN_READABLE, city->display_name,
+                                             CITY_COL_ZONE, city->zone,
+                                             CITY_COL_MATCHES, TRUE,
+                                             -1);
+          continue;
+        }
+
+      gtk_tree_model_get (model, &iter,
+                          CITY_COL_ZONE, &zone,
+                          CITY_COL_MATCHES, &row_matches,
+                          -1);
+      if (!row_matches || g_strcmp0 (zone, city->zone) != 0)
+        gtk_list_store_set (store, &iter,
+                            CITY_COL_CITY_HUMAN_READABLE, city->display_name,
+                            CITY_COL_ZONE, city->zone,
+                            CITY_COL_MATCHES, TRUE,
+                            -1);
+      g_free (zone);
+
+      valid = gtk_tree_model_iter_next (model, &iter);
+    }
+
+  for (; valid; valid = gtk_tree_model_iter_next (model, &iter))
+    {
+      gtk_tree_model_get (model, &iter, CITY_COL_MATCHES, &row_matches, -1);
+      if (row_matches)
+        gtk_list_store_set (store, &iter, CITY_COL_MATCHES, FALSE, -1);
+    }
+}
+
+static gboolean
+timezone_completion_match (GtkEntryCompletion *completion,
+                           const gchar        *key,
+                           GtkTreeIter        *iter,
+                           gpointer            user_data)
+{
+  gboolean matches;
+
+  gtk_tree_model_get (gtk_entry_completion_get_model (completion), iter,
+                      CITY_COL_MATCHES, &matches,
+                      -1);
+
+  return matches;
 }
 
 static void
@@ -696,9 +1047,22 @@ on_clock_changed (GnomeWallClock  *clock,
 		  CcDateTimePanel *panel)
 {
   CcDateTimePanelPrivate *priv = panel->priv;
+  GDateTime *now;
 
+  now = g_date_time_new_now_local ();
   g_date_time_unref (priv->date);
-  priv->date = g_date_time_new_now_local ();
+
+  /* Keep showing the time the user picked until it is sent */
+  if (priv->pending_changes & CHANGE_TIME)
+    {
+      priv->date = g_date_time_add (now, priv->pending_time_offset);
+      g_date_time_unref (now);
+    }
+  else
+    {
+      priv->date = now;
+    }
+
   update_time (panel);
   update_timezone (panel);
 }
@@ -1041,16 +1405,21 @@ setup_timezone_dialog (CcDateTimePanel *self)
   g_signal_connect (dialog, "delete-event",
                     G_CALLBACK (gtk_widget_hide_on_delete), NULL);
 
+  /* Before the completion, so that it sees the new matches */
+  g_signal_connect (entry, "changed",
+                    G_CALLBACK (timezone_search_changed), self);
+
   /* Create the completion object */
   completion = gtk_entry_completion_new ();
   gtk_entry_set_completion (GTK_ENTRY (entry), completion);
   g_object_unref (completion);
 
   completion_model = GTK_TREE_MODEL (gtk_builder_get_object (priv->builder,
-                                                             "city-modelsort"));
+                                                             "city-liststore"));
   gtk_entry_completion_set_model (completion, completion_model);
 
   gtk_entry_completion_set_text_column (completion, CITY_COL_CITY_HUMAN_READABLE);
+  gtk_entry_completion_set_match_func (completion, timezone_completion_match, NULL, NULL);
 }
 
 static char *
@@ -1205,7 +1574,6 @@ cc_date_time_panel_init (CcDateTimePanel *self)
   CcDateTimePanelPrivate *priv;
   GtkWidget *widget;
   GError *error;
-  GtkTreeModelSort *city_modelsort;
   const char *ampm;
   int ret;
   const char *date_grid_name;
@@ -1344,12 +1712,7 @@ cc_date_time_panel_init (CcDateTimePanel *self)
 
   update_time (self);
 
-  load_regions_model (GTK_LIST_STORE (gtk_builder_get_object (priv->builder,
-                                                              "city-liststore")));
-
-  city_modelsort = GTK_TREE_MODEL_SORT (gtk_builder_get_object (priv->builder, "city-modelsort"));
-  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (city_modelsort), CITY_COL_CITY_HUMAN_READABLE,
-                                        GTK_SORT_ASCENDING);
+  priv->city_index = load_regions_model ();
 
   /* After the initial setup, so we can be sure that
    * the model is filled up */
@@ -25,6 +25,8 @@
 #include <math.h>
 #include <string.h>
 #include "tz.h"
+#include "cc-city-names.h"
+#include "cc-zone-raster.h"
 
 G_DEFINE_TYPE (CcTimezoneMap, cc_timezone_map, GTK_TYPE_WIDGET)
 
@@ -36,34 +38,47 @@ G_DEFINE_TYPE (CcTimezoneMap, cc_timezone_map, GTK_TYPE_WIDGET)
 
 #define DATETIME_RESOURCE_PATH "/org/gnome/control-center/datetime"
 
-typedef struct
-{
-  gdouble offset;
-  guchar red;
-  guchar green;
-  guchar blue;
-  guchar alpha;
-} CcTimezoneMapOffset;
+/* Size in pixels of the cells of the grid used to find the closest city */
+#define GRID_CELL_SIZE 32
+/* Distance in pixels from the pointer under which a city is hovered */
+#define HOVER_RADIUS 12
 
 struct _CcTimezoneMapPrivate
 {
   GdkPixbuf *orig_background;
   GdkPixbuf *orig_background_dim;
-  GdkPixbuf *orig_color_map;
 
-  GdkPixbuf *background;
-  GdkPixbuf *color_map;
+  /* Scaled to the allocation and scale factor, built on demand */
+  cairo_surface_t *background;
+  GHashTable *hilights;
+  cairo_surface_t *cities;
+
   GdkPixbuf *pin;
 
-  guchar *visible_map_pixels;
-  gint visible_map_rowstride;
+  CcZoneRaster *zones;
 
   gdouble selected_offset;
 
   TzDB *tzdb;
   TzLocation *location;
+  TzLocation *hover_location;
+
+  /* The locations projected to a 1x1 map, as x, y pairs in the
+   * order of the database, which is all the trigonometry needed */
+  gfloat *unit_coords;
+
+  /* The locations projected to the allocation, as x, y pairs bucketed
+   * by grid cell, cell i holding points grid[i] to grid[i + 1] - 1 */
+  gfloat *coords;
+  TzLocation **coord_locations;
+  guint n_coords;
+  guint *grid;
+  gint grid_cols;
+  gint grid_rows;
 
   gchar *bubble_text;
+
+  gboolean show_cities;
 };
 
 enum
@@ -75,49 +90,6 @@ enum
 static guint signals[LAST_SIGNAL];
 
 
-static CcTimezoneMapOffset color_codes[] =
-{
-    {-11.0, 43, 0, 0, 255 },
-    {-10.0, 85, 0, 0, 255 },
-    {-9.5, 102, 255, 0, 255 },
-    {-9.0, 128, 0, 0, 255 },
-    {-8.0, 170, 0, 0, 255 },
-    {-7.0, 212, 0, 0, 255 },
-    {-6.0, 255, 0, 1, 255 }, // north
-    {-6.0, 255, 0, 0, 255 }, // south
-    {-5.0, 255, 42, 42, 255 },
-    {-4.5, 192, 255, 0, 255 },
-    {-4.0, 255, 85, 85, 255 },
-    {-3.5, 0, 255, 0, 255 },
-    {-3.0, 255, 128, 128, 255 },
-    {-2.0, 255, 170, 170, 255 },
-    {-1.0, 255, 213, 213, 255 },
-    {0.0, 43, 17, 0, 255 },
-    {1.0, 85, 34, 0, 255 },
-    {2.0, 128, 51, 0, 255 },
-    {3.0, 170, 68, 0, 255 },
-    {3.5, 0, 255, 102, 255 },
-    {4.0, 212, 85, 0, 255 },
-    {4.5, 0, 204, 255, 255 },
-    {5.0, 255, 102, 0, 255 },
-    {5.5, 0, 102, 255, 255 },
-    {5.75, 0, 238, 207, 247 },
-    {6.0, 255, 127, 42, 255 },
-    {6.5, 204, 0, 254, 254 },
-    {7.0, 255, 153, 85, 255 },
-    {8.0, 255, 179, 128, 255 },
-    {9.0, 255, 204, 170, 255 },
-    {9.5, 170, 0, 68, 250 },
-    {10.0, 255, 230, 213, 255 },
-    {10.5, 212, 124, 21, 250 },
-    {11.0, 212, 170, 0, 255 },
-    {11.5, 249, 25, 87, 253 },
-    {12.0, 255, 204, 0, 255 },
-    {12.75, 254, 74, 100, 248 },
-    {13.0, 255, 85, 153, 250 },
-    {-100, 0, 0, 0, 0 }
-};
-
 
 static void
 cc_timezone_map_dispose (GObject *object)
@@ -126,18 +98,14 @@ cc_timezone_map_dispose (GObject *object)
 
   g_clear_object (&priv->orig_background);
   g_clear_object (&priv->orig_background_dim);
-  g_clear_object (&priv->orig_color_map);
-  g_clear_object (&priv->background);
+  g_clear_pointer (&priv->background, cairo_surface_destroy);
+  g_clear_pointer (&priv->hilights, g_hash_table_destroy);
+  g_clear_pointer (&priv->cities, cairo_surface_destroy);
   g_clear_object (&priv->pin);
   g_clear_pointer (&priv->bubble_text, g_free);
-
-  if (priv->color_map)
-    {
-      g_clear_object (&priv->color_map);
-
-      priv->visible_map_pixels = NULL;
-      priv->visible_map_rowstride = 0;
-    }
+  g_clear_pointer (&priv->coords, g_free);
+  g_clear_pointer (&priv->coord_locations, g_free);
+  g_clear_pointer (&priv->grid, g_free);
 
   G_OBJECT_CLASS (cc_timezone_map_parent_class)->dispose (object);
 }
@@ -153,6 +121,8 @@ cc_timezone_map_finalize (GObject *object)
       priv->tzdb = NULL;
     }
 
+  g_clear_pointer (&priv->unit_coords, g_free);
+  g_clear_pointer (&priv->zones, cc_zone_raster_free);
 
   G_OBJECT_CLASS (cc_timezone_map_parent_class)->finalize (object);
 }
@@ -190,36 +160,368 @@ cc_timezone_map_get_preferred_height (GtkWidget *widget,
     *natural = size;
 }
 
+/* The projection of the background image, as a fraction of its size */
+static gdouble
+get_unit_x (gdouble longitude)
+{
+  const gdouble xdeg_offset = -6;
+
+  return (180.0 + longitude) / 360.0 + xdeg_offset / 180.0;
+}
+
+static gdouble
+radians (gdouble degrees)
+{
+  return (degrees / 360.0) * G_PI * 2;
+}
+
+static gdouble
+get_unit_y (gdouble latitude)
+{
+  gdouble bottom_lat = -59;
+  gdouble top_lat = 81;
+  gdouble top_per, y, full_range, top_offset, map_range;
+
+  top_per = top_lat / 180.0;
+  y = 1.25 * log (tan (G_PI_4 + 0.4 * radians (latitude)));
+  full_range = 4.6068250867599998;
+  top_offset = full_range * top_per;
+  map_range = fabs (1.25 * log (tan (G_PI_4 + 0.4 * radians (bottom_lat))) - top_offset);
+  y = fabs (y - top_offset);
+  y = y / map_range;
+  return y;
+}
+
+static gdouble
+convert_longitude_to_x (gdouble longitude, gint map_width)
+{
+  return map_width * get_unit_x (longitude);
+}
+
+static gdouble
+convert_latitude_to_y (gdouble latitude, gdouble map_height)
+{
+  return map_height * get_unit_y (latitude);
+}
+
+/* Projects all the locations once, scaling them to the allocation
+ * is then a multiplication, see build_location_grid() */
 static void
-cc_timezone_map_size_allocate (GtkWidget     *widget,
-                               GtkAllocation *allocation)
+project_locations (CcTimezoneMap *map)
+{
+  CcTimezoneMapPrivate *priv = map->priv;
+  const GPtrArray *array;
+  guint i;
+
+  array = tz_get_locations (priv->tzdb);
+
+  priv->n_coords = array->len;
+  priv->unit_coords = g_new (gfloat, 2 * array->len);
+  for (i = 0; i < array->len; i++)
+    {
+      TzLocation *loc = array->pdata[i];
+
+      priv->unit_coords[2 * i] = get_unit_x (loc->longitude);
+      priv->unit_coords[2 * i + 1] = get_unit_y (loc->latitude);
+    }
+}
+
+static guint
+get_cell (CcTimezoneMap *map,
+          gdouble        x,
+          gdouble        y)
+{
+  CcTimezoneMapPrivate *priv = map->priv;
+  gint col, row;
+
+  /* Points off the map go in the border cells */
+  col = CLAMP ((gint) floor (x / GRID_CELL_SIZE), 0, priv->grid_cols - 1);
+  row = CLAMP ((gint) floor (y / GRID_CELL_SIZE), 0, priv->grid_rows - 1);
+
+  return row * priv->grid_cols + col;
+}
+
+static void
+build_location_grid (CcTimezoneMap *map,
+                     gint           width,
+                     gint           height)
+{
+  CcTimezoneMapPrivate *priv = map->priv;
+  const GPtrArray *array;
+  gfloat *coords;
+  guint *cells;
+  guint n_cells, i;
+
+  array = tz_get_locations (priv->tzdb);
+  g_assert (array->len == priv->n_coords);
+
+  priv->grid_cols = MAX (width, 1) / GRID_CELL_SIZE + 1;
+  priv->grid_rows = MAX (height, 1) / GRID_CELL_SIZE + 1;
+  n_cells = priv->grid_cols * priv->grid_rows;
+
+  g_free (priv->coords);
+  g_free (priv->coord_locations);
+  g_free (priv->grid);
+  priv->coords = g_new (gfloat, 2 * priv->n_coords);
+  priv->coord_locations = g_new (TzLocation *, priv->n_coords);
+  priv->grid = g_new0 (guint, n_cells + 1);
+
+  /* Scale everything in one straight loop, which gets vectorized */
+  coords = g_new (gfloat, 2 * priv->n_coords);
+  for (i = 0; i < 2 * priv->n_coords; i += 2)
+    {
+      coords[i] = priv->unit_coords[i] * width;
+      coords[i + 1] = priv->unit_coords[i + 1] * height;
+    }
+
+  /* Then count the points in each cell */
+  cells = g_new (guint, priv->n_coords);
+  for (i = 0; i < priv->n_coords; i++)
+    {
+      cells[i] = get_cell (map, coords[2 * i], coords[2 * i + 1]);
+      priv->grid[cells[i] + 1]++;
+    }
+
+  for (i = 0; i < n_cells; i++)
+    priv->grid[i + 1] += priv->grid[i];
+
+  /* Then place the points in their cell, using the cell starts as cursors */
+  for (i = 0; i < priv->n_coords; i++)
+    {
+      guint j = priv->grid[cells[i]]++;
+
+      priv->coords[2 * j] = coords[2 * i];
+      priv->coords[2 * j + 1] = coords[2 * i + 1];
+      priv->coord_locations[j] = array->pdata[i];
+    }
+
+  for (i = n_cells; i > 0; i--)
+    priv->grid[i] = priv->grid[i - 1];
+  priv->grid[0] = 0;
+
+  g_free (cells);
+  g_free (coords);
+}
+
+/* Returns the location closest to (x, y), if it is less than
+ * max_dist away, by looking at rings of cells of increasing size
+ * around the point, until the remaining ones can only be further */
+static TzLocation *
+get_closest_location (CcTimezoneMap *map,
+                      gdouble        x,
+                      gdouble        y,
+                      gdouble        max_dist)
+{
+  CcTimezoneMapPrivate *priv = map->priv;
+  TzLocation *closest = NULL;
+  gdouble best;
+  gint col, row, r, max_r;
+
+  if (priv->grid == NULL)
+    return NULL;
+
+  best = max_dist * max_dist;
+  col = CLAMP ((gint) floor (x / GRID_CELL_SIZE), 0, priv->grid_cols - 1);
+  row = CLAMP ((gint) floor (y / GRID_CELL_SIZE), 0, priv->grid_rows - 1);
+  max_r = MAX (priv->grid_cols, priv->grid_rows);
+
+  for (r = 0; r <= max_r; r++)
+    {
+      gdouble bound = (gdouble) (r - 1) * GRID_CELL_SIZE;
+      gint c, l;
+
+      if (r > 0 && bound * bound > best)
+        break;
+
+      for (l = row - r; l <= row + r; l++)
+        {
+          if (l < 0 || l >= priv->grid_rows)
+            continue;
+
+          for (c = col - r; c <= col + r; c++)
+            {
+              guint cell, i;
+
+              if (c < 0 || c >= priv->grid_cols)
+                continue;
+
+              /* Only the outline of the ring is new */
+              if (ABS (l - row) != r && ABS (c - col) != r)
+                continue;
+
+              cell = l * priv->grid_cols + c;
+              for (i = priv->grid[cell]; i < priv->grid[cell + 1]; i++)
+                {
+                  gdouble dx = priv->coords[2 * i] - x;
+                  gdouble dy = priv->coords[2 * i + 1] - y;
+                  gdouble dist = dx * dx + dy * dy;
+
+                  if (dist < best)
+                    {
+                      best = dist;
+                      closest = priv->coord_locations[i];
+                    }
+                }
+            }
+        }
+    }
+
+  return closest;
+}
+
+static void
+clear_scaled_surfaces (CcTimezoneMap *map)
+{
+  CcTimezoneMapPrivate *priv = map->priv;
+
+  g_clear_pointer (&priv->background, cairo_surface_destroy);
+  g_hash_table_remove_all (priv->hilights);
+  g_clear_pointer (&priv->cities, cairo_surface_destroy);
+}
+
+static cairo_surface_t *
+create_scaled_surface (GtkWidget *widget,
+                       GdkPixbuf *pixbuf)
+{
+  GtkAllocation alloc;
+  GdkPixbuf *scaled;
+  cairo_surface_t *surface;
+  gint scale;
+
+  gtk_widget_get_allocation (widget, &alloc);
+  scale = gtk_widget_get_scale_factor (widget);
+
+  scaled = gdk_pixbuf_scale_simple (pixbuf,
+                                    MAX (alloc.width * scale, 1),
+                                    MAX (alloc.height * scale, 1),
+                                    GDK_INTERP_BILINEAR);
+  surface = gdk_cairo_surface_create_from_pixbuf (scaled, scale,
+                                                  gtk_widget_get_window (widget));
+  g_object_unref (scaled);
+
+  return surface;
+}
+
+static cairo_surface_t *
+get_background (GtkWidget *widget)
 {
   CcTimezoneMapPrivate *priv = CC_TIMEZONE_MAP (widget)->priv;
   GdkPixbuf *pixbuf;
 
   if (priv->background)
-    g_object_unref (priv->background);
+    return priv->background;
 
   if (!gtk_widget_is_sensitive (widget))
     pixbuf = priv->orig_background_dim;
   else
     pixbuf = priv->orig_background;
 
-  priv->background = gdk_pixbuf_scale_simple (pixbuf,
-                                              allocation->width,
-                                              allocation->height,
-                                              GDK_INTERP_BILINEAR);
+  priv->background = create_scaled_surface (widget, pixbuf);
+
+  return priv->background;
+}
+
+static cairo_surface_t *
+get_hilight (GtkWidget *widget)
+{
+  CcTimezoneMapPrivate *priv = CC_TIMEZONE_MAP (widget)->priv;
+  cairo_surface_t *surface;
+  GdkPixbuf *orig_hilight;
+  GError *err = NULL;
+  gchar *file;
+  char buf[16];
+
+  if (gtk_widget_is_sensitive (widget))
+    {
+      file = g_strdup_printf (DATETIME_RESOURCE_PATH "/timezone_%s.png",
+                              g_ascii_formatd (buf, sizeof (buf),
+                                               "%g", priv->selected_offset));
+    }
+  else
+    {
+      file = g_strdup_printf (DATETIME_RESOURCE_PATH "/timezone_%s_dim.png",
+                              g_ascii_formatd (buf, sizeof (buf),
+                                               "%g", priv->selected_offset));
+
+    }
+
+  /* A missing hilight is cached as NULL, so it only gets warned about once */
+  if (g_hash_table_lookup_extended (priv->hilights, file, NULL, (gpointer *) &surface))
+    {
+      g_free (file);
+      return surface;
+    }
+
+  orig_hilight = gdk_pixbuf_new_from_resource (file, &err);
+
+  if (!orig_hilight)
+    {
+      g_warning ("Could not load hilight: %s",
+                 (err) ? err->message : "Unknown Error");
+      if (err)
+        g_clear_error (&err);
+      surface = NULL;
+    }
+  else
+    {
+      surface = create_scaled_surface (widget, orig_hilight);
+      g_object_unref (orig_hilight);
+    }
+
+  g_hash_table_insert (priv->hilights, file, surface);
+
+  return surface;
+}
+
+/* All the cities as dots, drawn as a single path */
+static cairo_surface_t *
+get_cities (GtkWidget *widget)
+{
+  CcTimezoneMapPrivate *priv = CC_TIMEZONE_MAP (widget)->priv;
+  GtkAllocation alloc;
+  cairo_t *cr;
+  gint scale;
+  guint i;
+
+  if (priv->cities)
+    return priv->cities;
+
+  gtk_widget_get_allocation (widget, &alloc);
+  scale = gtk_widget_get_scale_factor (widget);
 
-  if (priv->color_map)
-    g_object_unref (priv->color_map);
+  priv->cities = gdk_window_create_similar_image_surface (gtk_widget_get_window (widget),
+                                                          CAIRO_FORMAT_ARGB32,
+                                                          MAX (alloc.width * scale, 1),
+                                                          MAX (alloc.height * scale, 1),
+                                                          scale);
 
-  priv->color_map = gdk_pixbuf_scale_simple (priv->orig_color_map,
-                                             allocation->width,
-                                             allocation->height,
-                                             GDK_INTERP_BILINEAR);
+  cr = cairo_create (priv->cities);
+  for (i = 0; i < priv->n_coords; i++)
+    {
+      cairo_new_sub_path (cr);
+      cairo_arc (cr, priv->coords[2 * i], priv->coords[2 * i + 1], 1.5, 0, 2 * G_PI);
+    }
+  cairo_set_source_rgba (cr, 0.2, 0.2, 0.2, 0.6);
+  cairo_fill (cr);
+  cairo_destroy (cr);
 
-  priv->visible_map_pixels = gdk_pixbuf_get_pixels (priv->color_map);
-  priv->visible_map_rowstride = gdk_pixbuf_get_rowstride (priv->color_map);
+  return priv->cities;
+}
+
+static void
+cc_timezone_map_size_allocate (GtkWidget     *widget,
+                               GtkAllocation *allocation)
+{
+  CcTimezoneMapPrivate *priv = CC_TIMEZONE_MAP (widget)->priv;
+  GtkAllocation old_alloc;
+
+  gtk_widget_get_allocation (widget, &old_alloc);
+  if (old_alloc.width != allocation->width || old_alloc.height != allocation->height)
+    clear_scaled_surfaces (CC_TIMEZONE_MAP (widget));
+
+  if (priv->coords == NULL ||
+      old_alloc.width != allocation->width || old_alloc.height != allocation->height)
+    build_location_grid (CC_TIMEZONE_MAP (widget), allocation->width, allocation->height);
 
   GTK_WIDGET_CLASS (cc_timezone_map_parent_class)->size_allocate (widget,
                                                                   allocation);
@@ -243,7 +545,8 @@ cc_timezone_map_realize (GtkWidget *widget)
   attr.x = allocation.x;
   attr.y = allocation.y;
   attr.event_mask = gtk_widget_get_events (widget)
-                                 | GDK_EXPOSURE_MASK | GDK_BUTTON_PRESS_MASK;
+                                 | GDK_EXPOSURE_MASK | GDK_BUTTON_PRESS_MASK
+                                 | GDK_POINTER_MOTION_MASK | GDK_LEAVE_NOTIFY_MASK;
 
   window = gdk_window_new (gtk_widget_get_parent_window (widget), &attr,
                            GDK_WA_X | GDK_WA_Y);
@@ -253,42 +556,6 @@ cc_timezone_map_realize (GtkWidget *widget)
 }
 
 
-static gdouble
-convert_longitude_to_x (gdouble longitude, gint map_width)
-{
-  const gdouble xdeg_offset = -6;
-  gdouble x;
-
-  x = (map_width * (180.0 + longitude) / 360.0)
-    + (map_width * xdeg_offset / 180.0);
-
-  return x;
-}
-
-static gdouble
-radians (gdouble degrees)
-{
-  return (degrees / 360.0) * G_PI * 2;
-}
-
-static gdouble
-convert_latitude_to_y (gdouble latitude, gdouble map_height)
-{
-  gdouble bottom_lat = -59;
-  gdouble top_lat = 81;
-  gdouble top_per, y, full_range, top_offset, map_range;
-
-  top_per = top_lat / 180.0;
-  y = 1.25 * log (tan (G_PI_4 + 0.4 * radians (latitude)));
-  full_range = 4.6068250867599998;
-  top_offset = full_range * top_per;
-  map_range = fabs (1.25 * log (tan (G_PI_4 + 0.4 * radians (bottom_lat))) - top_offset);
-  y = fabs (y - top_offset);
-  y = y / map_range;
-  y = y * map_height;
-  return y;
-}
-
 static void
 draw_text_bubble (cairo_t *cr,
                   GtkWidget *widget,
@@ -366,55 +633,41 @@ cc_timezone_map_draw (GtkWidget *widget,
                       cairo_t   *cr)
 {
   CcTimezoneMapPrivate *priv = CC_TIMEZONE_MAP (widget)->priv;
-  GdkPixbuf *hilight, *orig_hilight;
+  cairo_surface_t *hilight;
   GtkAllocation alloc;
-  gchar *file;
-  GError *err = NULL;
   gdouble pointx, pointy;
-  char buf[16];
 
   gtk_widget_get_allocation (widget, &alloc);
 
   /* paint background */
-  gdk_cairo_set_source_pixbuf (cr, priv->background, 0, 0);
+  cairo_set_source_surface (cr, get_background (widget), 0, 0);
   cairo_paint (cr);
 
   /* paint hilight */
-  if (gtk_widget_is_sensitive (widget))
-    {
-      file = g_strdup_printf (DATETIME_RESOURCE_PATH "/timezone_%s.png",
-                              g_ascii_formatd (buf, sizeof (buf),
-                                               "%g", priv->selected_offset));
-    }
-  else
+  hilight = get_hilight (widget);
+  if (hilight)
     {
-      file = g_strdup_printf (DATETIME_RESOURCE_PATH "/timezone_%s_dim.png",
-                              g_ascii_formatd (buf, sizeof (buf),
-                                               "%g", priv->selected_offset));
-
+      cairo_set_source_surface (cr, hilight, 0, 0);
+      cairo_paint (cr);
     }
 
-  orig_hilight = gdk_pixbuf_new_from_resource (file, &err);
-  g_free (file);
-  file = NULL;
-
-  if (!orig_hilight)
+  if (priv->show_cities)
     {
-      g_warning ("Could not load hilight: %s",
-                 (err) ? err->message : "Unknown Error");
-      if (err)
-        g_clear_error (&err);
+      cairo_set_source_surface (cr, get_cities (widget), 0, 0);
+      cairo_paint (cr);
     }
-  else
-    {
 
-      hilight = gdk_pixbuf_scale_simple (orig_hilight, alloc.width,
-                                         alloc.height, GDK_INTERP_BILINEAR);
-      gdk_cairo_set_source_pixbuf (cr, hilight, 0, 0);
-
-      cairo_paint (cr);
-      g_object_unref (hilight);
-      g_object_unref (orig_hilight);
+  if (priv->hover_location && priv->hover_location != priv->location)
+    {
+      pointx = convert_longitude_to_x (priv->hover_location->longitude, alloc.width);
+      pointy = convert_latitude_to_y (priv->hover_location->latitude, alloc.height);
+
+      cairo_arc (cr, floor (pointx) + 0.5, floor (pointy) + 0.5, 3.5, 0, 2 * G_PI);
+      cairo_set_source_rgba (cr, 1, 1, 1, 0.9);
+      cairo_fill_preserve (cr);
+      cairo_set_source_rgba (cr, 0.2, 0.2, 0.2, 0.7);
+      cairo_set_line_width (cr, 1);
+      cairo_stroke (cr);
     }
 
   if (priv->location)
@@ -466,13 +719,18 @@ static void
 cc_timezone_map_state_flags_changed (GtkWidget     *widget,
                                      GtkStateFlags  prev_state)
 {
+  CcTimezoneMapPrivate *priv = CC_TIMEZONE_MAP (widget)->priv;
+
   update_cursor (widget);
 
+  /* The dimmed background is only used when insensitive */
+  if (((prev_state & GTK_STATE_FLAG_INSENSITIVE) != 0) != !gtk_widget_is_sensitive (widget))
+    g_clear_pointer (&priv->background, cairo_surface_destroy);
+
   if (GTK_WIDGET_CLASS (cc_timezone_map_parent_class)->state_flags_changed)
     GTK_WIDGET_CLASS (cc_timezone_map_parent_class)->state_flags_changed (widget, prev_state);
 }
 
-
 static void
 cc_timezone_map_class_init (CcTimezoneMapClass *klass)
 {
@@ -503,19 +761,6 @@ cc_timezone_map_class_init (CcTimezoneMapClass *klass)
 }
 
 
-static gint
-sort_locations (TzLocation *a,
-                TzLocation *b)
-{
-  if (a->dist > b->dist)
-    return 1;
-
-  if (a->dist < b->dist)
-    return -1;
-
-  return 0;
-}
-
 static void
 set_location (CcTimezoneMap *map,
               TzLocation    *location)
@@ -527,7 +772,7 @@ set_location (CcTimezoneMap *map,
 
   info = tz_info_from_location (priv->location);
 
-  priv->selected_offset = tz_location_get_utc_offset (priv->location)
+  priv->selected_offset = info->utc_offset
     / (60.0*60.0) + ((info->daylight) ? -1.0 : 0.0);
 
   g_signal_emit (map, signals[LOCATION_CHANGED], 0, priv->location);
@@ -541,69 +786,91 @@ button_press_event (GtkWidget      *widget,
 {
   CcTimezoneMapPrivate *priv = CC_TIMEZONE_MAP (widget)->priv;
   gint x, y;
-  guchar r, g, b, a;
-  guchar *pixels;
-  gint rowstride;
-  gint i;
-
-  const GPtrArray *array;
-  gint width, height;
-  GList *distances = NULL;
   GtkAllocation alloc;
+  TzLocation *location;
+  gdouble zone_offset;
+  gboolean in_zone = FALSE;
 
   x = event->x;
   y = event->y;
 
+  gtk_widget_get_allocation (widget, &alloc);
 
-  rowstride = priv->visible_map_rowstride;
-  pixels = priv->visible_map_pixels;
+  /* Sample the middle of the pixel */
+  if (priv->zones)
+    in_zone = cc_zone_raster_get_offset (priv->zones,
+                                         (x + 0.5) / alloc.width,
+                                         (y + 0.5) / alloc.height,
+                                         &zone_offset);
 
-  r = pixels[(rowstride * y + x * 4)];
-  g = pixels[(rowstride * y + x * 4) + 1];
-  b = pixels[(rowstride * y + x * 4) + 2];
-  a = pixels[(rowstride * y + x * 4) + 3];
+  /* work out the co-ordinates */
 
+  location = get_closest_location (CC_TIMEZONE_MAP (widget), x, y, G_MAXDOUBLE);
+  if (location)
+    set_location (CC_TIMEZONE_MAP (widget), location);
 
-  for (i = 0; color_codes[i].offset != -100; i++)
-    {
-       if (color_codes[i].red == r && color_codes[i].green == g
-           && color_codes[i].blue == b && color_codes[i].alpha == a)
-         {
-           priv->selected_offset = color_codes[i].offset;
-         }
-    }
+  /* The zone clicked is highlighted, even if the closest city is
+   * across its border; the city's offset only stands in at sea */
+  if (in_zone)
+    priv->selected_offset = zone_offset;
 
   gtk_widget_queue_draw (widget);
 
-  /* work out the co-ordinates */
+  return TRUE;
+}
 
-  array = tz_get_locations (priv->tzdb);
+static void
+set_hover_location (CcTimezoneMap *map,
+                    TzLocation    *location)
+{
+  CcTimezoneMapPrivate *priv = map->priv;
 
-  gtk_widget_get_allocation (widget, &alloc);
-  width = alloc.width;
-  height = alloc.height;
+  if (priv->hover_location == location)
+    return;
 
-  for (i = 0; i < array->len; i++)
-    {
-      gdouble pointx, pointy, dx, dy;
-      TzLocation *loc = array->pdata[i];
+  priv->hover_location = location;
+
+  gtk_widget_trigger_tooltip_query (GTK_WIDGET (map));
+  gtk_widget_queue_draw (GTK_WIDGET (map));
+}
+
+static gboolean
+motion_notify_event (GtkWidget      *widget,
+                     GdkEventMotion *event)
+{
+  CcTimezoneMap *map = CC_TIMEZONE_MAP (widget);
 
-      pointx = convert_longitude_to_x (loc->longitude, width);
-      pointy = convert_latitude_to_y (loc->latitude, height);
+  if (!gtk_widget_is_sensitive (widget))
+    return FALSE;
 
-      dx = pointx - x;
-      dy = pointy - y;
+  set_hover_location (map, get_closest_location (map, event->x, event->y, HOVER_RADIUS));
 
-      loc->dist = dx * dx + dy * dy;
-      distances = g_list_prepend (distances, loc);
+  return FALSE;
+}
 
-    }
-  distances = g_list_sort (distances, (GCompareFunc) sort_locations);
+static gboolean
+leave_notify_event (GtkWidget        *widget,
+                    GdkEventCrossing *event)
+{
+  set_hover_location (CC_TIMEZONE_MAP (widget), NULL);
 
+  return FALSE;
+}
+
+static gboolean
+query_tooltip (GtkWidget  *widget,
+               gint        x,
+               gint        y,
+               gboolean    keyboard_mode,
+               GtkTooltip *tooltip)
+{
+  CcTimezoneMapPrivate *priv = CC_TIMEZONE_MAP (widget)->priv;
 
-  set_location (CC_TIMEZONE_MAP (widget), (TzLocation*) distances->data);
+  if (keyboard_mode || priv->hover_location == NULL)
+    return FALSE;
 
-  g_list_free (distances);
+  /* The same translated "city, country" as the rest of the panel */
+  gtk_tooltip_set_text (tooltip, cc_city_names_get (priv->hover_location)->display_name);
 
   return TRUE;
 }
@@ -613,9 +880,13 @@ cc_timezone_map_init (CcTimezoneMap *self)
 {
   CcTimezoneMapPrivate *priv;
   GError *err = NULL;
+  GBytes *zones;
 
   priv = self->priv = TIMEZONE_MAP_PRIVATE (self);
 
+  priv->hilights = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          (GDestroyNotify) cairo_surface_destroy);
+
   priv->orig_background = gdk_pixbuf_new_from_resource (DATETIME_RESOURCE_PATH "/bg.png",
                                                         &err);
 
@@ -636,12 +907,18 @@ cc_timezone_map_init (CcTimezoneMap *self)
       g_clear_error (&err);
     }
 
-  priv->orig_color_map = gdk_pixbuf_new_from_resource (DATETIME_RESOURCE_PATH "/cc.png",
-                                                       &err);
-  if (!priv->orig_color_map)
+  zones = g_resources_lookup_data (DATETIME_RESOURCE_PATH "/zones.rle",
+                                   G_RESOURCE_LOOKUP_FLAGS_NONE, &err);
+  if (zones)
     {
-      g_warning ("Could not load background image: %s",
-                 (err) ? err->message : "Unknown error");
+      priv->zones = cc_zone_raster_new (zones);
+      g_bytes_unref (zones);
+    }
+
+  if (!priv->zones)
+    {
+      g_warning ("Could not load timezone raster: %s",
+                 (err) ? err->message : "Invalid data");
       g_clear_error (&err);
     }
 
@@ -655,9 +932,19 @@ cc_timezone_map_init (CcTimezoneMap *self)
     }
 
   priv->tzdb = tz_load_db ();
+  project_locations (self);
 
   g_signal_connect (self, "button-press-event", G_CALLBACK (button_press_event),
                     NULL);
+  g_signal_connect (self, "motion-notify-event", G_CALLBACK (motion_notify_event),
+                    NULL);
+  g_signal_connect (self, "leave-notify-event", G_CALLBACK (leave_notify_event),
+                    NULL);
+  g_signal_connect (self, "query-tooltip", G_CALLBACK (query_tooltip),
+                    NULL);
+  gtk_widget_set_has_tooltip (GTK_WIDGET (self), TRUE);
+  g_signal_connect (self, "notify::scale-factor", G_CALLBACK (clear_scaled_surfaces),
+                    NULL);
 }
 
 CcTimezoneMap *
@@ -717,3 +1004,35 @@ cc_timezone_map_get_location (CcTimezoneMap *map)
 {
   return map->priv->location;
 }
+
+/* The UTC offset of the highlighted zone, in hours */
+gdouble
+cc_timezone_map_get_selected_offset (CcTimezoneMap *map)
+{
+  g_return_val_if_fail (CC_IS_TIMEZONE_MAP (map), 0.0);
+
+  return map->priv->selected_offset;
+}
+
+/* Draws every city as a dot, to show where there are some to pick */
+void
+cc_timezone_map_set_show_cities (CcTimezoneMap *map,
+                                 gboolean       show_cities)
+{
+  g_return_if_fail (CC_IS_TIMEZONE_MAP (map));
+
+  show_cities = !!show_cities;
+  if (map->priv->show_cities == show_cities)
+    return;
+
+  map->priv->show_cities = show_cities;
+  gtk_widget_queue_draw (GTK_WIDGET (map));
+}
+
+gboolean
+cc_timezone_map_get_show_cities (CcTimezoneMap *map)
+{
+  g_return_val_if_fail (CC_IS_TIMEZONE_MAP (map), FALSE);
+
+  return map->priv->show_cities;
+}
@@ -74,6 +74,10 @@ gboolean cc_timezone_map_set_timezone (CcTimezoneMap *map,
 void cc_timezone_map_set_bubble_text (CcTimezoneMap *map,
                                       const gchar   *text);
 TzLocation * cc_timezone_map_get_location (CcTimezoneMap *map);
+gdouble cc_timezone_map_get_selected_offset (CcTimezoneMap *map);
+void cc_timezone_map_set_show_cities (CcTimezoneMap *map,
+                                      gboolean       show_cities);
+gboolean cc_timezone_map_get_show_cities (CcTimezoneMap *map);
 
 G_END_DECLS
 
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include "cc-zone-raster.h"
+
+#define HEADER_SIZE 12
+#define RUN_SIZE 4
+
+struct _CcZoneRaster
+{
+  GBytes *bytes;
+  guint width;
+  guint height;
+  const guchar *row_starts;
+  const guchar *runs;
+  guint32 n_runs;
+};
+
+static inline guint16
+read_uint16 (const guchar *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static inline guint32
+read_uint32 (const guchar *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32) p[3] << 24);
+}
+
+/* Takes a reference on @bytes, which is usually straight from the
+ * resources, and returns NULL if it is not a valid raster */
+CcZoneRaster *
+cc_zone_raster_new (GBytes *bytes)
+{
+  CcZoneRaster *raster;
+  const guchar *data;
+  gsize size;
+  guint width, height;
+  guint32 n_runs;
+
+  g_return_val_if_fail (bytes != NULL, NULL);
+
+  data = g_bytes_get_data (bytes, &size);
+  if (size < HEADER_SIZE ||
+      memcmp (data, CC_ZONE_RASTER_MAGIC, 4) != 0 ||
+      read_uint16 (data + 4) != CC_ZONE_RASTER_VERSION)
+    return NULL;
+
+  width = read_uint16 (data + 6);
+  height = read_uint16 (data + 8);
+  if (width == 0 || height == 0 ||
+      size < HEADER_SIZE + (height + 1) * 4)
+    return NULL;
+
+  n_runs = read_uint32 (data + HEADER_SIZE + height * 4);
+  if (size != HEADER_SIZE + (height + 1) * 4 + (gsize) n_runs * RUN_SIZE)
+    return NULL;
+
+  raster = g_new0 (CcZoneRaster, 1);
+  raster->bytes = g_bytes_ref (bytes);
+  raster->width = width;
+  raster->height = height;
+  raster->row_starts = data + HEADER_SIZE;
+  raster->runs = raster->row_starts + (height + 1) * 4;
+  raster->n_runs = n_runs;
+
+  return raster;
+}
+
+void
+cc_zone_raster_free (CcZoneRaster *raster)
+{
+  if (raster == NULL)
+    return;
+
+  g_bytes_unref (raster->bytes);
+  g_free (raster);
+}
+
+/* Looks up the UTC offset, in hours, at (@x, @y), both between 0 and 1
+ * across the map. Returns FALSE if the point is not in any zone. */
+gboolean
+cc_zone_raster_get_offset (CcZoneRaster *raster,
+                           gdouble       x,
+                           gdouble       y,
+                           gdouble      *offset)
+{
+  guint col, row;
+  guint32 lo, hi;
+  gint8 zone;
+
+  g_return_val_if_fail (raster != NULL, FALSE);
+
+  if (x < 0 || x >= 1 || y < 0 || y >= 1)
+    return FALSE;
+
+  col = x * raster->width;
+  row = y * raster->height;
+
+  lo = read_uint32 (raster->row_starts + row * 4);
+  hi = read_uint32 (raster->row_starts + (row + 1) * 4);
+  if (lo >= hi || hi > raster->n_runs)
+    return FALSE;
+
+  /* Find the first run ending after the column */
+  while (lo < hi)
+    {
+      guint32 mid = lo + (hi - lo) / 2;
+
+      if (read_uint16 (raster->runs + mid * RUN_SIZE) <= col)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  zone = (gint8) raster->runs[lo * RUN_SIZE + 2];
+  if (zone == CC_ZONE_RASTER_NONE)
+    return FALSE;
+
+  if (offset)
+    *offset = zone / 4.0;
+
+  return TRUE;
+}
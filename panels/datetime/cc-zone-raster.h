@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _CC_ZONE_RASTER_H
+#define _CC_ZONE_RASTER_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* The UTC offsets of the map, as a run-length encoded raster of the
+ * same projection as the background, generated by gen-zone-raster.
+ * All the values are little endian:
+ *
+ * "TZRL", version (u16), width (u16), height (u16), padding (u16)
+ * height + 1 row starts (u32), indexes of the first run of each row
+ * runs, each being the x past its end (u16), the offset in quarters
+ *   of an hour or CC_ZONE_RASTER_NONE (s8) and padding (u8)
+ */
+
+#define CC_ZONE_RASTER_MAGIC "TZRL"
+#define CC_ZONE_RASTER_VERSION 1
+#define CC_ZONE_RASTER_NONE G_MININT8
+
+typedef struct _CcZoneRaster CcZoneRaster;
+
+CcZoneRaster *cc_zone_raster_new        (GBytes       *bytes);
+void          cc_zone_raster_free       (CcZoneRaster *raster);
+gboolean      cc_zone_raster_get_offset (CcZoneRaster *raster,
+                                         gdouble       x,
+                                         gdouble       y,
+                                         gdouble      *offset);
+
+G_END_DECLS
+
+#endif /* _CC_ZONE_RASTER_H */
@@ -0,0 +1,273 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/* Compiles zone.tab and the backward links into the binary
+ * timezone database loaded by tz_load_db(), see tz.h.
+ *
+ * Copyright (C) 2000-2001 Ximian, Inc.
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include "tz.h"
+#include "tz-zone-tab.h"
+
+typedef struct {
+	gchar *country;
+	gchar *zone;
+	gchar *comment;
+	gdouble latitude;
+	gdouble longitude;
+} Location;
+
+typedef struct {
+	gchar *alias;
+	gchar *real;
+} Link;
+
+/* The string pool, with each distinct string stored once */
+typedef struct {
+	GString    *data;
+	GHashTable *offsets;
+} Pool;
+
+static void
+add_location (const gchar *country, const gchar *zone, const gchar *comment,
+	      gdouble latitude, gdouble longitude, gpointer user_data)
+{
+	GPtrArray *locations = user_data;
+	Location *loc;
+
+	loc = g_new0 (Location, 1);
+	loc->country = g_strdup (country);
+	loc->zone = g_strdup (zone);
+	loc->comment = g_strdup (comment);
+	loc->latitude = latitude;
+	loc->longitude = longitude;
+
+	g_ptr_array_add (locations, loc);
+}
+
+static GPtrArray *
+load_locations (const gchar *path)
+{
+	GPtrArray *locations;
+	GError *error = NULL;
+
+	locations = g_ptr_array_new ();
+	if (!tz_zone_tab_parse (path, add_location, locations, &error)) {
+		g_printerr ("Could not load %s: %s\n", path, error->message);
+		g_error_free (error);
+		g_ptr_array_free (locations, TRUE);
+		return NULL;
+	}
+
+	return locations;
+}
+
+static GPtrArray *
+load_links (const gchar *path)
+{
+  GPtrArray *links;
+  char **lines;
+  char *contents;
+  GError *error = NULL;
+  guint i;
+
+  if (!g_file_get_contents (path, &contents, NULL, &error))
+    {
+      g_printerr ("Could not load %s: %s\n", path, error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+  links = g_ptr_array_new ();
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (i = 0; lines[i] != NULL; i++)
+    {
+      char **items;
+      guint j;
+      char *real, *alias;
+      Link *link;
+
+      if (g_ascii_strncasecmp (lines[i], "Link\t", 5) != 0)
+        continue;
+
+      items = g_strsplit (lines[i], "\t", -1);
+      real = NULL;
+      alias = NULL;
+      /* Skip the "Link<tab>" part */
+      for (j = 1; items[j] != NULL; j++)
+        {
+          if (items[j][0] == '\0')
+            continue;
+          if (real == NULL)
+            {
+              real = items[j];
+              continue;
+            }
+          alias = items[j];
+          break;
+        }
+
+      if (real == NULL || alias == NULL)
+        {
+          g_printerr ("Could not parse line: %s\n", lines[i]);
+          g_strfreev (items);
+          continue;
+        }
+
+      /* We don't need more than one name for it */
+      if (g_str_equal (real, "Etc/UTC") ||
+          g_str_equal (real, "Etc/UCT"))
+        real = "Etc/GMT";
+
+      link = g_new0 (Link, 1);
+      link->alias = g_strdup (alias);
+      link->real = g_strdup (real);
+      g_ptr_array_add (links, link);
+
+      g_strfreev (items);
+    }
+  g_strfreev (lines);
+
+  return links;
+}
+
+static int
+compare_zones (const void *a, const void *b)
+{
+	const Location *tza = * (Location **) a;
+	const Location *tzb = * (Location **) b;
+
+	return strcmp (tza->zone, tzb->zone);
+}
+
+static int
+compare_aliases (const void *a, const void *b)
+{
+	const Link *la = * (Link **) a;
+	const Link *lb = * (Link **) b;
+
+	return strcmp (la->alias, lb->alias);
+}
+
+static guint32
+pool_add (Pool *pool, const gchar *str)
+{
+	gpointer offset;
+
+	if (str == NULL)
+		return TZ_DB_NO_STRING;
+
+	if (g_hash_table_lookup_extended (pool->offsets, str, NULL, &offset))
+		return GPOINTER_TO_UINT (offset);
+
+	offset = GUINT_TO_POINTER (pool->data->len);
+	g_string_append_len (pool->data, str, strlen (str) + 1);
+	g_hash_table_insert (pool->offsets, (gpointer) str, offset);
+
+	return GPOINTER_TO_UINT (offset);
+}
+
+static void
+append_uint32 (GByteArray *array, guint32 value)
+{
+	value = GUINT32_TO_LE (value);
+	g_byte_array_append (array, (guint8 *) &value, sizeof (value));
+}
+
+int
+main (int argc, char **argv)
+{
+	GPtrArray *locations, *links;
+	GByteArray *out;
+	Pool pool;
+	GError *error = NULL;
+	const gchar *zone_tab;
+	GStatBuf buf;
+	guint64 mtime;
+	guint i;
+	gboolean ret;
+
+	if (argc != 3 && argc != 4) {
+		g_printerr ("Usage: %s BACKWARD OUTPUT [ZONE-TAB]\n", argv[0]);
+		return 1;
+	}
+
+	zone_tab = (argc == 4) ? argv[3] : TZ_DATA_FILE;
+
+	locations = load_locations (zone_tab);
+	links = load_links (argv[1]);
+	if (locations == NULL || links == NULL)
+		return 1;
+
+	/* tz_load_db() reads zone.tab itself if it is any newer */
+	mtime = (g_stat (zone_tab, &buf) == 0) ? (guint64) buf.st_mtime : 0;
+
+	/* Locations are sorted by zone, and links by alias so that
+	 * they can be searched without building a hash table */
+	qsort (locations->pdata, locations->len, sizeof (gpointer), compare_zones);
+	qsort (links->pdata, links->len, sizeof (gpointer), compare_aliases);
+
+	pool.data = g_string_new (NULL);
+	pool.offsets = g_hash_table_new (g_str_hash, g_str_equal);
+
+	out = g_byte_array_new ();
+	g_byte_array_append (out, (guint8 *) TZ_DB_MAGIC, 4);
+	append_uint32 (out, TZ_DB_VERSION);
+	append_uint32 (out, (guint32) mtime);
+	append_uint32 (out, (guint32) (mtime >> 32));
+	append_uint32 (out, locations->len);
+	append_uint32 (out, links->len);
+
+	for (i = 0; i < locations->len; i++) {
+		Location *loc = locations->pdata[i];
+
+		append_uint32 (out, pool_add (&pool, loc->country));
+		append_uint32 (out, pool_add (&pool, loc->zone));
+		append_uint32 (out, pool_add (&pool, loc->comment));
+		append_uint32 (out, (guint32) (gint32) lround (loc->latitude * TZ_DB_POSITION_SCALE));
+		append_uint32 (out, (guint32) (gint32) lround (loc->longitude * TZ_DB_POSITION_SCALE));
+	}
+
+	for (i = 0; i < links->len; i++) {
+		Link *link = links->pdata[i];
+
+		append_uint32 (out, pool_add (&pool, link->alias));
+		append_uint32 (out, pool_add (&pool, link->real));
+	}
+
+	g_byte_array_append (out, (guint8 *) pool.data->str, pool.data->len);
+
+	ret = g_file_set_contents (argv[2], (gchar *) out->data, out->len, &error);
+	if (!ret) {
+		g_printerr ("Could not save %s: %s\n", argv[2], error->message);
+		g_error_free (error);
+	}
+
+	/* The pool's table points to the strings of the locations and links */
+	g_hash_table_destroy (pool.offsets);
+	g_string_free (pool.data, TRUE);
+	g_byte_array_unref (out);
+
+	return ret ? 0 : 1;
+}
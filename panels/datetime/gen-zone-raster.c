@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Converts the colour coded map of the UTC offsets into the run-length
+ * encoded raster described in cc-zone-raster.h, at build time. */
+
+#include <string.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "cc-zone-raster.h"
+#include "cc-zone-colors.h"
+
+/* Antialiased pixels further than this from every colour are left out */
+#define MAX_COLOR_DISTANCE (48 * 48)
+
+static gint8
+get_zone (const guchar *p)
+{
+  gint best = -1;
+  gint best_dist = G_MAXINT;
+  guint i;
+
+  if (p[3] == 0)
+    return CC_ZONE_RASTER_NONE;
+
+  for (i = 0; i < G_N_ELEMENTS (cc_zone_colors); i++)
+    {
+      const CcZoneColor *c = &cc_zone_colors[i];
+      gint dr = c->red - p[0];
+      gint dg = c->green - p[1];
+      gint db = c->blue - p[2];
+      gint da = c->alpha - p[3];
+      gint dist = dr * dr + dg * dg + db * db + da * da;
+
+      if (dist < best_dist)
+        {
+          best_dist = dist;
+          best = i;
+        }
+    }
+
+  /* Pixels at the borders between zones are a blend of both colours,
+   * and are attributed to the closest one */
+  if (best < 0 || best_dist > MAX_COLOR_DISTANCE)
+    return CC_ZONE_RASTER_NONE;
+
+  return (gint8) (cc_zone_colors[best].offset * 4);
+}
+
+static void
+append_uint16 (GByteArray *array,
+               guint16     value)
+{
+  value = GUINT16_TO_LE (value);
+  g_byte_array_append (array, (guint8 *) &value, sizeof (value));
+}
+
+static void
+append_uint32 (GByteArray *array,
+               guint32     value)
+{
+  value = GUINT32_TO_LE (value);
+  g_byte_array_append (array, (guint8 *) &value, sizeof (value));
+}
+
+int
+main (int argc, char **argv)
+{
+  GdkPixbuf *pixbuf;
+  GByteArray *header, *runs;
+  GError *error = NULL;
+  guchar *pixels;
+  gint width, height, rowstride, n_channels;
+  guint32 n_runs = 0;
+  gint x, y;
+  gboolean ret;
+
+  if (argc != 3)
+    {
+      g_printerr ("Usage: %s COLOR-MAP OUTPUT\n", argv[0]);
+      return 1;
+    }
+
+  pixbuf = gdk_pixbuf_new_from_file (argv[1], &error);
+  if (pixbuf == NULL)
+    {
+      g_printerr ("Could not load %s: %s\n", argv[1], error->message);
+      g_error_free (error);
+      return 1;
+    }
+
+  if (!gdk_pixbuf_get_has_alpha (pixbuf))
+    {
+      GdkPixbuf *tmp = gdk_pixbuf_add_alpha (pixbuf, FALSE, 0, 0, 0);
+      g_object_unref (pixbuf);
+      pixbuf = tmp;
+    }
+
+  width = gdk_pixbuf_get_width (pixbuf);
+  height = gdk_pixbuf_get_height (pixbuf);
+  rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+  pixels = gdk_pixbuf_get_pixels (pixbuf);
+
+  header = g_byte_array_new ();
+  g_byte_array_append (header, (guint8 *) CC_ZONE_RASTER_MAGIC, 4);
+  append_uint16 (header, CC_ZONE_RASTER_VERSION);
+  append_uint16 (header, width);
+  append_uint16 (header, height);
+  append_uint16 (header, 0);
+
+  runs = g_byte_array_new ();
+
+  for (y = 0; y < height; y++)
+    {
+      gint8 zone = get_zone (pixels + y * rowstride);
+
+      append_uint32 (header, n_runs);
+
+      for (x = 1; x <= width; x++)
+        {
+          gint8 next = CC_ZONE_RASTER_NONE;
+
+          if (x < width)
+            next = get_zone (pixels + y * rowstride + x * n_channels);
+
+          if (x == width || next != zone)
+            {
+              /* Each run is the x past its end, and its zone */
+              append_uint16 (runs, x);
+              g_byte_array_append (runs, (guint8 *) &zone, 1);
+              g_byte_array_append (runs, (guint8 *) "", 1);
+              n_runs++;
+              zone = next;
+            }
+        }
+    }
+  append_uint32 (header, n_runs);
+
+  g_byte_array_append (header, runs->data, runs->len);
+
+  ret = g_file_set_contents (argv[2], (gchar *) header->data, header->len, &error);
+  if (!ret)
+    {
+      g_printerr ("Could not save %s: %s\n", argv[2], error->message);
+      g_error_free (error);
+    }
+
+  g_byte_array_unref (runs);
+  g_byte_array_unref (header);
+  g_object_unref (pixbuf);
+
+  return ret ? 0 : 1;
+}
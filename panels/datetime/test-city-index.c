@@ -0,0 +1,117 @@
+#include <glib.h>
+#include <locale.h>
+#include "cc-city-index.h"
+
+static CcCityIndex *
+create_index (void)
+{
+	CcCityIndex *index;
+	const char *zurich[] = { "Zürich", "Zurich", NULL };
+	const char *switzerland[] = { "Schweiz", "Switzerland", NULL };
+	const char *new_york[] = { "New York", NULL };
+	const char *york[] = { "York", NULL };
+	const char *usa[] = { "United States", NULL };
+	const char *uk[] = { "United Kingdom", NULL };
+	const char *sao_paulo[] = { "São Paulo", "Sao Paulo", NULL };
+	const char *brazil[] = { "Brasil", "Brazil", NULL };
+
+	index = cc_city_index_new ();
+	cc_city_index_add (index, "Zürich, Schweiz", "Europe/Zurich", zurich, switzerland);
+	cc_city_index_add (index, "New York, United States", "America/New_York", new_york, usa);
+	cc_city_index_add (index, "York, United Kingdom", "Europe/London", york, uk);
+	cc_city_index_add (index, "São Paulo, Brasil", "America/Sao_Paulo", sao_paulo, brazil);
+
+	return index;
+}
+
+static const char *
+get_zone (const GPtrArray *matches, guint i)
+{
+	g_assert_cmpuint (i, <, matches->len);
+	return ((CcCity *) matches->pdata[i])->zone;
+}
+
+static void
+test_normalize (void)
+{
+	char *str;
+
+	str = cc_city_index_normalize ("ZÜRICH");
+	g_assert_cmpstr (str, ==, "zurich");
+	g_free (str);
+
+	str = cc_city_index_normalize ("Port_of_Spain");
+	g_assert_cmpstr (str, ==, "port of spain");
+	g_free (str);
+}
+
+static void
+test_search (void)
+{
+	CcCityIndex *index;
+	const GPtrArray *matches;
+
+	index = create_index ();
+
+	/* Accents and case don't matter */
+	matches = cc_city_index_search (index, "zur");
+	g_assert_cmpuint (matches->len, ==, 1);
+	g_assert_cmpstr (get_zone (matches, 0), ==, "Europe/Zurich");
+
+	matches = cc_city_index_search (index, "SAO");
+	g_assert_cmpuint (matches->len, ==, 1);
+	g_assert_cmpstr (get_zone (matches, 0), ==, "America/Sao_Paulo");
+
+	/* Prefixes of the city come first */
+	matches = cc_city_index_search (index, "york");
+	g_assert_cmpuint (matches->len, ==, 2);
+	g_assert_cmpstr (get_zone (matches, 0), ==, "Europe/London");
+	g_assert_cmpstr (get_zone (matches, 1), ==, "America/New_York");
+
+	/* Both the translated and English country names are searched */
+	matches = cc_city_index_search (index, "switz");
+	g_assert_cmpuint (matches->len, ==, 1);
+	matches = cc_city_index_search (index, "brazil");
+	g_assert_cmpuint (matches->len, ==, 1);
+
+	matches = cc_city_index_search (index, "");
+	g_assert_cmpuint (matches->len, ==, 0);
+
+	cc_city_index_free (index);
+}
+
+static void
+test_narrowing (void)
+{
+	CcCityIndex *index;
+	const GPtrArray *matches;
+
+	index = create_index ();
+
+	matches = cc_city_index_search (index, "u");
+	g_assert_cmpuint (matches->len, ==, 4);
+	matches = cc_city_index_search (index, "un");
+	g_assert_cmpuint (matches->len, ==, 2);
+	matches = cc_city_index_search (index, "unit");
+	g_assert_cmpuint (matches->len, ==, 2);
+
+	/* Going back widens the search again */
+	matches = cc_city_index_search (index, "u");
+	g_assert_cmpuint (matches->len, ==, 4);
+
+	cc_city_index_free (index);
+}
+
+int main (int argc, char **argv)
+{
+	setlocale (LC_ALL, "");
+	g_test_init (&argc, &argv, NULL);
+
+	g_setenv ("G_DEBUG", "fatal_warnings", FALSE);
+
+	g_test_add_func ("/datetime/city-index/normalize", test_normalize);
+	g_test_add_func ("/datetime/city-index/search", test_search);
+	g_test_add_func ("/datetime/city-index/narrowing", test_narrowing);
+
+	return g_test_run ();
+}
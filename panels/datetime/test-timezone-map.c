@@ -0,0 +1,388 @@
+#include <config.h>
+#include <locale.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gtk/gtk.h>
+
+#include "cc-timezone-map.h"
+#include "cc-zone-raster.h"
+#include "tz.h"
+
+/* Renders the timezone map offscreen and clicks all over it, checking
+ * the results against straightforward implementations, and timing it.
+ * The timings are only shown with --verbose, run with -m perf for more
+ * iterations, and with --scale=2 for a HiDPI rendering. */
+
+#define N_CLICKS 2000
+#define N_DRAWS 20
+
+/* How long the window manager gets to give the map its size */
+#define ALLOCATION_TIMEOUT (5 * G_USEC_PER_SEC)
+
+static const struct {
+	gint width;
+	gint height;
+} sizes[] = {
+	{ 800, 409 },
+	{ 1200, 614 },
+	{ 1600, 818 },
+};
+
+/* Cities well inside a zone, with the standard UTC offset of the zone,
+ * none of them observing daylight saving time */
+static const struct {
+	const char *zone;
+	gdouble latitude;
+	gdouble longitude;
+	gdouble offset;
+} known_offsets[] = {
+	{ "America/Phoenix", 33.45, -112.07, -7.0 },
+	{ "America/Bogota", 4.71, -74.07, -5.0 },
+	{ "Africa/Kinshasa", -4.44, 15.27, 1.0 },
+	{ "Africa/Johannesburg", -26.20, 28.05, 2.0 },
+	{ "Africa/Nairobi", -1.29, 36.82, 3.0 },
+	{ "Asia/Riyadh", 24.71, 46.68, 3.0 },
+	{ "Asia/Kabul", 34.53, 69.17, 4.5 },
+	{ "Asia/Ulaanbaatar", 47.92, 106.92, 8.0 },
+	{ "Asia/Tokyo", 35.69, 139.69, 9.0 },
+};
+
+static gboolean has_display = FALSE;
+
+/* The projection used by the map, see cc-timezone-map.c */
+static gdouble
+reference_x (gdouble longitude, gint map_width)
+{
+	return (map_width * (180.0 + longitude) / 360.0) + (map_width * -6.0 / 180.0);
+}
+
+static gdouble
+reference_y (gdouble latitude, gdouble map_height)
+{
+	gdouble top_offset, map_range, y;
+
+	top_offset = 4.6068250867599998 * 81.0 / 180.0;
+	map_range = fabs (1.25 * log (tan (G_PI_4 + 0.4 * (-59.0 * G_PI / 180.0))) - top_offset);
+	y = 1.25 * log (tan (G_PI_4 + 0.4 * (latitude * G_PI / 180.0)));
+
+	return fabs (y - top_offset) / map_range * map_height;
+}
+
+static gdouble
+get_distance (TzLocation *loc, gint x, gint y, gint width, gint height)
+{
+	gdouble dx = reference_x (loc->longitude, width) - x;
+	gdouble dy = reference_y (loc->latitude, height) - y;
+
+	return dx * dx + dy * dy;
+}
+
+/* Returns NULL if the map didn't get the size in time */
+static GtkWidget *
+create_map (gint width, gint height)
+{
+	GtkWidget *window, *map;
+	GtkAllocation alloc;
+	gint64 deadline;
+
+	window = gtk_offscreen_window_new ();
+	map = GTK_WIDGET (cc_timezone_map_new ());
+	gtk_widget_set_size_request (map, width, height);
+	gtk_container_add (GTK_CONTAINER (window), map);
+	gtk_widget_show_all (window);
+
+	deadline = g_get_monotonic_time () + ALLOCATION_TIMEOUT;
+	do {
+		if (g_get_monotonic_time () > deadline) {
+			gtk_widget_destroy (window);
+			return NULL;
+		}
+
+		if (!gtk_events_pending ())
+			g_usleep (1000);
+		while (gtk_events_pending ())
+			gtk_main_iteration ();
+		gtk_widget_get_allocation (map, &alloc);
+	} while (alloc.width != width || alloc.height != height);
+
+	return map;
+}
+
+static void
+destroy_map (GtkWidget *map)
+{
+	gtk_widget_destroy (gtk_widget_get_toplevel (map));
+}
+
+static void
+click (GtkWidget *map, gint x, gint y)
+{
+	GdkEvent *event;
+
+	event = gdk_event_new (GDK_BUTTON_PRESS);
+	event->button.window = g_object_ref (gtk_widget_get_window (map));
+	event->button.x = x;
+	event->button.y = y;
+	event->button.button = 1;
+	gtk_widget_event (map, event);
+	gdk_event_free (event);
+}
+
+static void
+test_load_db (void)
+{
+	TzDB *db, *db2;
+
+	g_test_timer_start ();
+	db = tz_load_db ();
+	g_test_minimized_result (g_test_timer_elapsed () * 1000, "tz_load_db: %g ms", g_test_timer_last () * 1000);
+	g_assert (db != NULL);
+	g_assert_cmpuint (tz_get_locations (db)->len, >, 300);
+
+	/* Everyone shares the same copy */
+	g_test_timer_start ();
+	db2 = tz_load_db ();
+	g_test_minimized_result (g_test_timer_elapsed () * 1000, "tz_load_db, loaded: %g ms", g_test_timer_last () * 1000);
+	g_assert (db2 == db);
+
+	tz_db_free (db2);
+	tz_db_free (db);
+}
+
+static void
+test_offsets (void)
+{
+	TzDB *db;
+	GPtrArray *locs;
+	guint i, round, n_rounds;
+
+	db = tz_load_db ();
+	locs = tz_get_locations (db);
+	n_rounds = g_test_perf () ? 100 : 1;
+
+	g_test_timer_start ();
+	for (round = 0; round < n_rounds; round++) {
+		for (i = 0; i < locs->len; i++) {
+			TzLocation *loc = locs->pdata[i];
+			TzInfo *info;
+
+			info = tz_info_from_location (loc);
+
+			if (round == 0) {
+				GTimeZone *tz;
+				GDateTime *now;
+
+				tz = g_time_zone_new (loc->zone);
+				now = g_date_time_new_now (tz);
+				g_assert_cmpint (info->utc_offset, ==, g_date_time_get_utc_offset (now) / G_USEC_PER_SEC);
+				g_assert_cmpint (info->daylight, ==, g_date_time_is_daylight_savings (now));
+				g_date_time_unref (now);
+				g_time_zone_unref (tz);
+			}
+
+			tz_info_free (info);
+		}
+	}
+	g_test_minimized_result (g_test_timer_elapsed () * 1000,
+				 "%u offsets: %g ms", locs->len * n_rounds, g_test_timer_last () * 1000);
+
+	tz_db_free (db);
+}
+
+static void
+test_draw (void)
+{
+	guint i, j, n_draws;
+
+	if (!has_display) {
+		g_test_skip ("No display");
+		return;
+	}
+
+	n_draws = g_test_perf () ? N_DRAWS * 10 : N_DRAWS;
+
+	for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+		GtkWidget *map;
+		cairo_surface_t *surface;
+		cairo_t *cr;
+		gint scale;
+
+		map = create_map (sizes[i].width, sizes[i].height);
+		if (map == NULL) {
+			g_test_skip ("The map was not allocated its size");
+			return;
+		}
+		cc_timezone_map_set_timezone (CC_TIMEZONE_MAP (map), "Europe/Paris");
+		scale = gtk_widget_get_scale_factor (map);
+
+		surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						      sizes[i].width * scale,
+						      sizes[i].height * scale);
+		cairo_surface_set_device_scale (surface, scale, scale);
+		cr = cairo_create (surface);
+
+		/* The first draw scales the layers */
+		g_test_timer_start ();
+		gtk_widget_draw (map, cr);
+		g_test_message ("%dx%d@%d, first draw: %g ms",
+				sizes[i].width, sizes[i].height, scale,
+				g_test_timer_elapsed () * 1000);
+
+		g_test_timer_start ();
+		for (j = 0; j < n_draws; j++)
+			gtk_widget_draw (map, cr);
+		g_test_minimized_result (g_test_timer_elapsed () * 1000 / n_draws,
+					 "%dx%d@%d, draw: %g ms",
+					 sizes[i].width, sizes[i].height, scale,
+					 g_test_timer_last () * 1000 / n_draws);
+
+		cc_timezone_map_set_show_cities (CC_TIMEZONE_MAP (map), TRUE);
+		g_test_timer_start ();
+		gtk_widget_draw (map, cr);
+		g_test_message ("%dx%d@%d, first draw with the cities: %g ms",
+				sizes[i].width, sizes[i].height, scale,
+				g_test_timer_elapsed () * 1000);
+
+		g_test_timer_start ();
+		for (j = 0; j < n_draws; j++)
+			gtk_widget_draw (map, cr);
+		g_test_minimized_result (g_test_timer_elapsed () * 1000 / n_draws,
+					 "%dx%d@%d, draw with the cities: %g ms",
+					 sizes[i].width, sizes[i].height, scale,
+					 g_test_timer_last () * 1000 / n_draws);
+
+		g_assert_cmpint (cairo_status (cr), ==, CAIRO_STATUS_SUCCESS);
+
+		cairo_destroy (cr);
+		cairo_surface_destroy (surface);
+		destroy_map (map);
+	}
+}
+
+static void
+test_pick (void)
+{
+	GtkWidget *map;
+	TzDB *db;
+	GPtrArray *locs;
+	gint width, height;
+	guint i, j, n_clicks;
+
+	if (!has_display) {
+		g_test_skip ("No display");
+		return;
+	}
+
+	width = sizes[0].width;
+	height = sizes[0].height;
+	map = create_map (width, height);
+	if (map == NULL) {
+		g_test_skip ("The map was not allocated its size");
+		return;
+	}
+
+	db = tz_load_db ();
+	locs = tz_get_locations (db);
+	n_clicks = g_test_perf () ? N_CLICKS * 10 : N_CLICKS;
+
+	g_test_timer_start ();
+	for (i = 0; i < n_clicks; i++) {
+		TzLocation *picked;
+		gdouble best = G_MAXDOUBLE;
+		gint x, y;
+
+		x = g_test_rand_int_range (0, width);
+		y = g_test_rand_int_range (0, height);
+		click (map, x, y);
+
+		picked = cc_timezone_map_get_location (CC_TIMEZONE_MAP (map));
+		g_assert (picked != NULL);
+
+		/* Several cities can be as close, and the map uses floats */
+		for (j = 0; j < locs->len; j++)
+			best = MIN (best, get_distance (locs->pdata[j], x, y, width, height));
+		g_assert_cmpfloat (sqrt (get_distance (picked, x, y, width, height)), <=, sqrt (best) + 1e-3);
+	}
+	g_test_minimized_result (g_test_timer_elapsed () * 1000 / n_clicks,
+				 "click, including the reference search: %g ms",
+				 g_test_timer_last () * 1000 / n_clicks);
+
+	/* Clicking a city highlights the zone it is in */
+	for (i = 0; i < G_N_ELEMENTS (known_offsets); i++) {
+		gint x, y;
+
+		x = reference_x (known_offsets[i].longitude, width);
+		y = reference_y (known_offsets[i].latitude, height);
+		click (map, x, y);
+
+		g_test_message ("%s, clicked at %d,%d", known_offsets[i].zone, x, y);
+		g_assert_cmpfloat (cc_timezone_map_get_selected_offset (CC_TIMEZONE_MAP (map)), ==, known_offsets[i].offset);
+	}
+
+	tz_db_free (db);
+	destroy_map (map);
+}
+
+/* The raster has to give the known offsets where their cities are */
+static void
+test_zones (void)
+{
+	CcZoneRaster *raster;
+	GBytes *bytes;
+	guint i;
+
+	bytes = g_resources_lookup_data ("/org/gnome/control-center/datetime/zones.rle",
+					 G_RESOURCE_LOOKUP_FLAGS_NONE, NULL);
+	g_assert (bytes != NULL);
+	raster = cc_zone_raster_new (bytes);
+	g_assert (raster != NULL);
+	g_bytes_unref (bytes);
+
+	for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+		guint j;
+
+		for (j = 0; j < G_N_ELEMENTS (known_offsets); j++) {
+			gdouble offset;
+			gint x, y;
+
+			x = reference_x (known_offsets[j].longitude, sizes[i].width);
+			y = reference_y (known_offsets[j].latitude, sizes[i].height);
+
+			g_test_message ("%s, %dx%d", known_offsets[j].zone, sizes[i].width, sizes[i].height);
+			g_assert (cc_zone_raster_get_offset (raster,
+							     (x + 0.5) / sizes[i].width,
+							     (y + 0.5) / sizes[i].height,
+							     &offset));
+			g_assert_cmpfloat (offset, ==, known_offsets[j].offset);
+		}
+	}
+
+	cc_zone_raster_free (raster);
+}
+
+int main (int argc, char **argv)
+{
+	int i;
+
+	setlocale (LC_ALL, "");
+
+	/* Needs to happen before GDK picks the scale */
+	for (i = 1; i < argc; i++) {
+		if (g_str_has_prefix (argv[i], "--scale=")) {
+			g_setenv ("GDK_SCALE", argv[i] + strlen ("--scale="), TRUE);
+			argv[i] = (char *) "";
+		}
+	}
+
+	g_test_init (&argc, &argv, NULL);
+	has_display = gtk_init_check (NULL, NULL);
+
+	g_test_add_func ("/datetime/tz/load-db", test_load_db);
+	g_test_add_func ("/datetime/tz/offsets", test_offsets);
+	g_test_add_func ("/datetime/timezone-map/zones", test_zones);
+	g_test_add_func ("/datetime/timezone-map/draw", test_draw);
+	g_test_add_func ("/datetime/timezone-map/pick", test_pick);
+
+	return g_test_run ();
+}
@@ -0,0 +1,111 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/* Parser of zone.tab, shared by gen-tzdb and tz.c.
+ *
+ * Copyright (C) 2000-2001 Ximian, Inc.
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <math.h>
+#include <string.h>
+#include "tz-zone-tab.h"
+
+static float
+convert_pos (gchar *pos, int digits)
+{
+	gchar whole[10];
+	gchar *fraction;
+	gint i;
+	float t1, t2;
+
+	if (!pos || strlen(pos) < 4 || digits > 9) return 0.0;
+
+	for (i = 0; i < digits + 1; i++) whole[i] = pos[i];
+	whole[i] = '\0';
+	fraction = pos + digits + 1;
+
+	t1 = g_strtod (whole, NULL);
+	t2 = g_strtod (fraction, NULL);
+
+	if (t1 >= 0.0) return t1 + t2/pow (10.0, strlen(fraction));
+	else return t1 - t2/pow (10.0, strlen(fraction));
+}
+
+gboolean
+tz_zone_tab_parse (const gchar    *path,
+		   TzZoneTabFunc   func,
+		   gpointer        user_data,
+		   GError        **error)
+{
+	gchar *contents;
+	gchar **lines;
+	guint i;
+
+	if (!g_file_get_contents (path, &contents, NULL, error))
+		return FALSE;
+
+	lines = g_strsplit (contents, "\n", -1);
+	g_free (contents);
+
+	for (i = 0; lines[i] != NULL; i++)
+	{
+		gchar **tmpstrarr;
+		gchar *latstr, *lngstr, *p;
+
+		if (*lines[i] == '#') continue;
+
+		g_strchomp (lines[i]);
+		tmpstrarr = g_strsplit (lines[i], "\t", 6);
+
+		/* Blank lines, and the last one */
+		if (g_strv_length (tmpstrarr) < 3) {
+			g_strfreev (tmpstrarr);
+			continue;
+		}
+
+		latstr = g_strdup (tmpstrarr[1]);
+		p = latstr + 1;
+		while (*p != '-' && *p != '+' && *p != '\0') p++;
+		lngstr = g_strdup (p);
+		*p = '\0';
+
+#ifdef __sun
+		func (tmpstrarr[0], tmpstrarr[2],
+		      (tmpstrarr[3] && *tmpstrarr[3] == '-') ? tmpstrarr[4] : NULL,
+		      convert_pos (latstr, 2), convert_pos (lngstr, 3),
+		      user_data);
+
+		if (tmpstrarr[3] && *tmpstrarr[3] != '-' && !islower(tmpstrarr[2])) {
+			/* duplicate entry */
+			func (tmpstrarr[0], tmpstrarr[3], tmpstrarr[4],
+			      convert_pos (latstr, 2), convert_pos (lngstr, 3),
+			      user_data);
+		}
+#else
+		func (tmpstrarr[0], tmpstrarr[2], tmpstrarr[3],
+		      convert_pos (latstr, 2), convert_pos (lngstr, 3),
+		      user_data);
+#endif
+
+		g_free (latstr);
+		g_free (lngstr);
+		g_strfreev (tmpstrarr);
+	}
+
+	g_strfreev (lines);
+
+	return TRUE;
+}
@@ -0,0 +1,45 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * Copyright (C) 2016 Red Hat, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef _TZ_ZONE_TAB_H
+#define _TZ_ZONE_TAB_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Called for each location of zone.tab, with the position in degrees.
+ * The strings are only valid during the call, and @comment can be NULL. */
+typedef void (*TzZoneTabFunc) (const gchar *country,
+			       const gchar *zone,
+			       const gchar *comment,
+			       gdouble      latitude,
+			       gdouble      longitude,
+			       gpointer     user_data);
+
+/* Reads zone.tab, as used by gen-tzdb, and by tz_load_db() when the
+ * system's one changed since the database was compiled */
+gboolean tz_zone_tab_parse (const gchar    *path,
+			    TzZoneTabFunc   func,
+			    gpointer        user_data,
+			    GError        **error);
+
+G_END_DECLS
+
+#endif /* _TZ_ZONE_TAB_H */
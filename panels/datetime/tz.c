@@ -23,131 +23,205 @@
 
 
 #include <glib.h>
-#include <stdio.h>
+#include <glib/gstdio.h>
 #include <stdlib.h>
-#include <unistd.h>
-#include <time.h>
-#include <math.h>
 #include <string.h>
 #include "tz.h"
+#include "tz-zone-tab.h"
 #include "cc-datetime-resources.h"
 
 
-/* Forward declarations for private functions */
+#define TZ_DB_RESOURCE "/org/gnome/control-center/datetime/tzdb.bin"
 
-static float convert_pos (gchar *pos, int digits);
-static int compare_country_names (const void *a, const void *b);
-static void sort_locations_by_country (GPtrArray *locations);
-static gchar * tz_data_file_get (void);
-static void load_backward_tz (TzDB *tz_db);
+#define HEADER_SIZE (6 * 4)
+#define LOCATION_SIZE (5 * 4)
+#define LINK_SIZE (2 * 4)
 
-/* ---------------- *
- * Public interface *
- * ---------------- */
-TzDB *
-tz_load_db (void)
+/* The database is read-only, so a single copy is shared
+ * by everyone in the process */
+G_LOCK_DEFINE_STATIC (default_db);
+static TzDB *default_db = NULL;
+
+G_LOCK_DEFINE_STATIC (time_zones);
+
+static inline guint32
+read_uint32 (const guchar *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32) p[3] << 24);
+}
+
+static const gchar *
+get_string (TzDB *db, guint32 offset)
 {
-	gchar *tz_data_file;
+	if (offset == TZ_DB_NO_STRING)
+		return NULL;
+	return db->pool + offset;
+}
+
+typedef struct {
+	GStringChunk *strings;
+	GArray *records;
+} ZoneTabData;
+
+static void
+add_location (const gchar *country, const gchar *zone, const gchar *comment,
+	      gdouble latitude, gdouble longitude, gpointer user_data)
+{
+	ZoneTabData *data = user_data;
+	TzLocation loc;
+
+	loc.country = g_string_chunk_insert_const (data->strings, country);
+	loc.zone = g_string_chunk_insert_const (data->strings, zone);
+	loc.comment = comment ? g_string_chunk_insert_const (data->strings, comment) : NULL;
+	loc.latitude = latitude;
+	loc.longitude = longitude;
+
+	g_array_append_val (data->records, loc);
+}
+
+/* Replaces the locations of @tz_db with the ones of zone.tab, if it
+ * changed since the database was compiled from it */
+static void
+load_newer_zone_tab (TzDB *tz_db, guint64 mtime)
+{
+	ZoneTabData data;
+	GStatBuf buf;
+	GError *error = NULL;
+	guint n_locations, i;
+
+	if (g_stat (TZ_DATA_FILE, &buf) != 0 || (guint64) buf.st_mtime <= mtime)
+		return;
+
+	data.strings = g_string_chunk_new (4096);
+	data.records = g_array_new (FALSE, FALSE, sizeof (TzLocation));
+
+	if (!tz_zone_tab_parse (TZ_DATA_FILE, add_location, &data, &error)) {
+		g_warning ("Could not load %s: %s", TZ_DATA_FILE, error->message);
+		g_error_free (error);
+		g_array_free (data.records, TRUE);
+		g_string_chunk_free (data.strings);
+		return;
+	}
+
+	g_debug ("%s is newer than the timezone database, using it instead", TZ_DATA_FILE);
+
+	n_locations = data.records->len;
+
+	g_free (tz_db->records);
+	tz_db->records = (TzLocation *) g_array_free (data.records, FALSE);
+	tz_db->strings = data.strings;
+
+	g_ptr_array_set_size (tz_db->locations, 0);
+	for (i = 0; i < n_locations; i++)
+		g_ptr_array_add (tz_db->locations, &tz_db->records[i]);
+}
+
+static TzDB *
+tz_db_new (void)
+{
+	GBytes *bytes;
+	const guchar *data, *p;
+	gsize size, pool_start;
+	guint n_locations, n_links, i;
+	guint64 mtime;
 	TzDB *tz_db;
-	FILE *tzfile;
-	char buf[4096];
 
-	tz_data_file = tz_data_file_get ();
-	if (!tz_data_file) {
-		g_warning ("Could not get the TimeZone data file name");
+	bytes = g_resources_lookup_data (TZ_DB_RESOURCE, G_RESOURCE_LOOKUP_FLAGS_NONE, NULL);
+	if (!bytes) {
+		g_warning ("Could not find the timezone database");
+		return NULL;
+	}
+
+	data = g_bytes_get_data (bytes, &size);
+	if (size < HEADER_SIZE ||
+	    memcmp (data, TZ_DB_MAGIC, 4) != 0 ||
+	    read_uint32 (data + 4) != TZ_DB_VERSION) {
+		g_warning ("Invalid timezone database");
+		g_bytes_unref (bytes);
 		return NULL;
 	}
-	tzfile = fopen (tz_data_file, "r");
-	if (!tzfile) {
-		g_warning ("Could not open *%s*\n", tz_data_file);
-		g_free (tz_data_file);
+
+	mtime = read_uint32 (data + 8) | ((guint64) read_uint32 (data + 12) << 32);
+	n_locations = read_uint32 (data + 16);
+	n_links = read_uint32 (data + 20);
+	pool_start = HEADER_SIZE + (gsize) n_locations * LOCATION_SIZE + (gsize) n_links * LINK_SIZE;
+	/* The pool must end with the last string's nul */
+	if (size <= pool_start || data[size - 1] != '\0') {
+		g_warning ("Invalid timezone database");
+		g_bytes_unref (bytes);
 		return NULL;
 	}
 
 	tz_db = g_new0 (TzDB, 1);
-	tz_db->locations = g_ptr_array_new ();
-
-	while (fgets (buf, sizeof(buf), tzfile))
-	{
-		gchar **tmpstrarr;
-		gchar *latstr, *lngstr, *p;
-		TzLocation *loc;
-
-		if (*buf == '#') continue;
-
-		g_strchomp(buf);
-		tmpstrarr = g_strsplit(buf,"\t", 6);
-		
-		latstr = g_strdup (tmpstrarr[1]);
-		p = latstr + 1;
-		while (*p != '-' && *p != '+') p++;
-		lngstr = g_strdup (p);
-		*p = '\0';
-		
-		loc = g_new0 (TzLocation, 1);
-		loc->country = g_strdup (tmpstrarr[0]);
-		loc->zone = g_strdup (tmpstrarr[2]);
-		loc->latitude  = convert_pos (latstr, 2);
-		loc->longitude = convert_pos (lngstr, 3);
-		
-#ifdef __sun
-		if (tmpstrarr[3] && *tmpstrarr[3] == '-' && tmpstrarr[4])
-			loc->comment = g_strdup (tmpstrarr[4]);
-
-		if (tmpstrarr[3] && *tmpstrarr[3] != '-' && !islower(loc->zone)) {
-			TzLocation *locgrp;
-
-			/* duplicate entry */
-			locgrp = g_new0 (TzLocation, 1);
-			locgrp->country = g_strdup (tmpstrarr[0]);
-			locgrp->zone = g_strdup (tmpstrarr[3]);
-			locgrp->latitude  = convert_pos (latstr, 2);
-			locgrp->longitude = convert_pos (lngstr, 3);
-			locgrp->comment = (tmpstrarr[4]) ? g_strdup (tmpstrarr[4]) : NULL;
-
-			g_ptr_array_add (tz_db->locations, (gpointer) locgrp);
-		}
-#else
-		loc->comment = (tmpstrarr[3]) ? g_strdup(tmpstrarr[3]) : NULL;
-#endif
+	tz_db->data = bytes;
+	tz_db->pool = (const gchar *) data + pool_start;
+	tz_db->links = data + HEADER_SIZE + n_locations * LOCATION_SIZE;
+	tz_db->n_links = n_links;
 
-		g_ptr_array_add (tz_db->locations, (gpointer) loc);
+	/* The strings point straight into the resource data */
+	tz_db->records = g_new0 (TzLocation, n_locations);
+	tz_db->locations = g_ptr_array_sized_new (n_locations);
 
-		g_free (latstr);
-		g_free (lngstr);
-		g_strfreev (tmpstrarr);
+	for (i = 0, p = data + HEADER_SIZE; i < n_locations; i++, p += LOCATION_SIZE) {
+		TzLocation *loc = &tz_db->records[i];
+
+		loc->country = (gchar *) get_string (tz_db, read_uint32 (p));
+		loc->zone = (gchar *) get_string (tz_db, read_uint32 (p + 4));
+		loc->comment = (gchar *) get_string (tz_db, read_uint32 (p + 8));
+		loc->latitude = (gint32) read_uint32 (p + 12) / TZ_DB_POSITION_SCALE;
+		loc->longitude = (gint32) read_uint32 (p + 16) / TZ_DB_POSITION_SCALE;
+
+		g_ptr_array_add (tz_db->locations, loc);
 	}
-	
-	fclose (tzfile);
-	
-	/* now sort by country */
-	sort_locations_by_country (tz_db->locations);
-	
-	g_free (tz_data_file);
 
-	/* Load up the hashtable of backward links */
-	load_backward_tz (tz_db);
+	load_newer_zone_tab (tz_db, mtime);
 
 	return tz_db;
 }
 
-static void
-tz_location_free (TzLocation *loc)
+/* ---------------- *
+ * Public interface *
+ * ---------------- */
+
+/* Returns the process-wide database, to be released with tz_db_free() */
+TzDB *
+tz_load_db (void)
 {
-	g_free (loc->country);
-	g_free (loc->zone);
-	g_free (loc->comment);
+	TzDB *tz_db;
 
-	g_free (loc);
+	G_LOCK (default_db);
+
+	if (default_db == NULL)
+		default_db = tz_db_new ();
+	if (default_db != NULL)
+		default_db->ref_count++;
+	tz_db = default_db;
+
+	G_UNLOCK (default_db);
+
+	return tz_db;
 }
 
 void
 tz_db_free (TzDB *db)
 {
-	g_ptr_array_foreach (db->locations, (GFunc) tz_location_free, NULL);
-	g_ptr_array_free (db->locations, TRUE);
-	g_hash_table_destroy (db->backward);
-	g_free (db);
+	g_return_if_fail (db != NULL);
+
+	G_LOCK (default_db);
+
+	if (--db->ref_count == 0) {
+		if (db == default_db)
+			default_db = NULL;
+
+		g_ptr_array_free (db->locations, TRUE);
+		g_free (db->records);
+		if (db->strings)
+			g_string_chunk_free (db->strings);
+		g_bytes_unref (db->data);
+		g_free (db);
+	}
+
+	G_UNLOCK (default_db);
 }
 
 GPtrArray *
@@ -185,69 +259,98 @@ tz_location_get_position (TzLocation *loc, double *longitude, double *latitude)
 	*latitude = loc->latitude;
 }
 
+/* Returns a reference to the time zone of @loc, which can be used
+ * from any thread. They are cached for the lifetime of the process,
+ * so that each zone's transitions are only loaded once. */
+GTimeZone *
+tz_location_get_time_zone (TzLocation *loc)
+{
+	static GHashTable *time_zones = NULL;
+	GTimeZone *tz;
+
+	g_return_val_if_fail (loc != NULL, NULL);
+	g_return_val_if_fail (loc->zone != NULL, NULL);
+
+	G_LOCK (time_zones);
+
+	if (time_zones == NULL)
+		time_zones = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, (GDestroyNotify) g_time_zone_unref);
+
+	tz = g_hash_table_lookup (time_zones, loc->zone);
+	if (tz == NULL) {
+		tz = g_time_zone_new (loc->zone);
+		g_hash_table_insert (time_zones, g_strdup (loc->zone), tz);
+	}
+	g_time_zone_ref (tz);
+
+	G_UNLOCK (time_zones);
+
+	return tz;
+}
+
+static gint
+find_interval (GTimeZone *tz, gint64 time)
+{
+	gint interval;
+
+	interval = g_time_zone_find_interval (tz, G_TIME_TYPE_UNIVERSAL, time);
+
+	return MAX (interval, 0);
+}
+
 glong
-tz_location_get_utc_offset (TzLocation *loc)
+tz_location_get_utc_offset_at (TzLocation *loc, gint64 time)
 {
-	TzInfo *tz_info;
+	GTimeZone *tz;
 	glong offset;
 
-	tz_info = tz_info_from_location (loc);
-	offset = tz_info->utc_offset;
-	tz_info_free (tz_info);
+	tz = tz_location_get_time_zone (loc);
+	offset = g_time_zone_get_offset (tz, find_interval (tz, time));
+	g_time_zone_unref (tz);
+
 	return offset;
 }
 
+glong
+tz_location_get_utc_offset (TzLocation *loc)
+{
+	return tz_location_get_utc_offset_at (loc, g_get_real_time () / G_USEC_PER_SEC);
+}
+
 TzInfo *
-tz_info_from_location (TzLocation *loc)
+tz_info_from_location_at (TzLocation *loc, gint64 time)
 {
 	TzInfo *tzinfo;
-	time_t curtime;
-	struct tm *curzone;
-	gchar *tz_env_value;
-	
+	GTimeZone *tz;
+	const gchar *abbreviation;
+	gint interval;
+
 	g_return_val_if_fail (loc != NULL, NULL);
 	g_return_val_if_fail (loc->zone != NULL, NULL);
-	
-	tz_env_value = g_strdup (getenv ("TZ"));
-	setenv ("TZ", loc->zone, 1);
-	
-#if 0
-	tzset ();
-#endif
+
+	tz = tz_location_get_time_zone (loc);
+	interval = find_interval (tz, time);
+
 	tzinfo = g_new0 (TzInfo, 1);
 
-	curtime = time (NULL);
-	curzone = localtime (&curtime);
-
-#ifndef __sun
-	/* Currently this solution doesnt seem to work - I get that */
-	/* America/Phoenix uses daylight savings, which is wrong    */
-	tzinfo->tzname_normal = g_strdup (curzone->tm_zone);
-	if (curzone->tm_isdst) 
-		tzinfo->tzname_daylight =
-			g_strdup (&curzone->tm_zone[curzone->tm_isdst]);
-	else
-		tzinfo->tzname_daylight = NULL;
-
-	tzinfo->utc_offset = curzone->tm_gmtoff;
-#else
-	tzinfo->tzname_normal = NULL;
-	tzinfo->tzname_daylight = NULL;
-	tzinfo->utc_offset = 0;
-#endif
-
-	tzinfo->daylight = curzone->tm_isdst;
-
-	if (tz_env_value)
-		setenv ("TZ", tz_env_value, 1);
-	else
-		unsetenv ("TZ");
-
-	g_free (tz_env_value);
-	
+	abbreviation = g_time_zone_get_abbreviation (tz, interval);
+	tzinfo->utc_offset = g_time_zone_get_offset (tz, interval);
+	tzinfo->daylight = g_time_zone_is_dst (tz, interval);
+	tzinfo->tzname_normal = g_strdup (abbreviation);
+	tzinfo->tzname_daylight = tzinfo->daylight ? g_strdup (abbreviation) : NULL;
+
+	g_time_zone_unref (tz);
+
 	return tzinfo;
 }
 
+TzInfo *
+tz_info_from_location (TzLocation *loc)
+{
+	return tz_info_from_location_at (loc, g_get_real_time () / G_USEC_PER_SEC);
+}
+
 
 void
 tz_info_free (TzInfo *tzinfo)
@@ -287,6 +390,30 @@ struct {
 	{ "MST7MDT",        "America/Denver" },		/* ditto */
 };
 
+/* Returns the current name of a zone, from its old name */
+static const char *
+lookup_backward (TzDB *tz_db,
+		 const char *alias)
+{
+	guint lo = 0, hi = tz_db->n_links;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+		const guchar *link = tz_db->links + mid * LINK_SIZE;
+		int cmp;
+
+		cmp = strcmp (alias, get_string (tz_db, read_uint32 (link)));
+		if (cmp == 0)
+			return get_string (tz_db, read_uint32 (link + 4));
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return NULL;
+}
+
 static gboolean
 compare_timezones (const char *a,
 		   const char *b)
@@ -311,8 +438,8 @@ char *
 tz_info_get_clean_name (TzDB *tz_db,
 			const char *tz)
 {
-	char *ret;
 	const char *timezone;
+	const char *ret;
 	guint i;
 	gboolean replaced;
 
@@ -346,138 +473,8 @@ tz_info_get_clean_name (TzDB *tz_db,
 	if (!replaced)
 		timezone = tz;
 
-	ret = g_hash_table_lookup (tz_db->backward, timezone);
+	ret = lookup_backward (tz_db, timezone);
 	if (ret == NULL)
 		return g_strdup (timezone);
 	return g_strdup (ret);
 }
-
-/* ----------------- *
- * Private functions *
- * ----------------- */
-
-static gchar *
-tz_data_file_get (void)
-{
-	gchar *file;
-
-	file = g_strdup (TZ_DATA_FILE);
-
-	return file;
-}
-
-static float
-convert_pos (gchar *pos, int digits)
-{
-	gchar whole[10];
-	gchar *fraction;
-	gint i;
-	float t1, t2;
-	
-	if (!pos || strlen(pos) < 4 || digits > 9) return 0.0;
-	
-	for (i = 0; i < digits + 1; i++) whole[i] = pos[i];
-	whole[i] = '\0';
-	fraction = pos + digits + 1;
-
-	t1 = g_strtod (whole, NULL);
-	t2 = g_strtod (fraction, NULL);
-
-	if (t1 >= 0.0) return t1 + t2/pow (10.0, strlen(fraction));
-	else return t1 - t2/pow (10.0, strlen(fraction));
-}
-
-
-#if 0
-
-/* Currently not working */
-static void
-free_tzdata (TzLocation *tz)
-{
-	
-	if (tz->country)
-	  g_free(tz->country);
-	if (tz->zone)
-	  g_free(tz->zone);
-	if (tz->comment)
-	  g_free(tz->comment);
-	
-	g_free(tz);
-}
-#endif
-
-
-static int
-compare_country_names (const void *a, const void *b)
-{
-	const TzLocation *tza = * (TzLocation **) a;
-	const TzLocation *tzb = * (TzLocation **) b;
-	
-	return strcmp (tza->zone, tzb->zone);
-}
-
-
-static void
-sort_locations_by_country (GPtrArray *locations)
-{
-	qsort (locations->pdata, locations->len, sizeof (gpointer),
-	       compare_country_names);
-}
-
-static void
-load_backward_tz (TzDB *tz_db)
-{
-  char **lines;
-  GBytes *bytes;
-  const char *contents;
-  guint i;
-
-  tz_db->backward = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
-
-  bytes = g_resources_lookup_data ("/org/gnome/control-center/datetime/backward",
-                                   G_RESOURCE_LOOKUP_FLAGS_NONE, NULL);
-  contents = (const char *) g_bytes_get_data (bytes, NULL);
-
-  lines = g_strsplit (contents, "\n", -1);
-  g_bytes_unref (bytes);
-
-  for (i = 0; lines[i] != NULL; i++)
-    {
-      char **items;
-      guint j;
-      char *real, *alias;
-
-      if (g_ascii_strncasecmp (lines[i], "Link\t", 5) != 0)
-        continue;
-
-      items = g_strsplit (lines[i], "\t", -1);
-      real = NULL;
-      alias = NULL;
-      /* Skip the "Link<tab>" part */
-      for (j = 1; items[j] != NULL; j++)
-        {
-          if (items[j][0] == '\0')
-            continue;
-          if (real == NULL)
-            {
-              real = items[j];
-              continue;
-            }
-          alias = items[j];
-          break;
-        }
-
-      if (real == NULL || alias == NULL)
-        g_warning ("Could not parse line: %s", lines[i]);
-
-      /* We don't need more than one name for it */
-      if (g_str_equal (real, "Etc/UTC") ||
-          g_str_equal (real, "Etc/UCT"))
-        real = "Etc/GMT";
-
-      g_hash_table_insert (tz_db->backward, g_strdup (alias), g_strdup (real));
-      g_strfreev (items);
-    }
-  g_strfreev (lines);
-}
-
@@ -38,10 +38,40 @@ typedef struct _TzLocation TzLocation;
 typedef struct _TzInfo TzInfo;
 
 
+/* The database is compiled from zone.tab and the backward links at
+ * build time by gen-tzdb, and shipped in the resources. All the values
+ * are little endian 32-bit integers:
+ *
+ * "TZDB", version, modification time of zone.tab (low and high
+ * 32 bits), number of locations, number of links
+ * locations sorted by zone: country, zone, comment, latitude, longitude
+ * links sorted by alias: alias, real zone
+ * the string pool, with all the strings above as offsets into it
+ *
+ * Positions are in millionths of a degree, and missing strings are
+ * TZ_DB_NO_STRING.
+ *
+ * The locations are a snapshot of the build machine's zone.tab, so
+ * when TZ_DATA_FILE is newer than that, tz_load_db() reads the
+ * locations from it instead.
+ */
+#define TZ_DB_MAGIC "TZDB"
+#define TZ_DB_VERSION 2
+#define TZ_DB_NO_STRING G_MAXUINT32
+#define TZ_DB_POSITION_SCALE 1000000.0
+
 struct _TzDB
 {
 	GPtrArray  *locations;
-	GHashTable *backward;
+
+	/*< private >*/
+	GBytes     *data;
+	TzLocation *records;
+	GStringChunk *strings;
+	const guchar *links;
+	guint       n_links;
+	const gchar *pool;
+	gint        ref_count;
 };
 
 struct _TzLocation
@@ -51,13 +81,10 @@ struct _TzLocation
 	gdouble longitude;
 	gchar *zone;
 	gchar *comment;
-
-	gdouble dist; /* distance to clicked point for comparison */
 };
 
-/* see the glibc info page information on time zone information */
-/*  tzname_normal    is the default name for the timezone */
-/*  tzname_daylight  is the name of the zone when in daylight savings */
+/*  tzname_normal    is the abbreviation of the zone at the time */
+/*  tzname_daylight  is the same, if the zone is in daylight savings */
 /*  utc_offset       is offset in seconds from utc */
 /*  daylight         if non-zero then location obeys daylight savings */
 
@@ -81,8 +108,13 @@ char      *tz_location_get_country    (TzLocation *loc);
 gchar     *tz_location_get_zone       (TzLocation *loc);
 gchar     *tz_location_get_comment    (TzLocation *loc);
 glong      tz_location_get_utc_offset (TzLocation *loc);
+glong      tz_location_get_utc_offset_at (TzLocation *loc,
+				          gint64 time);
+GTimeZone *tz_location_get_time_zone  (TzLocation *loc);
 gint       tz_location_set_locally    (TzLocation *loc);
 TzInfo    *tz_info_from_location      (TzLocation *loc);
+TzInfo    *tz_info_from_location_at   (TzLocation *loc,
+				       gint64 time);
 void       tz_info_free               (TzInfo *tz_info);
 
 #endif
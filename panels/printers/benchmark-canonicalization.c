@@ -0,0 +1,136 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Measures what naming the devices of a site costs as the site grows,
+ * the way the new printer dialog names them as they are found:
+ *
+ *   ./benchmark-canonicalization --rounds=10
+ *
+ * Each site has as many queues as devices, a few local devices, and
+ * all of them are of the same model, so every name needs a suffix.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "pp-utils.h"
+
+static gint rounds = 10;
+
+static GOptionEntry entries[] =
+{
+  { "rounds", 'r', 0, G_OPTION_ARG_INT, &rounds, "Number of times to name each site", "N" },
+  { NULL }
+};
+
+static const gint sizes[] = { 10, 100, 1000 };
+
+static gint64
+name_devices (gint n_devices)
+{
+  PpPrintDevice *device;
+  cups_dest_t   *dests;
+  GList         *local_devices = NULL;
+  GList         *names = NULL;
+  gint64         start;
+  gint64         elapsed;
+  gint           i;
+
+  /* The queues were named by an older scheme, and clash with some names */
+  dests = g_new0 (cups_dest_t, n_devices);
+  for (i = 0; i < n_devices; i++)
+    dests[i].name = g_strdup_printf ("Officejet-7300-%d", 3 * i + 2);
+
+  for (i = 0; i < n_devices / 10 + 1; i++)
+    {
+      gchar *name;
+
+      name = g_strdup_printf ("Officejet-7300-%d", 5 * i + 3);
+      local_devices = g_list_prepend (local_devices,
+                                      g_object_new (PP_TYPE_PRINT_DEVICE,
+                                                    "device-original-name", name,
+                                                    NULL));
+      g_free (name);
+    }
+
+  device = g_object_new (PP_TYPE_PRINT_DEVICE,
+                         "device-id", "MFG:HP;MDL:Officejet 7300 series;",
+                         "device-make-and-model", "HP Officejet 7300 series",
+                         NULL);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_devices; i++)
+    names = g_list_prepend (names,
+                            canonicalize_device_name (names,
+                                                      local_devices,
+                                                      dests,
+                                                      n_devices,
+                                                      device));
+  elapsed = g_get_monotonic_time () - start;
+
+  g_object_unref (device);
+  g_list_free_full (names, g_free);
+  g_list_free_full (local_devices, g_object_unref);
+  for (i = 0; i < n_devices; i++)
+    g_free (dests[i].name);
+  g_free (dests);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError         *error = NULL;
+  guint           i;
+  gint            j;
+
+  context = g_option_context_new ("- measure the naming of found devices");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (rounds <= 0)
+    {
+      g_printerr ("Nothing to measure\n");
+      return 1;
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      gint64 elapsed = 0;
+
+      for (j = 0; j < rounds; j++)
+        elapsed += name_devices (sizes[i]);
+
+      g_print ("%5d devices %10.1f us per device\n",
+               sizes[i],
+               elapsed / ((gdouble) rounds * sizes[i]));
+    }
+
+  return 0;
+}
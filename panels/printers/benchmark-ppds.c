@@ -0,0 +1,261 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Measures what finding the manufacturer of each PPD costs when the
+ * answer of CUPS_GET_PPDS is grouped, over a recording of that answer:
+ *
+ *   lpinfo -l -m > ppds.txt
+ *   ./benchmark-ppds --rounds=100 ppds.txt
+ *
+ * The allocating path the catalog used to take is measured alongside.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "pp-utils.h"
+#include "pp-normalize.h"
+#include "pp-manufacturers-table.h"
+
+static gint rounds = 1000;
+
+static GOptionEntry entries[] =
+{
+  { "rounds", 'r', 0, G_OPTION_ARG_INT, &rounds, "Number of times to go through the PPDs", "N" },
+  { NULL }
+};
+
+typedef struct
+{
+  gchar *name;
+  gchar *make;
+  gchar *make_and_model;
+  gchar *device_id;
+} PPDEntry;
+
+static void
+ppd_entry_free (PPDEntry *entry)
+{
+  g_free (entry->name);
+  g_free (entry->make);
+  g_free (entry->make_and_model);
+  g_free (entry->device_id);
+  g_free (entry);
+}
+
+/*
+ * Reads the output of "lpinfo -l -m". It has no ppd-make, which
+ * cupsd takes from the first word of the model when a PPD has no
+ * Manufacturer, so that is used instead.
+ */
+static GPtrArray *
+load_ppds (const gchar *path)
+{
+  GPtrArray  *ppds;
+  PPDEntry   *entry = NULL;
+  GError     *error = NULL;
+  gchar     **lines;
+  gchar      *contents;
+  guint       i;
+
+  if (!g_file_get_contents (path, &contents, NULL, &error))
+    {
+      g_printerr ("Could not read %s: %s\n", path, error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+  ppds = g_ptr_array_new_with_free_func ((GDestroyNotify) ppd_entry_free);
+  lines = g_strsplit (contents, "\n", -1);
+
+  for (i = 0; lines[i] != NULL; i++)
+    {
+      gchar *line = g_strstrip (lines[i]);
+      gchar *value;
+
+      if (line[0] == '#' || line[0] == '\0')
+        continue;
+
+      if (g_str_has_prefix (line, "Model:"))
+        {
+          entry = g_new0 (PPDEntry, 1);
+          g_ptr_array_add (ppds, entry);
+          line = g_strchug (line + strlen ("Model:"));
+        }
+
+      value = strstr (line, " = ");
+      if (entry == NULL || value == NULL)
+        continue;
+
+      *value = '\0';
+      value += strlen (" = ");
+
+      if (g_str_equal (line, "name"))
+        {
+          entry->name = g_strdup (value);
+        }
+      else if (g_str_equal (line, "make-and-model"))
+        {
+          entry->make_and_model = g_strdup (value);
+          entry->make = g_strndup (value, strcspn (value, " "));
+        }
+      else if (g_str_equal (line, "device_id"))
+        {
+          entry->device_id = g_strdup (value);
+        }
+    }
+
+  g_strfreev (lines);
+  g_free (contents);
+
+  return ppds;
+}
+
+/* The manufacturers table is a hash table filled at each listing */
+static guint
+find_manufacturers_allocating (GPtrArray *ppds)
+{
+  GHashTable *manufacturers_hash;
+  guint       found = 0;
+  guint       i;
+
+  manufacturers_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
+    g_hash_table_insert (manufacturers_hash,
+                         g_strdup (manufacturers_names[i].normalized_name),
+                         g_strdup (manufacturers_names[i].display_name));
+
+  for (i = 0; i < ppds->len; i++)
+    {
+      PPDEntry *entry = ppds->pdata[i];
+      gchar    *mfg = NULL;
+      gchar    *mfg_normalized = NULL;
+
+      if (entry->device_id && entry->device_id[0] != '\0')
+        {
+          mfg = get_tag_value (entry->device_id, "mfg");
+          if (!mfg)
+            mfg = get_tag_value (entry->device_id, "manufacturer");
+        }
+
+      if (!mfg && entry->make && entry->make[0] != '\0')
+        mfg = g_strdup (entry->make);
+
+      if (mfg)
+        {
+          mfg_normalized = normalize (mfg);
+          if (g_hash_table_lookup (manufacturers_hash, mfg_normalized))
+            found++;
+        }
+
+      g_free (mfg_normalized);
+      g_free (mfg);
+    }
+
+  g_hash_table_destroy (manufacturers_hash);
+
+  return found;
+}
+
+static guint
+find_manufacturers (GPtrArray *ppds)
+{
+  guint found = 0;
+  guint i;
+
+  for (i = 0; i < ppds->len; i++)
+    {
+      PPDEntry    *entry = ppds->pdata[i];
+      const gchar *mfg;
+      gchar        mfg_normalized[NORMALIZED_NAME_SIZE];
+      gsize        length;
+
+      mfg = get_ppd_manufacturer (entry->device_id, entry->make, &length);
+      if (mfg)
+        {
+          normalize_into (mfg, length, mfg_normalized, sizeof (mfg_normalized));
+          if (lookup_standard_manufacturer (mfg_normalized, NULL))
+            found++;
+        }
+    }
+
+  return found;
+}
+
+static void
+measure (const gchar *label,
+         guint      (*func) (GPtrArray *ppds),
+         GPtrArray   *ppds)
+{
+  gint64 start;
+  gint64 elapsed;
+  guint  found = 0;
+  gint   i;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < rounds; i++)
+    found = func (ppds);
+  elapsed = g_get_monotonic_time () - start;
+
+  g_print ("%-12s %8.1f ns per PPD, %u of %u manufacturers known\n",
+           label,
+           elapsed * 1000.0 / ((gdouble) rounds * ppds->len),
+           found,
+           ppds->len);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GPtrArray      *ppds;
+  GError         *error = NULL;
+
+  context = g_option_context_new ("[RECORDING] - measure the grouping of PPDs by manufacturer");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  ppds = load_ppds (argc > 1 ? argv[1] : TEST_SRCDIR "ppds-lpinfo.txt");
+  if (ppds == NULL)
+    return 1;
+
+  if (ppds->len == 0 || rounds <= 0)
+    {
+      g_printerr ("Nothing to measure\n");
+      g_ptr_array_unref (ppds);
+      return 1;
+    }
+
+  measure ("allocating", find_manufacturers_allocating, ppds);
+  measure ("in place", find_manufacturers, ppds);
+
+  g_ptr_array_unref (ppds);
+
+  return 0;
+}
@@ -42,6 +42,7 @@
 #include "pp-maintenance-command.h"
 #include "pp-cups.h"
 #include "pp-job.h"
+#include "pp-markers.h"
 
 CC_PANEL_REGISTER (CcPrintersPanel, cc_printers_panel)
 
@@ -61,6 +62,8 @@ CC_PANEL_REGISTER (CcPrintersPanel, cc_printers_panel)
 
 #define CUPS_STATUS_CHECK_INTERVAL 5
 
+#define SUPPLY_HISTORY_SAVE_TIMEOUT 5
+
 #if (CUPS_VERSION_MAJOR > 1) || (CUPS_VERSION_MINOR > 5)
 #define HAVE_CUPS_1_6 1
 #endif
@@ -81,8 +84,24 @@ struct _CcPrintersPanelPrivate
   int num_dests;
   int current_dest;
 
+  GtkListStore *printers_store;
+  gboolean      printers_list_refreshing;
+  gboolean      printers_list_refresh_pending;
+
   int num_jobs;
 
+  GHashTable   *active_jobs;
+  GHashTable   *jobs_counts;
+  GCancellable *count_jobs_cancellable;
+  gboolean      counting_jobs;
+  gboolean      count_jobs_pending;
+
+  GHashTable      *markers_cache;
+  GHashTable      *markers_stale;
+  GHashTable      *markers_updates;
+  PpSupplyHistory *supply_history;
+  guint            supply_history_save_id;
+
   GPermission *permission;
 
   GSettings *lockdown_settings;
@@ -129,8 +148,41 @@ typedef struct
   GCancellable *cancellable;
 } SetPPDItem;
 
+/*
+ * The supplies of a printer as drawn in the details, which only
+ * change when the printer notifies a change of state. The bar is
+ * rendered once for the width and scale it was last drawn at.
+ */
+typedef struct
+{
+  GPtrArray       *markers;
+  gchar           *tooltip;
+  cairo_surface_t *bar;
+  gint             bar_width;
+  gint             bar_scale;
+} PrinterMarkers;
+
+static void
+printer_markers_free (PrinterMarkers *printer_markers)
+{
+  g_ptr_array_unref (printer_markers->markers);
+  g_free (printer_markers->tooltip);
+  g_clear_pointer (&printer_markers->bar, cairo_surface_destroy);
+  g_free (printer_markers);
+}
+
 static void update_jobs_count (CcPrintersPanel *self);
+static void count_jobs (CcPrintersPanel *self);
+static void add_active_job (CcPrintersPanel *self, gint job_id, const gchar *printer_name);
+static void remove_active_job (CcPrintersPanel *self, gint job_id);
 static void actualize_printers_list (CcPrintersPanel *self);
+static gboolean update_printer_state (CcPrintersPanel *self,
+                                      const gchar     *printer_name,
+                                      gint             printer_state,
+                                      const gchar     *printer_state_reasons,
+                                      gboolean         printer_is_accepting_jobs);
+static gboolean remove_printer (CcPrintersPanel *self, const gchar *printer_name);
+static void update_printer_markers (CcPrintersPanel *self, const gchar *printer_name);
 static void update_sensitivity (gpointer user_data);
 static void printer_disable_cb (GObject *gobject, GParamSpec *pspec, gpointer user_data);
 static void printer_set_default_cb (GtkToggleButton *button, gpointer user_data);
@@ -190,6 +242,7 @@ cc_printers_panel_dispose (GObject *object)
     g_clear_object (&priv->pp_new_printer_dialog);
 
   free_dests (CC_PRINTERS_PANEL (object));
+  g_clear_object (&priv->printers_store);
 
   g_clear_pointer (&priv->new_printer_name, g_free);
   g_clear_pointer (&priv->new_printer_location, g_free);
@@ -238,6 +291,25 @@ cc_printers_panel_dispose (GObject *object)
       priv->preferred_drivers = NULL;
     }
 
+  g_cancellable_cancel (priv->count_jobs_cancellable);
+  g_clear_object (&priv->count_jobs_cancellable);
+  g_clear_pointer (&priv->active_jobs, g_hash_table_unref);
+  g_clear_pointer (&priv->jobs_counts, g_hash_table_unref);
+
+  g_clear_pointer (&priv->markers_cache, g_hash_table_unref);
+  g_clear_pointer (&priv->markers_stale, g_hash_table_unref);
+  g_clear_pointer (&priv->markers_updates, g_hash_table_unref);
+
+  if (priv->supply_history_save_id > 0)
+    {
+      g_source_remove (priv->supply_history_save_id);
+      priv->supply_history_save_id = 0;
+    }
+
+  if (priv->supply_history != NULL)
+    pp_supply_history_save (priv->supply_history);
+  g_clear_pointer (&priv->supply_history, pp_supply_history_free);
+
   if (priv->get_all_ppds_cancellable)
     {
       g_cancellable_cancel (priv->get_all_ppds_cancellable);
@@ -307,10 +379,14 @@ on_get_job_attributes_cb (GObject      *source_object,
   GVariant               *attributes;
   GVariant               *username;
   GVariant               *printer_uri;
+  GVariant               *job_state;
   GError                 *error = NULL;
+  gint                    job_id;
+  gint                    state;
 
   priv = PRINTERS_PANEL_PRIVATE (self);
 
+  g_object_get (source_object, "id", &job_id, NULL);
   attributes = pp_job_get_attributes_finish (PP_JOB (source_object), res, &error);
   g_object_unref (source_object);
 
@@ -323,21 +399,28 @@ on_get_job_attributes_cb (GObject      *source_object,
               job_originating_user_name = g_variant_get_string (g_variant_get_child_value (username, 0), NULL);
               job_printer_uri = g_variant_get_string (g_variant_get_child_value (printer_uri, 0), NULL);
 
+              /* The job can be over by the time its attributes are here */
+              state = IPP_JOB_PENDING;
+              if ((job_state = g_variant_lookup_value (attributes, "job-state", G_VARIANT_TYPE ("ai"))) != NULL)
+                {
+                  if (g_variant_n_children (job_state) > 0)
+                    g_variant_get_child (job_state, 0, "i", &state);
+                  g_variant_unref (job_state);
+                }
+
               if (job_originating_user_name != NULL && job_printer_uri != NULL &&
                   g_strcmp0 (job_originating_user_name, cupsUser ()) == 0 &&
                   g_strrstr (job_printer_uri, "/") != 0 &&
-                  priv->current_dest >= 0 &&
-                  priv->current_dest < priv->num_dests &&
-                  priv->dests != NULL &&
-                  g_strcmp0 (g_strrstr (job_printer_uri, "/") + 1,
-                                        priv->dests[priv->current_dest].name) == 0)
+                  state < IPP_JOB_CANCELED)
                 {
-                  update_jobs_count (self);
+                  if (priv->counting_jobs)
+                    count_jobs (self);
+                  else
+                    add_active_job (self, job_id, g_strrstr (job_printer_uri, "/") + 1);
                 }
 
 	      g_variant_unref (printer_uri);
             }
-
 	  g_variant_unref (username);
 	}
 
@@ -363,13 +446,14 @@ on_cups_notification (GDBusConnection *connection,
   PpJob                  *job;
   gchar                  *job_state_reasons = NULL;
   gchar                  *job_name = NULL;
-  guint                   job_id;
+  guint                   job_id = 0;
   gint                    printer_state;
   gint                    job_state;
   gint                    job_impressions_completed;
   static gchar *requested_attrs[] = {
     "job-printer-uri",
     "job-originating-user-name",
+    "job-state",
     NULL };
 
   if (g_strcmp0 (signal_name, "PrinterAdded") != 0 &&
@@ -408,14 +492,36 @@ on_cups_notification (GDBusConnection *connection,
                      &job_impressions_completed);
     }
 
-  if (g_strcmp0 (signal_name, "PrinterAdded") == 0 ||
-      g_strcmp0 (signal_name, "PrinterDeleted") == 0 ||
-      g_strcmp0 (signal_name, "PrinterStateChanged") == 0 ||
+  /*
+   * Changes of state and removals are applied to the printers we
+   * know about. Anything else, e.g. a new printer whose details are
+   * not in the notification, or a printer we haven't heard of, is
+   * caught up with by listing all the printers again.
+   */
+  if (g_strcmp0 (signal_name, "PrinterStateChanged") == 0 ||
       g_strcmp0 (signal_name, "PrinterStopped") == 0)
+    {
+      if (self->priv->printers_list_refreshing ||
+          printer_name == NULL ||
+          !update_printer_state (self,
+                                 printer_name,
+                                 printer_state,
+                                 printer_state_reasons,
+                                 printer_is_accepting_jobs))
+        actualize_printers_list (self);
+    }
+  else if (g_strcmp0 (signal_name, "PrinterDeleted") == 0)
+    {
+      if (self->priv->printers_list_refreshing ||
+          printer_name == NULL ||
+          !remove_printer (self, printer_name))
+        actualize_printers_list (self);
+    }
+  else if (g_strcmp0 (signal_name, "PrinterAdded") == 0)
     actualize_printers_list (self);
-  else if (g_strcmp0 (signal_name, "JobCreated") == 0 ||
-           g_strcmp0 (signal_name, "JobCompleted") == 0)
+  else if (g_strcmp0 (signal_name, "JobCreated") == 0 && job_id > 0)
     {
+      /* Only the jobs of the user are counted */
       job = g_object_new (PP_TYPE_JOB, "id", job_id, NULL);
       pp_job_get_attributes_async (job,
                                    requested_attrs,
@@ -423,6 +529,13 @@ on_cups_notification (GDBusConnection *connection,
                                    on_get_job_attributes_cb,
                                    self);
     }
+  else if (g_strcmp0 (signal_name, "JobCompleted") == 0 && job_id > 0)
+    {
+      if (self->priv->counting_jobs)
+        count_jobs (self);
+      else
+        remove_active_job (self, job_id);
+    }
 }
 
 static gchar *subscription_events[] = {
@@ -451,6 +564,14 @@ renew_subscription_cb (GObject      *source_object,
     {
       priv = self->priv;
 
+      /* The old subscription expired, and what happened
+       * in between was missed */
+      if (subscription_id != priv->subscription_id)
+        {
+          actualize_printers_list (self);
+          count_jobs (self);
+        }
+
       priv->subscription_id = subscription_id;
     }
 }
@@ -639,6 +760,7 @@ enum
   PRINTER_PAUSED_COLUMN,
   PRINTER_DEFAULT_ICON_COLUMN,
   PRINTER_ICON_COLUMN,
+  PRINTER_JOBS_COLUMN,
   PRINTER_N_COLUMNS
 };
 
@@ -1165,6 +1287,378 @@ set_current_page (GObject      *source_object,
     gtk_stack_set_visible_child_name (GTK_STACK (widget), "no-cups-page");
 }
 
+/* The number of active jobs of the user on @printer_name */
+static guint
+get_jobs_count (CcPrintersPanel *self,
+                const gchar     *printer_name)
+{
+  CcPrintersPanelPrivate *priv;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  if (priv->jobs_counts == NULL)
+    return 0;
+
+  return GPOINTER_TO_UINT (g_hash_table_lookup (priv->jobs_counts, printer_name));
+}
+
+static gchar *
+get_jobs_badge (CcPrintersPanel *self,
+                const gchar     *printer_name)
+{
+  guint count;
+
+  count = get_jobs_count (self, printer_name);
+  if (count == 0)
+    return NULL;
+
+  return g_strdup_printf ("%u", count);
+}
+
+/* Updates the badges of the instances of @printer_name, or of all the printers */
+static void
+update_jobs_badges (CcPrintersPanel *self,
+                    const gchar     *printer_name)
+{
+  CcPrintersPanelPrivate *priv;
+  GtkTreeModel           *model;
+  GtkTreeIter             iter;
+  gboolean                valid;
+  gchar                  *badge;
+  gint                    id;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  if (priv->printers_store == NULL)
+    return;
+
+  model = GTK_TREE_MODEL (priv->printers_store);
+
+  valid = gtk_tree_model_get_iter_first (model, &iter);
+  while (valid)
+    {
+      gtk_tree_model_get (model, &iter, PRINTER_ID_COLUMN, &id, -1);
+
+      if (id >= 0 && id < priv->num_dests &&
+          (printer_name == NULL || g_strcmp0 (priv->dests[id].name, printer_name) == 0))
+        {
+          badge = get_jobs_badge (self, priv->dests[id].name);
+          gtk_list_store_set (priv->printers_store, &iter, PRINTER_JOBS_COLUMN, badge, -1);
+          g_free (badge);
+        }
+
+      valid = gtk_tree_model_iter_next (model, &iter);
+    }
+}
+
+static void
+jobs_count_changed (CcPrintersPanel *self,
+                    const gchar     *printer_name)
+{
+  CcPrintersPanelPrivate *priv;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  update_jobs_badges (self, printer_name);
+
+  if (priv->current_dest >= 0 &&
+      priv->current_dest < priv->num_dests &&
+      priv->dests != NULL &&
+      g_strcmp0 (priv->dests[priv->current_dest].name, printer_name) == 0)
+    update_jobs_count (self);
+}
+
+static void
+add_active_job (CcPrintersPanel *self,
+                gint             job_id,
+                const gchar     *printer_name)
+{
+  CcPrintersPanelPrivate *priv;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  if (priv->active_jobs == NULL ||
+      g_hash_table_contains (priv->active_jobs, GINT_TO_POINTER (job_id)))
+    return;
+
+  g_hash_table_insert (priv->active_jobs, GINT_TO_POINTER (job_id), g_strdup (printer_name));
+  g_hash_table_insert (priv->jobs_counts,
+                       g_strdup (printer_name),
+                       GUINT_TO_POINTER (get_jobs_count (self, printer_name) + 1));
+
+  jobs_count_changed (self, printer_name);
+}
+
+static void
+remove_active_job (CcPrintersPanel *self,
+                   gint             job_id)
+{
+  CcPrintersPanelPrivate *priv;
+  gchar                  *printer_name;
+  guint                   count;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  if (priv->active_jobs == NULL ||
+      !g_hash_table_lookup_extended (priv->active_jobs, GINT_TO_POINTER (job_id),
+                                     NULL, (gpointer *) &printer_name))
+    return;
+
+  g_hash_table_steal (priv->active_jobs, GINT_TO_POINTER (job_id));
+
+  count = get_jobs_count (self, printer_name);
+  if (count > 1)
+    g_hash_table_insert (priv->jobs_counts, g_strdup (printer_name), GUINT_TO_POINTER (count - 1));
+  else
+    g_hash_table_remove (priv->jobs_counts, printer_name);
+
+  jobs_count_changed (self, printer_name);
+
+  g_free (printer_name);
+}
+
+static void
+count_jobs_cb (GObject      *source_object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  CcPrintersPanelPrivate *priv;
+  CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
+  GHashTableIter          iter;
+  GHashTable             *jobs;
+  GError                 *error = NULL;
+  gpointer                printer_name;
+
+  jobs = pp_cups_get_active_jobs_finish (PP_CUPS (source_object), result, &error);
+  g_object_unref (source_object);
+
+  if (jobs == NULL && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      g_error_free (error);
+      return;
+    }
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+  priv->counting_jobs = FALSE;
+
+  if (jobs != NULL)
+    {
+      g_clear_pointer (&priv->active_jobs, g_hash_table_unref);
+      g_clear_pointer (&priv->jobs_counts, g_hash_table_unref);
+
+      priv->active_jobs = jobs;
+      priv->jobs_counts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+      g_hash_table_iter_init (&iter, jobs);
+      while (g_hash_table_iter_next (&iter, NULL, &printer_name))
+        g_hash_table_insert (priv->jobs_counts,
+                             g_strdup (printer_name),
+                             GUINT_TO_POINTER (get_jobs_count (self, printer_name) + 1));
+
+      update_jobs_badges (self, NULL);
+      update_jobs_count (self);
+    }
+  else
+    {
+      g_warning ("Could not count the active jobs: %s", error->message);
+      g_error_free (error);
+    }
+
+  if (priv->count_jobs_pending)
+    {
+      priv->count_jobs_pending = FALSE;
+      count_jobs (self);
+    }
+}
+
+/*
+ * Counts the active jobs of all the printers with one request. The
+ * counts are then kept up to date from the notifications, except for
+ * those which come while counting, which make it count once more.
+ */
+static void
+count_jobs (CcPrintersPanel *self)
+{
+  CcPrintersPanelPrivate *priv;
+  PpCups                 *cups;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  if (priv->counting_jobs)
+    {
+      priv->count_jobs_pending = TRUE;
+      return;
+    }
+
+  priv->counting_jobs = TRUE;
+
+  cups = pp_cups_new ();
+  pp_cups_get_active_jobs_async (cups,
+                                 priv->count_jobs_cancellable,
+                                 count_jobs_cb,
+                                 self);
+}
+
+/* The name of a destination, as shown in the list of printers */
+static gchar *
+get_dest_label (cups_dest_t *dest)
+{
+  if (dest->instance)
+    return g_strdup_printf ("%s / %s", dest->name, dest->instance);
+  else
+    return g_strdup (dest->name);
+}
+
+static void
+set_printer_row (CcPrintersPanel *self,
+                 GtkTreeIter     *iter,
+                 gint             id)
+{
+  CcPrintersPanelPrivate *priv;
+  cups_ptype_t            printer_type = 0;
+  cups_dest_t            *dest;
+  gboolean                paused = FALSE;
+  gchar                  *device_uri = NULL;
+  gchar                  *instance;
+  gchar                  *badge;
+  gint                    i;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+  dest = &priv->dests[id];
+
+  for (i = 0; i < dest->num_options; i++)
+    {
+      if (g_strcmp0 (dest->options[i].name, "printer-state") == 0)
+        paused = (g_strcmp0 (dest->options[i].value, "5") == 0);
+      else if (g_strcmp0 (dest->options[i].name, "device-uri") == 0)
+        device_uri = dest->options[i].value;
+      else if (g_strcmp0 (dest->options[i].name, "printer-type") == 0)
+        printer_type = atoi (dest->options[i].value);
+    }
+
+  instance = get_dest_label (dest);
+  badge = get_jobs_badge (self, dest->name);
+
+  gtk_list_store_set (priv->printers_store, iter,
+                      PRINTER_ID_COLUMN, id,
+                      PRINTER_NAME_COLUMN, instance,
+                      PRINTER_PAUSED_COLUMN, paused,
+                      PRINTER_DEFAULT_ICON_COLUMN, dest->is_default ? "object-select-symbolic" : NULL,
+                      PRINTER_ICON_COLUMN, printer_is_local (printer_type, device_uri) ?
+                        "printer" : "printer-network",
+                      PRINTER_JOBS_COLUMN, badge,
+                      -1);
+
+  g_free (instance);
+  g_free (badge);
+}
+
+static gboolean
+find_printer_row (CcPrintersPanel *self,
+                  gint             id,
+                  GtkTreeIter     *iter)
+{
+  CcPrintersPanelPrivate *priv;
+  GtkTreeModel           *model;
+  gboolean                valid;
+  gint                    row_id;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+  model = GTK_TREE_MODEL (priv->printers_store);
+
+  valid = gtk_tree_model_get_iter_first (model, iter);
+  while (valid)
+    {
+      gtk_tree_model_get (model, iter, PRINTER_ID_COLUMN, &row_id, -1);
+      if (row_id == id)
+        return TRUE;
+
+      valid = gtk_tree_model_iter_next (model, iter);
+    }
+
+  return FALSE;
+}
+
+/*
+ * Brings the list of printers in line with priv->dests. The rows of
+ * the printers which are still there are updated in place, so that the
+ * view keeps its selection and scroll position.
+ */
+static void
+update_printers_store (CcPrintersPanel *self)
+{
+  CcPrintersPanelPrivate *priv;
+  GtkTreeModel           *model;
+  GtkTreeIter             iter;
+  GtkTreeIter             new_iter;
+  GHashTable             *labels_set;
+  gboolean                valid;
+  gchar                 **labels;
+  gchar                  *name;
+  gint                    id;
+  gint                    i;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+  model = GTK_TREE_MODEL (priv->printers_store);
+
+  labels = g_new0 (gchar *, priv->num_dests + 1);
+  labels_set = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; i < priv->num_dests; i++)
+    {
+      labels[i] = get_dest_label (&priv->dests[i]);
+      g_hash_table_add (labels_set, labels[i]);
+    }
+
+  /* Remove the printers which are gone, and the one being added */
+  valid = gtk_tree_model_get_iter_first (model, &iter);
+  while (valid)
+    {
+      gtk_tree_model_get (model, &iter,
+                          PRINTER_ID_COLUMN, &id,
+                          PRINTER_NAME_COLUMN, &name,
+                          -1);
+
+      if (id < 0 || !g_hash_table_contains (labels_set, name))
+        valid = gtk_list_store_remove (priv->printers_store, &iter);
+      else
+        valid = gtk_tree_model_iter_next (model, &iter);
+
+      g_free (name);
+    }
+
+  /*
+   * cupsd sorts the printers, so the remaining rows are in the
+   * same order as priv->dests, and the new printers go in between.
+   */
+  valid = gtk_tree_model_get_iter_first (model, &iter);
+  for (i = 0; i < priv->num_dests; i++)
+    {
+      name = NULL;
+      if (valid)
+        gtk_tree_model_get (model, &iter, PRINTER_NAME_COLUMN, &name, -1);
+
+      if (valid && g_strcmp0 (name, labels[i]) == 0)
+        {
+          set_printer_row (self, &iter, i);
+          valid = gtk_tree_model_iter_next (model, &iter);
+        }
+      else
+        {
+          gtk_list_store_insert_before (priv->printers_store, &new_iter, valid ? &iter : NULL);
+          set_printer_row (self, &new_iter, i);
+        }
+
+      g_free (name);
+    }
+
+  /* Rows which were out of order have been added again above */
+  while (valid)
+    valid = gtk_list_store_remove (priv->printers_store, &iter);
+
+  g_hash_table_destroy (labels_set);
+  g_strfreev (labels);
+}
+
 static void
 actualize_printers_list_cb (GObject      *source_object,
                             GAsyncResult *result,
@@ -1173,35 +1667,32 @@ actualize_printers_list_cb (GObject      *source_object,
   CcPrintersPanelPrivate *priv;
   GtkTreeSelection       *selection;
   CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
-  GtkListStore           *store;
-  cups_ptype_t            printer_type = 0;
   GtkTreeModel           *model;
   GtkTreeIter             selected_iter;
   GtkTreeView            *treeview;
   GtkTreeIter             iter;
   cups_job_t             *jobs = NULL;
   GtkWidget              *widget;
-  gboolean                paused = FALSE;
   gboolean                selected_iter_set = FALSE;
   gboolean                valid = FALSE;
   PpCups                 *cups = PP_CUPS (source_object);
   PpCupsDests            *cups_dests;
   gchar                  *current_printer_name = NULL;
-  gchar                  *printer_icon_name = NULL;
-  gchar                  *default_icon_name = NULL;
-  gchar                  *device_uri = NULL;
   gint                    new_printer_position = 0;
   int                     current_dest = -1;
-  int                     i, j;
+  int                     i;
   int                     num_jobs = 0;
 
   priv = PRINTERS_PANEL_PRIVATE (self);
 
+  priv->printers_list_refreshing = FALSE;
+
   treeview = (GtkTreeView*)
     gtk_builder_get_object (priv->builder, "printers-treeview");
+  selection = gtk_tree_view_get_selection (treeview);
+  model = GTK_TREE_MODEL (priv->printers_store);
 
-  if ((selection = gtk_tree_view_get_selection (treeview)) != NULL &&
-      gtk_tree_selection_get_selected (selection, &model, &iter))
+  if (gtk_tree_selection_get_selected (selection, NULL, &iter))
     {
       gtk_tree_model_get (model, &iter,
 			  PRINTER_NAME_COLUMN, &current_printer_name,
@@ -1224,6 +1715,8 @@ actualize_printers_list_cb (GObject      *source_object,
     }
 
   free_dests (self);
+  g_hash_table_remove_all (priv->markers_cache);
+  g_hash_table_remove_all (priv->markers_stale);
   cups_dests = pp_cups_get_dests_finish (cups, result, NULL);
 
   priv->dests = cups_dests->dests;
@@ -1233,13 +1726,6 @@ actualize_printers_list_cb (GObject      *source_object,
   priv->dest_model_names = g_new0 (gchar *, priv->num_dests);
   priv->ppd_file_names = g_new0 (gchar *, priv->num_dests);
 
-  store = gtk_list_store_new (PRINTER_N_COLUMNS,
-                              G_TYPE_INT,
-                              G_TYPE_STRING,
-                              G_TYPE_BOOLEAN,
-                              G_TYPE_STRING,
-                              G_TYPE_STRING);
-
   if (priv->num_dests == 0 && !priv->new_printer_name)
     {
       widget = (GtkWidget*)
@@ -1254,9 +1740,18 @@ actualize_printers_list_cb (GObject      *source_object,
 
   g_object_unref (cups);
 
-  for (i = 0; i < priv->num_dests; i++)
+  g_signal_handlers_block_by_func (G_OBJECT (selection),
+                                   printer_selection_changed_cb,
+                                   self);
+
+  update_printers_store (self);
+
+  valid = gtk_tree_model_get_iter_first (model, &iter);
+  for (i = 0; valid; i++)
     {
-      gchar *instance;
+      gchar *name;
+
+      gtk_tree_model_get (model, &iter, PRINTER_NAME_COLUMN, &name, -1);
 
       if (priv->new_printer_name && new_printer_position >= 0)
         {
@@ -1268,169 +1763,305 @@ actualize_printers_list_cb (GObject      *source_object,
             new_printer_position = -1;
         }
 
-      gtk_list_store_append (store, &iter);
+      if (g_strcmp0 (current_printer_name, name) == 0)
+        {
+          current_dest = i;
+          selected_iter = iter;
+          selected_iter_set = TRUE;
+        }
 
-      if (priv->dests[i].instance)
+      g_free (name);
+      valid = gtk_tree_model_iter_next (model, &iter);
+    }
+
+  if (priv->new_printer_name && new_printer_position >= 0)
+    {
+      gtk_list_store_insert (priv->printers_store, &iter, new_printer_position);
+      gtk_list_store_set (priv->printers_store, &iter,
+                          PRINTER_ID_COLUMN, -1,
+                          PRINTER_NAME_COLUMN, priv->new_printer_name,
+                          PRINTER_PAUSED_COLUMN, TRUE,
+                          PRINTER_DEFAULT_ICON_COLUMN, NULL,
+                          PRINTER_ICON_COLUMN, priv->new_printer_on_network ?
+                            "printer-network" : "printer",
+                          -1);
+
+      if (g_strcmp0 (current_printer_name, priv->new_printer_name) == 0)
         {
-          instance = g_strdup_printf ("%s / %s", priv->dests[i].name, priv->dests[i].instance);
+          selected_iter = iter;
+          selected_iter_set = TRUE;
         }
-      else
+    }
+
+  if (selected_iter_set)
+    {
+      priv->current_dest = current_dest;
+    }
+  else
+    {
+      num_jobs = cupsGetJobs (&jobs, NULL, 1, CUPS_WHICHJOBS_ALL);
+
+      /* Select last used printer */
+      if (num_jobs > 0)
+        {
+          for (i = 0; i < priv->num_dests; i++)
+            if (g_strcmp0 (priv->dests[i].name, jobs[num_jobs - 1].dest) == 0)
+              {
+                priv->current_dest = i;
+                break;
+              }
+          cupsFreeJobs (num_jobs, jobs);
+        }
+
+      /* Select default printer */
+      if (priv->current_dest < 0)
         {
-          instance = g_strdup (priv->dests[i].name);
+          for (i = 0; i < priv->num_dests; i++)
+            if (priv->dests[i].is_default)
+              {
+                priv->current_dest = i;
+                break;
+              }
         }
 
-      for (j = 0; j < priv->dests[i].num_options; j++)
+      if (priv->current_dest >= 0)
+        {
+          selected_iter_set = find_printer_row (self, priv->current_dest, &selected_iter);
+        }
+      else if (priv->num_dests > 0)
         {
-          if (g_strcmp0 (priv->dests[i].options[j].name, "printer-state") == 0)
-            paused = (g_strcmp0 (priv->dests[i].options[j].value, "5") == 0);
-          else if (g_strcmp0 (priv->dests[i].options[j].name, "device-uri") == 0)
-            device_uri = priv->dests[i].options[j].value;
-          else if (g_strcmp0 (priv->dests[i].options[j].name, "printer-type") == 0)
-            printer_type = atoi (priv->dests[i].options[j].value);
+          /* Select first printer */
+          selected_iter_set = gtk_tree_model_get_iter_first (model, &selected_iter);
         }
+    }
 
-      if (priv->dests[i].is_default)
-        default_icon_name = g_strdup ("object-select-symbolic");
-      else
-        default_icon_name = NULL;
+  if (selected_iter_set)
+    gtk_tree_selection_select_iter (selection, &selected_iter);
+
+  g_signal_handlers_unblock_by_func (G_OBJECT (selection),
+                                     printer_selection_changed_cb,
+                                     self);
+
+  /* The details are those of the new list, even if the
+   * same printer stays selected */
+  if (selected_iter_set)
+    printer_selection_changed_cb (selection, self);
+
+  g_free (current_printer_name);
+
+  update_sensitivity (self);
+
+  if (priv->printers_list_refresh_pending)
+    {
+      priv->printers_list_refresh_pending = FALSE;
+      actualize_printers_list (self);
+    }
+}
+
+/*
+ * Lists all the printers again. Notifications which come in the
+ * meantime would be applied to the list which is being replaced, so
+ * they only make it list them once more after that.
+ */
+static void
+actualize_printers_list (CcPrintersPanel *self)
+{
+  CcPrintersPanelPrivate *priv;
+  PpCups                 *cups;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  if (priv->printers_list_refreshing)
+    {
+      priv->printers_list_refresh_pending = TRUE;
+      return;
+    }
+
+  priv->printers_list_refreshing = TRUE;
+
+  cups = pp_cups_new ();
+  pp_cups_get_dests_async (cups, NULL, actualize_printers_list_cb, self);
+}
+
+/*
+ * Applies the state a notification came with to all the instances of
+ * @printer_name. Returns FALSE if the list of printers has to be
+ * refreshed instead.
+ */
+static gboolean
+update_printer_state (CcPrintersPanel *self,
+                      const gchar     *printer_name,
+                      gint             printer_state,
+                      const gchar     *printer_state_reasons,
+                      gboolean         printer_is_accepting_jobs)
+{
+  CcPrintersPanelPrivate *priv;
+  GtkTreeIter             iter;
+  GtkWidget              *treeview;
+  gboolean                found = FALSE;
+  gboolean                current_changed = FALSE;
+  gchar                  *state;
+  gint                    i;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  if (printer_state < IPP_PRINTER_IDLE || printer_state > IPP_PRINTER_STOPPED)
+    return FALSE;
+
+  state = g_strdup_printf ("%d", printer_state);
+
+  for (i = 0; i < priv->num_dests; i++)
+    {
+      cups_dest_t *dest = &priv->dests[i];
+
+      if (g_strcmp0 (dest->name, printer_name) != 0)
+        continue;
+
+      dest->num_options = cupsAddOption ("printer-state",
+                                         state,
+                                         dest->num_options,
+                                         &dest->options);
+      dest->num_options = cupsAddOption ("printer-state-reasons",
+                                         printer_state_reasons ? printer_state_reasons : "none",
+                                         dest->num_options,
+                                         &dest->options);
+      dest->num_options = cupsAddOption ("printer-is-accepting-jobs",
+                                         printer_is_accepting_jobs ? "true" : "false",
+                                         dest->num_options,
+                                         &dest->options);
 
-      if (printer_is_local (printer_type, device_uri))
-        printer_icon_name = g_strdup ("printer");
-      else
-        printer_icon_name = g_strdup ("printer-network");
-
-      gtk_list_store_set (store, &iter,
-                          PRINTER_ID_COLUMN, i,
-                          PRINTER_NAME_COLUMN, instance,
-                          PRINTER_PAUSED_COLUMN, paused,
-                          PRINTER_DEFAULT_ICON_COLUMN, default_icon_name,
-                          PRINTER_ICON_COLUMN, printer_icon_name,
-                          -1);
+      if (find_printer_row (self, i, &iter))
+        set_printer_row (self, &iter, i);
 
-      if (g_strcmp0 (current_printer_name, instance) == 0)
-        {
-          current_dest = i;
-          selected_iter = iter;
-          selected_iter_set = TRUE;
-        }
+      if (i == priv->current_dest)
+        current_changed = TRUE;
 
-      g_free (instance);
-      g_free (printer_icon_name);
-      g_free (default_icon_name);
+      found = TRUE;
     }
 
-  if (priv->new_printer_name && new_printer_position >= 0)
+  g_free (state);
+
+  /* The levels are only asked for once the printer is shown */
+  if (found)
     {
-      gtk_list_store_insert (store, &iter, new_printer_position);
-      gtk_list_store_set (store, &iter,
-                          PRINTER_ID_COLUMN, -1,
-                          PRINTER_NAME_COLUMN, priv->new_printer_name,
-                          PRINTER_PAUSED_COLUMN, TRUE,
-                          PRINTER_DEFAULT_ICON_COLUMN, NULL,
-                          PRINTER_ICON_COLUMN, priv->new_printer_on_network ?
-                            "printer-network" : "printer",
-                          -1);
+      g_hash_table_remove (priv->markers_cache, printer_name);
+      g_hash_table_add (priv->markers_stale, g_strdup (printer_name));
+    }
 
-      if (g_strcmp0 (current_printer_name, priv->new_printer_name) == 0)
-        {
-          selected_iter = iter;
-          selected_iter_set = TRUE;
-        }
+  if (current_changed)
+    {
+      treeview = (GtkWidget*)
+        gtk_builder_get_object (priv->builder, "printers-treeview");
+      printer_selection_changed_cb (gtk_tree_view_get_selection (GTK_TREE_VIEW (treeview)), self);
     }
 
-  g_signal_handlers_block_by_func (
-    G_OBJECT (gtk_tree_view_get_selection (GTK_TREE_VIEW (treeview))),
-    printer_selection_changed_cb,
-    self);
+  return found;
+}
+
+/*
+ * Removes all the instances of @printer_name from the list. Returns
+ * FALSE if the list of printers has to be refreshed instead, e.g.
+ * when the selected printer goes and another one has to be picked.
+ */
+static gboolean
+remove_printer (CcPrintersPanel *self,
+                const gchar     *printer_name)
+{
+  CcPrintersPanelPrivate *priv;
+  GtkTreeModel           *model;
+  GtkTreeIter             iter;
+  gboolean                valid;
+  gint                   *new_ids;
+  gint                    old_num_dests;
+  gint                    num_removed = 0;
+  gint                    id;
+  gint                    i;
 
-  gtk_tree_view_set_model (treeview, GTK_TREE_MODEL (store));
+  priv = PRINTERS_PANEL_PRIVATE (self);
+  model = GTK_TREE_MODEL (priv->printers_store);
 
-  g_signal_handlers_unblock_by_func (
-    G_OBJECT (gtk_tree_view_get_selection (GTK_TREE_VIEW (treeview))),
-    printer_selection_changed_cb,
-    self);
+  if (priv->current_dest >= 0 &&
+      priv->current_dest < priv->num_dests &&
+      g_strcmp0 (priv->dests[priv->current_dest].name, printer_name) == 0)
+    return FALSE;
 
-  if (selected_iter_set)
+  old_num_dests = priv->num_dests;
+  new_ids = g_new (gint, old_num_dests);
+  for (i = 0; i < priv->num_dests; i++)
     {
-      priv->current_dest = current_dest;
-      gtk_tree_selection_select_iter (
-        gtk_tree_view_get_selection (GTK_TREE_VIEW (treeview)),
-        &selected_iter);
+      if (g_strcmp0 (priv->dests[i].name, printer_name) == 0)
+        {
+          new_ids[i] = -1;
+          num_removed++;
+        }
+      else
+        {
+          new_ids[i] = i - num_removed;
+        }
     }
-  else
+
+  /* The last printer going shows the page about adding one */
+  if (num_removed == 0 || num_removed == priv->num_dests)
     {
-      num_jobs = cupsGetJobs (&jobs, NULL, 1, CUPS_WHICHJOBS_ALL);
+      g_free (new_ids);
+      return FALSE;
+    }
 
-      /* Select last used printer */
-      if (num_jobs > 0)
-        {
-          for (i = 0; i < priv->num_dests; i++)
-            if (g_strcmp0 (priv->dests[i].name, jobs[num_jobs - 1].dest) == 0)
-              {
-                priv->current_dest = i;
-                break;
-              }
-          cupsFreeJobs (num_jobs, jobs);
-        }
+  valid = gtk_tree_model_get_iter_first (model, &iter);
+  while (valid)
+    {
+      gtk_tree_model_get (model, &iter, PRINTER_ID_COLUMN, &id, -1);
 
-      /* Select default printer */
-      if (priv->current_dest < 0)
+      if (id >= 0 && id < priv->num_dests && new_ids[id] < 0)
         {
-          for (i = 0; i < priv->num_dests; i++)
-            if (priv->dests[i].is_default)
-              {
-                priv->current_dest = i;
-                break;
-              }
+          valid = gtk_list_store_remove (priv->printers_store, &iter);
+          continue;
         }
 
-      if (priv->current_dest >= 0)
-        {
-          gint id;
-          valid = gtk_tree_model_get_iter_first ((GtkTreeModel *) store,
-                                                 &selected_iter);
+      if (id >= 0 && id < priv->num_dests)
+        gtk_list_store_set (priv->printers_store, &iter, PRINTER_ID_COLUMN, new_ids[id], -1);
 
-          while (valid)
-            {
-              gtk_tree_model_get ((GtkTreeModel *) store, &selected_iter,
-                                  PRINTER_ID_COLUMN, &id,
-                                  -1);
-              if (id == priv->current_dest)
-                break;
+      valid = gtk_tree_model_iter_next (model, &iter);
+    }
 
-              valid = gtk_tree_model_iter_next ((GtkTreeModel *) store,
-                                                &selected_iter);
-            }
+  for (i = priv->num_dests - 1; i >= 0; i--)
+    {
+      gchar *name;
+      gchar *instance;
 
-          gtk_tree_selection_select_iter (
-            gtk_tree_view_get_selection (GTK_TREE_VIEW (treeview)),
-            &selected_iter);
-        }
-      else if (priv->num_dests > 0)
-        {
-          /* Select first printer */
-          gtk_tree_model_get_iter_first ((GtkTreeModel *) store,
-                                         &selected_iter);
+      if (new_ids[i] >= 0)
+        continue;
 
-          gtk_tree_selection_select_iter (
-            gtk_tree_view_get_selection (GTK_TREE_VIEW (treeview)),
-            &selected_iter);
+      g_free (priv->dest_model_names[i]);
+      if (priv->ppd_file_names[i])
+        {
+          g_unlink (priv->ppd_file_names[i]);
+          g_free (priv->ppd_file_names[i]);
         }
+
+      memmove (&priv->dest_model_names[i], &priv->dest_model_names[i + 1],
+               (priv->num_dests - i - 1) * sizeof (gchar *));
+      memmove (&priv->ppd_file_names[i], &priv->ppd_file_names[i + 1],
+               (priv->num_dests - i - 1) * sizeof (gchar *));
+
+      name = g_strdup (priv->dests[i].name);
+      instance = g_strdup (priv->dests[i].instance);
+      priv->num_dests = cupsRemoveDest (name, instance, priv->num_dests, &priv->dests);
+      g_free (instance);
+      g_free (name);
     }
 
-  g_free (current_printer_name);
-  g_object_unref (store);
+  if (priv->current_dest >= 0 && priv->current_dest < old_num_dests)
+    priv->current_dest = new_ids[priv->current_dest];
+  else
+    priv->current_dest = -1;
 
-  update_sensitivity (self);
-}
+  g_free (new_ids);
 
-static void
-actualize_printers_list (CcPrintersPanel *self)
-{
-  PpCups *cups;
+  g_hash_table_remove (priv->markers_cache, printer_name);
+  g_hash_table_remove (priv->markers_stale, printer_name);
 
-  cups = pp_cups_new ();
-  pp_cups_get_dests_async (cups, NULL, actualize_printers_list_cb, self);
+  return TRUE;
 }
 
 static void
@@ -1491,10 +2122,21 @@ populate_printers_list (CcPrintersPanel *self)
   treeview = (GtkWidget*)
     gtk_builder_get_object (priv->builder, "printers-treeview");
 
+  /* The same store is kept, and updated as printers come and go */
+  priv->printers_store = gtk_list_store_new (PRINTER_N_COLUMNS,
+                                             G_TYPE_INT,
+                                             G_TYPE_STRING,
+                                             G_TYPE_BOOLEAN,
+                                             G_TYPE_STRING,
+                                             G_TYPE_STRING,
+                                             G_TYPE_STRING);
+  gtk_tree_view_set_model (GTK_TREE_VIEW (treeview), GTK_TREE_MODEL (priv->printers_store));
+
   g_signal_connect (gtk_tree_view_get_selection (GTK_TREE_VIEW (treeview)),
                     "changed", G_CALLBACK (printer_selection_changed_cb), self);
 
   actualize_printers_list (self);
+  count_jobs (self);
 
 
   icon_renderer = gtk_cell_renderer_pixbuf_new ();
@@ -1521,6 +2163,20 @@ populate_printers_list (CcPrintersPanel *self)
   gtk_tree_view_append_column (GTK_TREE_VIEW (treeview), column);
 
 
+  /* The number of active jobs of the user */
+  renderer = gtk_cell_renderer_text_new ();
+  g_object_set (G_OBJECT (renderer),
+                "scale", PANGO_SCALE_SMALL,
+                "xalign", 1.0,
+                NULL);
+  column = gtk_tree_view_column_new_with_attributes ("Jobs", renderer,
+                                                     "text", PRINTER_JOBS_COLUMN, NULL);
+  gtk_tree_view_column_set_cell_data_func (column, renderer, set_pixbuf_cell_sensitivity_func,
+                                           self, NULL);
+  gtk_tree_view_column_set_expand (column, FALSE);
+  gtk_tree_view_append_column (GTK_TREE_VIEW (treeview), column);
+
+
   icon_renderer2 = gtk_cell_renderer_pixbuf_new ();
   g_object_set (G_OBJECT (icon_renderer2), "follow-state", TRUE, NULL);
   column = gtk_tree_view_column_new_with_attributes ("Default", icon_renderer2,
@@ -1544,7 +2200,6 @@ static void
 update_jobs_count (CcPrintersPanel *self)
 {
   CcPrintersPanelPrivate *priv;
-  cups_job_t             *jobs;
   GtkWidget              *widget;
   gchar                  *active_jobs = NULL;
   gint                    num_jobs;
@@ -1553,15 +2208,15 @@ update_jobs_count (CcPrintersPanel *self)
 
   priv->num_jobs = -1;
 
+  /* Nothing is shown until the jobs are counted */
   if (priv->current_dest >= 0 &&
       priv->current_dest < priv->num_dests &&
-      priv->dests != NULL)
+      priv->dests != NULL &&
+      priv->jobs_counts != NULL)
     {
-      priv->num_jobs = cupsGetJobs (&jobs, priv->dests[priv->current_dest].name, 1, CUPS_WHICHJOBS_ACTIVE);
-      if (priv->num_jobs > 0)
-        cupsFreeJobs (priv->num_jobs, jobs);
+      priv->num_jobs = get_jobs_count (self, priv->dests[priv->current_dest].name);
 
-      num_jobs = priv->num_jobs < 0 ? 0 : (guint) priv->num_jobs;
+      num_jobs = priv->num_jobs;
       /* Translators: there is n active print jobs on this printer */
       active_jobs = g_strdup_printf (ngettext ("%u active", "%u active", num_jobs), num_jobs);
     }
@@ -1637,28 +2292,6 @@ printer_disable_cb (GObject    *gobject,
     }
 }
 
-typedef struct {
-  gchar *color;
-  gchar *type;
-  gchar *name;
-  gint   level;
-} MarkerItem;
-
-static gint
-markers_cmp (gconstpointer a,
-             gconstpointer b)
-{
-  MarkerItem *x = (MarkerItem*) a;
-  MarkerItem *y = (MarkerItem*) b;
-
-  if (x->level < y->level)
-    return 1;
-  else if (x->level == y->level)
-    return 0;
-  else
-    return -1;
-}
-
 static void
 rounded_rectangle (cairo_t *cr, double x, double y, double w, double h, double r)
 {
@@ -1670,6 +2303,180 @@ rounded_rectangle (cairo_t *cr, double x, double y, double w, double h, double r
     cairo_close_path (cr);
 }
 
+static gboolean
+save_supply_history (gpointer user_data)
+{
+  CcPrintersPanelPrivate *priv;
+
+  priv = PRINTERS_PANEL_PRIVATE (user_data);
+
+  priv->supply_history_save_id = 0;
+  pp_supply_history_save (priv->supply_history);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * Parses the supplies of @dest, unless that was done since its last
+ * change of state, and records their levels in the supply history.
+ * The levels of a printer whose state changed are asked for again,
+ * and shown once they arrive.
+ */
+static PrinterMarkers *
+get_printer_markers (CcPrintersPanel *self,
+                     cups_dest_t     *dest)
+{
+  CcPrintersPanelPrivate *priv;
+  PrinterMarkers         *printer_markers;
+  GString                *tooltip = NULL;
+  gboolean                recorded = FALSE;
+  gint64                  now;
+  guint                   i;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  if (g_hash_table_remove (priv->markers_stale, dest->name))
+    update_printer_markers (self, dest->name);
+
+  printer_markers = g_hash_table_lookup (priv->markers_cache, dest->name);
+  if (printer_markers != NULL)
+    return printer_markers;
+
+  printer_markers = g_new0 (PrinterMarkers, 1);
+  printer_markers->markers =
+    pp_markers_parse (cupsGetOption ("marker-names", dest->num_options, dest->options),
+                      cupsGetOption ("marker-colors", dest->num_options, dest->options),
+                      cupsGetOption ("marker-types", dest->num_options, dest->options),
+                      cupsGetOption ("marker-levels", dest->num_options, dest->options));
+
+  if (priv->supply_history == NULL)
+    priv->supply_history = pp_supply_history_new (NULL);
+
+  now = g_get_real_time () / G_USEC_PER_SEC;
+
+  for (i = 0; i < printer_markers->markers->len; i++)
+    {
+      PpMarker *marker = g_ptr_array_index (printer_markers->markers, i);
+      gint      days_left;
+
+      if (pp_supply_history_add_sample (priv->supply_history, dest->name, marker->name, now, marker->level))
+        recorded = TRUE;
+
+      if (tooltip == NULL)
+        tooltip = g_string_new (NULL);
+      else
+        g_string_append_c (tooltip, '\n');
+
+      days_left = pp_supply_history_estimate_days_left (priv->supply_history, dest->name, marker->name, now);
+      if (days_left >= 0)
+        /* Translators: The name of a supply of the printer, and in how many days it will likely be empty */
+        g_string_append_printf (tooltip,
+                                ngettext ("%s (about %d day left)", "%s (about %d days left)", days_left),
+                                marker->name,
+                                days_left);
+      else
+        g_string_append (tooltip, marker->name);
+    }
+
+  if (recorded && priv->supply_history_save_id == 0)
+    priv->supply_history_save_id =
+      g_timeout_add_seconds (SUPPLY_HISTORY_SAVE_TIMEOUT, save_supply_history, self);
+
+  if (tooltip != NULL)
+    printer_markers->tooltip = g_string_free (tooltip, FALSE);
+
+  g_hash_table_insert (priv->markers_cache, g_strdup (dest->name), printer_markers);
+
+  return printer_markers;
+}
+
+static cairo_surface_t *
+get_supply_bar (GtkWidget      *widget,
+                PrinterMarkers *printer_markers,
+                gint            width)
+{
+  GtkStyleContext *context;
+  cairo_t         *cr;
+  GValue           int_val = G_VALUE_INIT;
+  gint             border_radius = 0;
+  gint             scale;
+  guint            i;
+
+  scale = gtk_widget_get_scale_factor (widget);
+
+  if (printer_markers->bar != NULL &&
+      printer_markers->bar_width == width &&
+      printer_markers->bar_scale == scale)
+    return printer_markers->bar;
+
+  g_clear_pointer (&printer_markers->bar, cairo_surface_destroy);
+
+  printer_markers->bar = gdk_window_create_similar_image_surface (gtk_widget_get_window (widget),
+                                                                  CAIRO_FORMAT_ARGB32,
+                                                                  MAX (width * scale, 1),
+                                                                  SUPPLY_BAR_HEIGHT * scale,
+                                                                  scale);
+  printer_markers->bar_width = width;
+  printer_markers->bar_scale = scale;
+
+  context = gtk_widget_get_style_context (widget);
+  gtk_style_context_save (context);
+  gtk_style_context_add_class (context, GTK_STYLE_CLASS_BUTTON);
+
+  gtk_style_context_get_property (
+    context, GTK_STYLE_PROPERTY_BORDER_RADIUS, 0, &int_val);
+  if (G_VALUE_HOLDS_INT (&int_val))
+    border_radius = g_value_get_int (&int_val);
+  g_value_unset (&int_val);
+
+  cr = cairo_create (printer_markers->bar);
+
+  for (i = 0; i < printer_markers->markers->len; i++)
+    {
+      PpMarker *marker = g_ptr_array_index (printer_markers->markers, i);
+      GdkRGBA   color = {0.0, 0.0, 0.0, 1.0};
+      double    display_value;
+
+      gdk_rgba_parse (&color, marker->color);
+
+      if (marker->level > 0)
+        {
+          display_value = marker->level / 100.0 * (width - 3.0);
+          gdk_cairo_set_source_rgba (cr, &color);
+          rounded_rectangle (cr, 1.5, 1.5, display_value, SUPPLY_BAR_HEIGHT - 3.0, border_radius);
+          cairo_fill (cr);
+        }
+    }
+
+  gtk_render_frame (context, cr, 1, 1, width - 2, SUPPLY_BAR_HEIGHT - 2);
+
+  cairo_destroy (cr);
+  gtk_style_context_restore (context);
+
+  return printer_markers->bar;
+}
+
+static void
+drop_supply_bars (CcPrintersPanel *self)
+{
+  CcPrintersPanelPrivate *priv;
+  GHashTableIter          iter;
+  PrinterMarkers         *printer_markers;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  g_hash_table_iter_init (&iter, priv->markers_cache);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &printer_markers))
+    g_clear_pointer (&printer_markers->bar, cairo_surface_destroy);
+}
+
+static void
+supply_levels_style_updated_cb (GtkWidget *widget,
+                                gpointer   user_data)
+{
+  drop_supply_bars ((CcPrintersPanel *) user_data);
+}
+
 static gboolean
 supply_levels_draw_cb (GtkWidget *widget,
                        cairo_t *cr,
@@ -1678,14 +2485,9 @@ supply_levels_draw_cb (GtkWidget *widget,
   CcPrintersPanelPrivate *priv;
   CcPrintersPanel        *self = (CcPrintersPanel*) user_data;
   GtkStyleContext        *context;
-  gchar                  *marker_levels = NULL;
-  gchar                  *marker_colors = NULL;
-  gchar                  *marker_names = NULL;
-  gchar                  *marker_types = NULL;
-  gchar                  *tooltip_text = NULL;
+  PrinterMarkers         *printer_markers;
   gint                    width;
   gint                    height;
-  int                     i;
 
   priv = PRINTERS_PANEL_PRIVATE (self);
 
@@ -1700,134 +2502,134 @@ supply_levels_draw_cb (GtkWidget *widget,
       priv->current_dest < priv->num_dests &&
       priv->dests != NULL)
     {
-      for (i = 0; i < priv->dests[priv->current_dest].num_options; i++)
+      printer_markers = get_printer_markers (self, &priv->dests[priv->current_dest]);
+
+      if (printer_markers->markers->len > 0)
         {
-          if (g_strcmp0 (priv->dests[priv->current_dest].options[i].name, "marker-names") == 0)
-            marker_names = g_strcompress (priv->dests[priv->current_dest].options[i].value);
-          else if (g_strcmp0 (priv->dests[priv->current_dest].options[i].name, "marker-levels") == 0)
-            marker_levels = priv->dests[priv->current_dest].options[i].value;
-          else if (g_strcmp0 (priv->dests[priv->current_dest].options[i].name, "marker-colors") == 0)
-            marker_colors = priv->dests[priv->current_dest].options[i].value;
-          else if (g_strcmp0 (priv->dests[priv->current_dest].options[i].name, "marker-types") == 0)
-            marker_types = priv->dests[priv->current_dest].options[i].value;
+          cairo_set_source_surface (cr, get_supply_bar (widget, printer_markers, width), 0, 0);
+          cairo_paint (cr);
         }
 
-      if (marker_levels && marker_colors && marker_names && marker_types)
+      if (printer_markers->tooltip)
         {
-          GSList   *markers = NULL;
-          GSList   *tmp_list = NULL;
-          GValue    int_val = G_VALUE_INIT;
-          gchar   **marker_levelsv = NULL;
-          gchar   **marker_colorsv = NULL;
-          gchar   **marker_namesv = NULL;
-          gchar   **marker_typesv = NULL;
-          gchar    *tmp = NULL;
-          gint      border_radius = 0;
-
-          gtk_style_context_save (context);
-          gtk_style_context_add_class (context, GTK_STYLE_CLASS_BUTTON);
-
-          gtk_style_context_get_property (
-            context, GTK_STYLE_PROPERTY_BORDER_RADIUS, 0, &int_val);
-          if (G_VALUE_HOLDS_INT (&int_val))
-            border_radius = g_value_get_int (&int_val);
-
-          marker_levelsv = g_strsplit (marker_levels, ",", -1);
-          marker_colorsv = g_strsplit (marker_colors, ",", -1);
-          marker_namesv = g_strsplit (marker_names, ",", -1);
-          marker_typesv = g_strsplit (marker_types, ",", -1);
-
-          if (g_strv_length (marker_levelsv) == g_strv_length (marker_colorsv) &&
-              g_strv_length (marker_colorsv) == g_strv_length (marker_namesv) &&
-              g_strv_length (marker_namesv) == g_strv_length (marker_typesv))
-            {
-              for (i = 0; i < g_strv_length (marker_levelsv); i++)
-                {
-                  MarkerItem *marker;
-
-                  if (g_strcmp0 (marker_typesv[i], "ink") == 0 ||
-                      g_strcmp0 (marker_typesv[i], "toner") == 0 ||
-                      g_strcmp0 (marker_typesv[i], "inkCartridge") == 0 ||
-                      g_strcmp0 (marker_typesv[i], "tonerCartridge") == 0)
-                    {
-                      marker = g_new0 (MarkerItem, 1);
-                      marker->type = g_strdup (marker_typesv[i]);
-                      marker->name = g_strdup (marker_namesv[i]);
-                      marker->color = g_strdup (marker_colorsv[i]);
-                      marker->level = atoi (marker_levelsv[i]);
+          gtk_widget_set_tooltip_text (widget, printer_markers->tooltip);
+        }
+      else
+        {
+          gtk_widget_set_tooltip_text (widget, NULL);
+          gtk_widget_set_has_tooltip (widget, FALSE);
+        }
+    }
 
-                      markers = g_slist_prepend (markers, marker);
-                    }
-                }
+  return TRUE;
+}
 
-              markers = g_slist_sort (markers, markers_cmp);
+typedef struct
+{
+  CcPrintersPanel *self;
+  gchar           *printer_name;
+} MarkersUpdateData;
 
-              for (tmp_list = markers; tmp_list; tmp_list = tmp_list->next)
-                {
-                  GdkRGBA color = {0.0, 0.0, 0.0, 1.0};
-                  double  display_value;
-                  int     value;
+static void
+update_printer_markers_cb (cups_dest_t *destination,
+                           gpointer     user_data)
+{
+  CcPrintersPanelPrivate *priv;
+  MarkersUpdateData      *data = (MarkersUpdateData *) user_data;
+  CcPrintersPanel        *self = data->self;
+  GtkWidget              *widget;
+  gboolean                current_changed = FALSE;
+  guint                   j;
+  gint                    i;
+  static const gchar     *marker_options[] = {
+    "marker-names",
+    "marker-colors",
+    "marker-types",
+    "marker-levels" };
 
-                  value = ((MarkerItem*) tmp_list->data)->level;
+  if (self != NULL)
+    g_object_remove_weak_pointer (G_OBJECT (self), (gpointer *) &data->self);
 
-                  gdk_rgba_parse (&color, ((MarkerItem*) tmp_list->data)->color);
+  /* The panel may be gone, or going */
+  if (self != NULL && PRINTERS_PANEL_PRIVATE (self)->markers_updates != NULL)
+    {
+      priv = PRINTERS_PANEL_PRIVATE (self);
 
-                  if (value > 0)
-                    {
-                      display_value = value / 100.0 * (width - 3.0);
-                      gdk_cairo_set_source_rgba (cr, &color);
-                      rounded_rectangle (cr, 1.5, 1.5, display_value, SUPPLY_BAR_HEIGHT - 3.0, border_radius);
-                      cairo_fill (cr);
-                    }
+      g_hash_table_remove (priv->markers_updates, data->printer_name);
 
-                  if (tooltip_text)
-                    {
-                      tmp = g_strdup_printf ("%s\n%s",
-                                             tooltip_text,
-                                             ((MarkerItem*) tmp_list->data)->name);
-                      g_free (tooltip_text);
-                      tooltip_text = tmp;
-                      tmp = NULL;
-                    }
-                  else
-                    tooltip_text = g_strdup_printf ("%s",
-                                                    ((MarkerItem*) tmp_list->data)->name);
-                }
+      if (destination != NULL)
+        {
+          for (i = 0; i < priv->num_dests; i++)
+            {
+              cups_dest_t *dest = &priv->dests[i];
 
-              gtk_render_frame (context, cr, 1, 1, width - 2, SUPPLY_BAR_HEIGHT - 2);
+              if (g_strcmp0 (dest->name, data->printer_name) != 0)
+                continue;
 
-              for (tmp_list = markers; tmp_list; tmp_list = tmp_list->next)
+              for (j = 0; j < G_N_ELEMENTS (marker_options); j++)
                 {
-                  g_free (((MarkerItem*) tmp_list->data)->name);
-                  g_free (((MarkerItem*) tmp_list->data)->type);
-                  g_free (((MarkerItem*) tmp_list->data)->color);
+                  const gchar *value;
+
+                  value = cupsGetOption (marker_options[j],
+                                         destination->num_options,
+                                         destination->options);
+                  if (value != NULL)
+                    dest->num_options = cupsAddOption (marker_options[j],
+                                                       value,
+                                                       dest->num_options,
+                                                       &dest->options);
+                  else
+                    dest->num_options = cupsRemoveOption (marker_options[j],
+                                                          dest->num_options,
+                                                          &dest->options);
                 }
-              g_slist_free_full (markers, g_free);
+
+              if (i == priv->current_dest)
+                current_changed = TRUE;
             }
 
-          gtk_style_context_restore (context);
+          g_hash_table_remove (priv->markers_cache, data->printer_name);
 
-          g_strfreev (marker_levelsv);
-          g_strfreev (marker_colorsv);
-          g_strfreev (marker_namesv);
-          g_strfreev (marker_typesv);
+          if (current_changed)
+            {
+              widget = (GtkWidget*)
+                gtk_builder_get_object (priv->builder, "supply-drawing-area");
+              gtk_widget_queue_draw (widget);
+            }
         }
+    }
 
-      g_free (marker_names);
+  if (destination != NULL)
+    cupsFreeDests (1, destination);
 
-      if (tooltip_text)
-        {
-          gtk_widget_set_tooltip_text (widget, tooltip_text);
-          g_free (tooltip_text);
-        }
-      else
-        {
-          gtk_widget_set_tooltip_text (widget, NULL);
-          gtk_widget_set_has_tooltip (widget, FALSE);
-        }
-    }
+  g_free (data->printer_name);
+  g_free (data);
+}
 
-  return TRUE;
+/*
+ * Notifications don't carry the levels of the supplies, so they
+ * are asked for again when a printer whose state changed is shown.
+ */
+static void
+update_printer_markers (CcPrintersPanel *self,
+                        const gchar     *printer_name)
+{
+  CcPrintersPanelPrivate *priv;
+  MarkersUpdateData      *data;
+
+  priv = PRINTERS_PANEL_PRIVATE (self);
+
+  if (g_hash_table_contains (priv->markers_updates, printer_name))
+    return;
+
+  g_hash_table_add (priv->markers_updates, g_strdup (printer_name));
+
+  data = g_new0 (MarkersUpdateData, 1);
+  data->self = self;
+  data->printer_name = g_strdup (printer_name);
+  g_object_add_weak_pointer (G_OBJECT (self), (gpointer *) &data->self);
+
+  get_named_dest_async (printer_name, update_printer_markers_cb, data);
 }
 
 static void
@@ -2278,25 +3080,6 @@ set_ppd_from_list (GtkMenuItem *menuitem,
     }
 }
 
-static void
-ppd_names_free (gpointer user_data)
-{
-  PPDName **names = (PPDName **) user_data;
-  gint      i;
-
-  if (names)
-    {
-      for (i = 0; names[i]; i++)
-        {
-          g_free (names[i]->ppd_name);
-          g_free (names[i]->ppd_display_name);
-          g_free (names[i]);
-        }
-
-      g_free (names);
-    }
-}
-
 static void
 get_ppd_names_cb (PPDName     **names,
                   const gchar  *printer_name,
@@ -2346,7 +3129,7 @@ get_ppd_names_cb (PPDName     **names,
   if (!priv->preferred_drivers)
     {
       priv->preferred_drivers = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                       g_free, ppd_names_free);
+                                                       g_free, (GDestroyNotify) ppd_names_free);
     }
 
   if (!cancelled &&
@@ -3093,8 +3876,24 @@ cc_printers_panel_init (CcPrintersPanel *self)
   priv->num_dests = 0;
   priv->current_dest = -1;
 
+  priv->printers_store = NULL;
+  priv->printers_list_refreshing = FALSE;
+  priv->printers_list_refresh_pending = FALSE;
+
   priv->num_jobs = 0;
 
+  priv->active_jobs = NULL;
+  priv->jobs_counts = NULL;
+  priv->count_jobs_cancellable = g_cancellable_new ();
+  priv->counting_jobs = FALSE;
+  priv->count_jobs_pending = FALSE;
+
+  priv->markers_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) printer_markers_free);
+  priv->markers_stale = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  priv->markers_updates = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  priv->supply_history = NULL;
+  priv->supply_history_save_id = 0;
+
   priv->pp_new_printer_dialog = NULL;
   priv->pp_options_dialog = NULL;
 
@@ -3163,6 +3962,7 @@ cc_printers_panel_init (CcPrintersPanel *self)
   widget = (GtkWidget*)
     gtk_builder_get_object (priv->builder, "supply-drawing-area");
   g_signal_connect (widget, "draw", G_CALLBACK (supply_levels_draw_cb), self);
+  g_signal_connect (widget, "style-updated", G_CALLBACK (supply_levels_style_updated_cb), self);
 
   widget = (GtkWidget*)
     gtk_builder_get_object (priv->builder, "printer-default-check-button");
@@ -0,0 +1,195 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Turns the table of pp-manufacturers-table.h into the perfect hash of
+ * pp-manufacturers-hash.h: it looks for the seed of normalized_name_hash()
+ * for which no two names fall into the same slot, so that finding the
+ * display name of a manufacturer takes one hash and one string comparison.
+ */
+
+#include <string.h>
+#include <glib.h>
+
+#include "pp-normalize.h"
+#include "pp-manufacturers-table.h"
+
+#define MAX_SEEDS 1000000
+
+typedef struct
+{
+  gchar       *name;
+  const gchar *display_name;
+  gchar       *normalized_display_name;
+} Entry;
+
+static gboolean
+try_seed (GPtrArray *entries,
+          guint32    seed,
+          guint32    size,
+          Entry    **slots)
+{
+  guint i;
+
+  memset (slots, 0, size * sizeof (Entry *));
+
+  for (i = 0; i < entries->len; i++)
+    {
+      Entry   *entry = entries->pdata[i];
+      guint32  slot = normalized_name_hash (entry->name, seed) & (size - 1);
+
+      if (slots[slot] != NULL)
+        return FALSE;
+
+      slots[slot] = entry;
+    }
+
+  return TRUE;
+}
+
+static void
+append_string (GString     *str,
+               const gchar *value)
+{
+  gchar *escaped = g_strescape (value, NULL);
+
+  g_string_append_printf (str, "\"%s\"", escaped);
+  g_free (escaped);
+}
+
+static void
+entry_free (Entry *entry)
+{
+  g_free (entry->name);
+  g_free (entry->normalized_display_name);
+  g_free (entry);
+}
+
+int
+main (int argc, char **argv)
+{
+  GHashTable *names;
+  GPtrArray  *entries;
+  GString    *str;
+  GError     *error = NULL;
+  gboolean    found = FALSE;
+  gboolean    ret;
+  guint32     size;
+  guint32     seed = 0;
+  Entry     **slots = NULL;
+  gchar       buffer[NORMALIZED_NAME_SIZE];
+  guint       i;
+
+  if (argc != 2)
+    {
+      g_printerr ("Usage: %s OUTPUT\n", argv[0]);
+      return 1;
+    }
+
+  names = g_hash_table_new (g_str_hash, g_str_equal);
+  entries = g_ptr_array_new_with_free_func ((GDestroyNotify) entry_free);
+
+  /* The names are looked up normalized, so they are stored that way */
+  for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
+    {
+      Entry *entry;
+      Entry *other;
+
+      normalize_into (manufacturers_names[i].normalized_name, -1, buffer, sizeof (buffer));
+
+      other = g_hash_table_lookup (names, buffer);
+      if (other != NULL)
+        {
+          if (g_strcmp0 (other->display_name, manufacturers_names[i].display_name) != 0)
+            {
+              g_printerr ("\"%s\" is both %s and %s\n",
+                          buffer, other->display_name, manufacturers_names[i].display_name);
+              return 1;
+            }
+
+          continue;
+        }
+
+      entry = g_new0 (Entry, 1);
+      entry->name = g_strdup (buffer);
+      entry->display_name = manufacturers_names[i].display_name;
+      entry->normalized_display_name = g_strdup (normalize_into (entry->display_name, -1,
+                                                                 buffer, sizeof (buffer)));
+      g_ptr_array_add (entries, entry);
+      g_hash_table_insert (names, entry->name, entry);
+    }
+
+  /* Half full at most, which leaves plenty of seeds to pick from */
+  for (size = 1; size < 2 * entries->len; size *= 2)
+    ;
+
+  while (!found)
+    {
+      slots = g_renew (Entry *, slots, size);
+
+      for (seed = 0; seed < MAX_SEEDS && !found; seed++)
+        found = try_seed (entries, seed, size, slots);
+
+      if (!found)
+        size *= 2;
+    }
+  seed--;
+
+  str = g_string_new ("/* Generated by gen-manufacturers-hash from pp-manufacturers-table.h */\n\n");
+  g_string_append (str, "#ifndef __PP_MANUFACTURERS_HASH_H__\n");
+  g_string_append (str, "#define __PP_MANUFACTURERS_HASH_H__\n\n");
+  g_string_append_printf (str, "#define MANUFACTURERS_HASH_SEED %uu\n", seed);
+  g_string_append_printf (str, "#define MANUFACTURERS_HASH_SIZE %u\n\n", size);
+  g_string_append (str,
+                   "static const struct {\n"
+                   "  const char *normalized_name;\n"
+                   "  const char *display_name;\n"
+                   "  const char *normalized_display_name;\n"
+                   "} manufacturers_hash[MANUFACTURERS_HASH_SIZE] = {\n");
+
+  for (i = 0; i < size; i++)
+    {
+      if (slots[i] == NULL)
+        continue;
+
+      g_string_append_printf (str, "  [%u] = { ", i);
+      append_string (str, slots[i]->name);
+      g_string_append (str, ", ");
+      append_string (str, slots[i]->display_name);
+      g_string_append (str, ", ");
+      append_string (str, slots[i]->normalized_display_name);
+      g_string_append (str, " },\n");
+    }
+
+  g_string_append (str, "};\n\n#endif /* __PP_MANUFACTURERS_HASH_H__ */\n");
+
+  ret = g_file_set_contents (argv[1], str->str, str->len, &error);
+  if (!ret)
+    {
+      g_printerr ("Could not save %s: %s\n", argv[1], error->message);
+      g_error_free (error);
+    }
+
+  g_string_free (str, TRUE);
+  g_free (slots);
+  g_hash_table_destroy (names);
+  g_ptr_array_unref (entries);
+
+  return ret ? 0 : 1;
+}
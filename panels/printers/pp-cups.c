@@ -18,6 +18,8 @@
  * Author: Marek Kasik <mkasik@redhat.com>
  */
 
+#include <string.h>
+
 #include "pp-cups.h"
 
 #if (CUPS_VERSION_MAJOR > 1) || (CUPS_VERSION_MINOR > 5)
@@ -27,6 +29,26 @@
 #ifndef HAVE_CUPS_1_6
 #define ippGetInteger(attr, element) attr->values[element].integer
 #define ippGetStatusCode(ipp) ipp->request.status.status_code
+#define ippGetGroupTag(attr)  attr->group_tag
+#define ippGetValueTag(attr)  attr->value_tag
+#define ippGetName(attr)      attr->name
+#define ippGetString(attr, element, language) attr->values[element].string.text
+
+static ipp_attribute_t *
+ippFirstAttribute (ipp_t *ipp)
+{
+  if (!ipp)
+    return (NULL);
+  return (ipp->current = ipp->attrs);
+}
+
+static ipp_attribute_t *
+ippNextAttribute (ipp_t *ipp)
+{
+  if (!ipp || !ipp->current)
+    return (NULL);
+  return (ipp->current = ipp->current->next);
+}
 #endif
 
 G_DEFINE_TYPE (PpCups, pp_cups, G_TYPE_OBJECT);
@@ -301,3 +323,110 @@ pp_cups_renew_subscription_finish (PpCups       *cups,
 
   return g_task_propagate_int (G_TASK (result), NULL);
 }
+
+/*
+ * Lists the active jobs of the user on all the printers at once,
+ * asking only for what is needed to count them.
+ */
+static void
+get_active_jobs_thread (GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable)
+{
+  ipp_attribute_t *attr;
+  GHashTable      *jobs;
+  ipp_t           *request;
+  ipp_t           *response;
+  const gchar     *printer_uri;
+  gint             job_id;
+  static const char * const requested_attributes[] =
+    {
+      "job-id",
+      "job-printer-uri"
+    };
+
+  request = ippNewRequest (IPP_GET_JOBS);
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_URI,
+                "printer-uri", NULL, "ipp://localhost/");
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+                "requesting-user-name", NULL, cupsUser ());
+  ippAddBoolean (request, IPP_TAG_OPERATION, "my-jobs", 1);
+  ippAddString (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                "which-jobs", NULL, "not-completed");
+  ippAddStrings (request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+                 "requested-attributes", G_N_ELEMENTS (requested_attributes), NULL,
+                 requested_attributes);
+  response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
+
+  if (response == NULL || ippGetStatusCode (response) > IPP_OK_CONFLICT)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "%s", cupsLastErrorString ());
+      ippDelete (response);
+      return;
+    }
+
+  jobs = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+
+  for (attr = ippFirstAttribute (response); attr != NULL; attr = ippNextAttribute (response))
+    {
+      while (attr != NULL && ippGetGroupTag (attr) != IPP_TAG_JOB)
+        attr = ippNextAttribute (response);
+
+      if (attr == NULL)
+        break;
+
+      job_id = 0;
+      printer_uri = NULL;
+
+      while (attr != NULL && ippGetGroupTag (attr) == IPP_TAG_JOB)
+        {
+          if (g_strcmp0 (ippGetName (attr), "job-id") == 0 &&
+              ippGetValueTag (attr) == IPP_TAG_INTEGER)
+            job_id = ippGetInteger (attr, 0);
+          else if (g_strcmp0 (ippGetName (attr), "job-printer-uri") == 0 &&
+                   ippGetValueTag (attr) == IPP_TAG_URI)
+            printer_uri = ippGetString (attr, 0, NULL);
+
+          attr = ippNextAttribute (response);
+        }
+
+      if (job_id > 0 && printer_uri != NULL && strrchr (printer_uri, '/') != NULL)
+        g_hash_table_insert (jobs,
+                             GINT_TO_POINTER (job_id),
+                             g_strdup (strrchr (printer_uri, '/') + 1));
+
+      if (attr == NULL)
+        break;
+    }
+
+  ippDelete (response);
+
+  g_task_return_pointer (task, jobs, (GDestroyNotify) g_hash_table_unref);
+}
+
+void
+pp_cups_get_active_jobs_async (PpCups              *cups,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+  GTask *task;
+
+  task = g_task_new (cups, cancellable, callback, user_data);
+  g_task_run_in_thread (task, get_active_jobs_thread);
+
+  g_object_unref (task);
+}
+
+/* Returns a table of the names of the printers of the jobs, by job id */
+GHashTable *
+pp_cups_get_active_jobs_finish (PpCups        *cups,
+                                GAsyncResult  *result,
+                                GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, cups), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
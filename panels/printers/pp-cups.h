@@ -91,6 +91,15 @@ void         pp_cups_renew_subscription_async  (PpCups                *cups,
 gint         pp_cups_renew_subscription_finish (PpCups                *cups,
                                                 GAsyncResult          *result);
 
+void         pp_cups_get_active_jobs_async  (PpCups               *cups,
+                                             GCancellable         *cancellable,
+                                             GAsyncReadyCallback   callback,
+                                             gpointer              user_data);
+
+GHashTable  *pp_cups_get_active_jobs_finish (PpCups               *cups,
+                                             GAsyncResult         *result,
+                                             GError              **error);
+
 G_END_DECLS
 
 #endif /* __PP_CUPS_H__ */
@@ -0,0 +1,347 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "pp-device-index.h"
+
+/*
+ * Finds the devices whose name or location contains each word of
+ * a query. Every device keeps its name and location lowercased, and
+ * the trigrams of those are mapped to the devices containing them, so
+ * that only the devices sharing the rarest trigram of the query need
+ * to be looked at. A query which only extends the previous one is
+ * matched against the devices found for that one.
+ */
+
+typedef struct
+{
+  gpointer  device;
+  gchar    *key;
+} Entry;
+
+struct _PpDeviceIndex
+{
+  GHashTable  *entries;
+  GHashTable  *trigrams;
+  gchar       *query;
+  gchar      **words;
+  GHashTable  *matches;
+};
+
+#define TRIGRAM(s) GUINT_TO_POINTER (((guint) (guchar) (s)[0] << 16) | \
+                                     ((guint) (guchar) (s)[1] << 8) |  \
+                                     (guint) (guchar) (s)[2])
+
+static void
+entry_free (Entry *entry)
+{
+  g_free (entry->key);
+  g_free (entry);
+}
+
+PpDeviceIndex *
+pp_device_index_new (void)
+{
+  PpDeviceIndex *index;
+
+  index = g_new0 (PpDeviceIndex, 1);
+  index->entries = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                          NULL, (GDestroyNotify) entry_free);
+  index->trigrams = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                           NULL, (GDestroyNotify) g_hash_table_unref);
+
+  return index;
+}
+
+void
+pp_device_index_free (PpDeviceIndex *index)
+{
+  if (index == NULL)
+    return;
+
+  g_clear_pointer (&index->matches, g_hash_table_unref);
+  g_hash_table_unref (index->trigrams);
+  g_hash_table_unref (index->entries);
+  g_strfreev (index->words);
+  g_free (index->query);
+  g_free (index);
+}
+
+/* Name and location are kept apart so that no word matches across them */
+static gboolean
+is_trigram (const gchar *s)
+{
+  return s[0] != '\n' && s[1] != '\n' && s[2] != '\n';
+}
+
+static void
+index_entry (PpDeviceIndex *index,
+             Entry         *entry)
+{
+  GHashTable  *entries;
+  const gchar *s;
+
+  for (s = entry->key; s[0] != '\0' && s[1] != '\0' && s[2] != '\0'; s++)
+    {
+      if (!is_trigram (s))
+        continue;
+
+      entries = g_hash_table_lookup (index->trigrams, TRIGRAM (s));
+      if (entries == NULL)
+        {
+          entries = g_hash_table_new (g_direct_hash, g_direct_equal);
+          g_hash_table_insert (index->trigrams, TRIGRAM (s), entries);
+        }
+
+      g_hash_table_add (entries, entry);
+    }
+}
+
+static void
+unindex_entry (PpDeviceIndex *index,
+               Entry         *entry)
+{
+  GHashTable  *entries;
+  const gchar *s;
+
+  for (s = entry->key; s[0] != '\0' && s[1] != '\0' && s[2] != '\0'; s++)
+    {
+      if (!is_trigram (s))
+        continue;
+
+      entries = g_hash_table_lookup (index->trigrams, TRIGRAM (s));
+      if (entries != NULL)
+        {
+          g_hash_table_remove (entries, entry);
+          if (g_hash_table_size (entries) == 0)
+            g_hash_table_remove (index->trigrams, TRIGRAM (s));
+        }
+    }
+}
+
+static gboolean
+entry_matches (Entry  *entry,
+               gchar **words)
+{
+  gint i;
+
+  for (i = 0; words[i] != NULL; i++)
+    if (strstr (entry->key, words[i]) == NULL)
+      return FALSE;
+
+  return TRUE;
+}
+
+void
+pp_device_index_add (PpDeviceIndex *index,
+                     gpointer       device,
+                     const gchar   *name,
+                     const gchar   *location)
+{
+  Entry *entry;
+  gchar *key;
+
+  pp_device_index_remove (index, device);
+
+  key = g_strconcat (name ? name : "", "\n", location ? location : "", NULL);
+
+  entry = g_new0 (Entry, 1);
+  entry->device = device;
+  entry->key = g_ascii_strdown (key, -1);
+  g_free (key);
+
+  g_hash_table_insert (index->entries, device, entry);
+  index_entry (index, entry);
+
+  if (index->words != NULL && entry_matches (entry, index->words))
+    g_hash_table_add (index->matches, entry);
+}
+
+void
+pp_device_index_remove (PpDeviceIndex *index,
+                        gpointer       device)
+{
+  Entry *entry;
+
+  entry = g_hash_table_lookup (index->entries, device);
+  if (entry == NULL)
+    return;
+
+  if (index->matches != NULL)
+    g_hash_table_remove (index->matches, entry);
+
+  unindex_entry (index, entry);
+  g_hash_table_remove (index->entries, device);
+}
+
+static gchar **
+split_words (const gchar *query)
+{
+  gchar **words;
+  gint    i, j;
+
+  words = g_strsplit (query, " ", -1);
+  for (i = 0, j = 0; words[i] != NULL; i++)
+    {
+      if (words[i][0] != '\0')
+        words[j++] = words[i];
+      else
+        g_free (words[i]);
+    }
+  words[j] = NULL;
+
+  if (j == 0)
+    g_clear_pointer (&words, g_strfreev);
+
+  return words;
+}
+
+/* A NULL set of matches stands for all the devices */
+static gboolean
+same_matches (PpDeviceIndex *index,
+              GHashTable    *a,
+              GHashTable    *b)
+{
+  GHashTableIter iter;
+  gpointer       entry;
+  guint          total = g_hash_table_size (index->entries);
+
+  if ((a ? g_hash_table_size (a) : total) != (b ? g_hash_table_size (b) : total))
+    return FALSE;
+
+  if (a == NULL || b == NULL)
+    return TRUE;
+
+  g_hash_table_iter_init (&iter, a);
+  while (g_hash_table_iter_next (&iter, &entry, NULL))
+    if (!g_hash_table_contains (b, entry))
+      return FALSE;
+
+  return TRUE;
+}
+
+/*
+ * Sets the text the devices are filtered by and returns TRUE if that
+ * changed which of them match it.
+ */
+gboolean
+pp_device_index_set_query (PpDeviceIndex *index,
+                           const gchar   *text)
+{
+  GHashTableIter   iter;
+  GHashTable      *candidates;
+  GHashTable      *matches = NULL;
+  gboolean         changed;
+  gpointer         entry;
+  gchar          **words;
+  gchar           *query;
+  gint             i;
+
+  query = g_ascii_strdown (text ? text : "", -1);
+  if (g_strcmp0 (query, index->query) == 0)
+    {
+      g_free (query);
+      return FALSE;
+    }
+
+  words = split_words (query);
+  if (words != NULL)
+    {
+      /* Typing further can only lengthen the last word or add new ones */
+      if (index->words != NULL && g_str_has_prefix (query, index->query))
+        candidates = index->matches;
+      else
+        candidates = index->entries;
+
+      for (i = 0; words[i] != NULL && candidates != NULL; i++)
+        {
+          const gchar *s;
+
+          for (s = words[i]; s[0] != '\0' && s[1] != '\0' && s[2] != '\0'; s++)
+            {
+              GHashTable *entries;
+
+              entries = g_hash_table_lookup (index->trigrams, TRIGRAM (s));
+              if (entries == NULL)
+                {
+                  candidates = NULL;
+                  break;
+                }
+
+              if (g_hash_table_size (entries) < g_hash_table_size (candidates))
+                candidates = entries;
+            }
+        }
+
+      matches = g_hash_table_new (g_direct_hash, g_direct_equal);
+      if (candidates != NULL)
+        {
+          g_hash_table_iter_init (&iter, candidates);
+          while (g_hash_table_iter_next (&iter, NULL, &entry))
+            if (entry_matches (entry, words))
+              g_hash_table_add (matches, entry);
+        }
+    }
+
+  changed = !same_matches (index, index->matches, matches);
+
+  g_clear_pointer (&index->matches, g_hash_table_unref);
+  g_strfreev (index->words);
+  g_free (index->query);
+
+  index->matches = matches;
+  index->words = words;
+  index->query = query;
+
+  return changed;
+}
+
+/* Whether the query hides any device at all */
+gboolean
+pp_device_index_has_query (PpDeviceIndex *index)
+{
+  return index->words != NULL;
+}
+
+gboolean
+pp_device_index_matches (PpDeviceIndex *index,
+                         gpointer       device)
+{
+  Entry *entry;
+
+  if (index->words == NULL)
+    return TRUE;
+
+  entry = g_hash_table_lookup (index->entries, device);
+
+  return entry != NULL && g_hash_table_contains (index->matches, entry);
+}
+
+guint
+pp_device_index_get_n_matches (PpDeviceIndex *index)
+{
+  if (index->words == NULL)
+    return g_hash_table_size (index->entries);
+
+  return g_hash_table_size (index->matches);
+}
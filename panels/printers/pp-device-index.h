@@ -0,0 +1,53 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __PP_DEVICE_INDEX_H__
+#define __PP_DEVICE_INDEX_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _PpDeviceIndex PpDeviceIndex;
+
+PpDeviceIndex *pp_device_index_new           (void);
+
+void           pp_device_index_free          (PpDeviceIndex *index);
+
+void           pp_device_index_add           (PpDeviceIndex *index,
+                                              gpointer       device,
+                                              const gchar   *name,
+                                              const gchar   *location);
+
+void           pp_device_index_remove        (PpDeviceIndex *index,
+                                              gpointer       device);
+
+gboolean       pp_device_index_set_query     (PpDeviceIndex *index,
+                                              const gchar   *text);
+
+gboolean       pp_device_index_has_query     (PpDeviceIndex *index);
+
+gboolean       pp_device_index_matches       (PpDeviceIndex *index,
+                                              gpointer       device);
+
+guint          pp_device_index_get_n_matches (PpDeviceIndex *index);
+
+G_END_DECLS
+
+#endif /* __PP_DEVICE_INDEX_H__ */
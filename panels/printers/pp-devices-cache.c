@@ -0,0 +1,419 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "pp-devices-cache.h"
+#include "pp-utils.h"
+
+/*
+ * The devices the CUPS backends found lately, so that the new printer
+ * dialog can show them while the backends are asked again. They are
+ * kept per backend and forgotten once they are older than its TTL.
+ * On disk they are kept as
+ *
+ *   [backend]
+ *   time=seconds since the Epoch
+ *   device-uri=uri;uri;...
+ *   device-name=name;name;...
+ *   ...
+ *
+ * with the n-th item of each list describing the n-th device.
+ */
+
+#define DEFAULT_TTL (5 * 60)
+
+static const struct
+{
+  const gchar *backend;
+  gint64       ttl;
+} backend_ttls[] = {
+  /* Local printers get plugged and unplugged at will */
+  { "usb",       60 },
+  { "serial",    60 },
+  { "parallel",  60 },
+  { "bluetooth", 60 },
+  /* Network printers seldom go away but are slow to find */
+  { "socket",    10 * 60 },
+  { "lpd",       10 * 60 },
+  { "ipp",       10 * 60 },
+  { "dnssd",     10 * 60 },
+  { "snmp",      10 * 60 }
+};
+
+typedef struct
+{
+  gchar  *backend;
+  gint64  time;
+  GList  *devices;
+} Entry;
+
+struct _PpDevicesCache
+{
+  gchar     *path;
+  GPtrArray *entries;
+  gboolean   modified;
+};
+
+static void
+entry_free (Entry *entry)
+{
+  g_list_free_full (entry->devices, g_object_unref);
+  g_free (entry->backend);
+  g_free (entry);
+}
+
+static GList *
+copy_devices (GList *devices)
+{
+  GList *result = NULL;
+  GList *iter;
+
+  for (iter = devices; iter != NULL; iter = iter->next)
+    result = g_list_prepend (result, pp_print_device_copy (iter->data));
+
+  return g_list_reverse (result);
+}
+
+static const gchar *
+nonempty (const gchar *string)
+{
+  return string != NULL && string[0] != '\0' ? string : NULL;
+}
+
+static void
+load_entry (PpDevicesCache *cache,
+            GKeyFile       *key_file,
+            const gchar    *group)
+{
+  GError    *error = NULL;
+  gboolean  *networks = NULL;
+  gchar    **uris = NULL;
+  gchar    **names = NULL;
+  gchar    **ids = NULL;
+  gchar    **infos = NULL;
+  gchar    **makes = NULL;
+  gchar    **locations = NULL;
+  Entry     *entry;
+  gint64     time;
+  gsize      n, length;
+  gsize      i;
+
+  time = g_key_file_get_int64 (key_file, group, "time", &error);
+  if (error != NULL)
+    {
+      g_error_free (error);
+      return;
+    }
+
+  uris = g_key_file_get_string_list (key_file, group, "device-uri", &n, NULL);
+  if (uris == NULL || n == 0)
+    goto out;
+
+  names = g_key_file_get_string_list (key_file, group, "device-name", &length, NULL);
+  if (names == NULL || length != n)
+    goto out;
+
+  ids = g_key_file_get_string_list (key_file, group, "device-id", &length, NULL);
+  if (ids == NULL || length != n)
+    goto out;
+
+  infos = g_key_file_get_string_list (key_file, group, "device-info", &length, NULL);
+  if (infos == NULL || length != n)
+    goto out;
+
+  makes = g_key_file_get_string_list (key_file, group, "device-make-and-model", &length, NULL);
+  if (makes == NULL || length != n)
+    goto out;
+
+  locations = g_key_file_get_string_list (key_file, group, "device-location", &length, NULL);
+  if (locations == NULL || length != n)
+    goto out;
+
+  networks = g_key_file_get_boolean_list (key_file, group, "is-network-device", &length, NULL);
+  if (networks == NULL || length != n)
+    goto out;
+
+  entry = g_new0 (Entry, 1);
+  entry->backend = g_strdup (group);
+  entry->time = time;
+
+  for (i = 0; i < n; i++)
+    {
+      entry->devices = g_list_prepend (entry->devices,
+                                       g_object_new (PP_TYPE_PRINT_DEVICE,
+                                                     "device-uri", nonempty (uris[i]),
+                                                     "device-name", nonempty (names[i]),
+                                                     "device-id", nonempty (ids[i]),
+                                                     "device-info", nonempty (infos[i]),
+                                                     "device-make-and-model", nonempty (makes[i]),
+                                                     "device-location", nonempty (locations[i]),
+                                                     "is-network-device", networks[i],
+                                                     "acquisition-method", ACQUISITION_METHOD_DEFAULT_CUPS_SERVER,
+                                                     NULL));
+    }
+
+  entry->devices = g_list_reverse (entry->devices);
+  g_ptr_array_add (cache->entries, entry);
+
+out:
+  g_free (networks);
+  g_strfreev (locations);
+  g_strfreev (makes);
+  g_strfreev (infos);
+  g_strfreev (ids);
+  g_strfreev (names);
+  g_strfreev (uris);
+}
+
+/*
+ * Returns the cache the panel shares between the new printer dialogs
+ * it opens, kept on disk so that it outlives the panel.
+ */
+PpDevicesCache *
+pp_devices_cache_get_default (void)
+{
+  static PpDevicesCache *cache = NULL;
+
+  if (cache == NULL)
+    {
+      gchar *path;
+
+      path = g_build_filename (g_get_user_cache_dir (),
+                               "gnome-control-center",
+                               "cups-devices",
+                               NULL);
+      cache = pp_devices_cache_new (path);
+      g_free (path);
+    }
+
+  return cache;
+}
+
+/* The cache is only kept in memory if @path is NULL */
+PpDevicesCache *
+pp_devices_cache_new (const gchar *path)
+{
+  PpDevicesCache  *cache;
+  GKeyFile        *key_file;
+  gchar          **groups;
+  gint             i;
+
+  cache = g_new0 (PpDevicesCache, 1);
+  cache->path = g_strdup (path);
+  cache->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) entry_free);
+
+  if (path != NULL)
+    {
+      key_file = g_key_file_new ();
+      if (g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL))
+        {
+          groups = g_key_file_get_groups (key_file, NULL);
+          for (i = 0; groups[i] != NULL; i++)
+            load_entry (cache, key_file, groups[i]);
+          g_strfreev (groups);
+        }
+
+      g_key_file_free (key_file);
+    }
+
+  return cache;
+}
+
+void
+pp_devices_cache_free (PpDevicesCache *cache)
+{
+  if (cache == NULL)
+    return;
+
+  g_ptr_array_unref (cache->entries);
+  g_free (cache->path);
+  g_free (cache);
+}
+
+/* How many seconds the devices found by @backend are worth showing */
+gint64
+pp_devices_cache_get_ttl (const gchar *backend)
+{
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (backend_ttls); i++)
+    if (g_strcmp0 (backend_ttls[i].backend, backend) == 0)
+      return backend_ttls[i].ttl;
+
+  return DEFAULT_TTL;
+}
+
+/* Replaces what @backend found before with @devices, found at @now */
+void
+pp_devices_cache_store (PpDevicesCache *cache,
+                        const gchar    *backend,
+                        GList          *devices,
+                        gint64          now)
+{
+  Entry *entry = NULL;
+  guint  i;
+
+  for (i = 0; i < cache->entries->len; i++)
+    if (g_strcmp0 (((Entry *) cache->entries->pdata[i])->backend, backend) == 0)
+      entry = cache->entries->pdata[i];
+
+  if (entry == NULL)
+    {
+      entry = g_new0 (Entry, 1);
+      entry->backend = g_strdup (backend);
+      g_ptr_array_add (cache->entries, entry);
+    }
+
+  g_list_free_full (entry->devices, g_object_unref);
+  entry->devices = copy_devices (devices);
+  entry->time = now;
+
+  cache->modified = TRUE;
+}
+
+/*
+ * Returns copies of the devices which are not older than the TTL
+ * of their backend at @now, in the order the backends found them.
+ */
+GList *
+pp_devices_cache_lookup (PpDevicesCache *cache,
+                         gint64          now)
+{
+  GList *result = NULL;
+  guint  i = 0;
+
+  while (i < cache->entries->len)
+    {
+      Entry *entry = cache->entries->pdata[i];
+
+      if (now - entry->time > pp_devices_cache_get_ttl (entry->backend))
+        {
+          g_ptr_array_remove_index (cache->entries, i);
+          cache->modified = TRUE;
+          continue;
+        }
+
+      result = g_list_concat (result, copy_devices (entry->devices));
+      i++;
+    }
+
+  return result;
+}
+
+static gchar **
+get_strings (GList       *devices,
+             gchar       *(*get) (PpPrintDevice *device))
+{
+  gchar **strings;
+  GList  *iter;
+  gint    i = 0;
+
+  strings = g_new0 (gchar *, g_list_length (devices) + 1);
+  for (iter = devices; iter != NULL; iter = iter->next)
+    {
+      const gchar *string = get (iter->data);
+
+      strings[i++] = g_strdup (string != NULL ? string : "");
+    }
+
+  return strings;
+}
+
+void
+pp_devices_cache_save (PpDevicesCache *cache)
+{
+  GKeyFile *key_file;
+  GError   *error = NULL;
+  gchar    *contents;
+  gchar    *dir;
+  gsize     length;
+  guint     i;
+
+  if (cache->path == NULL || !cache->modified)
+    return;
+
+  key_file = g_key_file_new ();
+
+  for (i = 0; i < cache->entries->len; i++)
+    {
+      Entry     *entry = cache->entries->pdata[i];
+      gboolean  *networks;
+      gchar    **strings;
+      GList     *iter;
+      guint      n, j;
+
+      n = g_list_length (entry->devices);
+      if (n == 0)
+        continue;
+
+      g_key_file_set_int64 (key_file, entry->backend, "time", entry->time);
+
+      strings = get_strings (entry->devices, pp_print_device_get_device_uri);
+      g_key_file_set_string_list (key_file, entry->backend, "device-uri", (const gchar * const *) strings, n);
+      g_strfreev (strings);
+
+      strings = get_strings (entry->devices, pp_print_device_get_device_name);
+      g_key_file_set_string_list (key_file, entry->backend, "device-name", (const gchar * const *) strings, n);
+      g_strfreev (strings);
+
+      strings = get_strings (entry->devices, pp_print_device_get_device_id);
+      g_key_file_set_string_list (key_file, entry->backend, "device-id", (const gchar * const *) strings, n);
+      g_strfreev (strings);
+
+      strings = get_strings (entry->devices, pp_print_device_get_device_info);
+      g_key_file_set_string_list (key_file, entry->backend, "device-info", (const gchar * const *) strings, n);
+      g_strfreev (strings);
+
+      strings = get_strings (entry->devices, pp_print_device_get_device_make_and_model);
+      g_key_file_set_string_list (key_file, entry->backend, "device-make-and-model", (const gchar * const *) strings, n);
+      g_strfreev (strings);
+
+      strings = get_strings (entry->devices, pp_print_device_get_device_location);
+      g_key_file_set_string_list (key_file, entry->backend, "device-location", (const gchar * const *) strings, n);
+      g_strfreev (strings);
+
+      networks = g_new0 (gboolean, n);
+      for (iter = entry->devices, j = 0; iter != NULL; iter = iter->next, j++)
+        networks[j] = pp_print_device_is_network_device (iter->data);
+      g_key_file_set_boolean_list (key_file, entry->backend, "is-network-device", networks, n);
+      g_free (networks);
+    }
+
+  dir = g_path_get_dirname (cache->path);
+  g_mkdir_with_parents (dir, USER_DIR_MODE);
+
+  contents = g_key_file_to_data (key_file, &length, NULL);
+  if (g_file_set_contents (cache->path, contents, length, &error))
+    {
+      cache->modified = FALSE;
+    }
+  else
+    {
+      g_debug ("Could not save the found devices: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (contents);
+  g_free (dir);
+  g_key_file_free (key_file);
+}
@@ -0,0 +1,50 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __PP_DEVICES_CACHE_H__
+#define __PP_DEVICES_CACHE_H__
+
+#include <glib.h>
+#include "pp-print-device.h"
+
+G_BEGIN_DECLS
+
+typedef struct _PpDevicesCache PpDevicesCache;
+
+PpDevicesCache *pp_devices_cache_get_default (void);
+
+PpDevicesCache *pp_devices_cache_new         (const gchar    *path);
+
+void            pp_devices_cache_free        (PpDevicesCache *cache);
+
+gint64          pp_devices_cache_get_ttl     (const gchar    *backend);
+
+void            pp_devices_cache_store       (PpDevicesCache *cache,
+                                              const gchar    *backend,
+                                              GList          *devices,
+                                              gint64          now);
+
+GList          *pp_devices_cache_lookup      (PpDevicesCache *cache,
+                                              gint64          now);
+
+void            pp_devices_cache_save        (PpDevicesCache *cache);
+
+G_END_DECLS
+
+#endif /* __PP_DEVICES_CACHE_H__ */
@@ -0,0 +1,655 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "pp-host-search.h"
+#include "pp-samba.h"
+
+/*
+ * Looks for the printers of a host with several probes, a few of them
+ * at a time. A probe which takes longer than its timeout, or which is
+ * still running when the whole search is over, is given up: it is
+ * cancelled and whatever it finds later is dropped.
+ */
+
+#define DEFAULT_MAX_PROBES 3
+#define DEFAULT_DEADLINE   20000
+
+struct _PpHostSearchPrivate
+{
+  PpHostProbe *probes;
+  guint        n_probes;
+
+  guint        max_probes;
+  guint        deadline;
+
+  gchar       *key;
+  gchar       *scheme;
+  gchar       *hostname;
+  gint         port;
+
+  gboolean     searching;
+  GQueue       pending;
+  GList       *running;
+  guint        deadline_id;
+
+  GPtrArray   *found_devices;
+  GHashTable  *found_uris;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (PpHostSearch, pp_host_search, G_TYPE_OBJECT);
+
+enum {
+  PROP_0 = 0,
+  PROP_MAX_PROBES,
+  PROP_DEADLINE,
+};
+
+enum {
+  DEVICES_FOUND,
+  FINISHED,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+typedef struct
+{
+  PpHostSearch      *search;
+  const PpHostProbe *probe;
+  GCancellable      *cancellable;
+  guint              timeout_id;
+  gboolean           over;
+} ProbeData;
+
+static void
+set_host_port (PpHost *host,
+               gint    port)
+{
+  if (port != PP_HOST_UNSET_PORT)
+    g_object_set (host, "port", port, NULL);
+}
+
+static void
+start_remote_cups_probe (const gchar         *scheme,
+                         const gchar         *hostname,
+                         gint                 port,
+                         GCancellable        *cancellable,
+                         GAsyncReadyCallback  callback,
+                         gpointer             user_data)
+{
+  PpHost *host = pp_host_new (hostname);
+
+  set_host_port (host, port);
+  pp_host_get_remote_cups_devices_async (host, cancellable, callback, user_data);
+  g_object_unref (host);
+}
+
+static PpDevicesList *
+finish_remote_cups_probe (GObject       *source_object,
+                          GAsyncResult  *result,
+                          GError       **error)
+{
+  return pp_host_get_remote_cups_devices_finish (PP_HOST (source_object), result, error);
+}
+
+static void
+start_snmp_probe (const gchar         *scheme,
+                  const gchar         *hostname,
+                  gint                 port,
+                  GCancellable        *cancellable,
+                  GAsyncReadyCallback  callback,
+                  gpointer             user_data)
+{
+  PpHost *host = pp_host_new (hostname);
+
+  set_host_port (host, port);
+  pp_host_get_snmp_devices_async (host, cancellable, callback, user_data);
+  g_object_unref (host);
+}
+
+static PpDevicesList *
+finish_snmp_probe (GObject       *source_object,
+                   GAsyncResult  *result,
+                   GError       **error)
+{
+  return pp_host_get_snmp_devices_finish (PP_HOST (source_object), result, error);
+}
+
+/* Accept port different from the default one only if user specifies
+ * scheme (for socket and lpd printers).
+ */
+static void
+start_jetdirect_probe (const gchar         *scheme,
+                       const gchar         *hostname,
+                       gint                 port,
+                       GCancellable        *cancellable,
+                       GAsyncReadyCallback  callback,
+                       gpointer             user_data)
+{
+  PpHost *host = pp_host_new (hostname);
+
+  if (scheme != NULL && g_ascii_strcasecmp (scheme, "socket") == 0)
+    set_host_port (host, port);
+  pp_host_get_jetdirect_devices_async (host, cancellable, callback, user_data);
+  g_object_unref (host);
+}
+
+static PpDevicesList *
+finish_jetdirect_probe (GObject       *source_object,
+                        GAsyncResult  *result,
+                        GError       **error)
+{
+  return pp_host_get_jetdirect_devices_finish (PP_HOST (source_object), result, error);
+}
+
+static void
+start_lpd_probe (const gchar         *scheme,
+                 const gchar         *hostname,
+                 gint                 port,
+                 GCancellable        *cancellable,
+                 GAsyncReadyCallback  callback,
+                 gpointer             user_data)
+{
+  PpHost *host = pp_host_new (hostname);
+
+  if (scheme != NULL && g_ascii_strcasecmp (scheme, "lpd") == 0)
+    set_host_port (host, port);
+  pp_host_get_lpd_devices_async (host, cancellable, callback, user_data);
+  g_object_unref (host);
+}
+
+static PpDevicesList *
+finish_lpd_probe (GObject       *source_object,
+                  GAsyncResult  *result,
+                  GError       **error)
+{
+  return pp_host_get_lpd_devices_finish (PP_HOST (source_object), result, error);
+}
+
+static void
+start_samba_probe (const gchar         *scheme,
+                   const gchar         *hostname,
+                   gint                 port,
+                   GCancellable        *cancellable,
+                   GAsyncReadyCallback  callback,
+                   gpointer             user_data)
+{
+  PpSamba *samba = pp_samba_new (hostname);
+
+  pp_samba_get_devices_async (samba, TRUE, cancellable, callback, user_data);
+  g_object_unref (samba);
+}
+
+static PpDevicesList *
+finish_samba_probe (GObject       *source_object,
+                    GAsyncResult  *result,
+                    GError       **error)
+{
+  return pp_samba_get_devices_finish (PP_SAMBA (source_object), result, error);
+}
+
+/* Timeouts are in milliseconds */
+static const PpHostProbe default_probes[PP_HOST_N_PROBES] =
+{
+  [PP_HOST_PROBE_REMOTE_CUPS] = { "remote-cups", 10000, start_remote_cups_probe, finish_remote_cups_probe },
+  [PP_HOST_PROBE_SNMP]        = { "snmp",        10000, start_snmp_probe,        finish_snmp_probe },
+  [PP_HOST_PROBE_JETDIRECT]   = { "jetdirect",    5000, start_jetdirect_probe,   finish_jetdirect_probe },
+  [PP_HOST_PROBE_LPD]         = { "lpd",         15000, start_lpd_probe,         finish_lpd_probe },
+  [PP_HOST_PROBE_SAMBA]       = { "samba",       15000, start_samba_probe,       finish_samba_probe },
+};
+
+static void
+pp_host_search_finalize (GObject *object)
+{
+  PpHostSearch        *search = PP_HOST_SEARCH (object);
+  PpHostSearchPrivate *priv = search->priv;
+
+  pp_host_search_stop (search);
+
+  g_free (priv->probes);
+  g_free (priv->key);
+  g_free (priv->scheme);
+  g_free (priv->hostname);
+  g_ptr_array_unref (priv->found_devices);
+  g_hash_table_unref (priv->found_uris);
+
+  G_OBJECT_CLASS (pp_host_search_parent_class)->finalize (object);
+}
+
+static void
+pp_host_search_get_property (GObject    *object,
+                             guint       prop_id,
+                             GValue     *value,
+                             GParamSpec *param_spec)
+{
+  PpHostSearch *self = PP_HOST_SEARCH (object);
+
+  switch (prop_id)
+    {
+      case PROP_MAX_PROBES:
+        g_value_set_uint (value, self->priv->max_probes);
+        break;
+      case PROP_DEADLINE:
+        g_value_set_uint (value, self->priv->deadline);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object,
+                                           prop_id,
+                                           param_spec);
+        break;
+    }
+}
+
+static void
+pp_host_search_set_property (GObject      *object,
+                             guint         prop_id,
+                             const GValue *value,
+                             GParamSpec   *param_spec)
+{
+  PpHostSearch *self = PP_HOST_SEARCH (object);
+
+  switch (prop_id)
+    {
+      case PROP_MAX_PROBES:
+        self->priv->max_probes = g_value_get_uint (value);
+        break;
+      case PROP_DEADLINE:
+        self->priv->deadline = g_value_get_uint (value);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object,
+                                           prop_id,
+                                           param_spec);
+        break;
+    }
+}
+
+static void
+pp_host_search_class_init (PpHostSearchClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->set_property = pp_host_search_set_property;
+  gobject_class->get_property = pp_host_search_get_property;
+  gobject_class->finalize = pp_host_search_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_MAX_PROBES,
+    g_param_spec_uint ("max-probes",
+                       "Maximum probes",
+                       "How many probes run at the same time",
+                       1, G_MAXUINT, DEFAULT_MAX_PROBES,
+                       G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_DEADLINE,
+    g_param_spec_uint ("deadline",
+                       "Deadline",
+                       "How long a search may take in milliseconds, or 0 for no limit",
+                       0, G_MAXUINT, DEFAULT_DEADLINE,
+                       G_PARAM_READWRITE));
+
+  /*
+   * Emitted as soon as a probe finds devices, with copies of the
+   * devices not found by another probe of the same search yet.
+   */
+  signals[DEVICES_FOUND] =
+    g_signal_new ("devices-found",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (PpHostSearchClass, devices_found),
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+  signals[FINISHED] =
+    g_signal_new ("finished",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (PpHostSearchClass, finished),
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 0);
+}
+
+static void
+pp_host_search_init (PpHostSearch *search)
+{
+  search->priv = G_TYPE_INSTANCE_GET_PRIVATE (search,
+                                              PP_TYPE_HOST_SEARCH,
+                                              PpHostSearchPrivate);
+  search->priv->max_probes = DEFAULT_MAX_PROBES;
+  search->priv->deadline = DEFAULT_DEADLINE;
+  search->priv->port = PP_HOST_UNSET_PORT;
+  g_queue_init (&search->priv->pending);
+  search->priv->found_devices = g_ptr_array_new_with_free_func (g_object_unref);
+  search->priv->found_uris = g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+const PpHostProbe *
+pp_host_search_get_default_probes (void)
+{
+  return default_probes;
+}
+
+PpHostSearch *
+pp_host_search_new (void)
+{
+  return pp_host_search_new_with_probes (default_probes, PP_HOST_N_PROBES);
+}
+
+PpHostSearch *
+pp_host_search_new_with_probes (const PpHostProbe *probes,
+                                guint              n_probes)
+{
+  PpHostSearch *search;
+
+  search = g_object_new (PP_TYPE_HOST_SEARCH, NULL);
+  search->priv->probes = g_memdup (probes, n_probes * sizeof (PpHostProbe));
+  search->priv->n_probes = n_probes;
+
+  return search;
+}
+
+static void
+probe_data_free (ProbeData *data)
+{
+  g_object_unref (data->search);
+  g_object_unref (data->cancellable);
+  g_free (data);
+}
+
+/* The probe doesn't hold its place in the search anymore */
+static void
+probe_over (ProbeData *data,
+            gboolean   give_up)
+{
+  PpHostSearchPrivate *priv = data->search->priv;
+
+  data->over = TRUE;
+
+  if (data->timeout_id != 0)
+    {
+      g_source_remove (data->timeout_id);
+      data->timeout_id = 0;
+    }
+
+  if (give_up)
+    g_cancellable_cancel (data->cancellable);
+
+  priv->running = g_list_remove (priv->running, data);
+}
+
+static void
+emit_devices_found (PpHostSearch *search,
+                    GPtrArray    *devices,
+                    guint         first)
+{
+  GList *copies = NULL;
+  guint  i;
+
+  if (first >= devices->len)
+    return;
+
+  for (i = devices->len; i > first; i--)
+    copies = g_list_prepend (copies, pp_print_device_copy (g_ptr_array_index (devices, i - 1)));
+
+  g_signal_emit (search, signals[DEVICES_FOUND], 0, copies);
+
+  g_list_free_full (copies, g_object_unref);
+}
+
+static void
+add_found_devices (PpHostSearch *search,
+                   GList        *devices)
+{
+  PpHostSearchPrivate *priv = search->priv;
+  PpPrintDevice       *device;
+  const gchar         *device_uri;
+  GList               *iter;
+  guint                first = priv->found_devices->len;
+
+  for (iter = devices; iter != NULL; iter = iter->next)
+    {
+      device = (PpPrintDevice *) iter->data;
+      device_uri = pp_print_device_get_device_uri (device);
+
+      if (device_uri != NULL)
+        {
+          if (g_hash_table_contains (priv->found_uris, device_uri))
+            continue;
+
+          g_hash_table_add (priv->found_uris, (gpointer) device_uri);
+        }
+
+      g_ptr_array_add (priv->found_devices, g_object_ref (device));
+    }
+
+  emit_devices_found (search, priv->found_devices, first);
+}
+
+static void
+finish_if_done (PpHostSearch *search)
+{
+  PpHostSearchPrivate *priv = search->priv;
+
+  if (!priv->searching ||
+      priv->running != NULL ||
+      !g_queue_is_empty (&priv->pending))
+    return;
+
+  if (priv->deadline_id != 0)
+    {
+      g_source_remove (priv->deadline_id);
+      priv->deadline_id = 0;
+    }
+
+  priv->searching = FALSE;
+
+  g_signal_emit (search, signals[FINISHED], 0);
+}
+
+static void start_probes (PpHostSearch *search);
+
+static gboolean
+probe_timeout_cb (gpointer user_data)
+{
+  ProbeData    *data = (ProbeData *) user_data;
+  PpHostSearch *search = data->search;
+
+  g_debug ("Giving up the %s probe of %s", data->probe->name, search->priv->hostname);
+
+  data->timeout_id = 0;
+  probe_over (data, TRUE);
+
+  start_probes (search);
+  finish_if_done (search);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+probe_cb (GObject      *source_object,
+          GAsyncResult *result,
+          gpointer      user_data)
+{
+  PpDevicesList *devices;
+  PpHostSearch  *search;
+  ProbeData     *data = (ProbeData *) user_data;
+  GError        *error = NULL;
+
+  devices = data->probe->finish (source_object, result, &error);
+
+  if (!data->over)
+    {
+      search = data->search;
+
+      probe_over (data, FALSE);
+
+      if (devices != NULL)
+        add_found_devices (search, devices->devices);
+      else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("%s", error->message);
+
+      start_probes (search);
+      finish_if_done (search);
+    }
+
+  if (devices != NULL)
+    pp_devices_list_free (devices);
+  g_clear_error (&error);
+
+  probe_data_free (data);
+}
+
+static void
+start_probes (PpHostSearch *search)
+{
+  PpHostSearchPrivate *priv = search->priv;
+  const PpHostProbe   *probe;
+  ProbeData           *data;
+
+  while (g_list_length (priv->running) < priv->max_probes &&
+         !g_queue_is_empty (&priv->pending))
+    {
+      probe = g_queue_pop_head (&priv->pending);
+
+      data = g_new0 (ProbeData, 1);
+      data->search = g_object_ref (search);
+      data->probe = probe;
+      data->cancellable = g_cancellable_new ();
+
+      if (probe->timeout > 0)
+        data->timeout_id = g_timeout_add (probe->timeout, probe_timeout_cb, data);
+
+      priv->running = g_list_prepend (priv->running, data);
+
+      probe->start (priv->scheme,
+                    priv->hostname,
+                    priv->port,
+                    data->cancellable,
+                    probe_cb,
+                    data);
+    }
+}
+
+static gboolean
+deadline_cb (gpointer user_data)
+{
+  PpHostSearch        *search = PP_HOST_SEARCH (user_data);
+  PpHostSearchPrivate *priv = search->priv;
+
+  g_debug ("Giving up the search for printers of %s", priv->hostname);
+
+  priv->deadline_id = 0;
+
+  g_queue_clear (&priv->pending);
+  while (priv->running != NULL)
+    probe_over (priv->running->data, TRUE);
+
+  finish_if_done (search);
+
+  return G_SOURCE_REMOVE;
+}
+
+/*
+ * Looks for the printers of @hostname, unless that is what the search
+ * is already doing, in which case the devices it has found so far are
+ * announced again.
+ */
+void
+pp_host_search_start (PpHostSearch *search,
+                      const gchar  *scheme,
+                      const gchar  *hostname,
+                      gint          port)
+{
+  PpHostSearchPrivate *priv;
+  gchar               *address;
+  gchar               *key;
+  guint                i;
+
+  g_return_if_fail (PP_IS_HOST_SEARCH (search));
+  g_return_if_fail (hostname != NULL);
+
+  priv = search->priv;
+
+  address = g_strdup_printf ("%s://%s:%d", scheme != NULL ? scheme : "", hostname, port);
+  key = g_ascii_strdown (address, -1);
+  g_free (address);
+
+  if (priv->searching && g_strcmp0 (key, priv->key) == 0)
+    {
+      emit_devices_found (search, priv->found_devices, 0);
+      g_free (key);
+      return;
+    }
+
+  pp_host_search_stop (search);
+
+  g_free (priv->key);
+  priv->key = key;
+  g_free (priv->scheme);
+  priv->scheme = g_strdup (scheme);
+  g_free (priv->hostname);
+  priv->hostname = g_strdup (hostname);
+  priv->port = port;
+
+  g_hash_table_remove_all (priv->found_uris);
+  g_ptr_array_set_size (priv->found_devices, 0);
+
+  for (i = 0; i < priv->n_probes; i++)
+    g_queue_push_tail (&priv->pending, &priv->probes[i]);
+
+  priv->searching = TRUE;
+
+  if (priv->deadline > 0)
+    priv->deadline_id = g_timeout_add (priv->deadline, deadline_cb, search);
+
+  start_probes (search);
+  finish_if_done (search);
+}
+
+/* Gives the current search up, without announcing its end */
+void
+pp_host_search_stop (PpHostSearch *search)
+{
+  PpHostSearchPrivate *priv;
+
+  g_return_if_fail (PP_IS_HOST_SEARCH (search));
+
+  priv = search->priv;
+
+  g_queue_clear (&priv->pending);
+  while (priv->running != NULL)
+    probe_over (priv->running->data, TRUE);
+
+  if (priv->deadline_id != 0)
+    {
+      g_source_remove (priv->deadline_id);
+      priv->deadline_id = 0;
+    }
+
+  priv->searching = FALSE;
+}
+
+gboolean
+pp_host_search_is_searching (PpHostSearch *search)
+{
+  g_return_val_if_fail (PP_IS_HOST_SEARCH (search), FALSE);
+
+  return search->priv->searching;
+}
@@ -0,0 +1,111 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __PP_HOST_SEARCH_H__
+#define __PP_HOST_SEARCH_H__
+
+#include <glib-object.h>
+#include <gio/gio.h>
+#include "pp-host.h"
+
+G_BEGIN_DECLS
+
+#define PP_TYPE_HOST_SEARCH         (pp_host_search_get_type ())
+#define PP_HOST_SEARCH(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), PP_TYPE_HOST_SEARCH, PpHostSearch))
+#define PP_HOST_SEARCH_CLASS(k)     (G_TYPE_CHECK_CLASS_CAST((k), PP_TYPE_HOST_SEARCH, PpHostSearchClass))
+#define PP_IS_HOST_SEARCH(o)        (G_TYPE_CHECK_INSTANCE_TYPE ((o), PP_TYPE_HOST_SEARCH))
+#define PP_IS_HOST_SEARCH_CLASS(k)  (G_TYPE_CHECK_CLASS_TYPE ((k), PP_TYPE_HOST_SEARCH))
+#define PP_HOST_SEARCH_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), PP_TYPE_HOST_SEARCH, PpHostSearchClass))
+
+typedef struct _PpHostSearch        PpHostSearch;
+typedef struct _PpHostSearchClass   PpHostSearchClass;
+typedef struct _PpHostSearchPrivate PpHostSearchPrivate;
+
+struct _PpHostSearch
+{
+  GObject              parent_instance;
+  PpHostSearchPrivate *priv;
+};
+
+struct _PpHostSearchClass
+{
+  GObjectClass parent_class;
+
+  void (*devices_found) (PpHostSearch *search,
+                         GList        *devices);
+  void (*finished)      (PpHostSearch *search);
+};
+
+/*
+ * One way of finding the printers of a host. @start begins looking
+ * for them, with @port being PP_HOST_UNSET_PORT unless the user gave
+ * one, and @finish gets the result from the source object the
+ * callback was called with.
+ */
+typedef void           (*PpHostProbeStartFunc)  (const gchar          *scheme,
+                                                 const gchar          *hostname,
+                                                 gint                  port,
+                                                 GCancellable         *cancellable,
+                                                 GAsyncReadyCallback   callback,
+                                                 gpointer              user_data);
+
+typedef PpDevicesList *(*PpHostProbeFinishFunc) (GObject              *source_object,
+                                                 GAsyncResult         *result,
+                                                 GError              **error);
+
+typedef struct
+{
+  const gchar           *name;
+  guint                  timeout;
+  PpHostProbeStartFunc   start;
+  PpHostProbeFinishFunc  finish;
+} PpHostProbe;
+
+/* The probes pp_host_search_new () runs, in this order */
+enum
+{
+  PP_HOST_PROBE_REMOTE_CUPS = 0,
+  PP_HOST_PROBE_SNMP,
+  PP_HOST_PROBE_JETDIRECT,
+  PP_HOST_PROBE_LPD,
+  PP_HOST_PROBE_SAMBA,
+  PP_HOST_N_PROBES
+};
+
+GType              pp_host_search_get_type             (void) G_GNUC_CONST;
+
+const PpHostProbe *pp_host_search_get_default_probes   (void);
+
+PpHostSearch      *pp_host_search_new                  (void);
+
+PpHostSearch      *pp_host_search_new_with_probes      (const PpHostProbe *probes,
+                                                        guint              n_probes);
+
+void               pp_host_search_start                (PpHostSearch      *search,
+                                                        const gchar       *scheme,
+                                                        const gchar       *hostname,
+                                                        gint               port);
+
+void               pp_host_search_stop                 (PpHostSearch      *search);
+
+gboolean           pp_host_search_is_searching         (PpHostSearch      *search);
+
+G_END_DECLS
+
+#endif /* __PP_HOST_SEARCH_H__ */
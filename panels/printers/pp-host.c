@@ -256,11 +256,11 @@ _pp_host_get_snmp_devices_thread (GSimpleAsyncResult *res,
   PpPrintDevice  *device;
   gboolean        is_network_device;
   GSDData        *data;
-  GError         *error;
+  GError         *error = NULL;
   gchar         **argv;
   gchar          *stdout_string = NULL;
   gchar          *stderr_string = NULL;
-  gint            exit_status;
+  gint            exit_status = -1;
 
   data = g_simple_async_result_get_op_res_gpointer (res);
   data->devices = g_new0 (PpDevicesList, 1);
@@ -286,6 +286,12 @@ _pp_host_get_snmp_devices_thread (GSimpleAsyncResult *res,
   g_free (argv[0]);
   g_free (argv);
 
+  if (error != NULL)
+    {
+      g_debug ("%s", error->message);
+      g_error_free (error);
+    }
+
   if (exit_status == 0 && stdout_string)
     {
       gchar **printer_informations = NULL;
@@ -0,0 +1,86 @@
+/* Generated by gen-manufacturers-hash from pp-manufacturers-table.h */
+
+#ifndef __PP_MANUFACTURERS_HASH_H__
+#define __PP_MANUFACTURERS_HASH_H__
+
+#define MANUFACTURERS_HASH_SEED 25299u
+#define MANUFACTURERS_HASH_SIZE 256
+
+static const struct {
+  const char *normalized_name;
+  const char *display_name;
+  const char *normalized_display_name;
+} manufacturers_hash[MANUFACTURERS_HASH_SIZE] = {
+  [0] = { "brother", "Brother", "brother" },
+  [3] = { "xante", "Xante", "xante" },
+  [9] = { "anitech", "Anitech", "anitech" },
+  [13] = { "konica minolta", "Minolta", "minolta" },
+  [20] = { "samsung", "Samsung", "samsung" },
+  [21] = { "kyocera", "Kyocera", "kyocera" },
+  [22] = { "lexmark international", "Lexmark", "lexmark" },
+  [23] = { "dnp", "DNP", "dnp" },
+  [25] = { "olivetti", "Olivetti", "olivetti" },
+  [31] = { "ricoh", "Ricoh", "ricoh" },
+  [39] = { "xerox", "Xerox", "xerox" },
+  [43] = { "shinko", "Shinko", "shinko" },
+  [48] = { "fujitsu", "Fujitsu", "fujitsu" },
+  [52] = { "pentax", "Pentax", "pentax" },
+  [60] = { "oce", "Oce", "oce" },
+  [70] = { "kyocera mita", "Kyocera", "kyocera" },
+  [71] = { "minolta", "Minolta", "minolta" },
+  [75] = { "raven", "Raven", "raven" },
+  [78] = { "hp", "Hewlett-Packard", "hewlett packard" },
+  [80] = { "ibm", "IBM", "ibm" },
+  [85] = { "gestetner", "Gestetner", "gestetner" },
+  [90] = { "alps", "Alps", "alps" },
+  [95] = { "hewlett packard", "Hewlett-Packard", "hewlett packard" },
+  [100] = { "star", "Star", "star" },
+  [104] = { "compaq", "Compaq", "compaq" },
+  [107] = { "infoprint", "InfoPrint", "infoprint" },
+  [110] = { "gelsprinter", "Ricoh", "ricoh" },
+  [116] = { "canon", "Canon", "canon" },
+  [117] = { "raw", "Raw", "raw" },
+  [121] = { "tally", "Tally", "tally" },
+  [125] = { "tektronix", "Tektronix", "tektronix" },
+  [127] = { "minolta qms", "Minolta", "minolta" },
+  [129] = { "nrg", "NRG", "nrg" },
+  [130] = { "toshiba tec corp ", "Toshiba", "toshiba" },
+  [131] = { "olympus", "Olympus", "olympus" },
+  [136] = { "nec", "NEC", "nec" },
+  [142] = { "citoh", "Citoh", "citoh" },
+  [143] = { "pcpi", "PCPI", "pcpi" },
+  [148] = { "seiko", "Seiko", "seiko" },
+  [163] = { "zebra", "Zebra", "zebra" },
+  [166] = { "generic", "Generic", "generic" },
+  [167] = { "apollo", "Apollo", "apollo" },
+  [169] = { "oki", "Oki", "oki" },
+  [170] = { "toshiba", "Toshiba", "toshiba" },
+  [172] = { "kodak", "Kodak", "kodak" },
+  [173] = { "oki data corp", "Oki", "oki" },
+  [176] = { "sony", "Sony", "sony" },
+  [177] = { "citizen", "Citizen", "citizen" },
+  [183] = { "savin", "Savin", "savin" },
+  [184] = { "infotec", "Infotec", "infotec" },
+  [185] = { "dell", "Dell", "dell" },
+  [189] = { "epson", "Epson", "epson" },
+  [196] = { "heidelberg", "Heidelberg", "heidelberg" },
+  [197] = { "apple", "Apple", "apple" },
+  [199] = { "dymo", "Dymo", "dymo" },
+  [202] = { "qms", "QMS", "qms" },
+  [203] = { "panasonic", "Panasonic", "panasonic" },
+  [212] = { "hitachi", "Hitachi", "hitachi" },
+  [213] = { "fujifilm", "Fujifilm", "fujifilm" },
+  [214] = { "lexmark", "Lexmark", "lexmark" },
+  [218] = { "intellitech", "Intellitech", "intellitech" },
+  [220] = { "genicom", "Genicom", "genicom" },
+  [222] = { "lanier", "Lanier", "lanier" },
+  [237] = { "imagen", "Imagen", "imagen" },
+  [243] = { "mitsubishi", "Mitsubishi", "mitsubishi" },
+  [244] = { "texas instruments", "Texas Instruments", "texas instruments" },
+  [246] = { "sipix", "SiPix", "sipix" },
+  [249] = { "dec", "DEC", "dec" },
+  [250] = { "sharp", "Sharp", "sharp" },
+  [251] = { "imagistics", "Imagistics", "imagistics" },
+};
+
+#endif /* __PP_MANUFACTURERS_HASH_H__ */
@@ -0,0 +1,106 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __PP_MANUFACTURERS_TABLE_H__
+#define __PP_MANUFACTURERS_TABLE_H__
+
+/*
+ * The names manufacturers go by, and the name they are shown with.
+ * This is only read by gen-manufacturers-hash, which turns it into
+ * the perfect hash of pp-manufacturers-hash.h, and by the tests.
+ * Run "make update-manufacturers-hash" after changing it.
+ */
+
+static const struct {
+  const char *normalized_name;
+  const char *display_name;
+} manufacturers_names[] = {
+  { "alps", "Alps" },
+  { "anitech", "Anitech" },
+  { "apple", "Apple" },
+  { "apollo", "Apollo" },
+  { "brother", "Brother" },
+  { "canon", "Canon" },
+  { "citizen", "Citizen" },
+  { "citoh", "Citoh" },
+  { "compaq", "Compaq" },
+  { "dec", "DEC" },
+  { "dell", "Dell" },
+  { "dnp", "DNP" },
+  { "dymo", "Dymo" },
+  { "epson", "Epson" },
+  { "fujifilm", "Fujifilm" },
+  { "fujitsu", "Fujitsu" },
+  { "gelsprinter", "Ricoh" },
+  { "generic", "Generic" },
+  { "genicom", "Genicom" },
+  { "gestetner", "Gestetner" },
+  { "hewlett packard", "Hewlett-Packard" },
+  { "heidelberg", "Heidelberg" },
+  { "hitachi", "Hitachi" },
+  { "hp", "Hewlett-Packard" },
+  { "ibm", "IBM" },
+  { "imagen", "Imagen" },
+  { "imagistics", "Imagistics" },
+  { "infoprint", "InfoPrint" },
+  { "infotec", "Infotec" },
+  { "intellitech", "Intellitech" },
+  { "kodak", "Kodak" },
+  { "konica minolta", "Minolta" },
+  { "kyocera", "Kyocera" },
+  { "kyocera mita", "Kyocera" },
+  { "lanier", "Lanier" },
+  { "lexmark international", "Lexmark" },
+  { "lexmark", "Lexmark" },
+  { "minolta", "Minolta" },
+  { "minolta qms", "Minolta" },
+  { "mitsubishi", "Mitsubishi" },
+  { "nec", "NEC" },
+  { "nrg", "NRG" },
+  { "oce", "Oce" },
+  { "oki", "Oki" },
+  { "oki data corp", "Oki" },
+  { "olivetti", "Olivetti" },
+  { "olympus", "Olympus" },
+  { "panasonic", "Panasonic" },
+  { "pcpi", "PCPI" },
+  { "pentax", "Pentax" },
+  { "qms", "QMS" },
+  { "raven", "Raven" },
+  { "raw", "Raw" },
+  { "ricoh", "Ricoh" },
+  { "samsung", "Samsung" },
+  { "savin", "Savin" },
+  { "seiko", "Seiko" },
+  { "sharp", "Sharp" },
+  { "shinko", "Shinko" },
+  { "sipix", "SiPix" },
+  { "sony", "Sony" },
+  { "star", "Star" },
+  { "tally", "Tally" },
+  { "tektronix", "Tektronix" },
+  { "texas instruments", "Texas Instruments" },
+  { "toshiba", "Toshiba" },
+  { "toshiba tec corp.", "Toshiba" },
+  { "xante", "Xante" },
+  { "xerox", "Xerox" },
+  { "zebra", "Zebra" },
+};
+
+#endif /* __PP_MANUFACTURERS_TABLE_H__ */
@@ -0,0 +1,395 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "pp-markers.h"
+
+/* Older samples are dropped, the recent ones tell the rate anyway */
+#define MAX_SAMPLES 64
+
+/* Shorter histories give estimates too wild to be shown */
+#define MIN_ESTIMATE_SPAN (24 * 60 * 60)
+#define MAX_DAYS_LEFT     365
+
+#define SECONDS_PER_DAY (24 * 60 * 60)
+
+static void
+pp_marker_free (PpMarker *marker)
+{
+  g_free (marker->name);
+  g_free (marker->color);
+  g_free (marker->type);
+  g_free (marker);
+}
+
+static gint
+markers_cmp (gconstpointer a,
+             gconstpointer b)
+{
+  PpMarker *x = *((PpMarker **) a);
+  PpMarker *y = *((PpMarker **) b);
+
+  if (x->level < y->level)
+    return 1;
+  else if (x->level == y->level)
+    return 0;
+  else
+    return -1;
+}
+
+/*
+ * Returns the ink and toner markers described by the marker-* options
+ * of a destination, fullest first, which is the order their bars are
+ * drawn in. The array is empty if the options don't describe the same
+ * number of markers.
+ */
+GPtrArray *
+pp_markers_parse (const gchar *marker_names,
+                  const gchar *marker_colors,
+                  const gchar *marker_types,
+                  const gchar *marker_levels)
+{
+  GPtrArray  *markers;
+  gchar     **namesv;
+  gchar     **colorsv;
+  gchar     **typesv;
+  gchar     **levelsv;
+  gchar      *names;
+  guint       length;
+  gint        i;
+
+  markers = g_ptr_array_new_with_free_func ((GDestroyNotify) pp_marker_free);
+
+  if (!marker_names || !marker_colors || !marker_types || !marker_levels)
+    return markers;
+
+  names = g_strcompress (marker_names);
+  namesv = g_strsplit (names, ",", -1);
+  colorsv = g_strsplit (marker_colors, ",", -1);
+  typesv = g_strsplit (marker_types, ",", -1);
+  levelsv = g_strsplit (marker_levels, ",", -1);
+
+  length = g_strv_length (levelsv);
+  if (g_strv_length (namesv) == length &&
+      g_strv_length (colorsv) == length &&
+      g_strv_length (typesv) == length)
+    {
+      /* Backwards, so that markers of the same level keep the order
+       * they have always been drawn in */
+      for (i = length - 1; i >= 0; i--)
+        {
+          PpMarker *marker;
+
+          if (g_strcmp0 (typesv[i], "ink") == 0 ||
+              g_strcmp0 (typesv[i], "toner") == 0 ||
+              g_strcmp0 (typesv[i], "inkCartridge") == 0 ||
+              g_strcmp0 (typesv[i], "tonerCartridge") == 0)
+            {
+              marker = g_new0 (PpMarker, 1);
+              marker->name = g_strdup (namesv[i]);
+              marker->color = g_strdup (colorsv[i]);
+              marker->type = g_strdup (typesv[i]);
+              marker->level = atoi (levelsv[i]);
+
+              g_ptr_array_add (markers, marker);
+            }
+        }
+
+      g_ptr_array_sort (markers, markers_cmp);
+    }
+
+  g_strfreev (namesv);
+  g_strfreev (colorsv);
+  g_strfreev (typesv);
+  g_strfreev (levelsv);
+  g_free (names);
+
+  return markers;
+}
+
+/*
+ * The levels reported for each marker of each printer, kept as
+ *
+ *   [printer]
+ *   marker=time:level;time:level;...
+ *
+ * with a sample added only when the level changes.
+ */
+struct _PpSupplyHistory
+{
+  gchar    *path;
+  GKeyFile *key_file;
+  gboolean  modified;
+};
+
+typedef struct
+{
+  gint64 time;
+  gint   level;
+} Sample;
+
+static gchar *
+get_default_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-control-center",
+                           "supply-history",
+                           NULL);
+}
+
+/* Group names and keys of a GKeyFile can't hold all that names can */
+static gchar *
+escape_name (const gchar *name)
+{
+  return g_uri_escape_string (name, " ", TRUE);
+}
+
+PpSupplyHistory *
+pp_supply_history_new (const gchar *path)
+{
+  PpSupplyHistory *history;
+
+  history = g_new0 (PpSupplyHistory, 1);
+  history->path = path ? g_strdup (path) : get_default_path ();
+  history->key_file = g_key_file_new ();
+
+  g_key_file_load_from_file (history->key_file, history->path, G_KEY_FILE_NONE, NULL);
+
+  return history;
+}
+
+void
+pp_supply_history_free (PpSupplyHistory *history)
+{
+  if (history == NULL)
+    return;
+
+  g_key_file_free (history->key_file);
+  g_free (history->path);
+  g_free (history);
+}
+
+static GArray *
+get_samples (PpSupplyHistory *history,
+             const gchar     *group,
+             const gchar     *key)
+{
+  GArray  *samples;
+  gchar  **values;
+  gint     i;
+
+  samples = g_array_new (FALSE, FALSE, sizeof (Sample));
+
+  values = g_key_file_get_string_list (history->key_file, group, key, NULL, NULL);
+  for (i = 0; values != NULL && values[i] != NULL; i++)
+    {
+      Sample  sample;
+      gchar  *end;
+
+      sample.time = g_ascii_strtoll (values[i], &end, 10);
+      if (*end != ':')
+        continue;
+
+      sample.level = (gint) g_ascii_strtoll (end + 1, &end, 10);
+      if (*end != '\0')
+        continue;
+
+      g_array_append_val (samples, sample);
+    }
+
+  g_strfreev (values);
+
+  return samples;
+}
+
+static void
+set_samples (PpSupplyHistory *history,
+             const gchar     *group,
+             const gchar     *key,
+             GArray          *samples)
+{
+  gchar **values;
+  guint   first;
+  guint   i;
+
+  first = samples->len > MAX_SAMPLES ? samples->len - MAX_SAMPLES : 0;
+
+  values = g_new0 (gchar *, samples->len - first + 1);
+  for (i = first; i < samples->len; i++)
+    {
+      Sample *sample = &g_array_index (samples, Sample, i);
+
+      values[i - first] = g_strdup_printf ("%" G_GINT64_FORMAT ":%d", sample->time, sample->level);
+    }
+
+  g_key_file_set_string_list (history->key_file, group, key,
+                              (const gchar * const *) values,
+                              samples->len - first);
+  g_strfreev (values);
+}
+
+/*
+ * Records the level of a marker at @time, in seconds since the Epoch.
+ * Returns TRUE if the level differs from the one last recorded.
+ */
+gboolean
+pp_supply_history_add_sample (PpSupplyHistory *history,
+                              const gchar     *printer_name,
+                              const gchar     *marker_name,
+                              gint64           time,
+                              gint             level)
+{
+  GArray   *samples;
+  Sample    sample;
+  gboolean  added = FALSE;
+  gchar    *group;
+  gchar    *key;
+
+  /* Negative levels stand for unknown ones */
+  if (level < 0 || printer_name == NULL || marker_name == NULL || marker_name[0] == '\0')
+    return FALSE;
+
+  group = escape_name (printer_name);
+  key = escape_name (marker_name);
+  samples = get_samples (history, group, key);
+
+  if (samples->len == 0 ||
+      g_array_index (samples, Sample, samples->len - 1).level != level)
+    {
+      sample.time = time;
+      sample.level = level;
+      g_array_append_val (samples, sample);
+
+      set_samples (history, group, key, samples);
+      history->modified = TRUE;
+      added = TRUE;
+    }
+
+  g_array_unref (samples);
+  g_free (key);
+  g_free (group);
+
+  return added;
+}
+
+void
+pp_supply_history_save (PpSupplyHistory *history)
+{
+  GError *error = NULL;
+  gchar  *contents;
+  gchar  *dir;
+  gsize   length;
+
+  if (!history->modified)
+    return;
+
+  dir = g_path_get_dirname (history->path);
+  g_mkdir_with_parents (dir, USER_DIR_MODE);
+
+  contents = g_key_file_to_data (history->key_file, &length, NULL);
+  if (g_file_set_contents (history->path, contents, length, &error))
+    {
+      history->modified = FALSE;
+    }
+  else
+    {
+      g_debug ("Could not save the supply history: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (contents);
+  g_free (dir);
+}
+
+/*
+ * Estimates in how many days, counted from @now, a marker will be
+ * empty, by fitting a line to the levels recorded since it was last
+ * refilled. Returns -1 if the history doesn't allow to tell.
+ */
+gint
+pp_supply_history_estimate_days_left (PpSupplyHistory *history,
+                                      const gchar     *printer_name,
+                                      const gchar     *marker_name,
+                                      gint64           now)
+{
+  GArray  *samples;
+  gdouble  sum_t = 0.0;
+  gdouble  sum_l = 0.0;
+  gdouble  sum_tt = 0.0;
+  gdouble  sum_tl = 0.0;
+  gdouble  slope;
+  gdouble  intercept;
+  gdouble  days_left;
+  gint64   origin;
+  gchar   *group;
+  gchar   *key;
+  guint    first = 0;
+  guint    n;
+  guint    i;
+  gint     result = -1;
+
+  group = escape_name (printer_name);
+  key = escape_name (marker_name);
+  samples = get_samples (history, group, key);
+  g_free (key);
+  g_free (group);
+
+  for (i = 1; i < samples->len; i++)
+    if (g_array_index (samples, Sample, i).level > g_array_index (samples, Sample, i - 1).level)
+      first = i;
+
+  n = samples->len - first;
+  if (n < 2)
+    goto out;
+
+  origin = g_array_index (samples, Sample, first).time;
+  if (g_array_index (samples, Sample, samples->len - 1).time - origin < MIN_ESTIMATE_SPAN)
+    goto out;
+
+  for (i = first; i < samples->len; i++)
+    {
+      Sample  *sample = &g_array_index (samples, Sample, i);
+      gdouble  t = sample->time - origin;
+
+      sum_t += t;
+      sum_l += sample->level;
+      sum_tt += t * t;
+      sum_tl += t * sample->level;
+    }
+
+  slope = (n * sum_tl - sum_t * sum_l) / (n * sum_tt - sum_t * sum_t);
+  if (!(slope < 0.0))
+    goto out;
+
+  intercept = (sum_l - slope * sum_t) / n;
+  days_left = (origin - intercept / slope - now) / SECONDS_PER_DAY;
+
+  if (days_left <= MAX_DAYS_LEFT)
+    result = days_left > 0.0 ? (gint) (days_left + 0.5) : 0;
+
+out:
+  g_array_unref (samples);
+
+  return result;
+}
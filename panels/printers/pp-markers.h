@@ -0,0 +1,61 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __PP_MARKERS_H__
+#define __PP_MARKERS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  gchar *name;
+  gchar *color;
+  gchar *type;
+  gint   level;
+} PpMarker;
+
+GPtrArray       *pp_markers_parse                     (const gchar     *marker_names,
+                                                       const gchar     *marker_colors,
+                                                       const gchar     *marker_types,
+                                                       const gchar     *marker_levels);
+
+typedef struct _PpSupplyHistory PpSupplyHistory;
+
+PpSupplyHistory *pp_supply_history_new                (const gchar     *path);
+
+void             pp_supply_history_free               (PpSupplyHistory *history);
+
+gboolean         pp_supply_history_add_sample         (PpSupplyHistory *history,
+                                                       const gchar     *printer_name,
+                                                       const gchar     *marker_name,
+                                                       gint64           time,
+                                                       gint             level);
+
+void             pp_supply_history_save               (PpSupplyHistory *history);
+
+gint             pp_supply_history_estimate_days_left (PpSupplyHistory *history,
+                                                       const gchar     *printer_name,
+                                                       const gchar     *marker_name,
+                                                       gint64           now);
+
+G_END_DECLS
+
+#endif /* __PP_MARKERS_H__ */
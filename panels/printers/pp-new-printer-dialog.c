@@ -33,6 +33,9 @@
 #include "pp-ppd-selection-dialog.h"
 #include "pp-utils.h"
 #include "pp-host.h"
+#include "pp-host-search.h"
+#include "pp-device-index.h"
+#include "pp-devices-cache.h"
 #include "pp-cups.h"
 #include "pp-samba.h"
 #include "pp-new-printer.h"
@@ -77,6 +80,11 @@ static void     add_devices_to_list (PpNewPrinterDialog  *dialog,
                                      GList               *devices);
 static void     remove_device_from_list (PpNewPrinterDialog *dialog,
                                          const gchar        *device_name);
+static void     host_search_devices_found_cb (PpHostSearch *search,
+                                              GList        *devices,
+                                              gpointer      user_data);
+static void     host_search_finished_cb (PpHostSearch *search,
+                                         gpointer      user_data);
 
 enum
 {
@@ -85,7 +93,6 @@ enum
   DEVICE_DISPLAY_NAME_COLUMN,
   DEVICE_DESCRIPTION_COLUMN,
   SERVER_NEEDS_AUTHENTICATION_COLUMN,
-  DEVICE_VISIBLE_COLUMN,
   DEVICE_COLUMN,
   DEVICE_N_COLUMNS
 };
@@ -100,11 +107,16 @@ struct _PpNewPrinterDialogPrivate
   GtkTreeModelFilter *filter;
   GtkTreeView        *treeview;
 
+  /* Which devices of the store match the search */
+  PpDeviceIndex *device_index;
+
+  /* Devices from the cache the backends haven't found again yet */
+  GHashTable *stale_devices;
+
   cups_dest_t *dests;
   gint         num_of_dests;
 
   GCancellable *cancellable;
-  GCancellable *remote_host_cancellable;
 
   gboolean  cups_searching;
   gboolean  samba_authenticated_searching;
@@ -126,12 +138,9 @@ struct _PpNewPrinterDialogPrivate
   GIcon *remote_printer_icon;
   GIcon *authenticated_server_icon;
 
-  PpHost  *snmp_host;
-  PpHost  *socket_host;
-  PpHost  *lpd_host;
-  PpHost  *remote_cups_host;
-  PpSamba *samba_host;
-  guint    host_search_timeout_id;
+  PpSamba      *samba_host;
+  PpHostSearch *host_search;
+  guint         host_search_timeout_id;
 };
 
 #define PP_NEW_PRINTER_DIALOG_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), PP_TYPE_NEW_PRINTER_DIALOG, PpNewPrinterDialogPrivate))
@@ -513,6 +522,10 @@ pp_new_printer_dialog_init (PpNewPrinterDialog *dialog)
   /* GCancellable for cancelling of async operations */
   priv->cancellable = g_cancellable_new ();
 
+  priv->host_search = pp_host_search_new ();
+  g_signal_connect (priv->host_search, "devices-found", G_CALLBACK (host_search_devices_found_cb), dialog);
+  g_signal_connect (priv->host_search, "finished", G_CALLBACK (host_search_finished_cb), dialog);
+
   /* Construct dialog */
   priv->dialog = WID ("dialog");
 
@@ -522,6 +535,9 @@ pp_new_printer_dialog_init (PpNewPrinterDialog *dialog)
 
   priv->filter = GTK_TREE_MODEL_FILTER (gtk_builder_get_object (priv->builder, "devices-model-filter"));
 
+  priv->device_index = pp_device_index_new ();
+  priv->stale_devices = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+
   /* Connect signals */
   g_signal_connect (priv->dialog, "response", G_CALLBACK (new_printer_dialog_response_cb), dialog);
 
@@ -564,10 +580,11 @@ pp_new_printer_dialog_finalize (GObject *object)
       priv->host_search_timeout_id = 0;
     }
 
-  if (priv->remote_host_cancellable)
+  if (priv->host_search)
     {
-      g_cancellable_cancel (priv->remote_host_cancellable);
-      g_clear_object (&priv->remote_host_cancellable);
+      g_signal_handlers_disconnect_by_data (priv->host_search, dialog);
+      pp_host_search_stop (priv->host_search);
+      g_clear_object (&priv->host_search);
     }
 
   if (priv->cancellable)
@@ -581,6 +598,9 @@ pp_new_printer_dialog_finalize (GObject *object)
   if (priv->builder)
     g_clear_object (&priv->builder);
 
+  g_clear_pointer (&priv->device_index, pp_device_index_free);
+  g_clear_pointer (&priv->stale_devices, g_hash_table_unref);
+
   g_list_free_full (priv->local_cups_devices, (GDestroyNotify) g_object_unref);
   priv->local_cups_devices = NULL;
 
@@ -654,6 +674,7 @@ remove_device_from_list (PpNewPrinterDialog *dialog,
 
       if (g_strcmp0 (pp_print_device_get_device_name (device), device_name) == 0)
         {
+          pp_device_index_remove (priv->device_index, device);
           gtk_list_store_remove (priv->store, &iter);
           g_object_unref (device);
           break;
@@ -835,11 +856,7 @@ update_dialog_state (PpNewPrinterDialog *dialog)
   gboolean                   searching;
 
   searching = priv->cups_searching ||
-              priv->remote_cups_host != NULL ||
-              priv->snmp_host != NULL ||
-              priv->socket_host != NULL ||
-              priv->lpd_host != NULL ||
-              priv->samba_host != NULL ||
+              pp_host_search_is_searching (priv->host_search) ||
               priv->samba_authenticated_searching ||
               priv->samba_searching;
 
@@ -1007,6 +1024,131 @@ DBus method \"GroupPhysicalDevices\" to group duplicates in device list.");
     g_error_free (error);
 }
 
+static gboolean
+get_device_iter (PpNewPrinterDialog *dialog,
+                 PpPrintDevice      *device,
+                 GtkTreeIter        *iter)
+{
+  PpNewPrinterDialogPrivate *priv = dialog->priv;
+  PpPrintDevice             *store_device;
+  gboolean                   cont;
+
+  cont = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (priv->store), iter);
+  while (cont)
+    {
+      gtk_tree_model_get (GTK_TREE_MODEL (priv->store), iter,
+                          DEVICE_COLUMN, &store_device,
+                          -1);
+      g_object_unref (store_device);
+
+      if (store_device == device)
+        return TRUE;
+
+      cont = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->store), iter);
+    }
+
+  return FALSE;
+}
+
+static PpPrintDevice *
+get_stale_device (PpNewPrinterDialog *dialog,
+                  const gchar        *device_uri)
+{
+  PpNewPrinterDialogPrivate *priv = dialog->priv;
+  GHashTableIter             iter;
+  gpointer                   device;
+
+  if (device_uri == NULL)
+    return NULL;
+
+  g_hash_table_iter_init (&iter, priv->stale_devices);
+  while (g_hash_table_iter_next (&iter, &device, NULL))
+    if (g_strcmp0 (pp_print_device_get_device_uri (device), device_uri) == 0)
+      return device;
+
+  return NULL;
+}
+
+/*
+ * Takes the devices the backends found again out of @devices, and
+ * refreshes the cached ones shown for them in place instead.
+ */
+static GList *
+reconcile_cups_devices (PpNewPrinterDialog *dialog,
+                        GList              *devices)
+{
+  PpNewPrinterDialogPrivate *priv = dialog->priv;
+  PpPrintDevice             *stale_device;
+  PpPrintDevice             *device;
+  GtkTreeIter                iter;
+  GList                     *liter;
+  GList                     *next;
+
+  for (liter = devices; liter != NULL; liter = next)
+    {
+      device = (PpPrintDevice *) liter->data;
+      next = liter->next;
+
+      if (g_hash_table_contains (priv->stale_devices, device))
+        continue;
+
+      stale_device = get_stale_device (dialog, pp_print_device_get_device_uri (device));
+      if (stale_device == NULL)
+        continue;
+
+      g_object_ref (stale_device);
+      g_hash_table_remove (priv->stale_devices, stale_device);
+
+      g_object_set (stale_device,
+                    "device-id", pp_print_device_get_device_id (device),
+                    "device-info", pp_print_device_get_device_info (device),
+                    "device-make-and-model", pp_print_device_get_device_make_and_model (device),
+                    "device-location", pp_print_device_get_device_location (device),
+                    "is-network-device", pp_print_device_is_network_device (device),
+                    NULL);
+
+      if (get_device_iter (dialog, stale_device, &iter))
+        set_device (dialog, stale_device, &iter);
+
+      g_object_unref (stale_device);
+
+      g_object_unref (device);
+      devices = g_list_delete_link (devices, liter);
+    }
+
+  return devices;
+}
+
+/* Removes the cached devices which the backends didn't find again */
+static void
+remove_stale_devices (PpNewPrinterDialog *dialog)
+{
+  PpNewPrinterDialogPrivate *priv = dialog->priv;
+  GHashTableIter             hash_iter;
+  GtkTreeIter                iter;
+  gpointer                   device;
+  GList                     *link;
+
+  g_hash_table_iter_init (&hash_iter, priv->stale_devices);
+  while (g_hash_table_iter_next (&hash_iter, &device, NULL))
+    {
+      if (get_device_iter (dialog, device, &iter))
+        {
+          pp_device_index_remove (priv->device_index, device);
+          gtk_list_store_remove (priv->store, &iter);
+        }
+
+      link = g_list_find (priv->local_cups_devices, device);
+      if (link != NULL)
+        {
+          priv->local_cups_devices = g_list_delete_link (priv->local_cups_devices, link);
+          g_object_unref (device);
+        }
+    }
+
+  g_hash_table_remove_all (priv->stale_devices);
+}
+
 static void
 get_cups_devices_cb (GList    *devices,
                      gboolean  finished,
@@ -1034,9 +1176,12 @@ get_cups_devices_cb (GList    *devices,
       dialog = (PpNewPrinterDialog *) user_data;
       priv = dialog->priv;
 
+      devices = reconcile_cups_devices (dialog, devices);
+
       if (finished)
         {
           priv->cups_searching = FALSE;
+          remove_stale_devices (dialog);
         }
 
       if (devices)
@@ -1162,150 +1307,6 @@ get_cups_devices_cb (GList    *devices,
   g_list_free_full (devices, (GDestroyNotify) g_object_unref);
 }
 
-static void
-get_snmp_devices_cb (GObject      *source_object,
-                     GAsyncResult *res,
-                     gpointer      user_data)
-{
-  PpNewPrinterDialog        *dialog;
-  PpNewPrinterDialogPrivate *priv;
-  PpHost                    *host = (PpHost *) source_object;
-  GError                    *error = NULL;
-  PpDevicesList             *result;
-
-  result = pp_host_get_snmp_devices_finish (host, res, &error);
-  g_object_unref (source_object);
-
-  if (result)
-    {
-      dialog = PP_NEW_PRINTER_DIALOG (user_data);
-      priv = dialog->priv;
-
-      if ((gpointer) source_object == (gpointer) priv->snmp_host)
-        priv->snmp_host = NULL;
-
-      add_devices_to_list (dialog, result->devices);
-
-      update_dialog_state (dialog);
-
-      pp_devices_list_free (result);
-    }
-  else
-    {
-      if (error->domain != G_IO_ERROR ||
-          error->code != G_IO_ERROR_CANCELLED)
-        {
-          dialog = PP_NEW_PRINTER_DIALOG (user_data);
-          priv = dialog->priv;
-
-          g_warning ("%s", error->message);
-
-          if ((gpointer) source_object == (gpointer) priv->snmp_host)
-            priv->snmp_host = NULL;
-
-          update_dialog_state (dialog);
-        }
-
-      g_error_free (error);
-    }
-}
-
-static void
-get_remote_cups_devices_cb (GObject      *source_object,
-                            GAsyncResult *res,
-                            gpointer      user_data)
-{
-  PpNewPrinterDialog        *dialog;
-  PpNewPrinterDialogPrivate *priv;
-  PpHost                    *host = (PpHost *) source_object;
-  GError                    *error = NULL;
-  PpDevicesList             *result;
-
-  result = pp_host_get_remote_cups_devices_finish (host, res, &error);
-  g_object_unref (source_object);
-
-  if (result)
-    {
-      dialog = PP_NEW_PRINTER_DIALOG (user_data);
-      priv = dialog->priv;
-
-      if ((gpointer) source_object == (gpointer) priv->remote_cups_host)
-        priv->remote_cups_host = NULL;
-
-      add_devices_to_list (dialog, result->devices);
-
-      update_dialog_state (dialog);
-
-      pp_devices_list_free (result);
-    }
-  else
-    {
-      if (error->domain != G_IO_ERROR ||
-          error->code != G_IO_ERROR_CANCELLED)
-        {
-          dialog = PP_NEW_PRINTER_DIALOG (user_data);
-          priv = dialog->priv;
-
-          g_warning ("%s", error->message);
-
-          if ((gpointer) source_object == (gpointer) priv->remote_cups_host)
-            priv->remote_cups_host = NULL;
-
-          update_dialog_state (dialog);
-        }
-
-      g_error_free (error);
-    }
-}
-
-static void
-get_samba_host_devices_cb (GObject      *source_object,
-                           GAsyncResult *res,
-                           gpointer      user_data)
-{
-  PpNewPrinterDialogPrivate *priv;
-  PpNewPrinterDialog        *dialog;
-  PpDevicesList             *result;
-  PpSamba                   *samba = (PpSamba *) source_object;
-  GError                    *error = NULL;
-
-  result = pp_samba_get_devices_finish (samba, res, &error);
-  g_object_unref (source_object);
-
-  if (result)
-    {
-      dialog = PP_NEW_PRINTER_DIALOG (user_data);
-      priv = dialog->priv;
-
-      if ((gpointer) source_object == (gpointer) priv->samba_host)
-        priv->samba_host = NULL;
-
-      add_devices_to_list (dialog, result->devices);
-
-      update_dialog_state (dialog);
-
-      pp_devices_list_free (result);
-    }
-  else
-    {
-      if (error->domain != G_IO_ERROR ||
-          error->code != G_IO_ERROR_CANCELLED)
-        {
-          dialog = PP_NEW_PRINTER_DIALOG (user_data);
-          priv = dialog->priv;
-
-          g_warning ("%s", error->message);
-
-          if ((gpointer) source_object == (gpointer) priv->samba_host)
-            priv->samba_host = NULL;
-
-          update_dialog_state (dialog);
-        }
-
-      g_error_free (error);
-    }
-}
-
 static void
 get_samba_devices_cb (GObject      *source_object,
                       GAsyncResult *res,
@@ -1353,107 +1354,43 @@ get_samba_devices_cb (GObject      *source_object,
 }
 
 static void
-get_jetdirect_devices_cb (GObject      *source_object,
-                          GAsyncResult *res,
-                          gpointer      user_data)
+host_search_devices_found_cb (PpHostSearch *search,
+                              GList        *devices,
+                              gpointer      user_data)
 {
-  PpNewPrinterDialog        *dialog;
-  PpNewPrinterDialogPrivate *priv;
-  PpHost                    *host = (PpHost *) source_object;
-  GError                    *error = NULL;
-  PpDevicesList             *result;
-
-  result = pp_host_get_jetdirect_devices_finish (host, res, &error);
-  g_object_unref (source_object);
+  PpNewPrinterDialog *dialog = PP_NEW_PRINTER_DIALOG (user_data);
 
-  if (result != NULL)
-    {
-      dialog = PP_NEW_PRINTER_DIALOG (user_data);
-      priv = dialog->priv;
-
-      if ((gpointer) source_object == (gpointer) priv->socket_host)
-        priv->socket_host = NULL;
-
-      add_devices_to_list (dialog, result->devices);
+  add_devices_to_list (dialog, devices);
 
-      update_dialog_state (dialog);
-
-      pp_devices_list_free (result);
-    }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          dialog = PP_NEW_PRINTER_DIALOG (user_data);
-          priv = dialog->priv;
-
-          g_warning ("%s", error->message);
-
-          if ((gpointer) source_object == (gpointer) priv->socket_host)
-            priv->socket_host = NULL;
-
-          update_dialog_state (dialog);
-        }
-
-      g_error_free (error);
-    }
+  update_dialog_state (dialog);
 }
 
 static void
-get_lpd_devices_cb (GObject      *source_object,
-                    GAsyncResult *res,
-                    gpointer      user_data)
+host_search_finished_cb (PpHostSearch *search,
+                         gpointer      user_data)
 {
-  PpNewPrinterDialog        *dialog;
-  PpNewPrinterDialogPrivate *priv;
-  PpHost                    *host = (PpHost *) source_object;
-  GError                    *error = NULL;
-  PpDevicesList             *result;
-
-  result = pp_host_get_lpd_devices_finish (host, res, &error);
-  g_object_unref (source_object);
-
-  if (result != NULL)
-    {
-      dialog = PP_NEW_PRINTER_DIALOG (user_data);
-      priv = dialog->priv;
-
-      if ((gpointer) source_object == (gpointer) priv->lpd_host)
-        priv->lpd_host = NULL;
-
-      add_devices_to_list (dialog, result->devices);
-
-      update_dialog_state (dialog);
-
-      pp_devices_list_free (result);
-    }
-  else
-    {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        {
-          dialog = PP_NEW_PRINTER_DIALOG (user_data);
-          priv = dialog->priv;
-
-          g_warning ("%s", error->message);
-
-          if ((gpointer) source_object == (gpointer) priv->lpd_host)
-            priv->lpd_host = NULL;
-
-          update_dialog_state (dialog);
-        }
-
-      g_error_free (error);
-    }
+  update_dialog_state (PP_NEW_PRINTER_DIALOG (user_data));
 }
 
 static void
 get_cups_devices (PpNewPrinterDialog *dialog)
 {
   PpNewPrinterDialogPrivate *priv = dialog->priv;
+  GList                     *cached;
+  GList                     *iter;
 
   priv->cups_searching = TRUE;
   update_dialog_state (dialog);
 
+  /* Show what the backends found lately until they answer again */
+  cached = pp_devices_cache_lookup (pp_devices_cache_get_default (),
+                                    g_get_real_time () / G_USEC_PER_SEC);
+  for (iter = cached; iter != NULL; iter = iter->next)
+    g_hash_table_add (priv->stale_devices, g_object_ref (iter->data));
+
+  if (cached != NULL)
+    get_cups_devices_cb (cached, FALSE, FALSE, dialog);
+
   get_cups_devices_async (priv->cancellable,
                           get_cups_devices_cb,
                           dialog);
@@ -1532,66 +1469,13 @@ search_for_remote_printers (THostSearchData *data)
 {
   PpNewPrinterDialogPrivate *priv = data->dialog->priv;
 
-  if (priv->remote_host_cancellable != NULL)
-    {
-      g_cancellable_cancel (priv->remote_host_cancellable);
-      g_clear_object (&priv->remote_host_cancellable);
-    }
-
-  priv->remote_host_cancellable = g_cancellable_new ();
-
-  priv->remote_cups_host = pp_host_new (data->host_name);
-  priv->snmp_host = pp_host_new (data->host_name);
-  priv->socket_host = pp_host_new (data->host_name);
-  priv->lpd_host = pp_host_new (data->host_name);
-
-  if (data->host_port != PP_HOST_UNSET_PORT)
-    {
-      g_object_set (priv->remote_cups_host, "port", data->host_port, NULL);
-      g_object_set (priv->snmp_host, "port", data->host_port, NULL);
-
-      /* Accept port different from the default one only if user specifies
-       * scheme (for socket and lpd printers).
-       */
-      if (data->host_scheme != NULL &&
-          g_ascii_strcasecmp (data->host_scheme, "socket") == 0)
-        g_object_set (priv->socket_host, "port", data->host_port, NULL);
-
-      if (data->host_scheme != NULL &&
-          g_ascii_strcasecmp (data->host_scheme, "lpd") == 0)
-        g_object_set (priv->lpd_host, "port", data->host_port, NULL);
-    }
-
-  priv->samba_host = pp_samba_new (data->host_name);
+  pp_host_search_start (priv->host_search,
+                        data->host_scheme,
+                        data->host_name,
+                        data->host_port);
 
   update_dialog_state (data->dialog);
 
-  pp_host_get_remote_cups_devices_async (priv->remote_cups_host,
-                                         priv->remote_host_cancellable,
-                                         get_remote_cups_devices_cb,
-                                         data->dialog);
-
-  pp_host_get_snmp_devices_async (priv->snmp_host,
-                                  priv->remote_host_cancellable,
-                                  get_snmp_devices_cb,
-                                  data->dialog);
-
-  pp_host_get_jetdirect_devices_async (priv->socket_host,
-                                       priv->remote_host_cancellable,
-                                       get_jetdirect_devices_cb,
-                                       data->dialog);
-
-  pp_host_get_lpd_devices_async (priv->lpd_host,
-                                 priv->remote_host_cancellable,
-                                 get_lpd_devices_cb,
-                                 data->dialog);
-
-  pp_samba_get_devices_async (priv->samba_host,
-                              TRUE,
-                              priv->remote_host_cancellable,
-                              get_samba_host_devices_cb,
-                              data->dialog);
-
   priv->host_search_timeout_id = 0;
 
   return G_SOURCE_REMOVE;
@@ -1605,63 +1489,27 @@ search_address (const gchar        *text,
   PpNewPrinterDialogPrivate  *priv = dialog->priv;
   PpPrintDevice              *device;
   GtkTreeIter                 iter;
-  gboolean                    found = FALSE;
-  gboolean                    subfound;
+  gboolean                    found;
+  gboolean                    filtered;
+  gboolean                    changed;
   gboolean                    next_set;
   gboolean                    cont;
-  gchar                      *lowercase_name;
-  gchar                      *lowercase_location;
-  gchar                      *lowercase_text;
-  gchar                     **words;
   gint                        words_length = 0;
   gint                        i;
   gint                        acquisition_method;
 
-  lowercase_text = g_ascii_strdown (text, -1);
-  words = g_strsplit_set (lowercase_text, " ", -1);
-  g_free (lowercase_text);
-
-  if (words)
+  /* Counted the way the words of the search used to be split */
+  if (text != NULL && text[0] != '\0')
     {
-      words_length = g_strv_length (words);
-
-      cont = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (priv->store), &iter);
-      while (cont)
-        {
-          gtk_tree_model_get (GTK_TREE_MODEL (priv->store), &iter,
-                              DEVICE_COLUMN, &device,
-                              -1);
-
-          lowercase_name = g_ascii_strdown (pp_print_device_get_device_name (device), -1);
-          if (pp_print_device_get_device_location (device))
-            lowercase_location = g_ascii_strdown (pp_print_device_get_device_location (device), -1);
-          else
-            lowercase_location = NULL;
-
-          subfound = TRUE;
-          for (i = 0; words[i]; i++)
-            {
-              if (!g_strrstr (lowercase_name, words[i]) &&
-                  (!lowercase_location || !g_strrstr (lowercase_location, words[i])))
-                subfound = FALSE;
-            }
-
-          if (subfound)
-            found = TRUE;
-
-          gtk_list_store_set (GTK_LIST_STORE (priv->store), &iter,
-                              DEVICE_VISIBLE_COLUMN, subfound,
-                              -1);
-
-          g_free (lowercase_location);
-          g_free (lowercase_name);
-          g_object_unref (device);
-
-          cont = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->store), &iter);
-        }
+      words_length = 1;
+      for (i = 0; text[i] != '\0'; i++)
+        if (text[i] == ' ')
+          words_length++;
+    }
 
-      g_strfreev (words);
-  }
+  filtered = pp_device_index_has_query (priv->device_index);
+  changed = pp_device_index_set_query (priv->device_index, text);
+  found = pp_device_index_get_n_matches (priv->device_index) > 0;
 
   /*
    * The given word is probably an address since it was not found among
@@ -1677,28 +1525,35 @@ search_address (const gchar        *text,
                               DEVICE_COLUMN, &device,
                               -1);
 
-          gtk_list_store_set (GTK_LIST_STORE (priv->store), &iter,
-                              DEVICE_VISIBLE_COLUMN, TRUE,
-                              -1);
-
           acquisition_method = pp_print_device_get_acquisition_method (device);
-          g_object_unref (device);
           if (acquisition_method == ACQUISITION_METHOD_REMOTE_CUPS_SERVER ||
               acquisition_method == ACQUISITION_METHOD_SNMP ||
               acquisition_method == ACQUISITION_METHOD_JETDIRECT ||
               acquisition_method == ACQUISITION_METHOD_LPD ||
               acquisition_method == ACQUISITION_METHOD_SAMBA_HOST)
             {
+              pp_device_index_remove (priv->device_index, device);
+              g_object_unref (device);
               if (!gtk_list_store_remove (priv->store, &iter))
                 break;
               else
                 next_set = TRUE;
             }
+          else
+            {
+              g_object_unref (device);
+            }
 
           if (!next_set)
             cont = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->store), &iter);
         }
 
+      /* Show the devices of the host next to all the others. They
+       * were only hidden if the previous query matched some. */
+      pp_device_index_set_query (priv->device_index, NULL);
+      if (filtered)
+        gtk_tree_model_filter_refilter (priv->filter);
+
       if (text && text[0] != '\0')
         {
           gchar *scheme = NULL;
@@ -1739,6 +1594,10 @@ search_address (const gchar        *text,
             }
         }
     }
+  else if (changed)
+    {
+      gtk_tree_model_filter_refilter (priv->filter);
+    }
 }
 
 static void
@@ -1795,6 +1654,33 @@ get_local_scheme_description_from_uri (gchar *device_uri)
   return description;
 }
 
+/* Makes the search see @device in place of the one in @iter */
+static void
+index_device (PpNewPrinterDialog *dialog,
+              PpPrintDevice      *device,
+              GtkTreeIter        *iter)
+{
+  PpNewPrinterDialogPrivate *priv = dialog->priv;
+  PpPrintDevice             *old_device;
+
+  if (iter != NULL)
+    {
+      gtk_tree_model_get (GTK_TREE_MODEL (priv->store), iter,
+                          DEVICE_COLUMN, &old_device,
+                          -1);
+
+      if (old_device != NULL && old_device != device)
+        pp_device_index_remove (priv->device_index, old_device);
+
+      g_clear_object (&old_device);
+    }
+
+  pp_device_index_add (priv->device_index,
+                       device,
+                       pp_print_device_get_device_name (device),
+                       pp_print_device_get_device_location (device));
+}
+
 static void
 set_device (PpNewPrinterDialog *dialog,
             PpPrintDevice      *device,
@@ -1834,6 +1720,8 @@ set_device (PpNewPrinterDialog *dialog,
                 }
             }
 
+          index_device (dialog, device, iter);
+
           if (iter == NULL)
             gtk_list_store_append (priv->store, &titer);
 
@@ -1842,7 +1730,6 @@ set_device (PpNewPrinterDialog *dialog,
                               DEVICE_NAME_COLUMN, pp_print_device_get_device_name (device),
                               DEVICE_DISPLAY_NAME_COLUMN, pp_print_device_get_display_name (device),
                               DEVICE_DESCRIPTION_COLUMN, description,
-                              DEVICE_VISIBLE_COLUMN, TRUE,
                               DEVICE_COLUMN, device,
                               -1);
 
@@ -1851,6 +1738,8 @@ set_device (PpNewPrinterDialog *dialog,
       else if (pp_print_device_is_authenticated_server (device) &&
                pp_print_device_get_host_name (device) != NULL)
         {
+          index_device (dialog, device, iter);
+
           if (iter == NULL)
             gtk_list_store_append (priv->store, &titer);
 
@@ -1861,7 +1750,6 @@ set_device (PpNewPrinterDialog *dialog,
                               /* Translators: This item is a server which needs authentication to show its printers */
                               DEVICE_DESCRIPTION_COLUMN, _("Server requires authentication"),
                               SERVER_NEEDS_AUTHENTICATION_COLUMN, TRUE,
-                              DEVICE_VISIBLE_COLUMN, TRUE,
                               DEVICE_COLUMN, device,
                               -1);
         }
@@ -1962,6 +1850,7 @@ cell_data_func (GtkTreeViewColumn  *tree_column,
 {
   PpNewPrinterDialog        *dialog = (PpNewPrinterDialog *) user_data;
   PpNewPrinterDialogPrivate *priv = dialog->priv;
+  PpPrintDevice             *device = NULL;
   gboolean                   selected = FALSE;
   gchar                     *name = NULL;
   gchar                     *description = NULL;
@@ -1972,8 +1861,14 @@ cell_data_func (GtkTreeViewColumn  *tree_column,
   gtk_tree_model_get (tree_model, iter,
                       DEVICE_DISPLAY_NAME_COLUMN, &name,
                       DEVICE_DESCRIPTION_COLUMN, &description,
+                      DEVICE_COLUMN, &device,
                       -1);
 
+  /* Cached devices are dimmed until found again */
+  g_object_set (G_OBJECT (cell),
+                "sensitive", device == NULL || !g_hash_table_contains (priv->stale_devices, device),
+                NULL);
+
   if (name != NULL)
     {
       if (description != NULL)
@@ -2000,10 +1895,35 @@ cell_data_func (GtkTreeViewColumn  *tree_column,
       g_free (text);
     }
 
+  g_clear_object (&device);
   g_free (name);
   g_free (description);
 }
 
+static gboolean
+device_visible_func (GtkTreeModel *model,
+                     GtkTreeIter  *iter,
+                     gpointer      user_data)
+{
+  PpNewPrinterDialog        *dialog = (PpNewPrinterDialog *) user_data;
+  PpNewPrinterDialogPrivate *priv = dialog->priv;
+  PpPrintDevice             *device;
+  gboolean                   visible;
+
+  gtk_tree_model_get (model, iter,
+                      DEVICE_COLUMN, &device,
+                      -1);
+
+  /* Rows get their device right after being appended */
+  if (device == NULL)
+    return FALSE;
+
+  visible = pp_device_index_matches (priv->device_index, device);
+  g_object_unref (device);
+
+  return visible;
+}
+
 static void
 populate_devices_list (PpNewPrinterDialog *dialog)
 {
@@ -2051,7 +1971,7 @@ populate_devices_list (PpNewPrinterDialog *dialog)
                                            dialog, NULL);
   gtk_tree_view_append_column (priv->treeview, column);
 
-  gtk_tree_model_filter_set_visible_column (priv->filter, DEVICE_VISIBLE_COLUMN);
+  gtk_tree_model_filter_set_visible_func (priv->filter, device_visible_func, dialog, NULL);
 
   cups = pp_cups_new ();
   pp_cups_get_dests_async (cups, priv->cancellable, cups_get_dests_cb, dialog);
@@ -24,6 +24,7 @@
 #include <glib/gi18n.h>
 
 #include "pp-utils.h"
+#include "pp-ppd-index.h"
 #include "pp-maintenance-command.h"
 
 #define PACKAGE_KIT_BUS "org.freedesktop.PackageKit"
@@ -1346,6 +1347,25 @@ printer_configure_async (PpNewPrinter *new_printer)
                          ime_data);
 }
 
+static gchar *
+get_ppd_name_from_index (const gchar *device_id)
+{
+  PpPPDIndex  *index;
+  PPDName    **names;
+  gchar       *result = NULL;
+
+  index = pp_ppd_index_get_default ();
+  if (index == NULL)
+    return NULL;
+
+  names = pp_ppd_index_lookup (index, device_id, 1);
+  if (names && names[0]->ppd_match_level >= PPD_EXACT_MATCH)
+    result = g_strdup (names[0]->ppd_name);
+  ppd_names_free (names);
+
+  return result;
+}
+
 static void
 _pp_new_printer_add_async (GSimpleAsyncResult *res,
                            GObject            *object,
@@ -1362,6 +1382,12 @@ _pp_new_printer_add_async (GSimpleAsyncResult *res,
       /* We have everything we need */
       printer_add_real_async (printer);
     }
+  else if (priv->device_id &&
+           (priv->ppd_name = get_ppd_name_from_index (priv->device_id)))
+    {
+      /* The cached catalog has a driver made for this model */
+      printer_add_real_async (printer);
+    }
   else if (priv->device_id)
     {
       GDBusConnection *bus;
@@ -0,0 +1,105 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+
+#include "pp-normalize.h"
+
+/*
+ * Normalizes the first @length bytes of @input_string (all of it if
+ * @length is negative) like normalize() does, into @buffer. The result
+ * is truncated if it doesn't fit in @size bytes.
+ */
+const gchar *
+normalize_into (const gchar *input_string,
+                gssize       length,
+                gchar       *buffer,
+                gsize        size)
+{
+  const gchar *start;
+  const gchar *end;
+  gsize        j = 0;
+
+  g_return_val_if_fail (input_string != NULL, NULL);
+  g_return_val_if_fail (buffer != NULL && size > 0, NULL);
+
+  if (length < 0)
+    length = strlen (input_string);
+
+  start = input_string;
+  end = input_string + length;
+
+  while (start < end && g_ascii_isspace (*start))
+    start++;
+  while (end > start && g_ascii_isspace (end[-1]))
+    end--;
+
+  /* Each character takes at most two bytes, see below */
+  for (; start < end && j + 2 < size; start++)
+    {
+      gchar c = g_ascii_tolower (*start);
+      gchar last = j > 0 ? buffer[j - 1] : '\0';
+
+      if ((g_ascii_isalpha (c) && g_ascii_isdigit (last)) ||
+          (g_ascii_isdigit (c) && g_ascii_isalpha (last)))
+        {
+          buffer[j++] = ' ';
+          buffer[j++] = c;
+        }
+      else if (!g_ascii_isalnum (c))
+        {
+          if (j == 0 || last != ' ')
+            buffer[j++] = ' ';
+        }
+      else
+        {
+          buffer[j++] = c;
+        }
+    }
+
+  buffer[j] = '\0';
+
+  return buffer;
+}
+
+/*
+ * FNV-1a from a seed, for the perfect hash of the manufacturers. Its
+ * low bits only depend on the low bits of the seed, so they are mixed
+ * with the rest at the end, like MurmurHash3 does.
+ */
+guint32
+normalized_name_hash (const gchar *normalized_name,
+                      guint32      seed)
+{
+  guint32 hash = 2166136261u ^ seed;
+
+  for (; *normalized_name != '\0'; normalized_name++)
+    {
+      hash ^= (guchar) *normalized_name;
+      hash *= 16777619u;
+    }
+
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+
+  return hash;
+}
@@ -0,0 +1,252 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <locale.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <cups/cups.h>
+
+#include "pp-ppd-catalog.h"
+
+/*
+ * Listing the PPDs makes cupsd run every driver and walk all its PPD
+ * directories, which takes seconds with big driver collections, for
+ * a result which only changes when drivers get installed or removed.
+ *
+ * So the catalog is kept on disk, as a serialized GVariant which is
+ * mapped and read in place, along with a key made of the modification
+ * times of the directories where the drivers get installed. It is only
+ * asked to cupsd again when the key changes.
+ */
+
+#define PPD_CATALOG_MAGIC  0x50504443 /* "PPDC" */
+#define PPD_CATALOG_FORMAT "(usa(ssa(sss)))"
+
+/*
+ * Where drivers install their PPDs, and their PPD generators.
+ * Packages add subdirectories, so these are looked at one level deep.
+ */
+static const gchar *ppd_dirs[] =
+{
+  "/usr/share/cups/model",
+  "/usr/share/cups/drv",
+  "/usr/share/ppd",
+  "/usr/local/share/ppd",
+  "/opt/share/ppd",
+  "/usr/lib/cups/driver",
+  "/usr/libexec/cups/driver",
+};
+
+static gchar *
+get_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-control-center",
+                           "ppds.catalog",
+                           NULL);
+}
+
+static void
+append_dir_stamp (GString     *str,
+                  const gchar *path,
+                  gint         depth)
+{
+  GStatBuf     buf;
+  GPtrArray   *children;
+  const gchar *name;
+  GDir        *dir;
+  guint        i;
+
+  if (g_stat (path, &buf) != 0)
+    return;
+
+  g_string_append_printf (str, ";%s:%" G_GINT64_FORMAT, path, (gint64) buf.st_mtime);
+
+  if (depth <= 0 || !S_ISDIR (buf.st_mode))
+    return;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  children = g_ptr_array_new_with_free_func (g_free);
+  while ((name = g_dir_read_name (dir)) != NULL)
+    g_ptr_array_add (children, g_build_filename (path, name, NULL));
+  g_dir_close (dir);
+
+  /* The order of readdir() is not stable across file systems */
+  g_ptr_array_sort (children, (GCompareFunc) g_strcmp0);
+  for (i = 0; i < children->len; i++)
+    if (g_file_test (children->pdata[i], G_FILE_TEST_IS_DIR))
+      append_dir_stamp (str, children->pdata[i], depth - 1);
+
+  g_ptr_array_unref (children);
+}
+
+/*
+ * Returns the key under which the list of PPDs of the current server
+ * is cached, or NULL when it can't be known, e.g. for remote servers.
+ */
+gchar *
+pp_ppd_catalog_get_key (void)
+{
+  const gchar *server;
+  GString     *str;
+  guint        i;
+
+  server = cupsServer ();
+  if (server == NULL ||
+      !(server[0] == '/' ||
+        g_ascii_strcasecmp (server, "localhost") == 0 ||
+        g_ascii_strncasecmp (server, "localhost:", strlen ("localhost:")) == 0))
+    return NULL;
+
+  /* The models are localized by cupsd */
+  str = g_string_new (setlocale (LC_MESSAGES, NULL));
+  g_string_append_printf (str, ";%s", server);
+
+  for (i = 0; i < G_N_ELEMENTS (ppd_dirs); i++)
+    append_dir_stamp (str, ppd_dirs[i], 1);
+
+  return g_string_free (str, FALSE);
+}
+
+/*
+ * Returns the cached catalog if it was saved under @key, see
+ * PPD_CATALOG_TYPE. Its data is mapped from the cache file.
+ */
+GVariant *
+pp_ppd_catalog_load (const gchar *key)
+{
+  GMappedFile *file;
+  const gchar *file_key;
+  GVariant    *cache;
+  GVariant    *catalog = NULL;
+  GBytes      *bytes;
+  gchar       *path;
+  guint32      magic;
+
+  if (key == NULL)
+    return NULL;
+
+  path = get_cache_path ();
+  file = g_mapped_file_new (path, FALSE, NULL);
+  g_free (path);
+
+  if (file == NULL)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (file);
+  cache = g_variant_new_from_bytes (G_VARIANT_TYPE (PPD_CATALOG_FORMAT), bytes, FALSE);
+  g_variant_ref_sink (cache);
+
+  /* A cache written on a machine of the other endianness
+   * has a swapped magic, and is simply rebuilt */
+  g_variant_get (cache, "(u&s@a(ssa(sss)))", &magic, &file_key, &catalog);
+  if (magic != PPD_CATALOG_MAGIC || g_strcmp0 (file_key, key) != 0)
+    g_clear_pointer (&catalog, g_variant_unref);
+
+  g_variant_unref (cache);
+  g_bytes_unref (bytes);
+  g_mapped_file_unref (file);
+
+  return catalog;
+}
+
+void
+pp_ppd_catalog_save (const gchar *key,
+                     GVariant    *catalog)
+{
+  GVariant *cache;
+  GError   *error = NULL;
+  gchar    *path;
+  gchar    *dir;
+
+  g_return_if_fail (key != NULL);
+  g_return_if_fail (g_variant_is_of_type (catalog, PPD_CATALOG_TYPE));
+
+  cache = g_variant_new ("(us@a(ssa(sss)))", PPD_CATALOG_MAGIC, key, catalog);
+  g_variant_ref_sink (cache);
+
+  path = get_cache_path ();
+  dir = g_path_get_dirname (path);
+  g_mkdir_with_parents (dir, USER_DIR_MODE);
+
+  if (!g_file_set_contents (path,
+                            g_variant_get_data (cache),
+                            g_variant_get_size (cache),
+                            &error))
+    {
+      g_debug ("Could not save the list of PPDs: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (dir);
+  g_free (path);
+  g_variant_unref (cache);
+}
+
+PPDList *
+pp_ppd_catalog_to_ppd_list (GVariant *catalog)
+{
+  PPDList *result;
+  gsize    i, j;
+
+  g_return_val_if_fail (g_variant_is_of_type (catalog, PPD_CATALOG_TYPE), NULL);
+
+  result = g_new0 (PPDList, 1);
+  result->num_of_manufacturers = g_variant_n_children (catalog);
+  result->manufacturers = g_new0 (PPDManufacturerItem *, result->num_of_manufacturers);
+
+  for (i = 0; i < result->num_of_manufacturers; i++)
+    {
+      PPDManufacturerItem *manufacturer;
+      const gchar         *name;
+      const gchar         *display_name;
+      GVariant            *ppds;
+
+      g_variant_get_child (catalog, i, "(&s&s@a(sss))", &name, &display_name, &ppds);
+
+      manufacturer = g_new0 (PPDManufacturerItem, 1);
+      manufacturer->manufacturer_name = g_strdup (name);
+      manufacturer->manufacturer_display_name = g_strdup (display_name);
+      manufacturer->num_of_ppds = g_variant_n_children (ppds);
+      manufacturer->ppds = g_new0 (PPDName *, manufacturer->num_of_ppds);
+
+      for (j = 0; j < manufacturer->num_of_ppds; j++)
+        {
+          const gchar *ppd_name;
+          const gchar *model;
+
+          g_variant_get_child (ppds, j, "(&s&s&s)", &ppd_name, &model, NULL);
+
+          manufacturer->ppds[j] = g_new0 (PPDName, 1);
+          manufacturer->ppds[j]->ppd_name = g_strdup (ppd_name);
+          manufacturer->ppds[j]->ppd_display_name = g_strdup (model);
+          manufacturer->ppds[j]->ppd_match_level = -1;
+        }
+
+      result->manufacturers[i] = manufacturer;
+      g_variant_unref (ppds);
+    }
+
+  return result;
+}
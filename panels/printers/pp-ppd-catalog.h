@@ -0,0 +1,49 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __PP_PPD_CATALOG_H__
+#define __PP_PPD_CATALOG_H__
+
+#include <glib.h>
+
+#include "pp-utils.h"
+
+G_BEGIN_DECLS
+
+/*
+ * The PPDs known to cupsd, as returned by CUPS_GET_PPDS, grouped by
+ * manufacturer. Manufacturers are sorted by their normalized name,
+ * and each of them is:
+ *
+ *   (normalized name, display name, [(ppd-name, model, ppd-device-id)])
+ */
+#define PPD_CATALOG_TYPE G_VARIANT_TYPE ("a(ssa(sss))")
+
+gchar      *pp_ppd_catalog_get_key      (void);
+
+GVariant   *pp_ppd_catalog_load         (const gchar *key);
+
+void        pp_ppd_catalog_save         (const gchar *key,
+                                         GVariant    *catalog);
+
+PPDList    *pp_ppd_catalog_to_ppd_list  (GVariant    *catalog);
+
+G_END_DECLS
+
+#endif /* __PP_PPD_CATALOG_H__ */
@@ -0,0 +1,678 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "pp-ppd-index.h"
+#include "pp-ppd-catalog.h"
+#include "pp-normalize.h"
+
+/*
+ * Finds the drivers for a device in the PPD catalog, from its IEEE 1284
+ * device ID, the way system-config-printer's GetBestDrivers does:
+ *
+ *  - PPD_EXACT_CMD_MATCH: the device IDs have the same manufacturer and
+ *    model, and the device speaks all the languages the PPD lists in CMD
+ *  - PPD_EXACT_MATCH: the device IDs have the same manufacturer and model
+ *  - PPD_CLOSE_MATCH: same manufacturer, and the models have the longest
+ *    common words, which have to include a number, e.g. the same series
+ *  - PPD_GENERIC_MATCH: a generic PPD for a language the device speaks
+ *
+ * Manufacturers and models are compared normalized, with the aliases of
+ * the manufacturers merged, and the manufacturer left out of the model.
+ * Exact matches are a hash table lookup, and close matches a binary
+ * search in the sorted models of the manufacturer.
+ */
+
+#define GENERIC_MANUFACTURER "generic"
+
+typedef struct
+{
+  const gchar  *ppd_name;
+  const gchar  *model;
+  gchar       **cmd;
+  gboolean      recommended;
+} PPDEntry;
+
+typedef struct
+{
+  const gchar *key;
+  guint        entry;
+} ModelKey;
+
+struct _PpPPDIndex
+{
+  GVariant     *catalog;
+  GArray       *entries;
+  GStringChunk *strings;
+
+  /* "manufacturer\tmodel" of the device IDs -> array of entry indexes */
+  GHashTable   *exact;
+
+  /* manufacturer -> array of ModelKey, sorted by key */
+  GHashTable   *models;
+
+  /* array of ModelKey, keyed by the normalized model of the generic PPDs */
+  GArray       *generic;
+};
+
+static void
+ppd_entry_clear (PPDEntry *entry)
+{
+  g_strfreev (entry->cmd);
+}
+
+static gboolean
+parse_device_id (const gchar   *device_id,
+                 gchar        **mfg,
+                 gchar        **mdl,
+                 gchar       ***cmd)
+{
+  gchar **fields;
+  guint   i;
+
+  *mfg = NULL;
+  *mdl = NULL;
+  *cmd = NULL;
+
+  if (device_id == NULL)
+    return FALSE;
+
+  fields = g_strsplit (device_id, ";", -1);
+  for (i = 0; fields[i] != NULL; i++)
+    {
+      gchar *value;
+      gchar *key;
+
+      key = g_strstrip (fields[i]);
+      value = strchr (key, ':');
+      if (value == NULL)
+        continue;
+
+      *value++ = '\0';
+      g_strstrip (key);
+      g_strstrip (value);
+
+      if (*value == '\0')
+        continue;
+
+      if (*mfg == NULL &&
+          (g_ascii_strcasecmp (key, "MFG") == 0 ||
+           g_ascii_strcasecmp (key, "MANUFACTURER") == 0))
+        *mfg = g_strdup (value);
+      else if (*mdl == NULL &&
+               (g_ascii_strcasecmp (key, "MDL") == 0 ||
+                g_ascii_strcasecmp (key, "MODEL") == 0))
+        *mdl = g_strdup (value);
+      else if (*cmd == NULL &&
+               (g_ascii_strcasecmp (key, "CMD") == 0 ||
+                g_ascii_strcasecmp (key, "COMMAND SET") == 0))
+        {
+          gchar *upper;
+          guint  j;
+
+          upper = g_ascii_strup (value, -1);
+          *cmd = g_strsplit (upper, ",", -1);
+          for (j = 0; (*cmd)[j] != NULL; j++)
+            g_strstrip ((*cmd)[j]);
+          g_free (upper);
+        }
+    }
+  g_strfreev (fields);
+
+  return *mfg != NULL && *mdl != NULL;
+}
+
+/* "HP", "hp" and "Hewlett-Packard" are all "hewlett packard" */
+static gchar *
+canonical_manufacturer (const gchar *mfg)
+{
+  const gchar *canonical = NULL;
+  gchar        normalized[NORMALIZED_NAME_SIZE];
+
+  normalize_into (mfg, -1, normalized, sizeof (normalized));
+  if (lookup_standard_manufacturer (normalized, &canonical) == NULL)
+    canonical = normalized;
+
+  return g_strchomp (g_strdup (canonical));
+}
+
+/* The normalized model, without the manufacturer it often starts with */
+static gchar *
+model_key (const gchar *mfg,
+           const gchar *mdl)
+{
+  const gchar *space;
+  gchar       *key;
+  guint        words;
+
+  key = g_strchomp (normalize (mdl));
+
+  /* The manufacturer can be two words, e.g. "hewlett packard" */
+  for (space = strchr (key, ' '), words = 0;
+       space != NULL && words < 2;
+       space = strchr (space + 1, ' '), words++)
+    {
+      gchar    *prefix;
+      gchar    *canonical;
+      gboolean  found;
+
+      prefix = g_strndup (key, space - key);
+      canonical = canonical_manufacturer (prefix);
+      found = g_str_equal (canonical, mfg);
+      g_free (canonical);
+      g_free (prefix);
+
+      if (found)
+        {
+          gchar *stripped = g_strdup (space + 1);
+
+          g_free (key);
+          return stripped;
+        }
+    }
+
+  return key;
+}
+
+static void
+add_index (GHashTable  *table,
+           const gchar *key,
+           guint        entry)
+{
+  GArray *array;
+
+  array = g_hash_table_lookup (table, key);
+  if (array == NULL)
+    {
+      array = g_array_new (FALSE, FALSE, sizeof (guint));
+      g_hash_table_insert (table, g_strdup (key), array);
+    }
+
+  g_array_append_val (array, entry);
+}
+
+static void
+add_model (PpPPDIndex  *index,
+           const gchar *mfg,
+           const gchar *key,
+           guint        entry)
+{
+  ModelKey  model;
+  GArray   *array;
+
+  array = g_hash_table_lookup (index->models, mfg);
+  if (array == NULL)
+    {
+      array = g_array_new (FALSE, FALSE, sizeof (ModelKey));
+      g_hash_table_insert (index->models, g_strdup (mfg), array);
+    }
+
+  model.key = g_string_chunk_insert_const (index->strings, key);
+  model.entry = entry;
+  g_array_append_val (array, model);
+}
+
+static gint
+compare_model_keys (gconstpointer a,
+                    gconstpointer b)
+{
+  return strcmp (((const ModelKey *) a)->key, ((const ModelKey *) b)->key);
+}
+
+PpPPDIndex *
+pp_ppd_index_new (GVariant *catalog)
+{
+  GHashTableIter  iter;
+  PpPPDIndex     *index;
+  gpointer        value;
+  gsize           i, j;
+
+  g_return_val_if_fail (g_variant_is_of_type (catalog, PPD_CATALOG_TYPE), NULL);
+
+  index = g_new0 (PpPPDIndex, 1);
+  index->catalog = g_variant_ref (catalog);
+  index->entries = g_array_new (FALSE, FALSE, sizeof (PPDEntry));
+  g_array_set_clear_func (index->entries, (GDestroyNotify) ppd_entry_clear);
+  index->strings = g_string_chunk_new (4096);
+  index->exact = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free, (GDestroyNotify) g_array_unref);
+  index->models = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, (GDestroyNotify) g_array_unref);
+  index->generic = g_array_new (FALSE, FALSE, sizeof (ModelKey));
+
+  for (i = 0; i < g_variant_n_children (catalog); i++)
+    {
+      const gchar *manufacturer;
+      GVariant    *ppds;
+
+      g_variant_get_child (catalog, i, "(&s&s@a(sss))", &manufacturer, NULL, &ppds);
+
+      for (j = 0; j < g_variant_n_children (ppds); j++)
+        {
+          const gchar *device_id;
+          PPDEntry     entry;
+          gchar       *mfg;
+          gchar       *mdl;
+          gchar       *key;
+          guint        n = index->entries->len;
+
+          g_variant_get_child (ppds, j, "(&s&s&s)", &entry.ppd_name, &entry.model, &device_id);
+          entry.recommended = strstr (entry.model, "(recommended)") != NULL;
+
+          if (parse_device_id (device_id, &mfg, &mdl, &entry.cmd))
+            {
+              gchar *canonical;
+              gchar *exact_key;
+
+              canonical = canonical_manufacturer (mfg);
+              key = model_key (canonical, mdl);
+
+              exact_key = g_strconcat (canonical, "\t", key, NULL);
+              add_index (index->exact, exact_key, n);
+              add_model (index, canonical, key, n);
+
+              g_free (exact_key);
+              g_free (canonical);
+            }
+          else
+            {
+              gchar *canonical;
+
+              /* The catalog only has the make and model */
+              canonical = canonical_manufacturer (manufacturer);
+              key = model_key (canonical, entry.model);
+              add_model (index, canonical, key, n);
+
+              g_free (canonical);
+            }
+
+          if (g_str_equal (manufacturer, GENERIC_MANUFACTURER))
+            {
+              ModelKey  generic;
+              gchar    *model;
+
+              model = normalize (entry.model);
+              generic.key = g_string_chunk_insert_const (index->strings, model);
+              generic.entry = n;
+              g_array_append_val (index->generic, generic);
+
+              g_free (model);
+            }
+
+          g_array_append_val (index->entries, entry);
+
+          g_free (key);
+          g_free (mdl);
+          g_free (mfg);
+        }
+
+      g_variant_unref (ppds);
+    }
+
+  g_hash_table_iter_init (&iter, index->models);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    g_array_sort (value, compare_model_keys);
+
+  return index;
+}
+
+void
+pp_ppd_index_free (PpPPDIndex *index)
+{
+  if (index == NULL)
+    return;
+
+  g_array_unref (index->generic);
+  g_hash_table_destroy (index->models);
+  g_hash_table_destroy (index->exact);
+  g_string_chunk_free (index->strings);
+  g_array_unref (index->entries);
+  g_variant_unref (index->catalog);
+  g_free (index);
+}
+
+/* The default index, and the key of its catalog, see
+ * pp_ppd_catalog_get_key() */
+static PpPPDIndex *default_index = NULL;
+static gchar      *default_key = NULL;
+static gboolean    default_loaded = FALSE;
+
+/*
+ * Returns the index of the catalog cached by get_all_ppds_async(),
+ * or NULL if there is none yet. To be used from the main thread.
+ *
+ * Computing the key of the catalog walks the PPD directories, so it is
+ * only done on the first call; after that the index only changes when
+ * get_all_ppds_async() lists the PPDs again.
+ */
+PpPPDIndex *
+pp_ppd_index_get_default (void)
+{
+  GVariant *catalog;
+  gchar    *key;
+
+  if (default_loaded)
+    return default_index;
+
+  default_loaded = TRUE;
+
+  key = pp_ppd_catalog_get_key ();
+  catalog = pp_ppd_catalog_load (key);
+  if (catalog == NULL)
+    {
+      g_free (key);
+      return NULL;
+    }
+
+  default_index = pp_ppd_index_new (catalog);
+  default_key = key;
+  g_variant_unref (catalog);
+
+  return default_index;
+}
+
+/*
+ * Replaces the default index with one of @catalog, unless it already
+ * indexes the catalog saved under @key. A NULL @key is never the same.
+ * To be used from the main thread.
+ */
+void
+pp_ppd_index_set_default (const gchar *key,
+                          GVariant    *catalog)
+{
+  g_return_if_fail (catalog != NULL);
+
+  default_loaded = TRUE;
+
+  if (key != NULL && default_index != NULL &&
+      g_strcmp0 (key, default_key) == 0)
+    return;
+
+  pp_ppd_index_free (default_index);
+  default_index = pp_ppd_index_new (catalog);
+
+  g_free (default_key);
+  default_key = g_strdup (key);
+}
+
+/* The PPD only lists languages the device speaks */
+static gboolean
+cmd_matches (gchar **ppd_cmd,
+             gchar **device_cmd)
+{
+  guint i, j;
+
+  if (ppd_cmd == NULL || ppd_cmd[0] == NULL || device_cmd == NULL)
+    return FALSE;
+
+  for (i = 0; ppd_cmd[i] != NULL; i++)
+    {
+      gboolean found = FALSE;
+
+      for (j = 0; device_cmd[j] != NULL && !found; j++)
+        found = g_str_equal (ppd_cmd[i], device_cmd[j]);
+
+      if (!found)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+cmd_has (gchar       **cmd,
+         const gchar  *language)
+{
+  guint i;
+
+  for (i = 0; cmd != NULL && cmd[i] != NULL; i++)
+    if (g_str_equal (cmd[i], language))
+      return TRUE;
+
+  return FALSE;
+}
+
+/*
+ * Returns the length of the common words at the start of @a and @b,
+ * and whether they have a number
+ */
+static gsize
+common_words (const gchar *a,
+              const gchar *b,
+              gboolean    *has_number)
+{
+  gsize i, length = 0;
+
+  for (i = 0; a[i] != '\0' && a[i] == b[i]; i++)
+    if (a[i] == ' ')
+      length = i;
+
+  if ((a[i] == '\0' || a[i] == ' ') && (b[i] == '\0' || b[i] == ' '))
+    length = i;
+
+  *has_number = FALSE;
+  for (i = 0; i < length && !*has_number; i++)
+    *has_number = g_ascii_isdigit (a[i]);
+
+  return length;
+}
+
+static void
+add_close_matches (GArray      *models,
+                   const gchar *key,
+                   GArray      *result)
+{
+  ModelKey *keys = (ModelKey *) models->data;
+  gboolean  has_number;
+  gsize     best = 0;
+  guint     low = 0, high = models->len;
+  guint     i;
+
+  /* The longest common prefixes are next to where the key would be */
+  while (low < high)
+    {
+      guint middle = (low + high) / 2;
+
+      if (strcmp (keys[middle].key, key) < 0)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+
+  if (low > 0)
+    best = MAX (best, common_words (keys[low - 1].key, key, &has_number));
+  if (low < models->len)
+    best = MAX (best, common_words (keys[low].key, key, &has_number));
+
+  if (best == 0)
+    return;
+
+  for (i = low; i > 0 && common_words (keys[i - 1].key, key, &has_number) == best; i--)
+    if (has_number)
+      g_array_append_val (result, keys[i - 1].entry);
+
+  for (i = low; i < models->len && common_words (keys[i].key, key, &has_number) == best; i++)
+    if (has_number)
+      g_array_append_val (result, keys[i].entry);
+}
+
+static void
+add_generic_matches (PpPPDIndex  *index,
+                     gchar      **cmd,
+                     GArray      *result)
+{
+  const gchar *language = NULL;
+  guint        i;
+
+  if (cmd_has (cmd, "POSTSCRIPT") || cmd_has (cmd, "POSTSCRIPT3") || cmd_has (cmd, "PS"))
+    language = "postscript";
+  else if (cmd_has (cmd, "PCLXL") || cmd_has (cmd, "PCL6"))
+    language = "pcl 6";
+  else if (cmd_has (cmd, "PCL"))
+    language = "pcl";
+
+  if (language == NULL)
+    return;
+
+  for (i = 0; i < index->generic->len; i++)
+    {
+      ModelKey *generic = &g_array_index (index->generic, ModelKey, i);
+
+      if (strstr (generic->key, language) != NULL)
+        g_array_append_val (result, generic->entry);
+    }
+}
+
+static gint
+compare_entries (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      user_data)
+{
+  PpPPDIndex *index = user_data;
+  guint       index_a = *(const guint *) a;
+  guint       index_b = *(const guint *) b;
+  PPDEntry   *entry_a = &g_array_index (index->entries, PPDEntry, index_a);
+  PPDEntry   *entry_b = &g_array_index (index->entries, PPDEntry, index_b);
+  gsize       length_a, length_b;
+
+  if (entry_a->recommended != entry_b->recommended)
+    return entry_a->recommended ? -1 : 1;
+
+  length_a = strlen (entry_a->model);
+  length_b = strlen (entry_b->model);
+  if (length_a != length_b)
+    return length_a < length_b ? -1 : 1;
+
+  /* Then in the order of the catalog */
+  return (index_a > index_b) - (index_a < index_b);
+}
+
+static void
+append_results (PpPPDIndex *index,
+                GArray     *entries,
+                gint        match_level,
+                GHashTable *seen,
+                GPtrArray  *result,
+                gint        count)
+{
+  guint i;
+
+  g_array_sort_with_data (entries, compare_entries, index);
+
+  for (i = 0; i < entries->len && (count <= 0 || result->len < (guint) count); i++)
+    {
+      guint     entry = g_array_index (entries, guint, i);
+      PPDEntry *ppd = &g_array_index (index->entries, PPDEntry, entry);
+      PPDName  *name;
+
+      if (!g_hash_table_add (seen, GUINT_TO_POINTER (entry)))
+        continue;
+
+      name = g_new0 (PPDName, 1);
+      name->ppd_name = g_strdup (ppd->ppd_name);
+      name->ppd_display_name = g_strdup (ppd->model);
+      name->ppd_match_level = match_level;
+      g_ptr_array_add (result, name);
+    }
+
+  g_array_set_size (entries, 0);
+}
+
+/*
+ * Returns at most @count (all of them if 0) drivers for the device,
+ * best first, as a NULL terminated array, or NULL if there is none.
+ * Free it with ppd_names_free().
+ */
+PPDName **
+pp_ppd_index_lookup (PpPPDIndex  *index,
+                     const gchar *device_id,
+                     gint         count)
+{
+  GHashTable  *seen;
+  GPtrArray   *result;
+  GArray      *entries;
+  GArray      *matches;
+  gchar      **cmd;
+  gchar       *mfg;
+  gchar       *mdl;
+  guint        i;
+
+  g_return_val_if_fail (index != NULL, NULL);
+
+  result = g_ptr_array_new ();
+  seen = g_hash_table_new (NULL, NULL);
+  entries = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  if (parse_device_id (device_id, &mfg, &mdl, &cmd))
+    {
+      gchar *canonical;
+      gchar *exact_key;
+      gchar *key;
+
+      canonical = canonical_manufacturer (mfg);
+      key = model_key (canonical, mdl);
+      exact_key = g_strconcat (canonical, "\t", key, NULL);
+
+      matches = g_hash_table_lookup (index->exact, exact_key);
+      for (i = 0; matches != NULL && i < matches->len; i++)
+        {
+          guint     entry = g_array_index (matches, guint, i);
+          PPDEntry *ppd = &g_array_index (index->entries, PPDEntry, entry);
+
+          if (cmd_matches (ppd->cmd, cmd))
+            g_array_append_val (entries, entry);
+        }
+      append_results (index, entries, PPD_EXACT_CMD_MATCH, seen, result, count);
+
+      for (i = 0; matches != NULL && i < matches->len; i++)
+        g_array_append_val (entries, g_array_index (matches, guint, i));
+      append_results (index, entries, PPD_EXACT_MATCH, seen, result, count);
+
+      matches = g_hash_table_lookup (index->models, canonical);
+      if (matches != NULL)
+        add_close_matches (matches, key, entries);
+      append_results (index, entries, PPD_CLOSE_MATCH, seen, result, count);
+
+      g_free (exact_key);
+      g_free (key);
+      g_free (canonical);
+    }
+
+  add_generic_matches (index, cmd, entries);
+  append_results (index, entries, PPD_GENERIC_MATCH, seen, result, count);
+
+  g_strfreev (cmd);
+  g_free (mdl);
+  g_free (mfg);
+  g_array_unref (entries);
+  g_hash_table_destroy (seen);
+
+  if (result->len == 0)
+    {
+      g_ptr_array_unref (result);
+      return NULL;
+    }
+
+  g_ptr_array_add (result, NULL);
+
+  return (PPDName **) g_ptr_array_free (result, FALSE);
+}
@@ -0,0 +1,46 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2016  Red Hat, Inc,
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __PP_PPD_INDEX_H__
+#define __PP_PPD_INDEX_H__
+
+#include <glib.h>
+
+#include "pp-utils.h"
+
+G_BEGIN_DECLS
+
+typedef struct _PpPPDIndex PpPPDIndex;
+
+PpPPDIndex *pp_ppd_index_new         (GVariant    *catalog);
+
+void        pp_ppd_index_free        (PpPPDIndex  *index);
+
+PpPPDIndex *pp_ppd_index_get_default (void);
+
+void        pp_ppd_index_set_default (const gchar *key,
+                                      GVariant    *catalog);
+
+PPDName   **pp_ppd_index_lookup      (PpPPDIndex  *index,
+                                      const gchar *device_id,
+                                      gint         count);
+
+G_END_DECLS
+
+#endif /* __PP_PPD_INDEX_H__ */
@@ -27,6 +27,11 @@
 #include <cups/ppd.h>
 
 #include "pp-utils.h"
+#include "pp-normalize.h"
+#include "pp-manufacturers-hash.h"
+#include "pp-ppd-catalog.h"
+#include "pp-ppd-index.h"
+#include "pp-devices-cache.h"
 
 #define DBUS_TIMEOUT      120000
 #define DBUS_TIMEOUT_LONG 600000
@@ -101,63 +106,63 @@ get_tag_value (const gchar *tag_string, const gchar *tag_name)
   return tag_value;
 }
 
+/*
+ * Like get_tag_value(), but returns a pointer into @tag_string
+ * and the length of the value, instead of a copy of it.
+ */
+static const gchar *
+find_tag_value (const gchar *tag_string,
+                const gchar *tag_name,
+                gsize       *length)
+{
+  const gchar *field;
+  const gchar *end;
+  const gchar *value = NULL;
+  gsize        tag_name_length;
+
+  tag_name_length = strlen (tag_name);
+
+  for (field = tag_string; ; field = end + 1)
+    {
+      end = strchr (field, ';');
+      if (end == NULL)
+        end = field + strlen (field);
+
+      if ((gsize) (end - field) > tag_name_length + 1 &&
+          g_ascii_strncasecmp (field, tag_name, tag_name_length) == 0)
+        {
+          value = field + tag_name_length + 1;
+          *length = end - value;
+        }
+
+      if (*end == '\0')
+        break;
+    }
+
+  return value;
+}
+
 
 /*
  * Normalize given string so that it is lowercase, doesn't
  * have trailing or leading whitespaces and digits doesn't
  * neighbour with alphabetic.
  * (see cupshelpers/ppds.py from system-config-printer)
+ * normalize_into() does the same without allocating.
  */
-static gchar *
+gchar *
 normalize (const gchar *input_string)
 {
-  gchar *tmp = NULL;
-  gchar *res = NULL;
-  gchar *result = NULL;
-  gint   i, j = 0, k = -1;
-
-  if (input_string)
-    {
-      tmp = g_strstrip (g_ascii_strdown (input_string, -1));
-      if (tmp)
-        {
-          res = g_new (gchar, 2 * strlen (tmp));
-
-          for (i = 0; i < strlen (tmp); i++)
-            {
-              if ((g_ascii_isalpha (tmp[i]) && k >= 0 && g_ascii_isdigit (res[k])) ||
-                  (g_ascii_isdigit (tmp[i]) && k >= 0 && g_ascii_isalpha (res[k])))
-                {
-                  res[j] = ' ';
-                  k = j++;
-                  res[j] = tmp[i];
-                  k = j++;
-                }
-              else
-                {
-                  if (g_ascii_isspace (tmp[i]) || !g_ascii_isalnum (tmp[i]))
-                    {
-                      if (!(k >= 0 && res[k] == ' '))
-                        {
-                          res[j] = ' ';
-                          k = j++;
-                        }
-                    }
-                  else
-                    {
-                      res[j] = tmp[i];
-                      k = j++;
-                    }
-                }
-            }
+  gchar *result;
+  gsize  size;
 
-          res[j] = '\0';
+  if (input_string == NULL)
+    return NULL;
 
-          result = g_strdup (res);
-          g_free (tmp);
-          g_free (res);
-        }
-    }
+  /* A space can be inserted before each character */
+  size = 2 * strlen (input_string) + 1;
+  result = g_new (gchar, size);
+  normalize_into (input_string, -1, result, size);
 
   return result;
 }
@@ -2074,6 +2079,7 @@ get_device_attributes_cb (gchar    *device_id,
                           gpointer  user_data)
 {
   GDBusConnection *bus;
+  PpPPDIndex      *index;
   GError          *error = NULL;
   GPNData         *data = (GPNData *) user_data;
 
@@ -2083,6 +2089,30 @@ get_device_attributes_cb (gchar    *device_id,
   if (!device_id || !device_make_and_model || !device_uri)
     goto out;
 
+  /* Drivers made for this model can be found in the cached catalog */
+  index = pp_ppd_index_get_default ();
+  if (index)
+    {
+      PPDName **names;
+
+      names = pp_ppd_index_lookup (index, device_id, data->count);
+      if (names && names[0]->ppd_match_level >= PPD_EXACT_MATCH)
+        {
+          data->callback (names,
+                          data->printer_name,
+                          FALSE,
+                          data->user_data);
+
+          if (data->cancellable)
+            g_object_unref (data->cancellable);
+          g_free (data->printer_name);
+          g_free (data);
+          return;
+        }
+
+      ppd_names_free (names);
+    }
+
   bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
   if (!bus)
     {
@@ -2522,6 +2552,8 @@ get_ppd_names_async (gchar        *printer_name,
 typedef struct
 {
   PPDList      *result;
+  gchar        *key;
+  GVariant     *catalog;
   GCancellable *cancellable;
   GAPCallback   callback;
   gpointer      user_data;
@@ -2533,6 +2565,10 @@ get_all_ppds_idle_cb (gpointer user_data)
 {
   GAPData *data = (GAPData *) user_data;
 
+  /* The lookups by device ID use the catalog just listed */
+  if (data->catalog)
+    pp_ppd_index_set_default (data->key, data->catalog);
+
   /* Don't call callback if cancelled */
   if (data->cancellable &&
       g_cancellable_is_cancelled (data->cancellable))
@@ -2557,6 +2593,9 @@ get_all_ppds_data_free (gpointer user_data)
     g_main_context_unref (data->context);
   if (data->cancellable)
     g_object_unref (data->cancellable);
+  if (data->catalog)
+    g_variant_unref (data->catalog);
+  g_free (data->key);
   g_free (data);
 }
 
@@ -2575,103 +2614,99 @@ get_all_ppds_cb (gpointer user_data)
   g_source_unref (idle_source);
 }
 
-static const struct {
-  const char *normalized_name;
-  const char *display_name;
-} manufacturers_names[] = {
-  { "alps", "Alps" },
-  { "anitech", "Anitech" },
-  { "apple", "Apple" },
-  { "apollo", "Apollo" },
-  { "brother", "Brother" },
-  { "canon", "Canon" },
-  { "citizen", "Citizen" },
-  { "citoh", "Citoh" },
-  { "compaq", "Compaq" },
-  { "dec", "DEC" },
-  { "dell", "Dell" },
-  { "dnp", "DNP" },
-  { "dymo", "Dymo" },
-  { "epson", "Epson" },
-  { "fujifilm", "Fujifilm" },
-  { "fujitsu", "Fujitsu" },
-  { "gelsprinter", "Ricoh" },
-  { "generic", "Generic" },
-  { "genicom", "Genicom" },
-  { "gestetner", "Gestetner" },
-  { "hewlett packard", "Hewlett-Packard" },
-  { "heidelberg", "Heidelberg" },
-  { "hitachi", "Hitachi" },
-  { "hp", "Hewlett-Packard" },
-  { "ibm", "IBM" },
-  { "imagen", "Imagen" },
-  { "imagistics", "Imagistics" },
-  { "infoprint", "InfoPrint" },
-  { "infotec", "Infotec" },
-  { "intellitech", "Intellitech" },
-  { "kodak", "Kodak" },
-  { "konica minolta", "Minolta" },
-  { "kyocera", "Kyocera" },
-  { "kyocera mita", "Kyocera" },
-  { "lanier", "Lanier" },
-  { "lexmark international", "Lexmark" },
-  { "lexmark", "Lexmark" },
-  { "minolta", "Minolta" },
-  { "minolta qms", "Minolta" },
-  { "mitsubishi", "Mitsubishi" },
-  { "nec", "NEC" },
-  { "nrg", "NRG" },
-  { "oce", "Oce" },
-  { "oki", "Oki" },
-  { "oki data corp", "Oki" },
-  { "olivetti", "Olivetti" },
-  { "olympus", "Olympus" },
-  { "panasonic", "Panasonic" },
-  { "pcpi", "PCPI" },
-  { "pentax", "Pentax" },
-  { "qms", "QMS" },
-  { "raven", "Raven" },
-  { "raw", "Raw" },
-  { "ricoh", "Ricoh" },
-  { "samsung", "Samsung" },
-  { "savin", "Savin" },
-  { "seiko", "Seiko" },
-  { "sharp", "Sharp" },
-  { "shinko", "Shinko" },
-  { "sipix", "SiPix" },
-  { "sony", "Sony" },
-  { "star", "Star" },
-  { "tally", "Tally" },
-  { "tektronix", "Tektronix" },
-  { "texas instruments", "Texas Instruments" },
-  { "toshiba", "Toshiba" },
-  { "toshiba tec corp.", "Toshiba" },
-  { "xante", "Xante" },
-  { "xerox", "Xerox" },
-  { "zebra", "Zebra" },
-};
+/*
+ * Returns the manufacturer of a PPD as it is written in its attributes,
+ * and its length, or NULL if it has none.
+ */
+const gchar *
+get_ppd_manufacturer (const gchar *ppd_device_id,
+                      const gchar *ppd_make,
+                      gsize       *length)
+{
+  const gchar *mfg = NULL;
 
-static gpointer
-get_all_ppds_func (gpointer user_data)
+  if (ppd_device_id && ppd_device_id[0] != '\0')
+    {
+      mfg = find_tag_value (ppd_device_id, "mfg", length);
+      if (!mfg)
+        mfg = find_tag_value (ppd_device_id, "manufacturer", length);
+    }
+
+  if (!mfg &&
+      ppd_make &&
+      ppd_make[0] != '\0')
+    {
+      mfg = ppd_make;
+      *length = strlen (ppd_make);
+    }
+
+  return mfg;
+}
+
+/*
+ * Returns the display name of a known manufacturer, from its
+ * normalized name, and the normalized display name which all its
+ * names are grouped under. Returns NULL for unknown manufacturers.
+ */
+const gchar *
+lookup_standard_manufacturer (const gchar  *normalized_name,
+                              const gchar **normalized_display_name)
+{
+  guint32 slot;
+
+  slot = normalized_name_hash (normalized_name, MANUFACTURERS_HASH_SEED) &
+         (MANUFACTURERS_HASH_SIZE - 1);
+
+  if (manufacturers_hash[slot].normalized_name == NULL ||
+      strcmp (manufacturers_hash[slot].normalized_name, normalized_name) != 0)
+    return NULL;
+
+  if (normalized_display_name)
+    *normalized_display_name = manufacturers_hash[slot].normalized_display_name;
+
+  return manufacturers_hash[slot].display_name;
+}
+
+typedef struct
 {
-  ipp_attribute_t *attr;
-  GHashTable      *ppds_hash = NULL;
-  GHashTable      *manufacturers_hash = NULL;
-  GAPData         *data = (GAPData *) user_data;
-  PPDName         *item;
-  ipp_t           *request;
-  ipp_t           *response;
-  GList           *list;
-  const gchar     *ppd_make_and_model;
-  const gchar     *ppd_device_id;
-  const gchar     *ppd_name;
-  const gchar     *ppd_product;
-  const gchar     *ppd_make;
-  gchar           *mfg;
-  gchar           *mfg_normalized;
-  gchar           *mdl;
-  gchar           *manufacturer_display_name;
-  gint             i, j;
+  gchar     *display_name;
+  GPtrArray *ppds;
+} CatalogManufacturer;
+
+static void
+catalog_manufacturer_free (CatalogManufacturer *manufacturer)
+{
+  g_free (manufacturer->display_name);
+  g_ptr_array_unref (manufacturer->ppds);
+  g_free (manufacturer);
+}
+
+/*
+ * Asks cupsd for all its PPDs, and groups them by manufacturer,
+ * see PPD_CATALOG_TYPE.
+ */
+static GVariant *
+get_ppd_catalog_from_cups (void)
+{
+  CatalogManufacturer *manufacturer;
+  ipp_attribute_t     *attr;
+  GHashTable          *ppds_hash = NULL;
+  GVariant            *catalog = NULL;
+  ipp_t               *request;
+  ipp_t               *response;
+  const gchar         *ppd_make_and_model;
+  const gchar         *ppd_device_id;
+  const gchar         *ppd_name;
+  const gchar         *ppd_product;
+  const gchar         *ppd_make;
+  const gchar         *mfg;
+  const gchar         *mfg_key;
+  const gchar         *mdl;
+  const gchar         *display_name;
+  gchar               *mdl_value;
+  gchar                mfg_normalized[NORMALIZED_NAME_SIZE];
+  gsize                mfg_length;
+  gsize                mdl_length;
 
   request = ippNewRequest (CUPS_GET_PPDS);
   response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
@@ -2680,25 +2715,13 @@ get_all_ppds_func (gpointer user_data)
       ippGetStatusCode (response) <= IPP_OK_CONFLICT)
     {
       /*
-       * This hash contains names of manufacturers as keys and
-       * values are GLists of PPD names.
-       */
-      ppds_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-
-      /*
-       * This hash contains all possible names of manufacturers as keys
-       * and values are just first occurences of their equivalents.
-       * This is for mapping of e.g. "Hewlett Packard" and "HP" to the same name
-       * (the one which comes first).
+       * This hash contains normalized names of manufacturers as keys.
+       * All the names of a known manufacturer, e.g. "Hewlett Packard"
+       * and "HP", map to its normalized display name, and unknown
+       * ones are shown as they are first written.
        */
-      manufacturers_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
-
-      for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
-        {
-          g_hash_table_insert (manufacturers_hash,
-                               g_strdup (manufacturers_names[i].normalized_name),
-                               g_strdup (manufacturers_names[i].display_name));
-        }
+      ppds_hash = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, (GDestroyNotify) catalog_manufacturer_free);
 
       for (attr = ippFirstAttribute (response); attr != NULL; attr = ippNextAttribute (response))
         {
@@ -2713,9 +2736,9 @@ get_all_ppds_func (gpointer user_data)
           ppd_name = NULL;
           ppd_product = NULL;
           ppd_make = NULL;
-          mfg = NULL;
-          mfg_normalized = NULL;
+          mfg_length = 0;
           mdl = NULL;
+          mdl_value = NULL;
 
           while (attr != NULL && ippGetGroupTag (attr) == IPP_TAG_PRINTER)
             {
@@ -2739,80 +2762,60 @@ get_all_ppds_func (gpointer user_data)
             }
 
           /* Get manufacturer's name */
-          if (ppd_device_id && ppd_device_id[0] != '\0')
-            {
-              mfg = get_tag_value (ppd_device_id, "mfg");
-              if (!mfg)
-                mfg = get_tag_value (ppd_device_id, "manufacturer");
-              mfg_normalized = normalize (mfg);
-            }
-
-          if (!mfg &&
-              ppd_make &&
-              ppd_make[0] != '\0')
-            {
-              mfg = g_strdup (ppd_make);
-              mfg_normalized = normalize (ppd_make);
-            }
+          mfg = get_ppd_manufacturer (ppd_device_id, ppd_make, &mfg_length);
 
           /* Get model */
           if (ppd_make_and_model &&
               ppd_make_and_model[0] != '\0')
             {
-              mdl = g_strdup (ppd_make_and_model);
+              mdl = ppd_make_and_model;
             }
 
           if (!mdl &&
               ppd_product &&
               ppd_product[0] != '\0')
             {
-              mdl = g_strdup (ppd_product);
+              mdl = ppd_product;
             }
 
           if (!mdl &&
               ppd_device_id &&
               ppd_device_id[0] != '\0')
             {
-              mdl = get_tag_value (ppd_device_id, "mdl");
+              mdl = find_tag_value (ppd_device_id, "mdl", &mdl_length);
               if (!mdl)
-                mdl = get_tag_value (ppd_device_id, "model");
+                mdl = find_tag_value (ppd_device_id, "model", &mdl_length);
+              if (mdl)
+                mdl = mdl_value = g_strndup (mdl, mdl_length);
             }
 
           if (ppd_name && ppd_name[0] != '\0' &&
               mdl && mdl[0] != '\0' &&
-              mfg && mfg[0] != '\0')
+              mfg && mfg_length > 0)
             {
-              manufacturer_display_name = g_hash_table_lookup (manufacturers_hash, mfg_normalized);
-              if (!manufacturer_display_name)
-                {
-                  g_hash_table_insert (manufacturers_hash, g_strdup (mfg_normalized), g_strdup (mfg));
-                }
-              else
-                {
-                  g_free (mfg_normalized);
-                  mfg_normalized = normalize (manufacturer_display_name);
-                }
+              normalize_into (mfg, mfg_length, mfg_normalized, sizeof (mfg_normalized));
 
-              item = g_new0 (PPDName, 1);
-              item->ppd_name = g_strdup (ppd_name);
-              item->ppd_display_name = g_strdup (mdl);
-              item->ppd_match_level = -1;
+              mfg_key = mfg_normalized;
+              display_name = lookup_standard_manufacturer (mfg_normalized, &mfg_key);
 
-              list = g_hash_table_lookup (ppds_hash, mfg_normalized);
-              if (list)
+              manufacturer = g_hash_table_lookup (ppds_hash, mfg_key);
+              if (!manufacturer)
                 {
-                  list = g_list_append (list, item);
-                }
-              else
-                {
-                  list = g_list_append (list, item);
-                  g_hash_table_insert (ppds_hash, g_strdup (mfg_normalized), list);
+                  manufacturer = g_new0 (CatalogManufacturer, 1);
+                  manufacturer->display_name = display_name ? g_strdup (display_name) :
+                                                              g_strndup (mfg, mfg_length);
+                  manufacturer->ppds = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+                  g_hash_table_insert (ppds_hash, g_strdup (mfg_key), manufacturer);
                 }
+
+              g_ptr_array_add (manufacturer->ppds,
+                               g_variant_ref_sink (g_variant_new ("(sss)",
+                                                                  ppd_name,
+                                                                  mdl,
+                                                                  ppd_device_id ? ppd_device_id : "")));
             }
 
-          g_free (mdl);
-          g_free (mfg);
-          g_free (mfg_normalized);
+          g_free (mdl_value);
 
           if (attr == NULL)
             break;
@@ -2822,61 +2825,68 @@ get_all_ppds_func (gpointer user_data)
   if (response)
     ippDelete(response);
 
-  if (ppds_hash &&
-      manufacturers_hash)
+  if (ppds_hash)
     {
-      GHashTableIter  iter;
-      gpointer        key;
-      gpointer        value;
-      GList          *ppd_item;
-      GList          *sort_list = NULL;
+      GVariantBuilder builder;
+      GList          *sort_list;
       GList          *list_iter;
-      gchar          *name;
+      guint           i;
 
-      data->result = g_new0 (PPDList, 1);
-      data->result->num_of_manufacturers = g_hash_table_size (ppds_hash);
-      data->result->manufacturers = g_new0 (PPDManufacturerItem *, data->result->num_of_manufacturers);
-
-      g_hash_table_iter_init (&iter, ppds_hash);
-      while (g_hash_table_iter_next (&iter, &key, &value))
-        {
-          sort_list = g_list_append (sort_list, g_strdup (key));
-        }
+      g_variant_builder_init (&builder, PPD_CATALOG_TYPE);
 
       /* Sort list of manufacturers */
-      sort_list = g_list_sort (sort_list, (GCompareFunc) g_strcmp0);
+      sort_list = g_list_sort (g_hash_table_get_keys (ppds_hash), (GCompareFunc) g_strcmp0);
 
-      /*
-       * Fill resulting list of lists (list of manufacturers where
-       * each item contains list of PPD names)
-       */
-      i = 0;
       for (list_iter = sort_list; list_iter; list_iter = list_iter->next)
         {
-          name = (gchar *) list_iter->data;
-          value = g_hash_table_lookup (ppds_hash, name);
+          GVariantBuilder  ppds_builder;
+          const gchar     *name = list_iter->data;
 
-          data->result->manufacturers[i] = g_new0 (PPDManufacturerItem, 1);
-          data->result->manufacturers[i]->manufacturer_name = g_strdup (name);
-          data->result->manufacturers[i]->manufacturer_display_name = g_strdup (g_hash_table_lookup (manufacturers_hash, name));
-          data->result->manufacturers[i]->num_of_ppds = g_list_length ((GList *) value);
-          data->result->manufacturers[i]->ppds = g_new0 (PPDName *, data->result->manufacturers[i]->num_of_ppds);
+          manufacturer = g_hash_table_lookup (ppds_hash, name);
 
-          for (ppd_item = (GList *) value, j = 0; ppd_item; ppd_item = ppd_item->next, j++)
-            {
-              data->result->manufacturers[i]->ppds[j] = ppd_item->data;
-            }
+          g_variant_builder_init (&ppds_builder, G_VARIANT_TYPE ("a(sss)"));
+          for (i = 0; i < manufacturer->ppds->len; i++)
+            g_variant_builder_add_value (&ppds_builder, manufacturer->ppds->pdata[i]);
 
-          g_list_free ((GList *) value);
-
-          i++;
+          g_variant_builder_add (&builder, "(ss@a(sss))",
+                                 name,
+                                 manufacturer->display_name,
+                                 g_variant_builder_end (&ppds_builder));
         }
 
-      g_list_free_full (sort_list, g_free);
+      catalog = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+      g_list_free (sort_list);
       g_hash_table_destroy (ppds_hash);
-      g_hash_table_destroy (manufacturers_hash);
     }
 
+  return catalog;
+}
+
+static gpointer
+get_all_ppds_func (gpointer user_data)
+{
+  GAPData  *data = (GAPData *) user_data;
+  GVariant *catalog;
+  gchar    *key;
+
+  /* The list only changes when drivers are installed or removed */
+  key = pp_ppd_catalog_get_key ();
+  catalog = pp_ppd_catalog_load (key);
+
+  if (!catalog)
+    {
+      catalog = get_ppd_catalog_from_cups ();
+      if (catalog && key)
+        pp_ppd_catalog_save (key, catalog);
+    }
+
+  if (catalog)
+    data->result = pp_ppd_catalog_to_ppd_list (catalog);
+
+  data->key = key;
+  data->catalog = catalog;
+
   get_all_ppds_cb (data);
 
   return NULL;
@@ -2990,30 +3000,35 @@ ppd_list_free (PPDList *list)
     }
 }
 
-gchar *
-get_standard_manufacturers_name (gchar *name)
+void
+ppd_names_free (PPDName **names)
 {
-  gchar *normalized_name;
-  gchar *result = NULL;
-  gint   i;
+  gint i;
 
-  if (name)
+  if (names)
     {
-      normalized_name = normalize (name);
-
-      for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
+      for (i = 0; names[i]; i++)
         {
-          if (g_strcmp0 (manufacturers_names[i].normalized_name, normalized_name) == 0)
-            {
-              result = g_strdup (manufacturers_names[i].display_name);
-              break;
-            }
+          g_free (names[i]->ppd_name);
+          g_free (names[i]->ppd_display_name);
+          g_free (names[i]);
         }
 
-      g_free (normalized_name);
+      g_free (names);
     }
+}
 
-  return result;
+gchar *
+get_standard_manufacturers_name (gchar *name)
+{
+  gchar normalized_name[NORMALIZED_NAME_SIZE];
+
+  if (name == NULL)
+    return NULL;
+
+  normalize_into (name, -1, normalized_name, sizeof (normalized_name));
+
+  return g_strdup (lookup_standard_manufacturer (normalized_name, NULL));
 }
 
 typedef struct
@@ -3340,8 +3355,19 @@ typedef struct
   GCDCallback   callback;
   gpointer      user_data;
   GList        *backend_list;
+  gchar        *backend;
 } GCDData;
 
+static void
+gcd_data_free (GCDData *data)
+{
+  g_list_free_full (data->backend_list, g_free);
+  if (data->cancellable)
+    g_object_unref (data->cancellable);
+  g_free (data->backend);
+  g_free (data);
+}
+
 static gint
 get_suffix_index (gchar *string)
 {
@@ -3466,6 +3492,12 @@ get_cups_devices_async_dbus_cb (GObject      *source_object,
               g_free (devices);
             }
 
+          /* Before the callback gets to rename them */
+          pp_devices_cache_store (pp_devices_cache_get_default (),
+                                  data->backend,
+                                  result,
+                                  g_get_real_time () / G_USEC_PER_SEC);
+
           g_variant_unref (devices_variant);
         }
 
@@ -3483,12 +3515,8 @@ get_cups_devices_async_dbus_cb (GObject      *source_object,
                       g_cancellable_is_cancelled (data->cancellable),
                       data->user_data);
 
-      g_list_free_full (data->backend_list, g_free);
-      data->backend_list = NULL;
       g_object_unref (source_object);
-      if (data->cancellable)
-        g_object_unref (data->cancellable);
-      g_free (data);
+      gcd_data_free (data);
 
       return;
     }
@@ -3518,8 +3546,9 @@ get_cups_devices_async_dbus_cb (GObject      *source_object,
               exclude_scheme_builder = create_other_backends_array ();
             }
 
-          g_free (backend_name);
-          data->backend_list = g_list_remove_link (data->backend_list, data->backend_list);
+          g_free (data->backend);
+          data->backend = backend_name;
+          data->backend_list = g_list_delete_link (data->backend_list, data->backend_list);
 
           g_dbus_connection_call (G_DBUS_CONNECTION (g_object_ref (source_object)),
                                   MECHANISM_BUS,
@@ -3552,13 +3581,12 @@ get_cups_devices_async_dbus_cb (GObject      *source_object,
                           TRUE,
                           TRUE,
                           data->user_data);
-
-          g_list_free_full (data->backend_list, g_free);
-          data->backend_list = NULL;
         }
     }
   else
     {
+      pp_devices_cache_save (pp_devices_cache_get_default ());
+
       data->callback (result,
                       TRUE,
                       g_cancellable_is_cancelled (data->cancellable),
@@ -3566,9 +3594,7 @@ get_cups_devices_async_dbus_cb (GObject      *source_object,
     }
 
   g_object_unref (source_object);
-  if (data->cancellable)
-    g_object_unref (data->cancellable);
-  g_free (data);
+  gcd_data_free (data);
 }
 
 void
@@ -3603,8 +3629,8 @@ get_cups_devices_async (GCancellable *cancellable,
   g_variant_builder_init (&include_scheme_builder, G_VARIANT_TYPE ("as"));
   g_variant_builder_add (&include_scheme_builder, "s", backend_name);
 
-  g_free (backend_name);
-  data->backend_list = g_list_remove_link (data->backend_list, data->backend_list);
+  data->backend = backend_name;
+  data->backend_list = g_list_delete_link (data->backend_list, data->backend_list);
 
   g_dbus_connection_call (bus,
                           MECHANISM_BUS,
@@ -3804,14 +3830,14 @@ canonicalize_device_name (GList         *device_names,
                           PpPrintDevice *device)
 {
   PpPrintDevice             *item;
-  gboolean                   already_present;
+  GHashTable                *present_names;
   GList                     *iter;
   gsize                      len;
   gchar                     *name = NULL;
   gchar                     *new_name;
   gchar                     *lower_name;
   gchar                     *occurrence;
-  gint                       name_index, j;
+  gint                       name_index, i, j;
   static const char * const  residues[] = {
     "-foomatic",
     "-hpijs",
@@ -3864,20 +3890,21 @@ canonicalize_device_name (GList         *device_names,
   g_strstrip (name);
   g_strcanon (name, ALLOWED_CHARACTERS, '-');
 
-  /* Remove common strings found in driver names */
+  /*
+   * Remove common strings found in driver names. The name is plain
+   * ASCII by now, so its lowercase copy can be cut in step with it.
+   */
+  lower_name = g_ascii_strdown (name, -1);
   for (j = 0; j < G_N_ELEMENTS (residues); j++)
     {
-      lower_name = g_ascii_strdown (name, -1);
-
       occurrence = g_strrstr (lower_name, residues[j]);
       if (occurrence != NULL)
         {
           occurrence[0] = '\0';
-          name[strlen (lower_name)] = '\0';
+          name[occurrence - lower_name] = '\0';
         }
-
-      g_free (lower_name);
     }
+  g_free (lower_name);
 
   /* Remove trailing "-" */
   len = strlen (name);
@@ -3885,55 +3912,41 @@ canonicalize_device_name (GList         *device_names,
     name[len] = '\0';
 
   /* Merge "--" to "-" */
-  occurrence = g_strrstr (name, "--");
-  while (occurrence != NULL)
-    {
-      shift_string_left (occurrence);
-      occurrence = g_strrstr (name, "--");
-    }
+  for (i = 0, j = 0; name[i] != '\0'; i++)
+    if (name[i] != '-' || j == 0 || name[j - 1] != '-')
+      name[j++] = name[i];
+  name[j] = '\0';
 
   /* Remove leading "-" */
   if (name[0] == '-')
     shift_string_left (name);
 
-  name_index = 2;
-  already_present = FALSE;
-  do
-    {
-      if (already_present)
-        {
-          new_name = g_strdup_printf ("%s-%d", name, name_index);
-          name_index++;
-        }
-      else
-        {
-          new_name = g_strdup (name);
-        }
-
-      already_present = FALSE;
-      for (j = 0; j < num_of_dests; j++)
-        if (g_strcmp0 (dests[j].name, new_name) == 0)
-          already_present = TRUE;
+  /* The names are borrowed from the lists, which outlive the set */
+  present_names = g_hash_table_new (g_str_hash, g_str_equal);
 
-      for (iter = device_names; iter; iter = iter->next)
-        {
-          gchar *device_original_name = iter->data;
-          if (g_strcmp0 (device_original_name, new_name) == 0)
-            already_present = TRUE;
-        }
+  for (j = 0; j < num_of_dests; j++)
+    if (dests[j].name != NULL)
+      g_hash_table_add (present_names, dests[j].name);
 
-      for (iter = local_cups_devices; iter; iter = iter->next)
-        {
-          item = (PpPrintDevice *) iter->data;
-          if (g_strcmp0 (pp_print_device_get_device_original_name (item), new_name) == 0)
-            already_present = TRUE;
-        }
+  for (iter = device_names; iter; iter = iter->next)
+    if (iter->data != NULL)
+      g_hash_table_add (present_names, iter->data);
 
-      if (already_present)
-        g_free (new_name);
+  for (iter = local_cups_devices; iter; iter = iter->next)
+    {
+      item = (PpPrintDevice *) iter->data;
+      if (pp_print_device_get_device_original_name (item) != NULL)
+        g_hash_table_add (present_names, pp_print_device_get_device_original_name (item));
+    }
 
-    } while (already_present);
+  new_name = g_strdup (name);
+  for (name_index = 2; g_hash_table_contains (present_names, new_name); name_index++)
+    {
+      g_free (new_name);
+      new_name = g_strdup_printf ("%s-%d", name, name_index);
+    }
 
+  g_hash_table_unref (present_names);
   g_free (name);
 
   return new_name;
@@ -89,6 +89,8 @@ typedef struct
 gchar      *get_tag_value (const gchar *tag_string,
                            const gchar *tag_name);
 
+gchar      *normalize (const gchar *input_string);
+
 char       *get_dest_attr (const char *dest_name,
                            const char *attr);
 
@@ -176,6 +178,8 @@ void        get_all_ppds_async (GCancellable *cancellable,
 PPDList    *ppd_list_copy (PPDList *list);
 void        ppd_list_free (PPDList *list);
 
+void        ppd_names_free (PPDName **names);
+
 enum
 {
   IPP_ATTRIBUTE_TYPE_INTEGER = 0,
@@ -215,6 +219,13 @@ void        ipp_attribute_free (IPPAttribute *attr);
 
 gchar      *get_standard_manufacturers_name (gchar *name);
 
+const gchar *get_ppd_manufacturer (const gchar *ppd_device_id,
+                                   const gchar *ppd_make,
+                                   gsize       *length);
+
+const gchar *lookup_standard_manufacturer (const gchar  *normalized_name,
+                                           const gchar **normalized_display_name);
+
 typedef void (*PGPCallback) (const gchar *ppd_filename,
                              gpointer     user_data);
 
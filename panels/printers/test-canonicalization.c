@@ -5,6 +5,8 @@
 #include <locale.h>
 
 #include "pp-utils.h"
+#include "pp-normalize.h"
+#include "pp-manufacturers-table.h"
 
 static void
 test_canonicalization (gconstpointer data)
@@ -83,6 +85,135 @@ test_canonicalization (gconstpointer data)
   g_strfreev (lines);
 }
 
+/* A site sharing lots of queues of the same model */
+static void
+test_canonicalization_many (void)
+{
+  PpPrintDevice *device;
+  PpPrintDevice *local_device;
+  cups_dest_t    dests[2] = { { (char *) "Officejet-7300-3" }, { (char *) "Officejet-7300-1000" } };
+  GList         *names = NULL;
+  GList         *local_devices = NULL;
+  gchar         *name;
+  gchar         *expected;
+  gint           i, suffix = 1;
+
+  local_device = g_object_new (PP_TYPE_PRINT_DEVICE,
+                               "device-original-name", "Officejet-7300-5",
+                               NULL);
+  local_devices = g_list_append (local_devices, local_device);
+
+  device = g_object_new (PP_TYPE_PRINT_DEVICE,
+                         "device-id", "MFG:HP;MDL:Officejet 7300 series;",
+                         NULL);
+
+  for (i = 0; i < 1000; i++)
+    {
+      name = canonicalize_device_name (names, local_devices, dests, G_N_ELEMENTS (dests), device);
+
+      if (suffix == 1)
+        expected = g_strdup ("Officejet-7300");
+      else
+        expected = g_strdup_printf ("Officejet-7300-%d", suffix);
+
+      g_assert_cmpstr (name, ==, expected);
+      g_free (expected);
+
+      names = g_list_prepend (names, name);
+
+      /* Names of existing printers and local devices are skipped */
+      do
+        suffix++;
+      while (suffix == 3 || suffix == 5 || suffix == 1000);
+    }
+
+  g_list_free_full (names, g_free);
+  g_list_free_full (local_devices, g_object_unref);
+  g_object_unref (device);
+}
+
+/* The committed pp-manufacturers-hash.h has to be regenerated
+ * whenever pp-manufacturers-table.h changes */
+static void
+test_manufacturers_hash (void)
+{
+  gchar buffer[NORMALIZED_NAME_SIZE];
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
+    {
+      const gchar *normalized_display_name = NULL;
+      const gchar *display_name;
+
+      normalize_into (manufacturers_names[i].normalized_name, -1, buffer, sizeof (buffer));
+      display_name = lookup_standard_manufacturer (buffer, &normalized_display_name);
+      g_assert_cmpstr (display_name, ==, manufacturers_names[i].display_name);
+
+      normalize_into (manufacturers_names[i].display_name, -1, buffer, sizeof (buffer));
+      g_assert_cmpstr (normalized_display_name, ==, buffer);
+    }
+}
+
+typedef struct
+{
+  const gchar *device_uri;
+  const gchar *device_info;
+  const gchar *hostname;
+} HostnameTest;
+
+static const HostnameTest hostname_tests[] = {
+  { "socket://192.168.1.10:9100", NULL, "192.168.1.10" },
+  { "socket://printer.example.com", NULL, "printer.example.com" },
+  { "lpd://10.0.0.5/queue", NULL, "10.0.0.5" },
+  { "lpd://admin@print-server/lp", NULL, "print-server" },
+  { "ipp://cups.example.com:631/printers/office", NULL, "cups.example.com" },
+  { "ipps://secure.example.com/ipp/print", NULL, "secure.example.com" },
+  { "smb://fileserver/LaserJet", NULL, "fileserver" },
+  { "dnssd://Office%20Printer._ipp._tcp.local/", "Office Printer @ workstation", "workstation" },
+  { "dnssd://Office%20Printer._ipp._tcp.local/", "A @ B @ laptop", "laptop" },
+  { "dnssd://Office%20Printer._ipp._tcp.local/", "Office Printer", NULL },
+  { "dnssd://Office%20Printer._ipp._tcp.local/", NULL, NULL },
+  { "mdns://HP%20LaserJet._pdl-datastream._tcp.local", "HP LaserJet @ desktop", "desktop" },
+  { "hp:/net/HP_LaserJet_4000?ip=192.168.0.7&port=1", NULL, "192.168.0.7" },
+  { "hp:/net/HP_LaserJet_4000?ip=192.168.0.7", NULL, "192.168.0.7" },
+  { "hp:/net/HP_LaserJet_4000?zc=printer", NULL, NULL },
+  { "hpfax:/net/HP_Fax?ip=10.1.1.1", NULL, "10.1.1.1" },
+  { "hp:/usb/HP_LaserJet_4000?serial=00XYZ", NULL, NULL },
+  { "usb://HP/LaserJet%204000?serial=00XYZ", NULL, NULL },
+  { "parallel:/dev/lp0", NULL, NULL },
+  { "serial:/dev/ttyS0?baud=9600", NULL, NULL },
+  { "beh:/1/3/5/socket://10.0.0.1:9100", NULL, NULL },
+  /* A device without a URI, not the end of the table */
+  { NULL, NULL, NULL },
+};
+
+static void
+test_hostname (void)
+{
+  PpPrintDevice *device;
+  gchar         *hostname;
+  guint          i;
+
+  for (i = 0; i < G_N_ELEMENTS (hostname_tests); i++)
+    {
+      device = g_object_new (PP_TYPE_PRINT_DEVICE,
+                             "device-uri", hostname_tests[i].device_uri,
+                             "device-info", hostname_tests[i].device_info,
+                             NULL);
+
+      hostname = guess_device_hostname (device);
+      if (g_strcmp0 (hostname, hostname_tests[i].hostname) != 0)
+        g_error ("Host name for ('%s', '%s') doesn't match '%s' (got: '%s')",
+                 hostname_tests[i].device_uri, hostname_tests[i].device_info,
+                 hostname_tests[i].hostname, hostname);
+
+      g_free (hostname);
+      g_object_unref (device);
+    }
+
+  g_assert (guess_device_hostname (NULL) == NULL);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -114,6 +245,9 @@ main (int argc, char **argv)
     }
 
   g_test_add_data_func ("/printers/canonicalization", contents, test_canonicalization);
+  g_test_add_func ("/printers/canonicalization/many", test_canonicalization_many);
+  g_test_add_func ("/printers/manufacturers-hash", test_manufacturers_hash);
+  g_test_add_func ("/printers/hostname", test_hostname);
 
   return g_test_run ();
 }
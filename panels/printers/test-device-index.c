@@ -0,0 +1,181 @@
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <locale.h>
+
+#include "pp-device-index.h"
+
+typedef struct
+{
+  const gchar *name;
+  const gchar *location;
+} Device;
+
+static Device devices[] = {
+  { "HP LaserJet 4000", "Reception" },
+  { "HP OfficeJet Pro", "Kitchen" },
+  { "Canon Pixma", NULL },
+  { "Brother HL-2030", "Office 2nd floor" },
+  { "EPSON Stylus", "Office 3rd floor" },
+  { "Kyocera", "Kitchen" },
+};
+
+/* What matching looked like before the index */
+static gboolean
+brute_force_matches (Device      *device,
+                     const gchar *text)
+{
+  gboolean   result = TRUE;
+  gchar    **words;
+  gchar     *name;
+  gchar     *location;
+  gchar     *lowercase_text;
+  gint       i;
+
+  lowercase_text = g_ascii_strdown (text, -1);
+  words = g_strsplit (lowercase_text, " ", -1);
+  name = g_ascii_strdown (device->name, -1);
+  location = device->location ? g_ascii_strdown (device->location, -1) : NULL;
+
+  for (i = 0; words[i] != NULL; i++)
+    if (!strstr (name, words[i]) && (!location || !strstr (location, words[i])))
+      result = FALSE;
+
+  g_free (location);
+  g_free (name);
+  g_strfreev (words);
+  g_free (lowercase_text);
+
+  return result;
+}
+
+static void
+assert_matches (PpDeviceIndex *index,
+                const gchar   *text)
+{
+  guint n_matches = 0;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (devices); i++)
+    {
+      gboolean expected = brute_force_matches (&devices[i], text);
+
+      if (pp_device_index_matches (index, &devices[i]) != expected)
+        g_error ("\"%s\" %s match \"%s\"", devices[i].name, expected ? "does not" : "does", text);
+
+      n_matches += expected ? 1 : 0;
+    }
+
+  g_assert_cmpuint (pp_device_index_get_n_matches (index), ==, n_matches);
+}
+
+static void
+test_device_index_query (void)
+{
+  PpDeviceIndex *index;
+  const gchar   *queries[] = {
+    "", "o", "of", "off", "offi", "office", "office ", "office f", "office fl",
+    "office 3", "office", "ki", "kitchen hp", "KITCHEN", "jet", "jet 4",
+    "pixma", "pixma kitchen", "ch", "g", "  hp  ", "hl-2", "nowhere", "2nd floor",
+    "floor office", "reception 4000", "Canon"
+  };
+  guint          i;
+
+  index = pp_device_index_new ();
+  for (i = 0; i < G_N_ELEMENTS (devices); i++)
+    pp_device_index_add (index, &devices[i], devices[i].name, devices[i].location);
+
+  for (i = 0; i < G_N_ELEMENTS (queries); i++)
+    {
+      pp_device_index_set_query (index, queries[i]);
+      assert_matches (index, queries[i]);
+    }
+
+  pp_device_index_free (index);
+}
+
+static void
+test_device_index_changed (void)
+{
+  PpDeviceIndex *index;
+  guint          i;
+
+  index = pp_device_index_new ();
+  for (i = 0; i < G_N_ELEMENTS (devices); i++)
+    pp_device_index_add (index, &devices[i], devices[i].name, devices[i].location);
+
+  g_assert (!pp_device_index_set_query (index, ""));
+  g_assert (!pp_device_index_has_query (index));
+  g_assert (pp_device_index_set_query (index, "k"));
+  g_assert (pp_device_index_has_query (index));
+  g_assert (!pp_device_index_set_query (index, "k"));
+  g_assert (!pp_device_index_set_query (index, "kit"));
+  g_assert (!pp_device_index_set_query (index, "kitchen "));
+  g_assert (!pp_device_index_set_query (index, "kitchen h"));
+  g_assert (pp_device_index_set_query (index, "kitchen hp"));
+  g_assert (pp_device_index_set_query (index, NULL));
+  g_assert (!pp_device_index_has_query (index));
+
+  /* A name and a location don't make up words together */
+  g_assert (pp_device_index_set_query (index, "canon pixma"));
+  g_assert_cmpuint (pp_device_index_get_n_matches (index), ==, 1);
+  g_assert (pp_device_index_set_query (index, "pro\nkitchen"));
+  g_assert_cmpuint (pp_device_index_get_n_matches (index), ==, 0);
+  g_assert (!pp_device_index_set_query (index, "prokitchen"));
+  g_assert_cmpuint (pp_device_index_get_n_matches (index), ==, 0);
+
+  pp_device_index_free (index);
+}
+
+static void
+test_device_index_update (void)
+{
+  PpDeviceIndex *index;
+  Device         moved = { "Canon Pixma", "Kitchen" };
+  guint          i;
+
+  index = pp_device_index_new ();
+  for (i = 0; i < G_N_ELEMENTS (devices); i++)
+    pp_device_index_add (index, &devices[i], devices[i].name, devices[i].location);
+
+  pp_device_index_set_query (index, "kitchen");
+  assert_matches (index, "kitchen");
+
+  /* Devices coming and going while a query is set */
+  pp_device_index_add (index, &moved, moved.name, moved.location);
+  g_assert (pp_device_index_matches (index, &moved));
+  g_assert_cmpuint (pp_device_index_get_n_matches (index), ==, 3);
+
+  pp_device_index_add (index, &moved, moved.name, "Garage");
+  g_assert (!pp_device_index_matches (index, &moved));
+  g_assert_cmpuint (pp_device_index_get_n_matches (index), ==, 2);
+
+  pp_device_index_remove (index, &devices[1]);
+  g_assert (!pp_device_index_matches (index, &devices[1]));
+  g_assert_cmpuint (pp_device_index_get_n_matches (index), ==, 1);
+
+  /* Narrowing the query starts from what is left */
+  pp_device_index_set_query (index, "kitchen k");
+  g_assert (pp_device_index_matches (index, &devices[5]));
+  g_assert_cmpuint (pp_device_index_get_n_matches (index), ==, 1);
+
+  pp_device_index_remove (index, &moved);
+  pp_device_index_set_query (index, NULL);
+  g_assert_cmpuint (pp_device_index_get_n_matches (index), ==, G_N_ELEMENTS (devices) - 1);
+
+  pp_device_index_free (index);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/printers/device-index/query", test_device_index_query);
+  g_test_add_func ("/printers/device-index/changed", test_device_index_changed);
+  g_test_add_func ("/printers/device-index/update", test_device_index_update);
+
+  return g_test_run ();
+}
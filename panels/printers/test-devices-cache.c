@@ -0,0 +1,159 @@
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <locale.h>
+
+#include "pp-devices-cache.h"
+#include "pp-print-device.h"
+
+#define MINUTE 60
+
+static GList *
+create_devices (const gchar *first_uri,
+                ...)
+{
+  const gchar *uri;
+  va_list      args;
+  GList       *devices = NULL;
+
+  va_start (args, first_uri);
+  for (uri = first_uri; uri != NULL; uri = va_arg (args, const gchar *))
+    devices = g_list_append (devices,
+                             g_object_new (PP_TYPE_PRINT_DEVICE,
+                                           "device-uri", uri,
+                                           "device-name", "HP LaserJet 4000; Series",
+                                           "device-make-and-model", "HP LaserJet 4000; Series",
+                                           "device-id", "MFG:HP;MDL:LaserJet 4000;",
+                                           "is-network-device", g_str_has_prefix (uri, "socket:"),
+                                           NULL));
+  va_end (args);
+
+  return devices;
+}
+
+static void
+assert_uris (GList       *devices,
+             const gchar *uris)
+{
+  GString *string;
+  GList   *iter;
+
+  string = g_string_new (NULL);
+  for (iter = devices; iter != NULL; iter = iter->next)
+    {
+      if (string->len > 0)
+        g_string_append_c (string, ' ');
+      g_string_append (string, pp_print_device_get_device_uri (iter->data));
+    }
+
+  g_assert_cmpstr (string->str, ==, uris);
+
+  g_string_free (string, TRUE);
+}
+
+static void
+test_devices_cache_ttl (void)
+{
+  PpDevicesCache *cache;
+  GList          *devices;
+  gint64          start = 1400000000;
+
+  g_assert_cmpint (pp_devices_cache_get_ttl ("usb"), <, pp_devices_cache_get_ttl ("dnssd"));
+  g_assert_cmpint (pp_devices_cache_get_ttl ("other-backends"), >, 0);
+
+  cache = pp_devices_cache_new (NULL);
+
+  devices = create_devices ("usb://HP/LaserJet%204000", NULL);
+  pp_devices_cache_store (cache, "usb", devices, start);
+  g_list_free_full (devices, g_object_unref);
+
+  devices = create_devices ("socket://10.0.0.2", "socket://10.0.0.3", NULL);
+  pp_devices_cache_store (cache, "socket", devices, start);
+  g_list_free_full (devices, g_object_unref);
+
+  devices = pp_devices_cache_lookup (cache, start + 1);
+  assert_uris (devices, "usb://HP/LaserJet%204000 socket://10.0.0.2 socket://10.0.0.3");
+  g_list_free_full (devices, g_object_unref);
+
+  /* A backend answering again replaces what it found before */
+  devices = create_devices ("socket://10.0.0.4", NULL);
+  pp_devices_cache_store (cache, "socket", devices, start + MINUTE / 2);
+  g_list_free_full (devices, g_object_unref);
+
+  devices = pp_devices_cache_lookup (cache, start + MINUTE / 2);
+  assert_uris (devices, "usb://HP/LaserJet%204000 socket://10.0.0.4");
+  g_list_free_full (devices, g_object_unref);
+
+  /* USB devices don't stay as long as network ones */
+  devices = pp_devices_cache_lookup (cache, start + 5 * MINUTE);
+  assert_uris (devices, "socket://10.0.0.4");
+  g_list_free_full (devices, g_object_unref);
+
+  devices = pp_devices_cache_lookup (cache, start + 60 * MINUTE);
+  g_assert (devices == NULL);
+
+  pp_devices_cache_free (cache);
+}
+
+static void
+test_devices_cache_save (void)
+{
+  PpDevicesCache *cache;
+  PpPrintDevice  *device;
+  GError         *error = NULL;
+  GList          *devices;
+  gchar          *dir;
+  gchar          *path;
+  gint64          start = 1400000000;
+
+  dir = g_dir_make_tmp ("test-devices-cache-XXXXXX", &error);
+  g_assert_no_error (error);
+  path = g_build_filename (dir, "cups-devices", NULL);
+
+  cache = pp_devices_cache_new (path);
+
+  devices = create_devices ("usb://HP/LaserJet%204000", "socket://10.0.0.2", NULL);
+  g_object_set (devices->data, "device-location", "Kitchen", NULL);
+  pp_devices_cache_store (cache, "other-backends", devices, start);
+  g_list_free_full (devices, g_object_unref);
+
+  pp_devices_cache_save (cache);
+  pp_devices_cache_free (cache);
+
+  cache = pp_devices_cache_new (path);
+
+  devices = pp_devices_cache_lookup (cache, start + MINUTE);
+  assert_uris (devices, "usb://HP/LaserJet%204000 socket://10.0.0.2");
+
+  device = devices->data;
+  g_assert_cmpstr (pp_print_device_get_device_name (device), ==, "HP LaserJet 4000; Series");
+  g_assert_cmpstr (pp_print_device_get_device_id (device), ==, "MFG:HP;MDL:LaserJet 4000;");
+  g_assert_cmpstr (pp_print_device_get_device_location (device), ==, "Kitchen");
+  g_assert (pp_print_device_get_device_info (device) == NULL);
+  g_assert (!pp_print_device_is_network_device (device));
+
+  device = devices->next->data;
+  g_assert (pp_print_device_get_device_location (device) == NULL);
+  g_assert (pp_print_device_is_network_device (device));
+
+  g_list_free_full (devices, g_object_unref);
+  pp_devices_cache_free (cache);
+
+  g_unlink (path);
+  g_rmdir (dir);
+  g_free (path);
+  g_free (dir);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/printers/devices-cache/ttl", test_devices_cache_ttl);
+  g_test_add_func ("/printers/devices-cache/save", test_devices_cache_save);
+
+  return g_test_run ();
+}
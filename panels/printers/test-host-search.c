@@ -0,0 +1,421 @@
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <locale.h>
+
+#include "pp-host-search.h"
+
+/*
+ * The scheduling is checked with fake probes which find one device
+ * each after a delay, and the JetDirect and LPD probes against local
+ * responders.
+ */
+
+typedef struct
+{
+  guint        delay;
+  const gchar *device_uri;
+} FakeProbe;
+
+static const FakeProbe *fake_probes;
+static guint            n_started;
+static guint            n_running;
+static guint            max_running;
+
+static gboolean
+fake_probe_return (gpointer user_data)
+{
+  const FakeProbe *fake;
+  PpDevicesList   *devices;
+  GTask           *task = G_TASK (user_data);
+
+  fake = g_task_get_task_data (task);
+  n_running--;
+
+  devices = g_new0 (PpDevicesList, 1);
+  devices->devices = g_list_append (NULL, g_object_new (PP_TYPE_PRINT_DEVICE,
+                                                        "device-uri", fake->device_uri,
+                                                        "device-name", fake->device_uri,
+                                                        NULL));
+
+  g_task_return_pointer (task, devices, (GDestroyNotify) pp_devices_list_free);
+  g_object_unref (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+fake_probe_start (const gchar         *scheme,
+                  const gchar         *hostname,
+                  gint                 port,
+                  GCancellable        *cancellable,
+                  GAsyncReadyCallback  callback,
+                  gpointer             user_data)
+{
+  const FakeProbe *fake = &fake_probes[n_started++];
+  GTask           *task;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_task_data (task, (gpointer) fake, NULL);
+
+  n_running++;
+  max_running = MAX (max_running, n_running);
+
+  g_timeout_add (fake->delay, fake_probe_return, task);
+}
+
+static PpDevicesList *
+fake_probe_finish (GObject       *source_object,
+                   GAsyncResult  *result,
+                   GError       **error)
+{
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static PpHostSearch *
+fake_search_new (const FakeProbe *fakes,
+                 const guint     *timeouts,
+                 guint            n_fakes)
+{
+  PpHostSearch *search;
+  PpHostProbe  *probes;
+  guint         i;
+
+  fake_probes = fakes;
+  n_started = 0;
+  n_running = 0;
+  max_running = 0;
+
+  probes = g_new0 (PpHostProbe, n_fakes);
+  for (i = 0; i < n_fakes; i++)
+    {
+      probes[i].name = fakes[i].device_uri;
+      probes[i].timeout = timeouts[i];
+      probes[i].start = fake_probe_start;
+      probes[i].finish = fake_probe_finish;
+    }
+
+  search = pp_host_search_new_with_probes (probes, n_fakes);
+  g_free (probes);
+
+  return search;
+}
+
+typedef struct
+{
+  GMainLoop *loop;
+  GPtrArray *device_uris;
+  guint      n_emissions;
+  gboolean   finished;
+} SearchResult;
+
+static void
+devices_found_cb (PpHostSearch *search,
+                  GList        *devices,
+                  gpointer      user_data)
+{
+  SearchResult *result = user_data;
+  GList        *iter;
+
+  for (iter = devices; iter != NULL; iter = iter->next)
+    g_ptr_array_add (result->device_uris,
+                     g_strdup (pp_print_device_get_device_uri (iter->data)));
+
+  result->n_emissions++;
+}
+
+static void
+finished_cb (PpHostSearch *search,
+             gpointer      user_data)
+{
+  SearchResult *result = user_data;
+
+  result->finished = TRUE;
+  g_main_loop_quit (result->loop);
+}
+
+static gboolean
+quit_cb (gpointer user_data)
+{
+  g_main_loop_quit (user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+search_result_init (SearchResult *result,
+                    PpHostSearch *search)
+{
+  result->loop = g_main_loop_new (NULL, FALSE);
+  result->device_uris = g_ptr_array_new_with_free_func (g_free);
+  result->n_emissions = 0;
+  result->finished = FALSE;
+
+  g_signal_connect (search, "devices-found", G_CALLBACK (devices_found_cb), result);
+  g_signal_connect (search, "finished", G_CALLBACK (finished_cb), result);
+}
+
+static void
+search_result_wait (SearchResult *result)
+{
+  guint id;
+
+  id = g_timeout_add_seconds (10, quit_cb, result->loop);
+  g_main_loop_run (result->loop);
+  if (result->finished)
+    g_source_remove (id);
+}
+
+static void
+search_result_clear (SearchResult *result)
+{
+  g_main_loop_unref (result->loop);
+  g_ptr_array_unref (result->device_uris);
+}
+
+static void
+test_pool (void)
+{
+  static const FakeProbe fakes[] = {
+    { 50, "ipp://fake/1" },
+    { 50, "ipp://fake/2" },
+    { 50, "ipp://fake/3" },
+    { 50, "ipp://fake/4" },
+    { 50, "ipp://fake/5" },
+  };
+  static const guint timeouts[] = { 5000, 5000, 5000, 5000, 5000 };
+  PpHostSearch *search;
+  SearchResult  result;
+  guint         i;
+
+  search = fake_search_new (fakes, timeouts, G_N_ELEMENTS (fakes));
+  g_object_set (search, "max-probes", 2, NULL);
+  search_result_init (&result, search);
+
+  pp_host_search_start (search, NULL, "fake", PP_HOST_UNSET_PORT);
+  g_assert (pp_host_search_is_searching (search));
+  g_assert_cmpuint (n_started, ==, 2);
+
+  search_result_wait (&result);
+
+  g_assert (result.finished);
+  g_assert (!pp_host_search_is_searching (search));
+  g_assert_cmpuint (max_running, ==, 2);
+
+  /* Each probe's devices come as soon as it is done */
+  g_assert_cmpuint (result.n_emissions, ==, G_N_ELEMENTS (fakes));
+  g_assert_cmpuint (result.device_uris->len, ==, G_N_ELEMENTS (fakes));
+  for (i = 0; i < G_N_ELEMENTS (fakes); i++)
+    g_assert_cmpstr (result.device_uris->pdata[i], ==, fakes[i].device_uri);
+
+  search_result_clear (&result);
+  g_object_unref (search);
+}
+
+static gboolean
+search_again_cb (gpointer user_data)
+{
+  pp_host_search_start (PP_HOST_SEARCH (user_data), NULL, "FAKE", PP_HOST_UNSET_PORT);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+test_dedupe (void)
+{
+  static const FakeProbe fakes[] = {
+    { 50, "ipp://fake/a" },
+    { 100, "ipp://fake/a" },
+    { 150, "ipp://fake/b" },
+  };
+  static const guint timeouts[] = { 5000, 5000, 5000 };
+  PpHostSearch *search;
+  SearchResult  result;
+
+  search = fake_search_new (fakes, timeouts, G_N_ELEMENTS (fakes));
+  search_result_init (&result, search);
+
+  pp_host_search_start (search, NULL, "fake", PP_HOST_UNSET_PORT);
+
+  /* Searching the same host again keeps the search going */
+  g_timeout_add (75, search_again_cb, search);
+
+  search_result_wait (&result);
+
+  g_assert (result.finished);
+  g_assert_cmpuint (n_started, ==, G_N_ELEMENTS (fakes));
+
+  /* The device found before the second start is announced again,
+   * and the one two probes find only once */
+  g_assert_cmpuint (result.n_emissions, ==, 3);
+  g_assert_cmpuint (result.device_uris->len, ==, 3);
+  g_assert_cmpstr (result.device_uris->pdata[0], ==, "ipp://fake/a");
+  g_assert_cmpstr (result.device_uris->pdata[1], ==, "ipp://fake/a");
+  g_assert_cmpstr (result.device_uris->pdata[2], ==, "ipp://fake/b");
+
+  search_result_clear (&result);
+  g_object_unref (search);
+}
+
+static void
+test_timeouts (void)
+{
+  static const FakeProbe fakes[] = {
+    { 2000, "ipp://fake/slow" },
+    { 10, "ipp://fake/fast" },
+  };
+  static const guint timeouts[] = { 50, 1000 };
+  static const guint no_timeouts[] = { 0, 0 };
+  PpHostSearch *search;
+  SearchResult  result;
+  gint64        start;
+
+  search = fake_search_new (fakes, timeouts, G_N_ELEMENTS (fakes));
+  search_result_init (&result, search);
+
+  start = g_get_monotonic_time ();
+  pp_host_search_start (search, NULL, "fake", PP_HOST_UNSET_PORT);
+  search_result_wait (&result);
+
+  g_assert (result.finished);
+  g_assert_cmpint (g_get_monotonic_time () - start, <, 1000 * G_TIME_SPAN_MILLISECOND);
+  g_assert_cmpuint (result.device_uris->len, ==, 1);
+  g_assert_cmpstr (result.device_uris->pdata[0], ==, "ipp://fake/fast");
+
+  search_result_clear (&result);
+  g_object_unref (search);
+
+  /* The whole search is given up at its deadline */
+  search = fake_search_new (fakes, no_timeouts, G_N_ELEMENTS (fakes));
+  g_object_set (search, "deadline", 100, NULL);
+  search_result_init (&result, search);
+
+  start = g_get_monotonic_time ();
+  pp_host_search_start (search, NULL, "fake", PP_HOST_UNSET_PORT);
+  search_result_wait (&result);
+
+  g_assert (result.finished);
+  g_assert_cmpint (g_get_monotonic_time () - start, <, 1000 * G_TIME_SPAN_MILLISECOND);
+  g_assert_cmpuint (result.device_uris->len, ==, 1);
+  g_assert_cmpstr (result.device_uris->pdata[0], ==, "ipp://fake/fast");
+
+  search_result_clear (&result);
+  g_object_unref (search);
+}
+
+static gboolean
+jetdirect_incoming_cb (GSocketService    *service,
+                       GSocketConnection *connection,
+                       GObject           *source_object,
+                       gpointer           user_data)
+{
+  /* Accepting the connection is all a JetDirect printer is probed for */
+  return TRUE;
+}
+
+/* Only knows the "lp" queue, see RFC 1179 */
+static gboolean
+lpd_run_cb (GThreadedSocketService *service,
+            GSocketConnection      *connection,
+            GObject                *source_object,
+            gpointer                user_data)
+{
+  GOutputStream *output;
+  GInputStream  *input;
+  gssize         length;
+  gchar          buffer[1024];
+  gchar          reply;
+
+  input = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+  output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+  length = g_input_stream_read (input, buffer, sizeof (buffer) - 1, NULL, NULL);
+  if (length <= 0 || buffer[0] != '\2')
+    return TRUE;
+
+  buffer[length] = '\0';
+  buffer[strcspn (buffer, "\n")] = '\0';
+
+  reply = g_strcmp0 (buffer + 1, "lp") == 0 ? '\0' : '\1';
+  g_output_stream_write (output, &reply, 1, NULL, NULL);
+
+  return TRUE;
+}
+
+static void
+run_responder_test (GSocketService *service,
+                    gint            probe,
+                    const gchar    *scheme,
+                    const gchar    *expected_uri)
+{
+  PpHostSearch *search;
+  SearchResult  result;
+  GError       *error = NULL;
+  gchar        *device_uri;
+  guint16       port;
+
+  port = g_socket_listener_add_any_inet_port (G_SOCKET_LISTENER (service), NULL, &error);
+  g_assert_no_error (error);
+
+  search = pp_host_search_new_with_probes (&pp_host_search_get_default_probes ()[probe], 1);
+  search_result_init (&result, search);
+
+  pp_host_search_start (search, scheme, "127.0.0.1", port);
+  search_result_wait (&result);
+
+  g_assert (result.finished);
+  g_assert_cmpuint (result.device_uris->len, ==, 1);
+
+  device_uri = g_strdup_printf (expected_uri, port);
+  g_assert_cmpstr (result.device_uris->pdata[0], ==, device_uri);
+  g_free (device_uri);
+
+  search_result_clear (&result);
+  g_object_unref (search);
+
+  g_socket_service_stop (service);
+  g_socket_listener_close (G_SOCKET_LISTENER (service));
+}
+
+static void
+test_jetdirect (void)
+{
+  GSocketService *service;
+
+  service = g_socket_service_new ();
+  g_signal_connect (service, "incoming", G_CALLBACK (jetdirect_incoming_cb), NULL);
+
+  run_responder_test (service, PP_HOST_PROBE_JETDIRECT, "socket", "socket://127.0.0.1:%u");
+
+  g_object_unref (service);
+}
+
+static void
+test_lpd (void)
+{
+  GSocketService *service;
+
+  service = g_threaded_socket_service_new (4);
+  g_signal_connect (service, "run", G_CALLBACK (lpd_run_cb), NULL);
+
+  run_responder_test (service, PP_HOST_PROBE_LPD, "lpd", "lpd://127.0.0.1:%u/lp");
+
+  g_object_unref (service);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/printers/host-search/pool", test_pool);
+  g_test_add_func ("/printers/host-search/dedupe", test_dedupe);
+  g_test_add_func ("/printers/host-search/timeouts", test_timeouts);
+  g_test_add_func ("/printers/host-search/jetdirect", test_jetdirect);
+  g_test_add_func ("/printers/host-search/lpd", test_lpd);
+
+  return g_test_run ();
+}
@@ -0,0 +1,108 @@
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <locale.h>
+
+#include "pp-markers.h"
+
+#define DAY (24 * 60 * 60)
+
+static void
+test_markers_parse (void)
+{
+  GPtrArray *markers;
+  PpMarker  *marker;
+
+  markers = pp_markers_parse ("Black,Cyan,Waste,Yellow",
+                              "#000000,#00ffff,none,#ffff00",
+                              "toner,tonerCartridge,wasteToner,ink",
+                              "40,80,10,-1");
+
+  g_assert_cmpuint (markers->len, ==, 3);
+
+  marker = markers->pdata[0];
+  g_assert_cmpstr (marker->name, ==, "Cyan");
+  g_assert_cmpstr (marker->color, ==, "#00ffff");
+  g_assert_cmpint (marker->level, ==, 80);
+
+  marker = markers->pdata[1];
+  g_assert_cmpstr (marker->name, ==, "Black");
+  g_assert_cmpstr (marker->type, ==, "toner");
+  g_assert_cmpint (marker->level, ==, 40);
+
+  marker = markers->pdata[2];
+  g_assert_cmpstr (marker->name, ==, "Yellow");
+  g_assert_cmpint (marker->level, ==, -1);
+
+  g_ptr_array_unref (markers);
+
+  /* The options have to describe the same markers */
+  markers = pp_markers_parse ("Black,Cyan", "#000000", "toner,toner", "40,80");
+  g_assert_cmpuint (markers->len, ==, 0);
+  g_ptr_array_unref (markers);
+
+  markers = pp_markers_parse (NULL, "#000000", "toner", "40");
+  g_assert_cmpuint (markers->len, ==, 0);
+  g_ptr_array_unref (markers);
+}
+
+static void
+test_supply_history (void)
+{
+  PpSupplyHistory *history;
+  GError          *error = NULL;
+  gchar           *dir;
+  gchar           *path;
+  gint64           start = 1400000000;
+
+  dir = g_dir_make_tmp ("test-markers-XXXXXX", &error);
+  g_assert_no_error (error);
+  path = g_build_filename (dir, "supply-history", NULL);
+
+  history = pp_supply_history_new (path);
+
+  /* Unchanged and unknown levels aren't recorded */
+  g_assert (pp_supply_history_add_sample (history, "Office [2nd floor]", "Black=K", start, 90));
+  g_assert (!pp_supply_history_add_sample (history, "Office [2nd floor]", "Black=K", start + DAY / 2, 90));
+  g_assert (!pp_supply_history_add_sample (history, "Office [2nd floor]", "Black=K", start + DAY / 2, -1));
+
+  /* Not before a day of history */
+  g_assert_cmpint (pp_supply_history_estimate_days_left (history, "Office [2nd floor]", "Black=K", start), ==, -1);
+
+  /* 10% a day, from 90% */
+  g_assert (pp_supply_history_add_sample (history, "Office [2nd floor]", "Black=K", start + 2 * DAY, 70));
+  g_assert (pp_supply_history_add_sample (history, "Office [2nd floor]", "Black=K", start + 4 * DAY, 50));
+  g_assert_cmpint (pp_supply_history_estimate_days_left (history, "Office [2nd floor]", "Black=K", start + 4 * DAY), ==, 5);
+  g_assert_cmpint (pp_supply_history_estimate_days_left (history, "Office [2nd floor]", "Black=K", start + 20 * DAY), ==, 0);
+
+  pp_supply_history_save (history);
+  pp_supply_history_free (history);
+
+  history = pp_supply_history_new (path);
+  g_assert_cmpint (pp_supply_history_estimate_days_left (history, "Office [2nd floor]", "Black=K", start + 4 * DAY), ==, 5);
+  g_assert_cmpint (pp_supply_history_estimate_days_left (history, "Office [2nd floor]", "Cyan", start + 4 * DAY), ==, -1);
+
+  /* A refill starts the history over */
+  g_assert (pp_supply_history_add_sample (history, "Office [2nd floor]", "Black=K", start + 5 * DAY, 100));
+  g_assert_cmpint (pp_supply_history_estimate_days_left (history, "Office [2nd floor]", "Black=K", start + 5 * DAY), ==, -1);
+
+  pp_supply_history_free (history);
+
+  g_unlink (path);
+  g_rmdir (dir);
+  g_free (path);
+  g_free (dir);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/printers/markers/parse", test_markers_parse);
+  g_test_add_func ("/printers/markers/history", test_supply_history);
+
+  return g_test_run ();
+}
@@ -0,0 +1,127 @@
+#include "config.h"
+
+#include <glib.h>
+#include <locale.h>
+
+#include "pp-ppd-index.h"
+
+static const gchar *
+get_match_level_name (gint match_level)
+{
+  switch (match_level)
+    {
+      case PPD_EXACT_CMD_MATCH:
+        return "exact-cmd";
+      case PPD_EXACT_MATCH:
+        return "exact";
+      case PPD_CLOSE_MATCH:
+        return "close";
+      case PPD_GENERIC_MATCH:
+        return "generic";
+      default:
+        return "none";
+    }
+}
+
+static void
+test_ppd_index (gconstpointer data)
+{
+  PpPPDIndex  *index;
+  GVariant    *catalog;
+  GError      *error = NULL;
+  gchar       *contents;
+  gchar      **lines;
+  guint        i;
+
+  if (!g_file_get_contents (TEST_SRCDIR "/ppd-index-catalog.txt", &contents, NULL, &error))
+    {
+      g_warning ("Failed to load the catalog: %s", error->message);
+      g_error_free (error);
+      g_test_fail ();
+      return;
+    }
+
+  catalog = g_variant_parse (G_VARIANT_TYPE ("a(ssa(sss))"), contents, NULL, NULL, &error);
+  g_free (contents);
+  if (catalog == NULL)
+    {
+      g_warning ("Failed to parse the catalog: %s", error->message);
+      g_error_free (error);
+      g_test_fail ();
+      return;
+    }
+
+  index = pp_ppd_index_new (catalog);
+  g_variant_unref (catalog);
+
+  lines = g_strsplit (data, "\n", -1);
+  for (i = 0; lines[i] != NULL; i++)
+    {
+      PPDName  **names;
+      gchar    **items;
+
+      if (*lines[i] == '#')
+        continue;
+
+      if (*lines[i] == '\0')
+        break;
+
+      items = g_strsplit (lines[i], "\t", -1);
+      if (g_strv_length (items) == 3)
+        {
+          const gchar *ppd_name = NULL;
+          const gchar *match_level = "none";
+
+          names = pp_ppd_index_lookup (index, items[0], 0);
+          if (names)
+            {
+              ppd_name = names[0]->ppd_name;
+              match_level = get_match_level_name (names[0]->ppd_match_level);
+            }
+
+          if (g_strcmp0 (ppd_name ? ppd_name : "", items[1]) != 0 ||
+              g_strcmp0 (match_level, items[2]) != 0)
+            {
+              g_error ("Result for '%s' doesn't match '%s' (%s) (got: '%s' (%s))",
+                       items[0], items[1], items[2], ppd_name, match_level);
+              g_test_fail ();
+            }
+          else
+            {
+              g_debug ("Result for '%s' matches '%s' (%s)",
+                       items[0], items[1], items[2]);
+            }
+
+          ppd_names_free (names);
+        }
+      else
+        {
+          g_warning ("Line number %u has not correct number of items!", i);
+          g_test_fail ();
+        }
+
+      g_strfreev (items);
+    }
+
+  g_strfreev (lines);
+  pp_ppd_index_free (index);
+}
+
+int
+main (int argc, char **argv)
+{
+  char *contents;
+
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, NULL);
+
+  if (g_file_get_contents (TEST_SRCDIR "/ppd-index-test.txt", &contents, NULL, NULL) == FALSE)
+    {
+      g_warning ("Failed to load '%s'", TEST_SRCDIR "/ppd-index-test.txt");
+      return 1;
+    }
+
+  g_test_add_data_func ("/printers/ppd-index", contents, test_ppd_index);
+
+  return g_test_run ();
+}